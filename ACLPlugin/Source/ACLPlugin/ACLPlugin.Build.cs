@@ -25,6 +25,7 @@ namespace UnrealBuildTool.Rules
 			if (Target.bBuildEditor)
 			{
 				PrivateDependencyModuleNames.Add("DesktopPlatform");
+				PrivateDependencyModuleNames.Add("TargetPlatform");
 				PrivateDependencyModuleNames.Add("UnrealEd");
 
 				PublicIncludePaths.Add(Path.Combine(ACLSDKDir, "acl/external/sjson-cpp/includes"));
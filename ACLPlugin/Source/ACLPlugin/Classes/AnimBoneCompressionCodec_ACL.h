@@ -3,6 +3,7 @@
 // Copyright 2018 Nicholas Frechette. All Rights Reserved.
 
 #include "CoreMinimal.h"
+#include "PerPlatformProperties.h"
 #include "UObject/ObjectMacros.h"
 #include "AnimBoneCompressionCodec_ACLBase.h"
 #include "AnimBoneCompressionCodec_ACL.generated.h"
@@ -25,6 +26,10 @@ class UAnimBoneCompressionCodec_ACL : public UAnimBoneCompressionCodec_ACLBase
 	UPROPERTY(EditAnywhere, Category = "ACL Options")
 	TArray<class USkeletalMesh*> OptimizationTargets;
 
+	/** The proportion of keyframes to strip from every sequence, by order of least importance. Stripped keyframes are lost, this trades visual fidelity for a lower memory footprint. */
+	UPROPERTY(EditAnywhere, Category = "ACL Options", meta = (ClampMin = "0", ClampMax = "1"))
+	FPerPlatformFloat KeyframeStrippingProportion;
+
 	//////////////////////////////////////////////////////////////////////////
 	// UObject implementation
 	virtual void PostInitProperties() override;
@@ -37,6 +42,7 @@ class UAnimBoneCompressionCodec_ACL : public UAnimBoneCompressionCodec_ACLBase
 	// UAnimBoneCompressionCodec_ACLBase implementation
 	virtual void GetCompressionSettings(acl::compression_settings& OutSettings) const override;
 	virtual TArray<class USkeletalMesh*> GetOptimizationTargets() const override { return OptimizationTargets; }
+	virtual float GetKeyframeStrippingProportion() const override;
 	virtual ACLSafetyFallbackResult ExecuteSafetyFallback(acl::iallocator& Allocator, const acl::compression_settings& Settings, const acl::track_array_qvvf& RawClip, const acl::track_array_qvvf& BaseClip, const acl::compressed_tracks& CompressedClipData, const FCompressibleAnimData& CompressibleAnimData, FCompressibleAnimDataResult& OutResult);
 #endif
 
@@ -0,0 +1,65 @@
+#pragma once
+
+// Copyright 2020 Nicholas Frechette. All Rights Reserved.
+
+#include "CoreMinimal.h"
+#include "UObject/ObjectMacros.h"
+#include "AnimBoneCompressionCodec_ACLBase.h"
+#include "AnimBoneCompressionCodec_ACLAuto.generated.h"
+
+/** A set of compression settings the auto codec considers for every sequence. */
+USTRUCT()
+struct FACLAutoCandidate
+{
+	GENERATED_BODY()
+
+	/** The rotation format to use. Translations and scales always use a variable bit rate. */
+	UPROPERTY(EditAnywhere, Category = Clip)
+	TEnumAsByte<ACLRotationFormat> RotationFormat = ACLRF_QuatDropW_Variable;
+
+	/** The ideal number of key frames to retain per segment for each track. */
+	UPROPERTY(EditAnywhere, Category = Segmenting, meta = (ClampMin = "8"))
+	uint16 IdealNumKeyFramesPerSegment = 16;
+
+	/** The maximum number of key frames to retain per segment for each track. */
+	UPROPERTY(EditAnywhere, Category = Segmenting, meta = (ClampMin = "8"))
+	uint16 MaxNumKeyFramesPerSegment = 31;
+};
+
+/** The auto codec implementation for ACL support. Every sequence is compressed with a set of candidate settings and the best one is retained. */
+UCLASS(MinimalAPI, config = Engine, meta = (DisplayName = "Anim Compress ACL Auto"))
+class UAnimBoneCompressionCodec_ACLAuto : public UAnimBoneCompressionCodec_ACLBase
+{
+	GENERATED_UCLASS_BODY()
+
+#if WITH_EDITORONLY_DATA
+	/** The candidate settings to compress every sequence with. */
+	UPROPERTY(EditAnywhere, Category = "ACL Options")
+	TArray<FACLAutoCandidate> Candidates;
+
+	/** How much decompression speed matters relative to the memory footprint when selecting a candidate. 0 retains the smallest candidate, 1 retains the fastest to decompress. */
+	UPROPERTY(EditAnywhere, Category = "ACL Options", meta = (ClampMin = "0", ClampMax = "1"))
+	float DecodeSpeedWeight;
+
+	/** The skeletal meshes used to estimate the skinning deformation during compression. */
+	UPROPERTY(EditAnywhere, Category = "ACL Options")
+	TArray<class USkeletalMesh*> OptimizationTargets;
+
+	//////////////////////////////////////////////////////////////////////////
+
+	// UAnimBoneCompressionCodec implementation
+	virtual void PopulateDDCKey(FArchive& Ar) override;
+
+	// UAnimBoneCompressionCodec_ACLBase implementation
+	virtual void GetCompressionSettings(acl::compression_settings& OutSettings) const override;
+	virtual void SelectCompressionSettings(const FCompressibleAnimData& CompressibleAnimData, const acl::track_array_qvvf& ACLTracks, const acl::track_array_qvvf& ACLBaseTracks, float SequenceErrorThreshold, acl::compression_settings& OutSettings) const override;
+	virtual TArray<class USkeletalMesh*> GetOptimizationTargets() const override { return OptimizationTargets; }
+
+	// Our implementation
+	void GetCandidateCompressionSettings(const FACLAutoCandidate& Candidate, acl::compression_settings& OutSettings) const;
+#endif
+
+	// UAnimBoneCompressionCodec implementation
+	virtual void DecompressPose(FAnimSequenceDecompressionContext& DecompContext, const BoneTrackArray& RotationPairs, const BoneTrackArray& TranslationPairs, const BoneTrackArray& ScalePairs, TArrayView<FTransform>& OutAtoms) const override;
+	virtual void DecompressBone(FAnimSequenceDecompressionContext& DecompContext, int32 TrackIndex, FTransform& OutAtom) const override;
+};
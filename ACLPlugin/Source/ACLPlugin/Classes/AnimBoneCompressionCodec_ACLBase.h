@@ -3,10 +3,12 @@
 // Copyright 2018 Nicholas Frechette. All Rights Reserved.
 
 #include "CoreMinimal.h"
+#include "PerPlatformProperties.h"
 #include "UObject/ObjectMacros.h"
 #include "Animation/AnimBoneCompressionCodec.h"
 
 #include "ACLImpl.h"
+#include "ACLStreamedClipData.h"
 
 #if WITH_EDITORONLY_DATA
 #include <acl/compression/compression_settings.h>
@@ -32,12 +34,112 @@ struct FACLCompressedAnimData final : public ICompressedAnimData
 	/** Holds the compressed_tracks instance */
 	TArrayView<uint8> CompressedByteStream;
 
+	/** Owns the compressed_tracks instance when it was compressed or loaded directly from the archive, the engine byte stream is always empty. */
+	TArray<uint8, TAlignedHeapAllocator<16>> OwnedByteStream;
+
+	/** Whether or not our byte stream was allocated from the resident data region, it is freed when we rebind or are destroyed. */
+	bool bIsInResidentDataRegion = false;
+
+	/** Holds the compressed_tracks instance on disk when it was cooked as separately streamed bulk data. Our byte stream is only bound while it is resident. */
+	TUniquePtr<FACLStreamedClipData> StreamedData;
+
+#if WITH_EDITORONLY_DATA
+	/** Whether or not to cook our compressed data as separately streamed bulk data. */
+	bool bStreamWhenCooked = false;
+
+	/** Holds our compressed data while a cooked package saves, the linker writes it once the package is done. */
+	FByteBulkData CookedStreamedBulkData;
+#endif
+
+	/** The estimated cost to decompress a whole pose, in decode cost units. Computed once bound, on first use. */
+	mutable float DecodeCostUnits = -1.0f;
+
+	/** Identifies our anim sequence in usage profiles, see GetACLSequenceUsageKey. */
+	uint32 SequenceUsageKey = 0;
+
+	/** Whether or not our compressed data was bound to a database when compressed, its stripped keyframes then require database decompression settings. Cached when bound. */
+	bool bHasDatabase = false;
+
 	const acl::compressed_tracks* GetCompressedTracks() const { return acl::make_compressed_tracks(CompressedByteStream.GetData()); }
 
+	/** Returns whether or not our compressed data is resident. Streamed data that isn't resident is requested, it can't be decompressed until it streams in. */
+	bool RequestCompressedData() const { return StreamedData == nullptr || StreamedData->Request(); }
+
+	/** Like RequestCompressedData() but resident streamed data can't stream out until EndReadCompressedData() is called. */
+	bool BeginReadCompressedData() const { return StreamedData == nullptr || StreamedData->BeginRead(); }
+	void EndReadCompressedData() const { if (StreamedData != nullptr) { StreamedData->EndRead(); } }
+
+	/** Returns the estimated cost to decompress a whole pose, in decode cost units. */
+	ACLPLUGIN_API float GetDecodeCostUnits() const;
+
+	/** Caches the properties of the compressed data we are bound to, must be called whenever we bind to new compressed data. */
+	void CacheCompressedDataProperties();
+
+	virtual ~FACLCompressedAnimData();
+
 	// ICompressedAnimData implementation
-	virtual void Bind(const TArrayView<uint8> BulkData) override { CompressedByteStream = BulkData; }
+	virtual void SerializeCompressedData(FArchive& Ar) override;
+	virtual void Bind(const TArrayView<uint8> BulkData) override;
 	virtual int64 GetApproxCompressedSize() const override { return CompressedByteStream.Num(); }
 	virtual bool IsValid() const override;
+
+private:
+	void SerializeStreamedData(FArchive& Ar, UObject* Owner);
+
+	/** Frees our byte stream when it lives in the resident data region. */
+	void ReleaseResidentDataRegionBytes();
+};
+
+/** Holds the compressed data of an anim data resident while in scope when it was resident when the scope began. */
+struct FACLCompressedDataReadScope
+{
+	explicit FACLCompressedDataReadScope(const FACLCompressedAnimData& AnimData_)
+		: AnimData(AnimData_)
+		, bIsResident(AnimData_.BeginReadCompressedData())
+	{
+	}
+
+	~FACLCompressedDataReadScope()
+	{
+		if (bIsResident)
+		{
+			AnimData.EndReadCompressedData();
+		}
+	}
+
+	/** Returns whether or not the compressed data is resident, it can only be read when it is. */
+	bool IsResident() const { return bIsResident; }
+
+private:
+	const FACLCompressedAnimData& AnimData;
+	bool bIsResident;
+};
+
+/** A compression level that can be overridden per platform, edited by name unlike FPerPlatformInt. */
+USTRUCT()
+struct FPerPlatformACLCompressionLevel
+{
+	GENERATED_BODY()
+
+	/** The compression level of platforms without an override. */
+	UPROPERTY(EditAnywhere, Category = PerPlatform)
+	TEnumAsByte<ACLCompressionLevel> Default = ACLCL_Medium;
+
+	/** The compression level overrides, keyed by platform or platform group name (e.g. Mobile, Android, PS4). */
+	UPROPERTY(EditAnywhere, Category = PerPlatform)
+	TMap<FName, TEnumAsByte<ACLCompressionLevel>> PerPlatform;
+
+	/** Returns the value of a platform, a platform override takes precedence over the override of its group. */
+	TEnumAsByte<ACLCompressionLevel> GetValueForPlatformIdentifiers(FName PlatformGroupName, FName VanillaPlatformName = NAME_None) const
+	{
+		const TEnumAsByte<ACLCompressionLevel>* Value = PerPlatform.Find(VanillaPlatformName);
+		if (Value == nullptr && PlatformGroupName != NAME_None)
+		{
+			Value = PerPlatform.Find(PlatformGroupName);
+		}
+
+		return Value != nullptr ? *Value : Default;
+	}
 };
 
 /** The base codec implementation for ACL support. */
@@ -47,36 +149,86 @@ class UAnimBoneCompressionCodec_ACLBase : public UAnimBoneCompressionCodec
 	GENERATED_UCLASS_BODY()
 
 #if WITH_EDITORONLY_DATA
+	/** Deprecated, replaced by the per platform compression level. */
+	UPROPERTY()
+	TEnumAsByte<ACLCompressionLevel> CompressionLevel_DEPRECATED;
+
 	/** The compression level to use. Higher levels will be slower to compress but yield a lower memory footprint. */
-	UPROPERTY(EditAnywhere, Category = "ACL Options")
-	TEnumAsByte<ACLCompressionLevel> CompressionLevel;
+	UPROPERTY(EditAnywhere, Category = "ACL Options", meta = (DisplayName = "Compression Level"))
+	FPerPlatformACLCompressionLevel CompressionLevelPerPlatform;
 
 	/** The default virtual vertex distance for normal bones. */
 	UPROPERTY(EditAnywhere, Category = "ACL Options", meta = (ClampMin = "0"))
-	float DefaultVirtualVertexDistance;
+	FPerPlatformFloat DefaultVirtualVertexDistance;
 
 	/** The virtual vertex distance for bones that requires extra accuracy. */
 	UPROPERTY(EditAnywhere, Category = "ACL Options", meta = (ClampMin = "0"))
-	float SafeVirtualVertexDistance;
+	FPerPlatformFloat SafeVirtualVertexDistance;
 
 	/** The error threshold to use when optimizing and compressing the animation sequence. */
 	UPROPERTY(EditAnywhere, Category = "ACL Options", meta = (ClampMin = "0"))
-	float ErrorThreshold;
+	FPerPlatformFloat ErrorThreshold;
+
+	/** Whether or not to pick the segment size of every sequence automatically. Several sizes are compressed and the best trade-off between the compressed size and the memory touched per sample is retained. */
+	UPROPERTY(EditAnywhere, Category = "ACL Options")
+	bool bAutoSegmenting;
+
+	/** How much the memory touched per sample matters relative to the compressed size when picking a segment size. 0 retains the smallest compressed size, 1 retains the fewest bytes touched per sample. */
+	UPROPERTY(EditAnywhere, Category = "ACL Options", meta = (ClampMin = "0", ClampMax = "1", EditCondition = "bAutoSegmenting"))
+	float AutoSegmentingLocalityWeight;
+
+	/** Whether or not to cook the compressed data as separately streamed bulk data. It streams in on first use (the reference pose plays until then) or when preloaded, and streams out under the 'ACL.StreamedClipBudgetMB' memory budget. Suitable for rarely played sequences. Ignored by the database codec. */
+	UPROPERTY(EditAnywhere, Category = "ACL Options")
+	bool bStreamCompressedData;
+
+	/** The maximum sample rate to compress with. Sequences sampled at a higher rate are resampled unless it exceeds the error threshold. Zero disables resampling. */
+	UPROPERTY(EditAnywhere, Category = "ACL Options", meta = (ClampMin = "0"))
+	float MaxSampleRate;
+
+	//////////////////////////////////////////////////////////////////////////
+	// UObject implementation
+	virtual void PostLoad() override;
 
 	// UAnimBoneCompressionCodec implementation
 	virtual bool Compress(const FCompressibleAnimData& CompressibleAnimData, FCompressibleAnimDataResult& OutResult) override;
 	virtual void PopulateDDCKey(FArchive& Ar) override;
 
 	// Our implementation
+	ACLPLUGIN_API ACLCompressionLevel GetCompressionLevelForPlatform() const;
+	ACLPLUGIN_API float GetDefaultVirtualVertexDistanceForPlatform() const;
+	ACLPLUGIN_API float GetSafeVirtualVertexDistanceForPlatform() const;
+	ACLPLUGIN_API float GetErrorThresholdForPlatform() const;
+
+	/** Returns the error threshold for the platform scaled by the compression error threshold scale of the sequence. The scale is part of the sequence DDC key. */
+	ACLPLUGIN_API float GetErrorThresholdForSequence(const FCompressibleAnimData& CompressibleAnimData) const;
+
 	virtual bool UseDatabase() const { return false; }
 	virtual void RegisterWithDatabase(const FCompressibleAnimData& CompressibleAnimData, FCompressibleAnimDataResult& OutResult) {}
+	virtual float GetKeyframeStrippingProportion() const { return 0.0f; }
+
+	/** Returns how much to scale the contributing error of every key frame of a sequence compressed for a database. Key frames with a larger contributing error remain resident longer. */
+	virtual float GetContributingErrorScale(const FCompressibleAnimData& CompressibleAnimData) const { return 1.0f; }
+
 	virtual void GetCompressionSettings(acl::compression_settings& OutSettings) const PURE_VIRTUAL(UAnimBoneCompressionCodec_ACLBase::GetCompressionSettings, );
+	virtual void SelectCompressionSettings(const FCompressibleAnimData& CompressibleAnimData, const acl::track_array_qvvf& ACLTracks, const acl::track_array_qvvf& ACLBaseTracks, float SequenceErrorThreshold, acl::compression_settings& OutSettings) const;
 	virtual TArray<class USkeletalMesh*> GetOptimizationTargets() const { return TArray<class USkeletalMesh*>(); }
 	virtual ACLSafetyFallbackResult ExecuteSafetyFallback(acl::iallocator& Allocator, const acl::compression_settings& Settings, const acl::track_array_qvvf& RawClip, const acl::track_array_qvvf& BaseClip, const acl::compressed_tracks& CompressedClipData, const FCompressibleAnimData& CompressibleAnimData, FCompressibleAnimDataResult& OutResult);
+
+	/** Compresses the tracks with the provided settings and error metric. Tracks are resampled first when MaxSampleRate allows it and the error remains below the threshold. */
+	ACLPLUGIN_API acl::error_result CompressTracks(const acl::track_array_qvvf& ACLTracks, const acl::track_array_qvvf& ACLBaseTracks, const acl::compression_settings& Settings, float SequenceErrorThreshold, acl::compressed_tracks*& OutCompressedTracks) const;
+
+	/** Compresses the tracks with several segment sizes and retains the one with the best trade-off between the compressed size and the memory touched per sample. */
+	ACLPLUGIN_API void SelectSegmentSize(const acl::track_array_qvvf& ACLTracks, const acl::track_array_qvvf& ACLBaseTracks, float SequenceErrorThreshold, acl::compression_settings& InOutSettings) const;
 #endif
 
 	// UAnimBoneCompressionCodec implementation
 	virtual TUniquePtr<ICompressedAnimData> AllocateAnimData() const override;
 	virtual void ByteSwapIn(ICompressedAnimData& AnimData, TArrayView<uint8> CompressedData, FMemoryReader& MemoryStream) const override;
 	virtual void ByteSwapOut(ICompressedAnimData& AnimData, TArrayView<uint8> CompressedData, FMemoryWriter& MemoryStream) const override;
+
+	/** Returns the estimated cost in nanoseconds to decompress a whole pose of the provided sequence, see EstimateDecodeCostUnits. Returns zero if it isn't compressed with ACL. */
+	static ACLPLUGIN_API float GetDecodeCostEstimate(const UAnimSequence& AnimSeq);
+
+	/** Requests the compressed data of the provided sequence when it is cooked as streamed bulk data, ahead of its first use. Returns whether or not it is resident. */
+	static ACLPLUGIN_API bool PreloadStreamedData(const UAnimSequence& AnimSeq);
 };
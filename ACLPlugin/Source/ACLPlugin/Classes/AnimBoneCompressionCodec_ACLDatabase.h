@@ -26,6 +26,12 @@ struct FACLDatabaseCompressedAnimData final : public ICompressedAnimData
 	/** The sequence name hash that owns this data. */
 	uint32 SequenceNameHash = 0;
 
+	/** Identifies our anim sequence in usage profiles, see GetACLSequenceUsageKey. */
+	uint32 SequenceUsageKey = 0;
+
+	/** The estimated cost to decompress a whole pose, in decode cost units. Computed once bound, on first use. */
+	mutable float DecodeCostUnits = -1.0f;
+
 #if WITH_EDITORONLY_DATA
 	/** Holds the compressed_tracks instance for the anim sequence */
 	TArray<uint8> CompressedClip;
@@ -37,6 +43,9 @@ struct FACLDatabaseCompressedAnimData final : public ICompressedAnimData
 	const acl::compressed_tracks* GetCompressedTracks() const { return acl::make_compressed_tracks(CompressedByteStream.GetData()); }
 #endif
 
+	/** Returns the estimated cost to decompress a whole pose, in decode cost units. */
+	ACLPLUGIN_API float GetDecodeCostUnits() const;
+
 	// ICompressedAnimData implementation
 	virtual void SerializeCompressedData(FArchive& Ar) override;
 	virtual void Bind(const TArrayView<uint8> BulkData) override;
@@ -70,6 +79,7 @@ class UAnimBoneCompressionCodec_ACLDatabase : public UAnimBoneCompressionCodec_A
 	virtual bool UseDatabase() const override { return true; }
 	virtual void RegisterWithDatabase(const FCompressibleAnimData& CompressibleAnimData, FCompressibleAnimDataResult& OutResult) override;
 	virtual void GetCompressionSettings(acl::compression_settings& OutSettings) const override;
+	virtual float GetContributingErrorScale(const FCompressibleAnimData& CompressibleAnimData) const override;
 	virtual TArray<class USkeletalMesh*> GetOptimizationTargets() const override { return OptimizationTargets; }
 #endif
 
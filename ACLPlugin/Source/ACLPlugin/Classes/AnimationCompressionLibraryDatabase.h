@@ -3,11 +3,13 @@
 // Copyright 2020 Nicholas Frechette. All Rights Reserved.
 
 #include "ACLImpl.h"
+#include "ACLUsageProfile.h"
 
 #include <acl/decompression/database/database.h>
 #include <acl/decompression/database/database_streamer.h>
 
 #include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
 #include "PerPlatformProperties.h"
 #include "UObject/ObjectMacros.h"
 #include "AnimationCompressionLibraryDatabase.generated.h"
@@ -53,6 +55,12 @@ private:
 	UPROPERTY()
 	TArray<uint8> CookedCompressedBytes;
 
+	/** A view on our compressed database and anim sequences. Points into the resident data region when the cooked data has been relocated. */
+	TArrayView<uint8> CookedCompressedBytesView;
+
+	/** Whether or not our view points into the resident data region, it is freed when we are destroyed or reloaded. */
+	bool bIsCookedCompressedBytesViewInResidentDataRegion;
+
 	/** Stores a mapping for each anim sequence, where its compresssed data lives in our compressed buffer. Each 64 bit value is split into 32 bits: (Hash << 32) | Offset. Present only in cooked builds. */
 	UPROPERTY()
 	TArray<uint64> CookedAnimSequenceMappings;
@@ -76,21 +84,37 @@ private:
 	TArray<FFidelityChangeRequest> FidelityChangeRequests;
 
 #if WITH_EDITORONLY_DATA
+	/** Deprecated, replaced by the per platform medium importance proportion. */
+	UPROPERTY()
+	float MediumImportanceProportion_DEPRECATED;
+
+	/** Deprecated, replaced by the per platform lowest importance proportion. */
+	UPROPERTY()
+	float LowestImportanceProportion_DEPRECATED;
+
 	/** What percentage of the key frames should remain in the anim sequences. */
-	UPROPERTY(VisibleAnywhere, Category = "Database")
-	float HighestImportanceProportion;
+	UPROPERTY(VisibleAnywhere, Category = "Database", meta = (DisplayName = "Highest Importance Proportion"))
+	FPerPlatformFloat HighestImportanceProportionPerPlatform;
 
 	/** What percentage of the key frames should be moved to the database. Medium importance key frames are moved second. */
-	UPROPERTY(EditAnywhere, Category = "Database", meta = (ClampMin = "0", ClampMax = "1"))
-	float MediumImportanceProportion;
+	UPROPERTY(EditAnywhere, Category = "Database", meta = (DisplayName = "Medium Importance Proportion", ClampMin = "0", ClampMax = "1"))
+	FPerPlatformFloat MediumImportanceProportionPerPlatform;
 
 	/** What percentage of the key frames should be moved to the database. Least important key frames are moved first. */
-	UPROPERTY(EditAnywhere, Category = "Database", meta = (ClampMin = "0", ClampMax = "1"))
-	float LowestImportanceProportion;
+	UPROPERTY(EditAnywhere, Category = "Database", meta = (DisplayName = "Lowest Importance Proportion", ClampMin = "0", ClampMax = "1"))
+	FPerPlatformFloat LowestImportanceProportionPerPlatform;
 
 	/** Whether or not to strip the lowest importance tier entirely from disk. Stripping the lowest tier means that the visual fidelity of Highest and Medium are equivalent. */
 	UPROPERTY(EditAnywhere, Category = "Database")
 	FPerPlatformBool StripLowestImportanceTier;
+
+	/** An optional usage profile captured at runtime with 'ACL.SaveUsageProfile'. Sequences frequently played together are laid out next to each other in memory and in the streamed bulk data. */
+	UPROPERTY(EditAnywhere, Category = "Database", meta = (FilePathFilter = "aclusage", RelativeToGameDir))
+	FFilePath UsageProfile;
+
+	/** How strongly the usage profile biases which key frames are moved to the database. Key frames of frequently played sequences remain in the anim sequences, rarely played ones are moved first. 0 = No bias, 1 = Full bias */
+	UPROPERTY(EditAnywhere, Category = "Database", meta = (ClampMin = "0", ClampMax = "1"))
+	float UsageProfileBias;
 #endif
 
 	/** The maximum size in KiloBytes of streaming requests. Setting this to 0 will force tiers to load in a single request regardless of their size. */
@@ -114,6 +138,18 @@ private:
 	/** Editor only, transient, preview version of 'DatabaseStreamer'. */
 	TUniquePtr<acl::database_streamer> PreviewDatabaseStreamer;
 
+	/** Editor only, transient, the usage profile that biases the contributing error of our anim sequences. Reloaded when the file changes. */
+	FACLUsageProfile BiasUsageProfile;
+	FString BiasUsageProfileFilename;
+	FDateTime BiasUsageProfileTimestamp;
+
+	/** Editor only, transient, the hash of the usage profile file and the mean number of times its sequences were decompressed. */
+	uint32 BiasUsageProfileHash;
+	double BiasUsageProfileMeanDecompressions;
+
+	/** Editor only, anim sequences compress in parallel and query the usage profile concurrently. */
+	FCriticalSection BiasUsageProfileLock;
+
 	/** The anim sequences contained within the database. Built manually from the asset UI, content browser, or with a commandlet. */
 	UPROPERTY(VisibleAnywhere, Category = "Metadata")
 	TArray<class UAnimSequence*> AnimSequences;
@@ -126,6 +162,21 @@ public:
 
 	/** Updates the internal list of anim sequences that reference this database. Returns whether or not anything changed. */
 	ACLPLUGIN_API bool UpdateReferencingAnimSequenceList();
+
+	/** Builds the database in memory without modifying this asset and returns the size in bytes of the resident and streamed data. Used by editor tooling. */
+	ACLPLUGIN_API void CalculateBuiltSize(uint32& OutCompressedSize, uint32& OutBulkDataSize, bool bStripLowestTier = false) const;
+
+	/** Builds the database in memory without modifying this asset and returns the compressed bytes cooked for the target platform. Used by editor tooling. */
+	ACLPLUGIN_API void BuildCookedCompressedBytes(const class ITargetPlatform* TargetPlatform, TArray<uint8>& OutCompressedBytes) const;
+
+	/**
+	 * Returns how much to scale the contributing error of the key frames of an anim sequence, based on how often it was decompressed in our usage profile
+	 * relative to the mean of the profile. Sequences absent from the profile are the coldest. Returns 1.0 without a usage profile or bias. Thread safe.
+	 */
+	float GetContributingErrorScale(uint32 SequenceUsageKey);
+
+	/** Returns a hash of our usage profile and its bias or 0 if they don't bias our anim sequences. Part of the DDC key of our anim sequences. Thread safe. */
+	uint32 GetUsageProfileBiasHash();
 #endif
 
 public:
@@ -149,13 +200,31 @@ public:
 
 private:
 #if WITH_EDITORONLY_DATA
-	/** Builds our database and its related mappings as well as the new anim sequence data. */
-	void BuildDatabase(TArray<uint8>& OutCompressedBytes, TArray<uint64>& OutAnimSequenceMappings, TArray<uint8>& OutBulkData, bool bStripLowestTier = false) const;
+	/** Builds our database and its related mappings as well as the new anim sequence data. Tier proportions are the ones of the target platform or of the platform we compress for if null. */
+	void BuildDatabase(TArray<uint8>& OutCompressedBytes, TArray<uint64>& OutAnimSequenceMappings, TArray<uint8>& OutBulkData, const class ITargetPlatform* TargetPlatform, bool bStripLowestTier = false) const;
 
 	/** Updates the internal preview state and optionally builds the database when requested. */
 	void UpdatePreviewState(bool bBuildDatabase);
+
+	/** Returns whether or not the lowest importance tier is stripped when cooking for the target platform. */
+	bool ShouldStripLowestImportanceTier(const class ITargetPlatform* TargetPlatform) const;
+
+	/** Returns the tier proportions to build with for the target platform or for the platform we compress for if null. */
+	void GetTierProportions(const class ITargetPlatform* TargetPlatform, float& OutLowestProportion, float& OutMediumProportion) const;
+
+	/** Clamps the other tier proportion of every platform so that both fit together and updates the proportion that remains in the anim sequences. */
+	void ClampTierProportions(bool bLowestProportionChanged);
+
+	/** Loads our usage profile again if it changed since we last loaded it. BiasUsageProfileLock must be held. */
+	void UpdateBiasUsageProfile();
 #endif
 
+	/** Binds our view on the cooked compressed bytes, binding them to the shared data file or relocating them into the resident data region when enabled. */
+	void RelocateCookedCompressedBytes();
+
+	/** Frees the resident data region copy of our cooked compressed bytes, if we have one. */
+	void ReleaseResidentDataRegionBytes();
+
 	/** Shared implementation between C++ and blueprint interfaces. */
 	void SetVisualFidelityImpl(ACLVisualFidelity VisualFidelity, ACLVisualFidelityChangeResult* OutResult);
 
@@ -163,6 +232,7 @@ private:
 	bool UpdateVisualFidelityTicker(float DeltaTime);
 
 	friend class FACLPlugin;
+	friend struct FACLDatabaseStreamingBenchmark;
 	friend class FSetDatabaseVisualFidelityAction;
 	friend class UAnimBoneCompressionCodec_ACLDatabase;
 	friend struct FACLDatabaseCompressedAnimData;
@@ -0,0 +1,289 @@
+// Copyright 2020 Nicholas Frechette. All Rights Reserved.
+
+#include "ACLClipArena.h"
+
+#include "AnimBoneCompressionCodec_ACLBase.h"
+#include "AnimBoneCompressionCodec_ACLDatabase.h"
+#include "ACLUsageRecorder.h"
+
+#include "AnimationCompression.h"
+#include "Animation/AnimSequence.h"
+#include "Animation/Skeleton.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/CoreDelegates.h"
+#include "Misc/PackageName.h"
+#include "Misc/Paths.h"
+#include "UObject/UObjectGlobals.h"
+#include "UObject/UObjectIterator.h"
+
+static TAutoConsoleVariable<int32> CVarACLClipArena(
+	TEXT("ACL.ClipArena"),
+	0,
+	TEXT("When enabled in a cooked build, the compressed data of non-database ACL anim sequences is relocated into a single contiguous arena after every map load and compacted after every garbage collection.\n")
+	TEXT("The original engine buffers are released once relocated. Relocation runs at the end of the frame, while nothing decompresses, and briefly needs both the old and the new arena: up to twice the arena size."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<FString> CVarACLClipArenaUsageProfile(
+	TEXT("ACL.ClipArena.UsageProfile"),
+	TEXT(""),
+	TEXT("The path, relative to the project directory, of a usage profile captured with 'ACL.SaveUsageProfile'. When set, sequences frequently played together are laid out next to each other in the clip arena.\n")
+	TEXT("When empty and 'ACL.RecordUsage' is enabled, what was recorded so far is used instead. Without a profile, sequences are grouped by skeleton and by folder."),
+	ECVF_ReadOnly);
+
+FACLClipArena& FACLClipArena::Get()
+{
+	static FACLClipArena Arena;
+	return Arena;
+}
+
+FACLClipArena::FACLClipArena()
+	: ArenaData(nullptr)
+	, ArenaSize(0)
+	, bIsUsageProfileLoaded(false)
+	, bHasUsageProfile(false)
+	, bIsRelocationRequested(false)
+	, bLogRequestedRelocation(false)
+{
+}
+
+void FACLClipArena::Initialize()
+{
+#if !WITH_EDITORONLY_DATA
+	PostLoadMapHandle = FCoreUObjectDelegates::PostLoadMapWithWorld.AddRaw(this, &FACLClipArena::OnPostLoadMap);
+	PostGarbageCollectHandle = FCoreUObjectDelegates::GetPostGarbageCollect().AddRaw(this, &FACLClipArena::OnPostGarbageCollect);
+#endif
+
+	EndFrameHandle = FCoreDelegates::OnEndFrame.AddRaw(this, &FACLClipArena::OnEndFrame);
+}
+
+void FACLClipArena::Shutdown()
+{
+#if !WITH_EDITORONLY_DATA
+	FCoreUObjectDelegates::PostLoadMapWithWorld.Remove(PostLoadMapHandle);
+	FCoreUObjectDelegates::GetPostGarbageCollect().Remove(PostGarbageCollectHandle);
+#endif
+
+	FCoreDelegates::OnEndFrame.Remove(EndFrameHandle);
+
+	// We do not free the arena, anim sequences might still be bound to it
+}
+
+void FACLClipArena::OnPostLoadMap(UWorld* World)
+{
+	if (CVarACLClipArena.GetValueOnGameThread() != 0)
+	{
+		RequestRelocate();
+	}
+}
+
+void FACLClipArena::OnPostGarbageCollect()
+{
+	// Compact away the sequences that were unloaded
+	if (CVarACLClipArena.GetValueOnGameThread() != 0 && Entries.Num() != 0)
+	{
+		RequestRelocate();
+	}
+}
+
+void FACLClipArena::RequestRelocate(bool bLogResult)
+{
+	check(IsInGameThread());
+
+	bIsRelocationRequested = true;
+	bLogRequestedRelocation |= bLogResult;
+}
+
+void FACLClipArena::OnEndFrame()
+{
+	if (!bIsRelocationRequested)
+	{
+		return;
+	}
+
+	// Parallel animation evaluation completes before the frame ends, nothing reads from the arena while we relocate it
+	bIsRelocationRequested = false;
+
+	const ELogVerbosity::Type OldVerbosity = LogAnimationCompression.GetVerbosity();
+	if (bLogRequestedRelocation)
+	{
+		LogAnimationCompression.SetVerbosity(ELogVerbosity::All);
+		bLogRequestedRelocation = false;
+	}
+
+	Relocate();
+
+	LogAnimationCompression.SetVerbosity(OldVerbosity);
+}
+
+/**
+ * Without a usage profile, anim sequences are grouped by skeleton since only those can play on the same mesh.
+ * Within a skeleton, sequences that live in the same folder are typically authored and played together
+ * (e.g. a locomotion set) and we use this as the expected co-usage.
+ */
+static FString GetSortKey(const UAnimSequence& AnimSeq)
+{
+	const USkeleton* Skeleton = AnimSeq.GetSkeleton();
+	const FString SkeletonPath = Skeleton != nullptr ? Skeleton->GetPathName() : FString();
+	const FString FolderPath = FPackageName::GetLongPackagePath(AnimSeq.GetOutermost()->GetName());
+
+	return FString::Printf(TEXT("%s|%s|%s"), *SkeletonPath, *FolderPath, *AnimSeq.GetName());
+}
+
+const FACLUsageProfile* FACLClipArena::GetUsageProfile(FACLUsageProfile& RecordedProfile, FString& OutProfileName)
+{
+	if (!bIsUsageProfileLoaded)
+	{
+		bIsUsageProfileLoaded = true;
+
+		const FString ProfilePath = CVarACLClipArenaUsageProfile.GetValueOnGameThread();
+		if (!ProfilePath.IsEmpty())
+		{
+			bHasUsageProfile = UsageProfile.LoadFromFile(FPaths::ConvertRelativePathToFull(FPaths::ProjectDir(), ProfilePath));
+		}
+	}
+
+	if (bHasUsageProfile)
+	{
+		OutProfileName = CVarACLClipArenaUsageProfile.GetValueOnGameThread();
+		return &UsageProfile;
+	}
+
+	if (GACLRecordUsage != 0)
+	{
+		FACLUsageRecorder::GetProfile(RecordedProfile);
+		OutProfileName = TEXT("recorded usage");
+		return &RecordedProfile;
+	}
+
+	return nullptr;
+}
+
+void FACLClipArena::Relocate()
+{
+	check(IsInGameThread());
+
+#if !WITH_EDITORONLY_DATA
+	TArray<FEntry> NewEntries;
+	NewEntries.Reserve(Entries.Num());
+
+	// Keep the sequences that are still loaded and bound to the arena
+	for (const FEntry& Entry : Entries)
+	{
+		const UAnimSequence* AnimSeq = Entry.AnimSeq.Get();
+		if (AnimSeq != nullptr && AnimSeq->CompressedData.CompressedDataStructure.Get() == Entry.AnimData && IsInArena(Entry.AnimData->CompressedByteStream.GetData()))
+		{
+			NewEntries.Add(Entry);
+		}
+	}
+
+	const int32 NumRetainedEntries = NewEntries.Num();
+
+	// Find the sequences that loaded since we last ran
+	for (TObjectIterator<UAnimSequence> It; It; ++It)
+	{
+		UAnimSequence* AnimSeq = *It;
+		if (AnimSeq->HasAnyFlags(RF_NeedLoad | RF_NeedPostLoad | RF_BeginDestroyed) || AnimSeq->HasAnyInternalFlags(EInternalObjectFlags::Async | EInternalObjectFlags::AsyncLoading))
+		{
+			continue;	// Still loading or being destroyed
+		}
+
+		const UAnimBoneCompressionCodec* Codec = AnimSeq->CompressedData.BoneCompressionCodec;
+		if (Codec == nullptr || !Codec->IsA<UAnimBoneCompressionCodec_ACLBase>() || Codec->IsA<UAnimBoneCompressionCodec_ACLDatabase>())
+		{
+			continue;	// Not an ACL sequence or its data lives in a database
+		}
+
+		FACLCompressedAnimData* AnimData = static_cast<FACLCompressedAnimData*>(AnimSeq->CompressedData.CompressedDataStructure.Get());
+		if (AnimData == nullptr || AnimData->CompressedByteStream.Num() == 0 || IsInArena(AnimData->CompressedByteStream.GetData()))
+		{
+			continue;	// Nothing to relocate or already relocated
+		}
+
+		if (AnimData->OwnedByteStream.Num() == 0)
+		{
+			continue;	// Our data already lives elsewhere (e.g. in the resident data region), leave it there
+		}
+
+		NewEntries.Add({ AnimSeq, AnimData, GetSortKey(*AnimSeq) });
+	}
+
+	const int32 NumRelocatedEntries = NewEntries.Num() - NumRetainedEntries;
+	const int32 NumUnloadedEntries = Entries.Num() - NumRetainedEntries;
+	if (NumRelocatedEntries == 0 && NumUnloadedEntries == 0)
+	{
+		return;	// Nothing changed
+	}
+
+	NewEntries.Sort([](const FEntry& Lhs, const FEntry& Rhs) { return Lhs.SortKey.Compare(Rhs.SortKey) < 0; });
+
+	// Lay out sequences played together next to each other when we have a usage profile, those it doesn't know about retain the folder order at the end
+	FACLUsageProfile RecordedProfile;
+	FString ProfileName;
+	const FACLUsageProfile* Profile = GetUsageProfile(RecordedProfile, ProfileName);
+	if (Profile != nullptr && Profile->CoUsage.Num() != 0)
+	{
+		TArray<uint32> SequenceUsageKeys;
+		SequenceUsageKeys.Reserve(NewEntries.Num());
+		for (const FEntry& Entry : NewEntries)
+		{
+			SequenceUsageKeys.Add(Entry.AnimData->SequenceUsageKey);
+		}
+
+		const TArray<int32> Order = Profile->CalculateCoUsageOrder(SequenceUsageKeys);
+
+		TArray<FEntry> OrderedEntries;
+		OrderedEntries.Reserve(NewEntries.Num());
+		for (int32 EntryIndex : Order)
+		{
+			OrderedEntries.Add(NewEntries[EntryIndex]);
+		}
+
+		NewEntries = MoveTemp(OrderedEntries);
+
+		UE_LOG(LogAnimationCompression, Verbose, TEXT("ACL clip arena ordered with usage profile [%s]"), *ProfileName);
+	}
+
+	// ACL requires 16 byte alignment for its compressed data
+	const SIZE_T Alignment = 16;
+
+	SIZE_T NewArenaSize = 0;
+	for (const FEntry& Entry : NewEntries)
+	{
+		NewArenaSize = Align(NewArenaSize, Alignment) + Entry.AnimData->CompressedByteStream.Num();
+	}
+
+	uint8* NewArenaData = NewArenaSize != 0 ? static_cast<uint8*>(FMemory::Malloc(NewArenaSize, Alignment)) : nullptr;
+
+	SIZE_T Offset = 0;
+	for (const FEntry& Entry : NewEntries)
+	{
+		FACLCompressedAnimData& AnimData = *Entry.AnimData;
+		const int32 NumBytes = AnimData.CompressedByteStream.Num();
+		const bool bWasInArena = IsInArena(AnimData.CompressedByteStream.GetData());
+
+		Offset = Align(Offset, Alignment);
+		FMemory::Memcpy(NewArenaData + Offset, AnimData.CompressedByteStream.GetData(), NumBytes);
+
+		AnimData.CompressedByteStream = TArrayView<uint8>(NewArenaData + Offset, NumBytes);
+		Offset += NumBytes;
+
+		if (!bWasInArena)
+		{
+			// We no longer need our own copy
+			AnimData.OwnedByteStream.Empty();
+		}
+	}
+
+	FMemory::Free(ArenaData);
+
+	const SIZE_T OldArenaSize = ArenaSize;
+	ArenaData = NewArenaData;
+	ArenaSize = NewArenaSize;
+	Entries = MoveTemp(NewEntries);
+
+	UE_LOG(LogAnimationCompression, Log, TEXT("ACL clip arena relocated %d sequences and released %d unloaded sequences, %d sequences went from %.2f MB -> %.2f MB"),
+		NumRelocatedEntries, NumUnloadedEntries, Entries.Num(), double(OldArenaSize) / (1024.0 * 1024.0), double(ArenaSize) / (1024.0 * 1024.0));
+#else
+	UE_LOG(LogAnimationCompression, Log, TEXT("ACL clip arena is only supported in cooked builds"));
+#endif
+}
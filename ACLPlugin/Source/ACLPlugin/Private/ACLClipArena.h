@@ -0,0 +1,86 @@
+#pragma once
+
+// Copyright 2020 Nicholas Frechette. All Rights Reserved.
+
+#include "CoreMinimal.h"
+#include "UObject/WeakObjectPtr.h"
+
+#include "ACLUsageProfile.h"
+
+class UAnimSequence;
+class UWorld;
+struct FACLCompressedAnimData;
+
+/**
+ * A contiguous arena that holds the compressed data of every loaded anim sequence that uses a non-database ACL codec.
+ * Sequences played together are laid out next to each other when a usage profile is available, otherwise they are
+ * grouped by skeleton and by folder. The original engine buffers are released once relocated.
+ * The arena is rebuilt when new sequences load and compacted when sequences unload. Only used in cooked builds.
+ */
+class FACLClipArena
+{
+public:
+	/** Returns the global arena instance. */
+	static FACLClipArena& Get();
+
+	/** Registers the load, garbage collection, and end of frame callbacks. */
+	void Initialize();
+
+	/** Unregisters the load, garbage collection, and end of frame callbacks. */
+	void Shutdown();
+
+	/** Requests a relocation at the end of the current frame, once animations are done decompressing. Must be called on the game thread. */
+	void RequestRelocate(bool bLogResult = false);
+
+	/**
+	 * Relocates newly loaded sequences and compacts away unloaded ones. The old arena is freed right away and both arenas are
+	 * allocated while we copy. Must be called on the game thread while nothing decompresses, use RequestRelocate() otherwise.
+	 */
+	void Relocate();
+
+	/** Returns the number of bytes used by the arena. */
+	SIZE_T GetArenaSize() const { return ArenaSize; }
+
+	/** Returns the number of sequences that live in the arena. */
+	int32 GetNumSequences() const { return Entries.Num(); }
+
+private:
+	FACLClipArena();
+
+	/** Represents a sequence that lives in the arena. */
+	struct FEntry
+	{
+		TWeakObjectPtr<UAnimSequence> AnimSeq;
+		FACLCompressedAnimData* AnimData;
+		FString SortKey;
+	};
+
+	void OnPostLoadMap(UWorld* World);
+	void OnPostGarbageCollect();
+	void OnEndFrame();
+
+	bool IsInArena(const uint8* Ptr) const { return Ptr >= ArenaData && Ptr < ArenaData + ArenaSize; }
+
+	/**
+	 * Returns the usage profile to order sequences with or nullptr if we have none: the one referenced by 'ACL.ClipArena.UsageProfile'
+	 * or a snapshot of what was recorded so far when 'ACL.RecordUsage' is enabled.
+	 */
+	const FACLUsageProfile* GetUsageProfile(FACLUsageProfile& RecordedProfile, FString& OutProfileName);
+
+	TArray<FEntry> Entries;
+
+	uint8* ArenaData;
+	SIZE_T ArenaSize;
+
+	/** The usage profile loaded from 'ACL.ClipArena.UsageProfile', loaded on first use. */
+	FACLUsageProfile UsageProfile;
+	bool bIsUsageProfileLoaded;
+	bool bHasUsageProfile;
+
+	bool bIsRelocationRequested;
+	bool bLogRequestedRelocation;
+
+	FDelegateHandle PostLoadMapHandle;
+	FDelegateHandle PostGarbageCollectHandle;
+	FDelegateHandle EndFrameHandle;
+};
@@ -0,0 +1,390 @@
+// Copyright 2020 Nicholas Frechette. All Rights Reserved.
+
+#include "CoreMinimal.h"
+
+// Benchmarks are only available in development builds when logging is enabled
+#define WITH_ACL_CROWD_BENCHMARK (!UE_BUILD_SHIPPING && !UE_BUILD_TEST && !NO_LOGGING)
+
+#if WITH_ACL_CROWD_BENCHMARK
+#include "AnimBoneCompressionCodec_ACLBase.h"
+#include "ACLPersistentPose.h"
+#include "ACLUsageRecorder.h"
+
+#include "AnimationCompression.h"
+#include "AnimEncoding.h"
+#include "Algo/BinarySearch.h"
+#include "Animation/AnimSequence.h"
+#include "Animation/Skeleton.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "Math/RandomStream.h"
+#include "Misc/MemStack.h"
+#include "UObject/UObjectIterator.h"
+
+#if PLATFORM_LINUX
+#include "ACLResidentDataRegion.h"
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/** The playback rate of the simulated crowd. */
+static constexpr float CrowdFrameRate = 30.0f;
+
+/** A single simulated character playing a sequence. */
+struct FACLCrowdInstance
+{
+	const UAnimSequence* AnimSeq;
+	const BoneTrackArray* TrackPairs;
+	float Time;
+	float PlayRate;
+
+	/** Where the pose is written in the packed and padded output layouts. */
+	FTransform* PackedPose;
+	FTransform* PaddedPose;
+	int32 NumTracks;
+
+	/** The state of the packed pose when it persists between frames. */
+	FACLPersistentPoseState PersistentPoseState;
+};
+
+/** How the poses of every instance are written. */
+enum class EACLCrowdOutputLayout : uint8
+{
+	/** Poses are contiguous, neighboring instances can share a cache line. */
+	Packed,
+
+	/** Every pose starts on its own cache line. */
+	Padded,
+
+	/** Poses are contiguous and persist between frames, constant and default tracks are only written once. */
+	PackedPersistent,
+
+	/** Nothing is decompressed, only the per pose FMemStack allocation the codecs perform is. */
+	MemStackOnly,
+};
+
+static void DecompressInstance(FACLCrowdInstance& Instance, EACLCrowdOutputLayout Layout)
+{
+	const UAnimSequence* AnimSeq = Instance.AnimSeq;
+
+	// Every pose evaluation has its own mark like the engine does
+	FMemMark Mark(FMemStack::Get());
+
+	if (Layout == EACLCrowdOutputLayout::MemStackOnly)
+	{
+		// Same allocation as the codecs perform to map tracks to atoms
+		uint8* TrackToAtomsMap = new(FMemStack::Get()) uint8[Instance.NumTracks * 6];
+		FMemory::Memset(TrackToAtomsMap, 0xFF, Instance.NumTracks * 6);
+		return;
+	}
+
+#if ENGINE_MINOR_VERSION >= 26
+	FAnimSequenceDecompressionContext DecompContext(AnimSeq->SequenceLength, AnimSeq->Interpolation, AnimSeq->GetFName(), *AnimSeq->CompressedData.CompressedDataStructure, AnimSeq->GetSkeleton()->GetRefLocalPoses(), AnimSeq->CompressedData.CompressedTrackToSkeletonMapTable);
+#else
+	FAnimSequenceDecompressionContext DecompContext(AnimSeq->SequenceLength, AnimSeq->Interpolation, AnimSeq->GetFName(), *AnimSeq->CompressedData.CompressedDataStructure);
+#endif
+	DecompContext.Seek(Instance.Time);
+
+	TArrayView<FTransform> Pose(Layout == EACLCrowdOutputLayout::Padded ? Instance.PaddedPose : Instance.PackedPose, Instance.NumTracks);
+
+	if (Layout == EACLCrowdOutputLayout::PackedPersistent)
+	{
+		// The track pairs of an instance never change, their address is enough of a key
+		FACLPersistentPoseScope PersistentPoseScope(Instance.PersistentPoseState, PointerHash(Instance.TrackPairs));
+		AnimSeq->CompressedData.BoneCompressionCodec->DecompressPose(DecompContext, *Instance.TrackPairs, *Instance.TrackPairs, *Instance.TrackPairs, Pose);
+		return;
+	}
+
+	AnimSeq->CompressedData.BoneCompressionCodec->DecompressPose(DecompContext, *Instance.TrackPairs, *Instance.TrackPairs, *Instance.TrackPairs, Pose);
+}
+
+/** Advances every instance by a frame. */
+static void AdvanceCrowd(TArray<FACLCrowdInstance>& Instances)
+{
+	for (FACLCrowdInstance& Instance : Instances)
+	{
+		Instance.Time = FMath::Fmod(Instance.Time + (Instance.PlayRate / CrowdFrameRate), Instance.AnimSeq->SequenceLength);
+	}
+}
+
+/**
+ * Simulates every instance for a number of frames with the provided number of tasks and returns the number of poses per second.
+ * Instances are interleaved between tasks, neighboring instances are decompressed by different threads at the same time.
+ */
+static double SimulateCrowd(TArray<FACLCrowdInstance>& Instances, int32 NumTasks, int32 NumFrames, EACLCrowdOutputLayout Layout)
+{
+	const double StartTime = FPlatformTime::Seconds();
+
+	for (int32 FrameIndex = 0; FrameIndex < NumFrames; ++FrameIndex)
+	{
+		FGraphEventArray Tasks;
+		for (int32 TaskIndex = 0; TaskIndex < NumTasks; ++TaskIndex)
+		{
+			Tasks.Add(FFunctionGraphTask::CreateAndDispatchWhenReady([&Instances, TaskIndex, NumTasks, Layout]()
+				{
+					for (int32 InstanceIndex = TaskIndex; InstanceIndex < Instances.Num(); InstanceIndex += NumTasks)
+					{
+						DecompressInstance(Instances[InstanceIndex], Layout);
+					}
+				}, TStatId(), nullptr, ENamedThreads::AnyHiPriThreadHiPriTask));
+		}
+
+		FTaskGraphInterface::Get().WaitUntilTasksComplete(Tasks, ENamedThreads::GameThread);
+
+		AdvanceCrowd(Instances);
+	}
+
+	const double ElapsedTime = FPlatformTime::Seconds() - StartTime;
+	return (double(Instances.Num()) * NumFrames) / FMath::Max(ElapsedTime, 1.0e-9);
+}
+
+#if PLATFORM_LINUX
+/** Opens a perf event that counts the data TLB loads or load misses of the calling thread in user space. Returns -1 if perf events are unavailable. */
+static int32 OpenDTLBEvent(uint64 Result)
+{
+	perf_event_attr Attr;
+	FMemory::Memzero(Attr);
+	Attr.type = PERF_TYPE_HW_CACHE;
+	Attr.size = sizeof(Attr);
+	Attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (Result << 16);
+	Attr.disabled = 1;
+	Attr.exclude_kernel = 1;
+	Attr.exclude_hv = 1;
+
+	return int32(syscall(__NR_perf_event_open, &Attr, 0, -1, -1, 0));	// Calling thread, any CPU
+}
+
+/**
+ * Decompresses every instance on the calling thread for a number of frames and counts the data TLB loads and load misses.
+ * Returns false if perf events are unavailable (e.g. a restrictive /proc/sys/kernel/perf_event_paranoid or a virtual machine).
+ */
+static bool MeasureDTLBMisses(TArray<FACLCrowdInstance>& Instances, int32 NumFrames, uint64& OutNumLoads, uint64& OutNumMisses)
+{
+	const int32 LoadHandle = OpenDTLBEvent(PERF_COUNT_HW_CACHE_RESULT_ACCESS);
+	const int32 MissHandle = OpenDTLBEvent(PERF_COUNT_HW_CACHE_RESULT_MISS);
+	if (LoadHandle < 0 || MissHandle < 0)
+	{
+		if (LoadHandle >= 0)
+		{
+			close(LoadHandle);
+		}
+
+		if (MissHandle >= 0)
+		{
+			close(MissHandle);
+		}
+		return false;
+	}
+
+	ioctl(LoadHandle, PERF_EVENT_IOC_RESET, 0);
+	ioctl(MissHandle, PERF_EVENT_IOC_RESET, 0);
+	ioctl(LoadHandle, PERF_EVENT_IOC_ENABLE, 0);
+	ioctl(MissHandle, PERF_EVENT_IOC_ENABLE, 0);
+
+	for (int32 FrameIndex = 0; FrameIndex < NumFrames; ++FrameIndex)
+	{
+		for (FACLCrowdInstance& Instance : Instances)
+		{
+			DecompressInstance(Instance, EACLCrowdOutputLayout::Packed);
+		}
+
+		AdvanceCrowd(Instances);
+	}
+
+	ioctl(LoadHandle, PERF_EVENT_IOC_DISABLE, 0);
+	ioctl(MissHandle, PERF_EVENT_IOC_DISABLE, 0);
+
+	OutNumLoads = 0;
+	OutNumMisses = 0;
+	const bool bIsValid = read(LoadHandle, &OutNumLoads, sizeof(uint64)) == sizeof(uint64) && read(MissHandle, &OutNumMisses, sizeof(uint64)) == sizeof(uint64);
+
+	close(LoadHandle);
+	close(MissHandle);
+	return bIsValid;
+}
+#endif
+
+static void RunCrowdBenchmark(const TArray<FString>& Args)
+{
+	// Make sure to log everything
+	const ELogVerbosity::Type OldVerbosity = LogAnimationCompression.GetVerbosity();
+	LogAnimationCompression.SetVerbosity(ELogVerbosity::All);
+
+	const int32 NumInstances = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 512;
+	const int32 NumFrames = Args.Num() > 1 ? FMath::Max(FCString::Atoi(*Args[1]), 1) : 30;
+	const int32 MaxNumThreads = Args.Num() > 2 ? FMath::Clamp(FCString::Atoi(*Args[2]), 1, 64) : 64;
+
+	TArray<const UAnimSequence*> AnimSequences;
+	for (TObjectIterator<UAnimSequence> It; It; ++It)
+	{
+		const UAnimSequence* AnimSeq = *It;
+		if (AnimSeq->CompressedData.BoneCompressionCodec != nullptr && AnimSeq->CompressedData.BoneCompressionCodec->IsA<UAnimBoneCompressionCodec_ACLBase>()
+			&& AnimSeq->IsCompressedDataValid() && AnimSeq->SequenceLength > 0.0f)
+		{
+			AnimSequences.Add(AnimSeq);
+		}
+	}
+
+	if (AnimSequences.Num() == 0)
+	{
+		UE_LOG(LogAnimationCompression, Log, TEXT("No ACL anim sequences are loaded, cannot run the crowd benchmark"));
+		LogAnimationCompression.SetVerbosity(OldVerbosity);
+		return;
+	}
+
+	if (GACLRecordUsage != 0)
+	{
+		UE_LOG(LogAnimationCompression, Warning, TEXT("'ACL.RecordUsage' is enabled, its per thread locks will skew the results"));
+	}
+
+	// Sort for deterministic results regardless of the load order
+	AnimSequences.Sort([](const UAnimSequence& Lhs, const UAnimSequence& Rhs) { return Lhs.GetPathName().Compare(Rhs.GetPathName()) < 0; });
+
+	TArray<BoneTrackArray> SequenceTrackPairs;
+	SequenceTrackPairs.SetNum(AnimSequences.Num());
+	for (int32 SequenceIndex = 0; SequenceIndex < AnimSequences.Num(); ++SequenceIndex)
+	{
+		const int32 NumTracks = AnimSequences[SequenceIndex]->CompressedData.CompressedTrackToSkeletonMapTable.Num();
+		for (int32 TrackIndex = 0; TrackIndex < NumTracks; ++TrackIndex)
+		{
+			SequenceTrackPairs[SequenceIndex].Add(BoneTrackPair(TrackIndex, TrackIndex));
+		}
+	}
+
+	// A few sequences are played by most of the crowd (idles, locomotion) while most are rarely played,
+	// we pick sequences with a Zipf distribution over the sorted sequences
+	TArray<double> CumulativeWeights;
+	double TotalWeight = 0.0;
+	for (int32 SequenceIndex = 0; SequenceIndex < AnimSequences.Num(); ++SequenceIndex)
+	{
+		TotalWeight += 1.0 / (SequenceIndex + 1);
+		CumulativeWeights.Add(TotalWeight);
+	}
+
+	FRandomStream RandomStream(0x41434C);	// Fixed seed for reproducible results
+
+	TArray<FACLCrowdInstance> Instances;
+	Instances.SetNum(NumInstances);
+
+	const int32 PosePaddingAlignment = 4;	// 192 bytes, the smallest multiple of both a 48 bytes transform and a 64 bytes cache line
+	int32 NumPackedTransforms = 0;
+	int32 NumPaddedTransforms = 0;
+	for (FACLCrowdInstance& Instance : Instances)
+	{
+		const double Weight = RandomStream.FRand() * TotalWeight;
+		const int32 SequenceIndex = FMath::Min(Algo::LowerBound(CumulativeWeights, Weight), AnimSequences.Num() - 1);
+
+		Instance.AnimSeq = AnimSequences[SequenceIndex];
+		Instance.TrackPairs = &SequenceTrackPairs[SequenceIndex];
+		Instance.Time = RandomStream.FRand() * Instance.AnimSeq->SequenceLength;
+		Instance.PlayRate = RandomStream.FRandRange(0.9f, 1.1f);
+		Instance.NumTracks = SequenceTrackPairs[SequenceIndex].Num();
+
+		NumPackedTransforms += Instance.NumTracks;
+		NumPaddedTransforms += Align(Instance.NumTracks, PosePaddingAlignment);
+	}
+
+	FTransform* PackedPoses = static_cast<FTransform*>(FMemory::Malloc(sizeof(FTransform) * FMath::Max(NumPackedTransforms, 1), PLATFORM_CACHE_LINE_SIZE));
+	FTransform* PaddedPoses = static_cast<FTransform*>(FMemory::Malloc(sizeof(FTransform) * FMath::Max(NumPaddedTransforms, 1), PLATFORM_CACHE_LINE_SIZE));
+
+	int32 PackedOffset = 0;
+	int32 PaddedOffset = 0;
+	for (FACLCrowdInstance& Instance : Instances)
+	{
+		Instance.PackedPose = PackedPoses + PackedOffset;
+		Instance.PaddedPose = PaddedPoses + PaddedOffset;
+
+		PackedOffset += Instance.NumTracks;
+		PaddedOffset += Align(Instance.NumTracks, PosePaddingAlignment);
+	}
+
+	for (int32 TransformIndex = 0; TransformIndex < NumPackedTransforms; ++TransformIndex)
+	{
+		new(PackedPoses + TransformIndex) FTransform();
+	}
+
+	for (int32 TransformIndex = 0; TransformIndex < NumPaddedTransforms; ++TransformIndex)
+	{
+		new(PaddedPoses + TransformIndex) FTransform();
+	}
+
+	const int32 NumWorkerThreads = FTaskGraphInterface::Get().GetNumWorkerThreads();
+
+	UE_LOG(LogAnimationCompression, Log, TEXT("===== ACL Crowd Benchmark ====="));
+	UE_LOG(LogAnimationCompression, Log, TEXT("%d instances of %d anim sequences over %d frames, %d task graph worker threads"), NumInstances, AnimSequences.Num(), NumFrames, NumWorkerThreads);
+
+	// Warm up the caches and the memory stacks of every worker
+	SimulateCrowd(Instances, FMath::Min(MaxNumThreads, NumWorkerThreads), 1, EACLCrowdOutputLayout::Packed);
+
+	double SingleThreadPosesPerSec = 0.0;
+	double SingleThreadMemStackNsPerPose = 0.0;
+	for (int32 NumThreads = 1; NumThreads <= MaxNumThreads; NumThreads *= 2)
+	{
+		const double PackedPosesPerSec = SimulateCrowd(Instances, NumThreads, NumFrames, EACLCrowdOutputLayout::Packed);
+		const double PaddedPosesPerSec = SimulateCrowd(Instances, NumThreads, NumFrames, EACLCrowdOutputLayout::Padded);
+		const double PersistentPosesPerSec = SimulateCrowd(Instances, NumThreads, NumFrames, EACLCrowdOutputLayout::PackedPersistent);
+		const double MemStackPosesPerSec = SimulateCrowd(Instances, NumThreads, NumFrames, EACLCrowdOutputLayout::MemStackOnly);
+
+		const int32 NumActiveThreads = FMath::Min(NumThreads, NumWorkerThreads);
+		const double MemStackNsPerPose = (1.0e9 * NumActiveThreads) / MemStackPosesPerSec;
+
+		if (NumThreads == 1)
+		{
+			SingleThreadPosesPerSec = PackedPosesPerSec;
+			SingleThreadMemStackNsPerPose = MemStackNsPerPose;
+		}
+
+		const double Speedup = PackedPosesPerSec / SingleThreadPosesPerSec;
+
+		UE_LOG(LogAnimationCompression, Log, TEXT("%2d threads%s: %.0f poses/sec, %.2fx speedup (%.0f %% efficiency), padded output %.0f poses/sec (%+.1f %%), persistent output %.0f poses/sec (%+.1f %%), FMemStack %.1f ns/pose"),
+			NumThreads, NumThreads > NumWorkerThreads ? TEXT(" (capped)") : TEXT(""),
+			PackedPosesPerSec, Speedup, (Speedup / NumActiveThreads) * 100.0,
+			PaddedPosesPerSec, ((PaddedPosesPerSec / PackedPosesPerSec) - 1.0) * 100.0,
+			PersistentPosesPerSec, ((PersistentPosesPerSec / PackedPosesPerSec) - 1.0) * 100.0,
+			MemStackNsPerPose);
+
+		// Poor scaling with the padded layout faster points to false sharing of the output poses
+		if (NumActiveThreads > 1 && PaddedPosesPerSec > PackedPosesPerSec * 1.05)
+		{
+			UE_LOG(LogAnimationCompression, Log, TEXT("    false sharing between neighboring output poses costs %.1f %%"), ((PaddedPosesPerSec / PackedPosesPerSec) - 1.0) * 100.0);
+		}
+
+		// The memory stacks are thread local, a per pose cost that grows with the thread count points to page allocation contention
+		if (NumActiveThreads > 1 && MemStackNsPerPose > SingleThreadMemStackNsPerPose * 1.5)
+		{
+			UE_LOG(LogAnimationCompression, Log, TEXT("    FMemStack allocations are %.1fx slower than with a single thread"), MemStackNsPerPose / SingleThreadMemStackNsPerPose);
+		}
+	}
+
+#if PLATFORM_LINUX
+	// Compare runs with 'ACL.UseHugePages' enabled and disabled to measure the dTLB miss reduction of the resident data region
+	uint64 NumDTLBLoads = 0;
+	uint64 NumDTLBMisses = 0;
+	if (MeasureDTLBMisses(Instances, NumFrames, NumDTLBLoads, NumDTLBMisses))
+	{
+		const double NumPoses = double(NumInstances) * NumFrames;
+		UE_LOG(LogAnimationCompression, Log, TEXT("dTLB on 1 thread: %.2f load misses/pose (%.3f %% of %.0f loads/pose), resident data region %s (%.2f MB in huge pages)"),
+			double(NumDTLBMisses) / NumPoses, (double(NumDTLBMisses) / double(FMath::Max<uint64>(NumDTLBLoads, 1))) * 100.0, double(NumDTLBLoads) / NumPoses,
+			FACLResidentDataRegion::IsEnabled() ? TEXT("enabled") : TEXT("disabled"), double(FACLResidentDataRegion::Get().GetHugePageBackedSize()) / (1024.0 * 1024.0));
+	}
+	else
+	{
+		UE_LOG(LogAnimationCompression, Log, TEXT("dTLB misses cannot be measured, perf events are unavailable (see /proc/sys/kernel/perf_event_paranoid)"));
+	}
+#endif
+
+	FMemory::Free(PackedPoses);
+	FMemory::Free(PaddedPoses);
+
+	LogAnimationCompression.SetVerbosity(OldVerbosity);
+}
+
+static FAutoConsoleCommand CrowdBenchmarkCommand(
+	TEXT("ACL.CrowdBenchmark"),
+	TEXT("Measures how the decompression of a simulated crowd of loaded ACL anim sequences scales from 1 to 64 task graph threads. Arguments: number of instances (default 512), number of frames (default 30), maximum number of threads (default 64)"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&RunCrowdBenchmark));
+#endif
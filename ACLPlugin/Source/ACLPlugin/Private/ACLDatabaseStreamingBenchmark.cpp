@@ -0,0 +1,370 @@
+// Copyright 2020 Nicholas Frechette. All Rights Reserved.
+
+#include "CoreMinimal.h"
+
+// Benchmarks are only available in development builds when logging is enabled
+#define WITH_ACL_DATABASE_STREAMING_BENCHMARK (!UE_BUILD_SHIPPING && !UE_BUILD_TEST && !NO_LOGGING)
+
+#if WITH_ACL_DATABASE_STREAMING_BENCHMARK
+#include "AnimationCompressionLibraryDatabase.h"
+#include "ACLIoUring.h"
+#include "UE4DatabaseStreamer.h"
+
+#include "AnimationCompression.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "UObject/UObjectIterator.h"
+
+#if PLATFORM_LINUX
+#include <sys/resource.h>
+#endif
+
+// Defined in AnimationCompressionLibraryDatabase.cpp
+const TCHAR* VisualFidelityToString(ACLVisualFidelity Fidelity);
+
+/** How long a scripted sequence of visual fidelity changes can take before we give up, in seconds. */
+static constexpr double MaxFidelityChangeTime = 30.0;
+
+/** The number of frames decompressed at every visual fidelity to measure its steady state decode cost. */
+static constexpr int32 NumSteadyStateFrames = 16;
+
+static constexpr int32 NumVisualFidelities = 3;
+
+/** Returns the CPU time consumed by every thread of the process, in seconds, or a negative value if unsupported. */
+static double GetProcessCPUTime()
+{
+#if PLATFORM_LINUX
+	rusage Usage;
+	if (getrusage(RUSAGE_SELF, &Usage) == 0)
+	{
+		return double(Usage.ru_utime.tv_sec + Usage.ru_stime.tv_sec) + (double(Usage.ru_utime.tv_usec + Usage.ru_stime.tv_usec) * 1.0e-6);
+	}
+#endif
+
+	return -1.0;
+}
+
+/** Writes the decompressed pose into a buffer that we discard. */
+struct FACLStreamingBenchmarkPoseWriter final : public acl::track_writer
+{
+	TArray<rtm::qvvf>& Pose;
+
+	explicit FACLStreamingBenchmarkPoseWriter(TArray<rtm::qvvf>& Pose_) : Pose(Pose_) {}
+
+	void RTM_SIMD_CALL write_rotation(uint32_t TrackIndex, rtm::quatf_arg0 Rotation) { Pose[TrackIndex].rotation = Rotation; }
+	void RTM_SIMD_CALL write_translation(uint32_t TrackIndex, rtm::vector4f_arg0 Translation) { Pose[TrackIndex].translation = Translation; }
+	void RTM_SIMD_CALL write_scale(uint32_t TrackIndex, rtm::vector4f_arg0 Scale) { Pose[TrackIndex].scale = Scale; }
+};
+
+/** The decode cost measured while a visual fidelity is current. */
+struct FACLTierDecodeCost
+{
+	double TotalTime = 0.0;	// Summed over every task, in seconds
+	uint64 NumPoses = 0;
+
+	double GetNsPerPose() const { return NumPoses != 0 ? (TotalTime * 1.0e9) / double(NumPoses) : 0.0; }
+};
+
+/** The measurements of a scripted sequence of visual fidelity changes. */
+struct FACLFidelityChangeMeasurements
+{
+	double Time = 0.0;
+	int32 NumFrames = 0;
+	bool bTimedOut = false;
+
+	/** The CPU time consumed by the process, decompression included, in seconds. Negative if unsupported. */
+	double ProcessCPUTime = -1.0;
+
+	FACLDatabaseStreamingStats Stats;
+#if WITH_ACL_IO_URING
+	FACLIoUringStats IoUringStats;
+#endif
+	FACLTierDecodeCost DecodeCosts[NumVisualFidelities];
+};
+
+/**
+ * Replays visual fidelity changes on a cooked database while the task graph decompresses its sequences every frame.
+ * Frames are simulated back to back: the streaming update runs first on the game thread followed by the decompression
+ * load, streaming out cannot happen while animations decompress.
+ */
+struct FACLDatabaseStreamingBenchmark
+{
+	UAnimationCompressionLibraryDatabase& Database;
+	UE4DatabaseStreamer& Streamer;
+
+	TArray<const acl::compressed_tracks*> Clips;
+	uint32 MaxNumTracks;
+
+	int32 NumTasks;
+	int32 NumPosesPerFrame;
+	int32 FrameIndex;
+
+	FACLDatabaseStreamingBenchmark(UAnimationCompressionLibraryDatabase& Database_, UE4DatabaseStreamer& Streamer_, int32 NumPosesPerFrame_)
+		: Database(Database_)
+		, Streamer(Streamer_)
+		, MaxNumTracks(0)
+		, NumTasks(FMath::Max(FTaskGraphInterface::Get().GetNumWorkerThreads(), 1))
+		, NumPosesPerFrame(NumPosesPerFrame_)
+		, FrameIndex(0)
+	{
+		// Every sequence contained in the database, in the order they are laid out
+		for (uint64 Mapping : Database.CookedAnimSequenceMappings)
+		{
+			const uint32 CompressedClipOffset = uint32(Mapping);	// Truncate top 32 bits
+			const acl::compressed_tracks* CompressedClipData = acl::make_compressed_tracks(Database.CookedCompressedBytesView.GetData() + CompressedClipOffset);
+			if (CompressedClipData != nullptr && CompressedClipData->is_valid(false).empty())
+			{
+				Clips.Add(CompressedClipData);
+				MaxNumTracks = FMath::Max(MaxNumTracks, CompressedClipData->get_num_tracks());
+			}
+		}
+	}
+
+	/** Updates the streaming and decompresses a frame worth of poses, the decode cost is recorded against the current visual fidelity. */
+	void RunFrame(FACLFidelityChangeMeasurements& Measurements)
+	{
+		if (Database.FidelityChangeRequests.Num() != 0)
+		{
+			Database.UpdateVisualFidelityTicker(0.0f);
+		}
+
+		TArray<double> TaskTimes;
+		TaskTimes.SetNumZeroed(NumTasks);
+
+		FGraphEventArray Tasks;
+		for (int32 TaskIndex = 0; TaskIndex < NumTasks; ++TaskIndex)
+		{
+			Tasks.Add(FFunctionGraphTask::CreateAndDispatchWhenReady([this, TaskIndex, &TaskTimes]()
+				{
+					TArray<rtm::qvvf> Pose;
+					Pose.SetNumUninitialized(MaxNumTracks);
+					FACLStreamingBenchmarkPoseWriter Writer(Pose);
+
+					acl::decompression_context<UE4DefaultDBDecompressionSettings> ACLContext;
+
+					const double StartTime = FPlatformTime::Seconds();
+					for (int32 PoseIndex = TaskIndex; PoseIndex < NumPosesPerFrame; PoseIndex += NumTasks)
+					{
+						// Walk through the sequences and their duration as frames go by
+						const int32 SampleIndex = (FrameIndex * NumPosesPerFrame) + PoseIndex;
+						const acl::compressed_tracks* CompressedClipData = Clips[SampleIndex % Clips.Num()];
+						const float SampleTime = CompressedClipData->get_duration() * float((SampleIndex / Clips.Num()) % 32) / 32.0f;
+
+						ACLContext.initialize(*CompressedClipData, Database.DatabaseContext);
+						ACLContext.seek(SampleTime, acl::sample_rounding_policy::none);
+						ACLContext.decompress_tracks(Writer);
+					}
+					TaskTimes[TaskIndex] = FPlatformTime::Seconds() - StartTime;
+				}, TStatId(), nullptr, ENamedThreads::AnyHiPriThreadHiPriTask));
+		}
+
+		FTaskGraphInterface::Get().WaitUntilTasksComplete(Tasks, ENamedThreads::GameThread);
+
+		// Only the streaming update changes the current visual fidelity, it is the one every task decompressed with
+		FACLTierDecodeCost& DecodeCost = Measurements.DecodeCosts[uint32(Database.CurrentVisualFidelity)];
+		for (double TaskTime : TaskTimes)
+		{
+			DecodeCost.TotalTime += TaskTime;
+		}
+		DecodeCost.NumPoses += NumPosesPerFrame;
+
+		Measurements.NumFrames++;
+		FrameIndex++;
+	}
+
+	/** Requests the visual fidelity changes, one per frame, and runs frames until the last one is reached. */
+	FACLFidelityChangeMeasurements RunScript(const TArray<ACLVisualFidelity>& Script)
+	{
+		FACLFidelityChangeMeasurements Measurements;
+
+		Streamer.ResetStats();
+#if WITH_ACL_IO_URING
+		FACLIoUring::Get().ResetStats();
+#endif
+		const double StartCPUTime = GetProcessCPUTime();
+		const double StartTime = FPlatformTime::Seconds();
+
+		for (ACLVisualFidelity Fidelity : Script)
+		{
+			Database.SetVisualFidelity(Fidelity);
+			RunFrame(Measurements);
+		}
+
+		while (Database.FidelityChangeRequests.Num() != 0)
+		{
+			if (FPlatformTime::Seconds() - StartTime > MaxFidelityChangeTime)
+			{
+				Measurements.bTimedOut = true;
+				break;
+			}
+
+			RunFrame(Measurements);
+		}
+
+		Measurements.Time = FPlatformTime::Seconds() - StartTime;
+		Measurements.ProcessCPUTime = StartCPUTime >= 0.0 ? GetProcessCPUTime() - StartCPUTime : -1.0;
+		Measurements.Stats = Streamer.GetStats();
+#if WITH_ACL_IO_URING
+		Measurements.IoUringStats = FACLIoUring::Get().GetStats();
+#endif
+		return Measurements;
+	}
+
+	/** Measures the decode cost once the database has settled at the provided visual fidelity. */
+	FACLTierDecodeCost MeasureSteadyState(ACLVisualFidelity Fidelity)
+	{
+		RunScript({ Fidelity });
+
+		FACLFidelityChangeMeasurements Measurements;
+		for (int32 SteadyStateFrameIndex = 0; SteadyStateFrameIndex < NumSteadyStateFrames; ++SteadyStateFrameIndex)
+		{
+			RunFrame(Measurements);
+		}
+
+		return Measurements.DecodeCosts[uint32(Fidelity)];
+	}
+
+	static void LogMeasurements(const TCHAR* Description, const FACLFidelityChangeMeasurements& Measurements, const FACLTierDecodeCost* SteadyStateCosts)
+	{
+		const FACLDatabaseStreamingStats& Stats = Measurements.Stats;
+
+		UE_LOG(LogAnimationCompression, Log, TEXT("%s: %.2f ms over %d frames%s"), Description, Measurements.Time * 1000.0, Measurements.NumFrames, Measurements.bTimedOut ? TEXT(" (timed out)") : TEXT(""));
+		UE_LOG(LogAnimationCompression, Log, TEXT("    %.2f MB read with %u stream in requests, %u stream out requests"), double(Stats.NumBytesStreamedIn) / (1024.0 * 1024.0), Stats.NumStreamInRequests, Stats.NumStreamOutRequests);
+		UE_LOG(LogAnimationCompression, Log, TEXT("    game thread blocked %.3f ms in WaitForStreamingToComplete (max %.3f ms)"), Stats.TotalWaitTime * 1000.0, Stats.MaxWaitTime * 1000.0);
+
+		if (Stats.NumCompletedStreamIns != 0)
+		{
+			UE_LOG(LogAnimationCompression, Log, TEXT("    stream in latency %.3f ms on average (max %.3f ms) with %s"),
+				(Stats.TotalStreamInLatency * 1000.0) / double(Stats.NumCompletedStreamIns), Stats.MaxStreamInLatency * 1000.0, Stats.bUsedIoUring ? TEXT("io_uring") : TEXT("the default IO path"));
+		}
+
+		if (Measurements.ProcessCPUTime >= 0.0)
+		{
+			UE_LOG(LogAnimationCompression, Log, TEXT("    process CPU time %.2f ms"), Measurements.ProcessCPUTime * 1000.0);
+		}
+
+#if WITH_ACL_IO_URING
+		const FACLIoUringStats& IoUringStats = Measurements.IoUringStats;
+		if (IoUringStats.NumReads != 0)
+		{
+			UE_LOG(LogAnimationCompression, Log, TEXT("    io_uring: %u reads in %u batches (%.2f MB), completion thread CPU time %.3f ms"),
+				IoUringStats.NumReads, IoUringStats.NumBatches, double(IoUringStats.NumBytesRead) / (1024.0 * 1024.0), IoUringStats.CompletionThreadCPUTime * 1000.0);
+		}
+#endif
+
+		for (int32 FidelityIndex = 0; FidelityIndex < NumVisualFidelities; ++FidelityIndex)
+		{
+			const FACLTierDecodeCost& DecodeCost = Measurements.DecodeCosts[FidelityIndex];
+			if (DecodeCost.NumPoses == 0)
+			{
+				continue;
+			}
+
+			const double SteadyStateNsPerPose = SteadyStateCosts[FidelityIndex].GetNsPerPose();
+			UE_LOG(LogAnimationCompression, Log, TEXT("    %s: %.1f ns/pose over %llu poses (%+.1f %% vs steady state)"),
+				VisualFidelityToString(ACLVisualFidelity(FidelityIndex)), DecodeCost.GetNsPerPose(), DecodeCost.NumPoses,
+				SteadyStateNsPerPose > 0.0 ? ((DecodeCost.GetNsPerPose() / SteadyStateNsPerPose) - 1.0) * 100.0 : 0.0);
+		}
+	}
+
+	static void Run(const TArray<FString>& Args)
+	{
+		// Make sure to log everything
+		const ELogVerbosity::Type OldVerbosity = LogAnimationCompression.GetVerbosity();
+		LogAnimationCompression.SetVerbosity(ELogVerbosity::All);
+
+		const int32 NumToggles = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 8;
+		const int32 NumPosesPerFrame = Args.Num() > 1 ? FMath::Max(FCString::Atoi(*Args[1]), 0) : 1024;
+
+		UAnimationCompressionLibraryDatabase* Database = nullptr;
+		if (Args.Num() > 2)
+		{
+			Database = LoadObject<UAnimationCompressionLibraryDatabase>(nullptr, *Args[2]);
+			if (Database == nullptr)
+			{
+				UE_LOG(LogAnimationCompression, Warning, TEXT("Failed to load the ACL database: %s"), *Args[2]);
+				LogAnimationCompression.SetVerbosity(OldVerbosity);
+				return;
+			}
+		}
+		else
+		{
+			for (TObjectIterator<UAnimationCompressionLibraryDatabase> It; It; ++It)
+			{
+				if (It->DatabaseStreamer && It->CookedAnimSequenceMappings.Num() != 0)
+				{
+					Database = *It;
+					break;
+				}
+			}
+		}
+
+		// Only cooked databases stream their tiers from disk
+		if (Database == nullptr || !Database->DatabaseStreamer || Database->CookedAnimSequenceMappings.Num() == 0)
+		{
+			UE_LOG(LogAnimationCompression, Log, TEXT("No cooked ACL database is loaded, cannot run the database streaming benchmark"));
+			LogAnimationCompression.SetVerbosity(OldVerbosity);
+			return;
+		}
+
+		FACLDatabaseStreamingBenchmark Benchmark(*Database, *static_cast<UE4DatabaseStreamer*>(Database->DatabaseStreamer.Get()), NumPosesPerFrame);
+		if (Benchmark.Clips.Num() == 0)
+		{
+			UE_LOG(LogAnimationCompression, Log, TEXT("ACL database %s contains no valid anim sequence, cannot run the database streaming benchmark"), *Database->GetPathName());
+			LogAnimationCompression.SetVerbosity(OldVerbosity);
+			return;
+		}
+
+		const ACLVisualFidelity OriginalFidelity = Database->CurrentVisualFidelity;
+
+		// The streaming logs would skew the timings
+		LogAnimationCompression.SetVerbosity(ELogVerbosity::Warning);
+
+		// Warm up the caches and the task graph workers
+		FACLFidelityChangeMeasurements WarmUpMeasurements;
+		Benchmark.RunFrame(WarmUpMeasurements);
+
+		FACLTierDecodeCost SteadyStateCosts[NumVisualFidelities];
+		SteadyStateCosts[uint32(ACLVisualFidelity::Highest)] = Benchmark.MeasureSteadyState(ACLVisualFidelity::Highest);
+		SteadyStateCosts[uint32(ACLVisualFidelity::Medium)] = Benchmark.MeasureSteadyState(ACLVisualFidelity::Medium);
+		SteadyStateCosts[uint32(ACLVisualFidelity::Lowest)] = Benchmark.MeasureSteadyState(ACLVisualFidelity::Lowest);
+
+		// Every script starts with the database at the highest visual fidelity
+		Benchmark.RunScript({ ACLVisualFidelity::Highest });
+		const FACLFidelityChangeMeasurements HighestToLowest = Benchmark.RunScript({ ACLVisualFidelity::Lowest });
+		const FACLFidelityChangeMeasurements LowestToHighest = Benchmark.RunScript({ ACLVisualFidelity::Highest });
+
+		// A new request every frame, the database goes through every queued change
+		TArray<ACLVisualFidelity> ToggleScript;
+		for (int32 ToggleIndex = 0; ToggleIndex < NumToggles; ++ToggleIndex)
+		{
+			ToggleScript.Add((ToggleIndex % 2) == 0 ? ACLVisualFidelity::Lowest : ACLVisualFidelity::Highest);
+		}
+		const FACLFidelityChangeMeasurements RapidToggling = Benchmark.RunScript(ToggleScript);
+
+		Benchmark.RunScript({ OriginalFidelity });
+
+		LogAnimationCompression.SetVerbosity(ELogVerbosity::All);
+
+		UE_LOG(LogAnimationCompression, Log, TEXT("===== ACL Database Streaming Benchmark ====="));
+		UE_LOG(LogAnimationCompression, Log, TEXT("%s: %d anim sequences, %d poses per frame, %d task graph worker threads"), *Database->GetPathName(), Benchmark.Clips.Num(), NumPosesPerFrame, Benchmark.NumTasks);
+
+		for (int32 FidelityIndex = 0; FidelityIndex < NumVisualFidelities; ++FidelityIndex)
+		{
+			UE_LOG(LogAnimationCompression, Log, TEXT("Steady state %s: %.1f ns/pose"), VisualFidelityToString(ACLVisualFidelity(FidelityIndex)), SteadyStateCosts[FidelityIndex].GetNsPerPose());
+		}
+
+		LogMeasurements(TEXT("Highest -> Lowest"), HighestToLowest, SteadyStateCosts);
+		LogMeasurements(TEXT("Lowest -> Highest"), LowestToHighest, SteadyStateCosts);
+		LogMeasurements(*FString::Printf(TEXT("Rapid toggling (%d changes)"), NumToggles), RapidToggling, SteadyStateCosts);
+
+		LogAnimationCompression.SetVerbosity(OldVerbosity);
+	}
+};
+
+static FAutoConsoleCommand DatabaseStreamingBenchmarkCommand(
+	TEXT("ACL.DatabaseStreamingBenchmark"),
+	TEXT("Replays visual fidelity changes on a cooked ACL database while its anim sequences decompress and measures the streaming. Arguments: number of rapid toggles (default 8), number of poses decompressed per frame (default 1024, 0 to only measure the streaming), database asset path (default the first loaded cooked database)"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&FACLDatabaseStreamingBenchmark::Run));
+#endif
@@ -5,6 +5,9 @@
 #include "CoreMinimal.h"
 
 #include "ACLImpl.h"
+#include "ACLPersistentPose.h"
+#include "ACLRetargetTable.h"
+#include "ACLUsageRecorder.h"
 
 #include <acl/decompression/decompress.h>
 #include <acl/decompression/database/database.h>
@@ -56,7 +59,7 @@ struct FAtomIndices
 /*
  * Output pose writer that can selectively skip certain tracks.
  */
-struct FUE4OutputWriter final : public acl::track_writer
+struct FUE4OutputWriter : public acl::track_writer
 {
 	// Raw pointer for performance reasons, caller is responsible for ensuring data is valid
 	FACLTransform* Atoms;
@@ -104,6 +107,56 @@ struct FUE4OutputWriter final : public acl::track_writer
 	}
 };
 
+/*
+ * Output pose writer for a persistent output pose. Constant and default sub-tracks are already present in the pose and skipped.
+ */
+struct FUE4PersistentOutputWriter : public FUE4OutputWriter
+{
+	// One bit per sub-track, set when the sub-track is constant or default
+	const uint32* StaticSubTracks;
+
+	FUE4PersistentOutputWriter(TArrayView<FTransform>& Atoms_, const FAtomIndices* TrackToAtomsMap_, const uint32* StaticSubTracks_)
+		: FUE4OutputWriter(Atoms_, TrackToAtomsMap_)
+		, StaticSubTracks(StaticSubTracks_)
+	{}
+
+	FORCEINLINE bool IsStaticSubTrack(uint32 SubTrackIndex) const { return (StaticSubTracks[SubTrackIndex / 32] & (1U << (SubTrackIndex % 32))) != 0; }
+
+	//////////////////////////////////////////////////////////////////////////
+	// Override the OutputWriter behavior
+	bool skip_track_rotation(uint32_t BoneIndex) const { return TrackToAtomsMap[BoneIndex].Rotation == 0xFFFF || IsStaticSubTrack((BoneIndex * 3) + 0); }
+	bool skip_track_translation(uint32_t BoneIndex) const { return TrackToAtomsMap[BoneIndex].Translation == 0xFFFF || IsStaticSubTrack((BoneIndex * 3) + 1); }
+	bool skip_track_scale(uint32_t BoneIndex) const { return TrackToAtomsMap[BoneIndex].Scale == 0xFFFF || IsStaticSubTrack((BoneIndex * 3) + 2); }
+};
+
+/*
+ * Output pose writer that retargets translations as they are written, this avoids a second pass over the pose.
+ */
+template<class BaseWriterType>
+struct TUE4RetargetOutputWriter final : public BaseWriterType
+{
+	const FACLRetargetTranslation* RetargetBones;
+	const FTrackToSkeletonMap* TrackToSkeletonMap;
+
+	template<typename... ArgTypes>
+	TUE4RetargetOutputWriter(const FACLActiveRetarget& Retarget, ArgTypes&&... Args)
+		: BaseWriterType(Forward<ArgTypes>(Args)...)
+		, RetargetBones(Retarget.Table->Bones.GetData())
+		, TrackToSkeletonMap(Retarget.TrackToSkeletonMap)
+	{}
+
+	//////////////////////////////////////////////////////////////////////////
+	// Called by the decoder to write out a translation value for a specified bone index
+	void RTM_SIMD_CALL write_translation(uint32_t BoneIndex, rtm::vector4f_arg0 Translation)
+	{
+		const FACLRetargetTranslation& Retarget = RetargetBones[TrackToSkeletonMap[BoneIndex].BoneTreeIndex];
+		const rtm::vector4f Scale = rtm::vector_set(Retarget.Scale);
+		const rtm::vector4f Offset = rtm::vector_load3(&Retarget.Offset.X);
+
+		BaseWriterType::write_translation(BoneIndex, rtm::vector_mul_add(Translation, Scale, Offset));
+	}
+};
+
 /*
 * Output track writer for a single track.
 */
@@ -227,6 +280,52 @@ template<class ACLContextType>
 	// We will decompress the whole pose even if we only care about a smaller subset of bone tracks.
 	// This ensures we read the compressed pose data once, linearly.
 
+	// When the caller retargets inline, translations are retargeted as they are written
+	const FACLActiveRetarget* Retarget = GetActiveRetarget();
+
+#if DO_CHECK
+	if (Retarget != nullptr)
+	{
+		checkf(Retarget->NumTracks == ACLBoneCount, TEXT("Invalid track to skeleton map size: %d, expected %d"), Retarget->NumTracks, ACLBoneCount);
+
+		for (int32 TrackIndex = 0; TrackIndex < ACLBoneCount; ++TrackIndex)
+		{
+			checkf(Retarget->Table->Bones.IsValidIndex(Retarget->TrackToSkeletonMap[TrackIndex].BoneTreeIndex), TEXT("Invalid skeleton bone index: %d"), Retarget->TrackToSkeletonMap[TrackIndex].BoneTreeIndex);
+		}
+	}
+#endif
+
+	// When the caller keeps a persistent output pose, constant and default tracks are only written once
+	FACLPersistentPoseState* PersistentState = GetActivePersistentPoseState();
+	if (PersistentState != nullptr)
+	{
+		// Constant tracks remain valid only as long as they are mapped and retargeted the same way
+		// The caller provides the mapping key with the scope, we don't hash our track to atoms map on every decompression
+		const uint32 TrackMappingHash = HashCombine(PersistentState->GetBoneMappingKey(), PointerHash(Retarget != nullptr ? Retarget->Table : nullptr));
+
+		if (PersistentState->Prepare(*CompressedClipData, OutAtoms, TrackMappingHash))
+		{
+			if (Retarget != nullptr)
+			{
+				TUE4RetargetOutputWriter<FUE4PersistentOutputWriter> PoseWriter(*Retarget, OutAtoms, TrackToAtomsMap, PersistentState->GetStaticSubTracks());
+				ACLContext.decompress_tracks(PoseWriter);
+			}
+			else
+			{
+				FUE4PersistentOutputWriter PoseWriter(OutAtoms, TrackToAtomsMap, PersistentState->GetStaticSubTracks());
+				ACLContext.decompress_tracks(PoseWriter);
+			}
+			return;
+		}
+	}
+
+	if (Retarget != nullptr)
+	{
+		TUE4RetargetOutputWriter<FUE4OutputWriter> PoseWriter(*Retarget, OutAtoms, TrackToAtomsMap);
+		ACLContext.decompress_tracks(PoseWriter);
+		return;
+	}
+
 	FUE4OutputWriter PoseWriter(OutAtoms, TrackToAtomsMap);
 	ACLContext.decompress_tracks(PoseWriter);
 }
@@ -2,10 +2,133 @@
 
 #include "ACLImpl.h"
 
+#include "HAL/IConsoleManager.h"
+
+static TAutoConsoleVariable<float> CVarACLDecodeCostNsPerUnit(
+	TEXT("ACL.DecodeCostNsPerUnit"),
+	1.0f,
+	TEXT("The number of nanoseconds per ACL decode cost unit on this platform. Use 'ACL.CalibrateDecodeCost' to measure it."),
+	ECVF_Default);
+
+/**
+ * The relative decode cost weights: variable bit rate sub-tracks require unpacking while full precision sub-tracks are plain loads,
+ * and every track must be written out regardless of whether it is animated. They are initial guesses, 'ACL.CalibrateDecodeCost' fits them
+ * against measurements and prints the values to paste here. Changing them changes the candidates retained by the auto codec and must bump its DDC key.
+ */
+namespace ACLDecodeCost
+{
+	static constexpr float PoseSetup = 120.0f;
+	static constexpr float SegmentSeek = 6.0f;
+	static constexpr float OutputTrack = 3.0f;
+	static constexpr float FullRotationSubTrack = 6.0f;
+	static constexpr float VariableRotationSubTrack = 14.0f;
+	static constexpr float FullVectorSubTrack = 4.0f;
+	static constexpr float VariableVectorSubTrack = 9.0f;
+	static constexpr float DatabaseSubTrack = 2.0f;
+
+	/** Indexed by EACLDecodeCostTerm. */
+	static constexpr float Weights[] = { PoseSetup, SegmentSeek, OutputTrack, FullRotationSubTrack, VariableRotationSubTrack, FullVectorSubTrack, VariableVectorSubTrack, DatabaseSubTrack };
+	static const TCHAR* const Names[] = { TEXT("PoseSetup"), TEXT("SegmentSeek"), TEXT("OutputTrack"), TEXT("FullRotationSubTrack"), TEXT("VariableRotationSubTrack"), TEXT("FullVectorSubTrack"), TEXT("VariableVectorSubTrack"), TEXT("DatabaseSubTrack") };
+
+	static_assert(UE_ARRAY_COUNT(Weights) == (int32)EACLDecodeCostTerm::Count, "Every decode cost term requires a weight");
+	static_assert(UE_ARRAY_COUNT(Names) == (int32)EACLDecodeCostTerm::Count, "Every decode cost term requires a name");
+}
+
+const TCHAR* GetDecodeCostTermName(EACLDecodeCostTerm Term)
+{
+	return ACLDecodeCost::Names[(int32)Term];
+}
+
+float GetDecodeCostTermWeight(EACLDecodeCostTerm Term)
+{
+	return ACLDecodeCost::Weights[(int32)Term];
+}
+
+bool GetDecodeCostTermCounts(const acl::compressed_tracks& CompressedTracks, float OutCounts[(int32)EACLDecodeCostTerm::Count])
+{
+	FMemory::Memzero(OutCounts, sizeof(float) * (int32)EACLDecodeCostTerm::Count);
+
+	if (CompressedTracks.get_track_type() != acl::track_type8::qvvf)
+	{
+		return false;
+	}
+
+	const acl::acl_impl::tracks_header& TracksHeader = acl::acl_impl::get_tracks_header(CompressedTracks);
+	const acl::acl_impl::transform_tracks_header& TransformHeader = acl::acl_impl::get_transform_tracks_header(CompressedTracks);
+
+	const bool bIsRotationVariable = acl::is_rotation_format_variable(TracksHeader.get_rotation_format());
+	const bool bIsTranslationVariable = acl::is_vector_format_variable(TracksHeader.get_translation_format());
+	const bool bIsScaleVariable = acl::is_vector_format_variable(TracksHeader.get_scale_format());
+
+	const uint32 NumAnimatedRotations = TransformHeader.num_animated_rotation_sub_tracks;
+	const uint32 NumAnimatedTranslations = TransformHeader.num_animated_translation_sub_tracks;
+	const uint32 NumAnimatedScales = TracksHeader.get_has_scale() ? TransformHeader.num_animated_scale_sub_tracks : 0;
+
+	OutCounts[(int32)EACLDecodeCostTerm::PoseSetup] = 1.0f;
+
+	// Seeking searches the segment that contains our sample
+	OutCounts[(int32)EACLDecodeCostTerm::SegmentSeek] = float(FMath::CeilLogTwo(FMath::Max<uint32>(TransformHeader.num_segments, 1)));
+
+	OutCounts[(int32)EACLDecodeCostTerm::OutputTrack] = float(CompressedTracks.get_num_tracks());
+	OutCounts[(int32)(bIsRotationVariable ? EACLDecodeCostTerm::VariableRotationSubTrack : EACLDecodeCostTerm::FullRotationSubTrack)] += float(NumAnimatedRotations);
+	OutCounts[(int32)(bIsTranslationVariable ? EACLDecodeCostTerm::VariableVectorSubTrack : EACLDecodeCostTerm::FullVectorSubTrack)] += float(NumAnimatedTranslations);
+	OutCounts[(int32)(bIsScaleVariable ? EACLDecodeCostTerm::VariableVectorSubTrack : EACLDecodeCostTerm::FullVectorSubTrack)] += float(NumAnimatedScales);
+
+	// Sequences bound to a database must also lookup which key frames are streamed in
+	if (TracksHeader.get_has_database())
+	{
+		OutCounts[(int32)EACLDecodeCostTerm::DatabaseSubTrack] = float(NumAnimatedRotations + NumAnimatedTranslations + NumAnimatedScales);
+	}
+
+	return true;
+}
+
+float EstimateDecodeCostUnits(const acl::compressed_tracks& CompressedTracks)
+{
+	float Counts[(int32)EACLDecodeCostTerm::Count];
+	if (!GetDecodeCostTermCounts(CompressedTracks, Counts))
+	{
+		return 0.0f;
+	}
+
+	float Cost = 0.0f;
+	for (int32 TermIndex = 0; TermIndex < (int32)EACLDecodeCostTerm::Count; ++TermIndex)
+	{
+		Cost += ACLDecodeCost::Weights[TermIndex] * Counts[TermIndex];
+	}
+
+	return Cost;
+}
+
+uint32 EstimateBytesTouchedPerSample(const acl::compressed_tracks& CompressedTracks)
+{
+	if (CompressedTracks.get_track_type() != acl::track_type8::qvvf)
+	{
+		return CompressedTracks.get_size();
+	}
+
+	// Sampling only reads the segment that contains our sample along with the clip wide data
+	// Segments hold roughly the same number of samples, the average segment footprint is a good approximation
+	const acl::acl_impl::transform_tracks_header& TransformHeader = acl::acl_impl::get_transform_tracks_header(CompressedTracks);
+	const uint32 NumSegments = FMath::Max<uint32>(TransformHeader.num_segments, 1);
+
+	return FMath::DivideAndRoundUp<uint32>(CompressedTracks.get_size(), NumSegments);
+}
+
+float DecodeCostUnitsToNanoseconds(float DecodeCostUnits)
+{
+	return DecodeCostUnits * CVarACLDecodeCostNsPerUnit.GetValueOnAnyThread();
+}
+
 #if WITH_EDITOR
+#include "AnimBoneCompressionCodec_ACLBase.h"
 #include "AnimationCompression.h"
 #include "AnimationUtils.h"
 #include "Animation/AnimCompressionTypes.h"
+#include "HAL/ThreadSafeCounter.h"
+#include "Interfaces/ITargetPlatform.h"
+#include "Interfaces/ITargetPlatformManagerModule.h"
+#include "PlatformInfo.h"
 
 acl::rotation_format8 GetRotationFormat(ACLRotationFormat Format)
 {
@@ -14,7 +137,7 @@ acl::rotation_format8 GetRotationFormat(ACLRotationFormat Format)
 	default:
 	case ACLRF_Quat_128:			return acl::rotation_format8::quatf_full;
 	case ACLRF_QuatDropW_96:		return acl::rotation_format8::quatf_drop_w_full;
-	case ACLRF_QuatDropW_Variable:	return acl::rotation_format8::quatf_drop_w_full;
+	case ACLRF_QuatDropW_Variable:	return acl::rotation_format8::quatf_drop_w_variable;
 	}
 }
 
@@ -41,6 +164,55 @@ acl::compression_level8 GetCompressionLevel(ACLCompressionLevel Level)
 	}
 }
 
+const ITargetPlatform* GetCompressionTargetPlatform()
+{
+	ITargetPlatformManagerModule* TargetPlatformManager = GetTargetPlatformManager();
+	if (TargetPlatformManager == nullptr)
+	{
+		return nullptr;
+	}
+
+	// When cooking, the active platforms are the cook targets, otherwise it is the platform we run on.
+	// UE 4.25 and 4.26 do not pass the cook target down to the codecs, anim sequences are compressed once for every
+	// platform. We have no way to know which platform a sequence is compressed for when we cook for several at once.
+	const TArray<ITargetPlatform*>& ActivePlatforms = TargetPlatformManager->GetActiveTargetPlatforms();
+	if (ActivePlatforms.Num() > 1)
+	{
+		return nullptr;
+	}
+
+	return ActivePlatforms.Num() == 1 ? ActivePlatforms[0] : TargetPlatformManager->GetRunningTargetPlatform();
+}
+
+template<typename PerPlatformType>
+static auto GetPerPlatformValueImpl(const PerPlatformType& Property) -> decltype(Property.Default)
+{
+	const ITargetPlatform* TargetPlatform = GetCompressionTargetPlatform();
+	if (TargetPlatform == nullptr)
+	{
+		if (Property.PerPlatform.Num() != 0)
+		{
+			// The data we compress is shared by every platform being cooked, it can only honor a single value
+			static FThreadSafeCounter NumWarnings;
+			if (NumWarnings.Increment() == 1)
+			{
+				UE_LOG(LogAnimationCompression, Warning, TEXT("ACL per platform overrides are ignored when cooking for several platforms at once, the default values are used instead. Cook each platform that overrides ACL settings in its own session."));
+			}
+		}
+
+		return Property.Default;
+	}
+
+	return Property.GetValueForPlatformIdentifiers(
+		TargetPlatform->GetPlatformInfo().PlatformGroupName,
+		TargetPlatform->GetPlatformInfo().VanillaPlatformName);
+}
+
+float GetPerPlatformValue(const FPerPlatformFloat& Property) { return GetPerPlatformValueImpl(Property); }
+int32 GetPerPlatformValue(const FPerPlatformInt& Property) { return GetPerPlatformValueImpl(Property); }
+bool GetPerPlatformValue(const FPerPlatformBool& Property) { return GetPerPlatformValueImpl(Property); }
+ACLCompressionLevel GetPerPlatformValue(const FPerPlatformACLCompressionLevel& Property) { return GetPerPlatformValueImpl(Property).GetValue(); }
+
 static int32 FindAnimationTrackIndex(const FCompressibleAnimData& CompressibleAnimData, int32 BoneIndex)
 {
 	const TArray<FTrackToSkeletonMap>& TrackToSkelMap = CompressibleAnimData.TrackToSkeletonMapTable;
@@ -165,4 +337,62 @@ acl::track_array_qvvf BuildACLTransformTrackArray(ACLAllocator& AllocatorImpl, c
 
 	return Tracks;
 }
+
+/** Writes sampled raw values into a track array at a specific sample index. */
+struct FResampledTrackWriter final : public acl::track_writer
+{
+	FResampledTrackWriter(acl::track_array_qvvf& Tracks_, uint32 SampleIndex_) : Tracks(Tracks_), SampleIndex(SampleIndex_) {}
+
+	acl::track_array_qvvf& Tracks;
+	uint32 SampleIndex;
+
+	void RTM_SIMD_CALL write_rotation(uint32_t TrackIndex, rtm::quatf_arg0 Rotation)
+	{
+		Tracks[TrackIndex][SampleIndex].rotation = Rotation;
+	}
+
+	void RTM_SIMD_CALL write_translation(uint32_t TrackIndex, rtm::vector4f_arg0 Translation)
+	{
+		Tracks[TrackIndex][SampleIndex].translation = Translation;
+	}
+
+	void RTM_SIMD_CALL write_scale(uint32_t TrackIndex, rtm::vector4f_arg0 Scale)
+	{
+		Tracks[TrackIndex][SampleIndex].scale = Scale;
+	}
+};
+
+acl::track_array_qvvf ResampleACLTransformTrackArray(ACLAllocator& AllocatorImpl, const acl::track_array_qvvf& Tracks, float MaxSampleRate)
+{
+	const uint32 NumTracks = Tracks.get_num_tracks();
+	const float Duration = Tracks.get_duration();
+
+	// We keep the exact same duration which means our new sample rate can end up slightly lower than the maximum requested
+	const uint32 NumSamples = FMath::Max<uint32>(FMath::FloorToInt(Duration * MaxSampleRate), 1) + 1;
+	const float SampleRate = float(NumSamples - 1) / Duration;
+
+	acl::track_array_qvvf ResampledTracks(AllocatorImpl, NumTracks);
+	ResampledTracks.set_name(acl::string(AllocatorImpl, Tracks.get_name().c_str()));
+
+	for (uint32 TrackIndex = 0; TrackIndex < NumTracks; ++TrackIndex)
+	{
+		const acl::track_qvvf& Track = Tracks[TrackIndex];
+
+		acl::track_qvvf ResampledTrack = acl::track_qvvf::make_reserve(Track.get_description(), AllocatorImpl, NumSamples, SampleRate);
+		ResampledTrack.set_name(acl::string(AllocatorImpl, Track.get_name().c_str()));
+
+		ResampledTracks[TrackIndex] = MoveTemp(ResampledTrack);
+	}
+
+	for (uint32 SampleIndex = 0; SampleIndex < NumSamples; ++SampleIndex)
+	{
+		// Clamp the last sample to avoid any floating point drift past the end
+		const float SampleTime = FMath::Min(float(SampleIndex) / SampleRate, Duration);
+
+		FResampledTrackWriter Writer(ResampledTracks, SampleIndex);
+		Tracks.sample_tracks(SampleTime, acl::sample_rounding_policy::none, Writer);
+	}
+
+	return ResampledTracks;
+}
 #endif	// WITH_EDITOR
@@ -0,0 +1,694 @@
+// Copyright 2020 Nicholas Frechette. All Rights Reserved.
+
+#include "ACLIoUring.h"
+
+#if WITH_ACL_IO_URING
+#include "AnimationCompression.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/RunnableThread.h"
+#include "HAL/UnrealMemory.h"
+#include "Misc/ScopeLock.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+static TAutoConsoleVariable<int32> CVarACLDatabaseIoUring(
+	TEXT("ACL.DatabaseIoUring"),
+	0,
+	TEXT("Whether or not cooked ACL databases stream their bulk data with io_uring on Linux. Requires Linux 5.1 or later and loose bulk data files, otherwise the default IO path is used."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarACLDatabaseIoUringDirectIO(
+	TEXT("ACL.DatabaseIoUring.DirectIO"),
+	0,
+	TEXT("Whether or not the io_uring database streaming bypasses the page cache with O_DIRECT."),
+	ECVF_Default);
+
+// The system headers of the UE4 toolchain predate io_uring, the system call numbers are shared by every architecture
+#ifndef __NR_io_uring_setup
+	#define __NR_io_uring_setup 425
+#endif
+#ifndef __NR_io_uring_enter
+	#define __NR_io_uring_enter 426
+#endif
+#ifndef __NR_io_uring_register
+	#define __NR_io_uring_register 427
+#endif
+
+#ifndef O_DIRECT
+	#if defined(__aarch64__)
+		#define O_DIRECT 0200000
+	#else
+		#define O_DIRECT 040000
+	#endif
+#endif
+
+/** The kernel ABI, see linux/io_uring.h */
+namespace ACLIoUringABI
+{
+	static constexpr uint64 SubmissionRingOffset = 0;
+	static constexpr uint64 CompletionRingOffset = 0x8000000;
+	static constexpr uint64 SubmissionEntriesOffset = 0x10000000;
+
+	static constexpr uint32 EnterGetEvents = 1;
+	static constexpr uint32 RegisterBuffers = 0;
+	static constexpr uint32 UnregisterBuffers = 1;
+	static constexpr uint32 FeatureSingleMmap = 1;
+
+	static constexpr uint8 OpNop = 0;
+	static constexpr uint8 OpReadv = 1;
+	static constexpr uint8 OpReadFixed = 4;
+
+	struct FSubmissionEntry
+	{
+		uint8 Opcode;
+		uint8 Flags;
+		uint16 IoPriority;
+		int32 FileHandle;
+		uint64 Offset;
+		uint64 Address;
+		uint32 Length;
+		uint32 OpFlags;
+		uint64 UserData;
+		uint16 BufferIndex;
+		uint16 Personality;
+		int32 SpliceFileHandle;
+		uint64 Padding[2];
+	};
+	static_assert(sizeof(FSubmissionEntry) == 64, "Unexpected io_uring_sqe size");
+
+	struct FCompletionEntry
+	{
+		uint64 UserData;
+		int32 Result;
+		uint32 Flags;
+	};
+	static_assert(sizeof(FCompletionEntry) == 16, "Unexpected io_uring_cqe size");
+
+	struct FSubmissionRingOffsets
+	{
+		uint32 Head;
+		uint32 Tail;
+		uint32 RingMask;
+		uint32 RingEntries;
+		uint32 Flags;
+		uint32 Dropped;
+		uint32 Array;
+		uint32 Reserved0;
+		uint64 Reserved1;
+	};
+
+	struct FCompletionRingOffsets
+	{
+		uint32 Head;
+		uint32 Tail;
+		uint32 RingMask;
+		uint32 RingEntries;
+		uint32 Overflow;
+		uint32 Entries;
+		uint32 Flags;
+		uint32 Reserved0;
+		uint64 Reserved1;
+	};
+
+	struct FParams
+	{
+		uint32 SubmissionEntries;
+		uint32 CompletionEntries;
+		uint32 Flags;
+		uint32 SubmissionThreadCPU;
+		uint32 SubmissionThreadIdle;
+		uint32 Features;
+		uint32 WorkQueueHandle;
+		uint32 Reserved[3];
+		FSubmissionRingOffsets SubmissionRing;
+		FCompletionRingOffsets CompletionRing;
+	};
+	static_assert(sizeof(FParams) == 120, "Unexpected io_uring_params size");
+}
+
+/** Every in-flight chunk owns a slot, a registered buffer. O_DIRECT requires reads aligned to the logical block size. */
+static constexpr int32 NumBufferSlots = 16;
+static constexpr uint32 BufferSlotSize = 256 * 1024;
+static constexpr uint32 DirectIOAlignment = 4096;
+
+/** One submission per slot and one to wake the completion thread. */
+static constexpr uint32 RingNumEntries = NumBufferSlots * 2;
+
+static constexpr uint64 WakeUserData = ~uint64(0);
+
+struct FACLIoUring::FReadRequest
+{
+	int32 FileHandle;
+
+	/** The requested range. */
+	uint64 Offset;
+	uint32 Size;
+	uint8* Destination;
+
+	/** The range read from disk, aligned for O_DIRECT. ReadOffset is the next chunk to submit. */
+	uint64 ReadOffset;
+	uint64 ReadEnd;
+
+	int32 NumInFlightReads;
+	bool bFailed;
+
+	TFunction<void(bool bSuccess)> OnComplete;
+};
+
+struct FACLIoUring::FSlot
+{
+	uint8* Buffer;
+	iovec Vector;
+
+	FReadRequest* Request;
+	uint64 FileOffset;
+	uint32 Length;
+};
+
+static int32 IoUringSetup(uint32 NumEntries, ACLIoUringABI::FParams& Params)
+{
+	return int32(syscall(__NR_io_uring_setup, NumEntries, &Params));
+}
+
+static int32 IoUringEnter(int32 RingHandle, uint32 NumToSubmit, uint32 MinComplete, uint32 Flags)
+{
+	return int32(syscall(__NR_io_uring_enter, RingHandle, NumToSubmit, MinComplete, Flags, nullptr, 0));
+}
+
+static int32 IoUringRegister(int32 RingHandle, uint32 Opcode, const void* Args, uint32 NumArgs)
+{
+	return int32(syscall(__NR_io_uring_register, RingHandle, Opcode, Args, NumArgs));
+}
+
+static uint64 GetThreadCPUTimeNs()
+{
+	timespec Time;
+	if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &Time) != 0)
+	{
+		return 0;
+	}
+
+	return (uint64(Time.tv_sec) * 1000000000ull) + uint64(Time.tv_nsec);
+}
+
+FACLIoUring& FACLIoUring::Get()
+{
+	static FACLIoUring IoUring;
+	return IoUring;
+}
+
+bool FACLIoUring::IsEnabled()
+{
+	return CVarACLDatabaseIoUring.GetValueOnAnyThread() != 0;
+}
+
+bool FACLIoUring::UseDirectIO()
+{
+	return CVarACLDatabaseIoUringDirectIO.GetValueOnAnyThread() != 0;
+}
+
+FACLIoUringFile FACLIoUring::OpenFile(const FString& Filename, bool bDirectIO)
+{
+	FACLIoUringFile File;
+	File.Handle = open(TCHAR_TO_UTF8(*Filename), O_RDONLY | O_CLOEXEC | (bDirectIO ? O_DIRECT : 0));
+	File.bDirectIO = bDirectIO;
+	return File;
+}
+
+void FACLIoUring::CloseFile(FACLIoUringFile& File)
+{
+	if (File.IsValid())
+	{
+		close(File.Handle);
+		File.Handle = -1;
+	}
+}
+
+FACLIoUring::FACLIoUring()
+	: RingHandle(-1)
+	, bIsInitialized(false)
+	, bIsShuttingDown(false)
+	, bUseRegisteredBuffers(false)
+	, SubmissionRing(nullptr)
+	, SubmissionRingSize(0)
+	, CompletionRing(nullptr)
+	, CompletionRingSize(0)
+	, SubmissionEntries(nullptr)
+	, SubmissionEntriesSize(0)
+	, SubmissionHead(nullptr)
+	, SubmissionTail(nullptr)
+	, SubmissionRingMask(0)
+	, SubmissionArray(nullptr)
+	, CompletionHead(nullptr)
+	, CompletionTail(nullptr)
+	, CompletionRingMask(0)
+	, CompletionEntries(nullptr)
+	, SlotMemory(nullptr)
+	, CompletionThread(nullptr)
+	, NumReads(0)
+	, NumBatches(0)
+	, NumBytesRead(0)
+	, CompletionThreadCPUTimeNs(0)
+	, CompletionThreadCPUTimeBaselineNs(0)
+{
+}
+
+bool FACLIoUring::IsAvailable()
+{
+	FScopeLock ScopeLock(&Lock);
+
+	if (!bIsInitialized)
+	{
+		Initialize();
+	}
+
+	return RingHandle >= 0 && !bIsShuttingDown;
+}
+
+void FACLIoUring::Initialize()
+{
+	using namespace ACLIoUringABI;
+
+	bIsInitialized = true;
+
+	FParams Params;
+	FMemory::Memzero(Params);
+
+	RingHandle = IoUringSetup(RingNumEntries, Params);
+	if (RingHandle < 0)
+	{
+		UE_LOG(LogAnimationCompression, Warning, TEXT("ACL failed to create an io_uring instance (errno %d), databases will stream with the default IO path"), errno);
+		return;
+	}
+
+	SubmissionRingSize = Params.SubmissionRing.Array + (Params.SubmissionEntries * sizeof(uint32));
+	CompletionRingSize = Params.CompletionRing.Entries + (Params.CompletionEntries * sizeof(FCompletionEntry));
+	SubmissionEntriesSize = Params.SubmissionEntries * sizeof(FSubmissionEntry);
+
+	// Since Linux 5.4, both rings live in a single mapping
+	const bool bSingleMmap = (Params.Features & FeatureSingleMmap) != 0;
+	if (bSingleMmap)
+	{
+		SubmissionRingSize = CompletionRingSize = FMath::Max(SubmissionRingSize, CompletionRingSize);
+	}
+
+	SubmissionRing = mmap(nullptr, SubmissionRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, RingHandle, SubmissionRingOffset);
+	CompletionRing = bSingleMmap ? SubmissionRing : mmap(nullptr, CompletionRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, RingHandle, CompletionRingOffset);
+	SubmissionEntries = mmap(nullptr, SubmissionEntriesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, RingHandle, SubmissionEntriesOffset);
+
+	if (SubmissionRing == MAP_FAILED || CompletionRing == MAP_FAILED || SubmissionEntries == MAP_FAILED)
+	{
+		UE_LOG(LogAnimationCompression, Warning, TEXT("ACL failed to map the io_uring queues (errno %d), databases will stream with the default IO path"), errno);
+		Destroy();
+		return;
+	}
+
+	uint8* SubmissionRingPtr = static_cast<uint8*>(SubmissionRing);
+	SubmissionHead = reinterpret_cast<uint32*>(SubmissionRingPtr + Params.SubmissionRing.Head);
+	SubmissionTail = reinterpret_cast<uint32*>(SubmissionRingPtr + Params.SubmissionRing.Tail);
+	SubmissionRingMask = *reinterpret_cast<uint32*>(SubmissionRingPtr + Params.SubmissionRing.RingMask);
+	SubmissionArray = reinterpret_cast<uint32*>(SubmissionRingPtr + Params.SubmissionRing.Array);
+
+	uint8* CompletionRingPtr = static_cast<uint8*>(CompletionRing);
+	CompletionHead = reinterpret_cast<uint32*>(CompletionRingPtr + Params.CompletionRing.Head);
+	CompletionTail = reinterpret_cast<uint32*>(CompletionRingPtr + Params.CompletionRing.Tail);
+	CompletionRingMask = *reinterpret_cast<uint32*>(CompletionRingPtr + Params.CompletionRing.RingMask);
+	CompletionEntries = CompletionRingPtr + Params.CompletionRing.Entries;
+
+	SlotMemory = static_cast<uint8*>(FMemory::Malloc(SIZE_T(NumBufferSlots) * BufferSlotSize, DirectIOAlignment));
+
+	TArray<iovec> Vectors;
+	Slots.SetNum(NumBufferSlots);
+	for (int32 SlotIndex = 0; SlotIndex < NumBufferSlots; ++SlotIndex)
+	{
+		FSlot& Slot = Slots[SlotIndex];
+		Slot.Buffer = SlotMemory + (SIZE_T(SlotIndex) * BufferSlotSize);
+		Slot.Vector.iov_base = Slot.Buffer;
+		Slot.Vector.iov_len = BufferSlotSize;
+		Slot.Request = nullptr;
+		Slot.FileOffset = 0;
+		Slot.Length = 0;
+
+		Vectors.Add(Slot.Vector);
+		FreeSlots.Add(SlotIndex);
+	}
+
+	// Registered buffers are pinned once instead of on every read, this counts against RLIMIT_MEMLOCK
+	bUseRegisteredBuffers = IoUringRegister(RingHandle, RegisterBuffers, Vectors.GetData(), Vectors.Num()) == 0;
+	if (!bUseRegisteredBuffers)
+	{
+		UE_LOG(LogAnimationCompression, Log, TEXT("ACL failed to register the io_uring buffers (errno %d), reads will not use fixed buffers"), errno);
+	}
+
+	CompletionThread = FRunnableThread::Create(this, TEXT("ACLIoUringCompletion"), 0, TPri_AboveNormal);
+	if (CompletionThread == nullptr)
+	{
+		UE_LOG(LogAnimationCompression, Warning, TEXT("ACL failed to create the io_uring completion thread, databases will stream with the default IO path"));
+		Destroy();
+		return;
+	}
+
+	UE_LOG(LogAnimationCompression, Log, TEXT("ACL io_uring initialized with %d buffers of %u KB%s"), NumBufferSlots, BufferSlotSize / 1024, bUseRegisteredBuffers ? TEXT(" (registered)") : TEXT(""));
+}
+
+void FACLIoUring::Destroy()
+{
+	if (RingHandle >= 0 && bUseRegisteredBuffers)
+	{
+		IoUringRegister(RingHandle, ACLIoUringABI::UnregisterBuffers, nullptr, 0);
+	}
+
+	if (SubmissionEntries != nullptr && SubmissionEntries != MAP_FAILED)
+	{
+		munmap(SubmissionEntries, SubmissionEntriesSize);
+	}
+
+	if (CompletionRing != nullptr && CompletionRing != MAP_FAILED && CompletionRing != SubmissionRing)
+	{
+		munmap(CompletionRing, CompletionRingSize);
+	}
+
+	if (SubmissionRing != nullptr && SubmissionRing != MAP_FAILED)
+	{
+		munmap(SubmissionRing, SubmissionRingSize);
+	}
+
+	if (RingHandle >= 0)
+	{
+		close(RingHandle);
+	}
+
+	FMemory::Free(SlotMemory);
+
+	RingHandle = -1;
+	bUseRegisteredBuffers = false;
+	SubmissionRing = CompletionRing = SubmissionEntries = nullptr;
+	SlotMemory = nullptr;
+	Slots.Empty();
+	FreeSlots.Empty();
+}
+
+bool FACLIoUring::Read(const FACLIoUringFile& File, uint64 Offset, uint32 Size, uint8* Destination, TFunction<void(bool bSuccess)>&& OnComplete)
+{
+	check(File.IsValid());
+
+	{
+		FScopeLock ScopeLock(&Lock);
+
+		if (!bIsInitialized)
+		{
+			Initialize();
+		}
+
+		if (RingHandle < 0 || bIsShuttingDown)
+		{
+			return false;
+		}
+
+		if (Size != 0)
+		{
+			const uint64 Alignment = File.bDirectIO ? DirectIOAlignment : 1;
+
+			FReadRequest* Request = new FReadRequest();
+			Request->FileHandle = File.Handle;
+			Request->Offset = Offset;
+			Request->Size = Size;
+			Request->Destination = Destination;
+			Request->ReadOffset = AlignDown(Offset, Alignment);
+			Request->ReadEnd = Align(Offset + Size, Alignment);
+			Request->NumInFlightReads = 0;
+			Request->bFailed = false;
+			Request->OnComplete = MoveTemp(OnComplete);
+
+			PendingRequests.Add(Request);
+			SubmitPendingReads();
+			return true;
+		}
+	}
+
+	// Nothing to read
+	OnComplete(true);
+	return true;
+}
+
+void FACLIoUring::SubmitPendingReads()
+{
+	using namespace ACLIoUringABI;
+
+	FSubmissionEntry* Entries = static_cast<FSubmissionEntry*>(SubmissionEntries);
+
+	// We are the only producer, the kernel only updates the head
+	uint32 Tail = *SubmissionTail;
+	uint32 NumQueued = 0;
+
+	while (FreeSlots.Num() != 0 && PendingRequests.Num() != 0)
+	{
+		FReadRequest* Request = PendingRequests[0];
+
+		const int32 SlotIndex = FreeSlots.Pop(false);
+		FSlot& Slot = Slots[SlotIndex];
+		Slot.Request = Request;
+		Slot.FileOffset = Request->ReadOffset;
+		Slot.Length = uint32(FMath::Min<uint64>(Request->ReadEnd - Request->ReadOffset, BufferSlotSize));
+
+		const uint32 EntryIndex = Tail & SubmissionRingMask;
+		FSubmissionEntry& Entry = Entries[EntryIndex];
+		FMemory::Memzero(Entry);
+		Entry.FileHandle = Request->FileHandle;
+		Entry.Offset = Slot.FileOffset;
+		Entry.UserData = uint64(SlotIndex);
+
+		if (bUseRegisteredBuffers)
+		{
+			Entry.Opcode = OpReadFixed;
+			Entry.Address = uint64(Slot.Buffer);
+			Entry.Length = Slot.Length;
+			Entry.BufferIndex = uint16(SlotIndex);
+		}
+		else
+		{
+			Slot.Vector.iov_len = Slot.Length;
+
+			Entry.Opcode = OpReadv;
+			Entry.Address = uint64(&Slot.Vector);
+			Entry.Length = 1;
+		}
+
+		SubmissionArray[EntryIndex] = EntryIndex;
+		Tail++;
+		NumQueued++;
+
+		Request->ReadOffset += Slot.Length;
+		Request->NumInFlightReads++;
+		if (Request->ReadOffset == Request->ReadEnd)
+		{
+			PendingRequests.RemoveAt(0, 1, false);
+		}
+	}
+
+	if (NumQueued == 0)
+	{
+		return;
+	}
+
+	__atomic_store_n(SubmissionTail, Tail, __ATOMIC_RELEASE);
+
+	// The whole batch is submitted with a single system call
+	uint32 NumSubmitted = 0;
+	while (NumSubmitted < NumQueued)
+	{
+		const int32 Result = IoUringEnter(RingHandle, NumQueued - NumSubmitted, 0, 0);
+		if (Result < 0)
+		{
+			if (errno == EINTR || errno == EAGAIN || errno == EBUSY)
+			{
+				continue;
+			}
+
+			// The entries remain queued and will be submitted with the next batch
+			UE_LOG(LogAnimationCompression, Warning, TEXT("ACL failed to submit io_uring reads (errno %d)"), errno);
+			break;
+		}
+
+		NumSubmitted += uint32(Result);
+	}
+
+	NumReads += NumQueued;
+	NumBatches++;
+}
+
+uint32 FACLIoUring::Run()
+{
+	using namespace ACLIoUringABI;
+
+	const FCompletionEntry* Entries = static_cast<const FCompletionEntry*>(CompletionEntries);
+
+	TArray<FReadRequest*> CompletedRequests;
+	bool bWakeRequested = false;
+	bool bIsRunning = true;
+
+	while (bIsRunning)
+	{
+		const int32 Result = IoUringEnter(RingHandle, 0, 1, EnterGetEvents);
+		if (Result < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY)
+		{
+			UE_LOG(LogAnimationCompression, Warning, TEXT("ACL failed to wait on io_uring completions (errno %d)"), errno);
+		}
+
+		// We are the only consumer, the kernel only updates the tail
+		uint32 Head = *CompletionHead;
+		const uint32 Tail = __atomic_load_n(CompletionTail, __ATOMIC_ACQUIRE);
+
+		for (; Head != Tail; ++Head)
+		{
+			const FCompletionEntry& Entry = Entries[Head & CompletionRingMask];
+			if (Entry.UserData == WakeUserData)
+			{
+				bWakeRequested = true;
+				continue;
+			}
+
+			// The slot and its request are ours until the slot is freed
+			FSlot& Slot = Slots[int32(Entry.UserData)];
+			FReadRequest* Request = Slot.Request;
+
+			const uint64 CopyStart = FMath::Max(Slot.FileOffset, Request->Offset);
+			const uint64 CopyEnd = FMath::Min(Slot.FileOffset + Slot.Length, Request->Offset + Request->Size);
+
+			// Reads past the end of the file are short, we only need the requested range
+			if (Entry.Result >= 0 && uint64(Entry.Result) >= CopyEnd - Slot.FileOffset)
+			{
+				FMemory::Memcpy(Request->Destination + (CopyStart - Request->Offset), Slot.Buffer + (CopyStart - Slot.FileOffset), CopyEnd - CopyStart);
+				NumBytesRead += uint64(Entry.Result);
+			}
+			else
+			{
+				Request->bFailed = true;
+			}
+
+			FScopeLock ScopeLock(&Lock);
+
+			Slot.Request = nullptr;
+			FreeSlots.Add(int32(Entry.UserData));
+
+			Request->NumInFlightReads--;
+			if (Request->NumInFlightReads == 0 && Request->ReadOffset == Request->ReadEnd)
+			{
+				CompletedRequests.Add(Request);
+			}
+		}
+
+		__atomic_store_n(CompletionHead, Head, __ATOMIC_RELEASE);
+
+		{
+			FScopeLock ScopeLock(&Lock);
+
+			// Freed slots pick up the remaining chunks
+			SubmitPendingReads();
+
+			// Stop once the kernel no longer writes into our buffers
+			bIsRunning = !(bIsShuttingDown && bWakeRequested && FreeSlots.Num() == Slots.Num());
+		}
+
+		for (FReadRequest* Request : CompletedRequests)
+		{
+			Request->OnComplete(!Request->bFailed);
+			delete Request;
+		}
+		CompletedRequests.Reset();
+
+		CompletionThreadCPUTimeNs = GetThreadCPUTimeNs();
+	}
+
+	return 0;
+}
+
+void FACLIoUring::Shutdown()
+{
+	using namespace ACLIoUringABI;
+
+	TArray<FReadRequest*> CancelledRequests;
+
+	{
+		FScopeLock ScopeLock(&Lock);
+
+		if (RingHandle < 0 || bIsShuttingDown)
+		{
+			return;
+		}
+
+		bIsShuttingDown = true;
+
+		// Requests with chunks in flight complete as failed, the others are cancelled right away
+		for (FReadRequest* Request : PendingRequests)
+		{
+			Request->ReadEnd = Request->ReadOffset;
+			Request->bFailed = true;
+
+			if (Request->NumInFlightReads == 0)
+			{
+				CancelledRequests.Add(Request);
+			}
+		}
+		PendingRequests.Empty();
+	}
+
+	for (FReadRequest* Request : CancelledRequests)
+	{
+		Request->OnComplete(false);
+		delete Request;
+	}
+
+	// Wake the completion thread, it exits once every slot is free
+	{
+		FScopeLock ScopeLock(&Lock);
+
+		const uint32 Tail = *SubmissionTail;
+		const uint32 EntryIndex = Tail & SubmissionRingMask;
+
+		FSubmissionEntry& Entry = static_cast<FSubmissionEntry*>(SubmissionEntries)[EntryIndex];
+		FMemory::Memzero(Entry);
+		Entry.Opcode = OpNop;
+		Entry.FileHandle = -1;
+		Entry.UserData = WakeUserData;
+
+		SubmissionArray[EntryIndex] = EntryIndex;
+		__atomic_store_n(SubmissionTail, Tail + 1, __ATOMIC_RELEASE);
+		IoUringEnter(RingHandle, 1, 0, 0);
+	}
+
+	CompletionThread->WaitForCompletion();
+	delete CompletionThread;
+	CompletionThread = nullptr;
+
+	FScopeLock ScopeLock(&Lock);
+	Destroy();
+}
+
+FACLIoUringStats FACLIoUring::GetStats() const
+{
+	FACLIoUringStats Stats;
+	Stats.NumReads = NumReads;
+	Stats.NumBatches = NumBatches;
+	Stats.NumBytesRead = NumBytesRead;
+
+	const uint64 CPUTimeNs = CompletionThreadCPUTimeNs;
+	const uint64 CPUTimeBaselineNs = CompletionThreadCPUTimeBaselineNs;
+	Stats.CompletionThreadCPUTime = CPUTimeNs > CPUTimeBaselineNs ? double(CPUTimeNs - CPUTimeBaselineNs) * 1.0e-9 : 0.0;
+	return Stats;
+}
+
+void FACLIoUring::ResetStats()
+{
+	NumReads = 0;
+	NumBatches = 0;
+	NumBytesRead = 0;
+	CompletionThreadCPUTimeBaselineNs = CompletionThreadCPUTimeNs.Load();
+}
+#endif
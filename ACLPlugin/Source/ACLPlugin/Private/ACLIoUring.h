@@ -0,0 +1,129 @@
+#pragma once
+
+// Copyright 2020 Nicholas Frechette. All Rights Reserved.
+
+#include "CoreMinimal.h"
+
+// io_uring requires Linux 5.1 or later, older kernels are detected at runtime and fall back to the default IO path
+#define WITH_ACL_IO_URING PLATFORM_LINUX
+
+#if WITH_ACL_IO_URING
+#include "HAL/CriticalSection.h"
+#include "HAL/Runnable.h"
+#include "Templates/Atomic.h"
+
+class FRunnableThread;
+
+/** A file opened for reading through io_uring. */
+struct FACLIoUringFile
+{
+	int32 Handle = -1;
+	bool bDirectIO = false;
+
+	bool IsValid() const { return Handle >= 0; }
+};
+
+/** Statistics gathered by the io_uring backend. */
+struct FACLIoUringStats
+{
+	uint32 NumReads = 0;
+	uint32 NumBatches = 0;
+	uint64 NumBytesRead = 0;
+
+	/** The CPU time consumed by the completion thread, in seconds. */
+	double CompletionThreadCPUTime = 0.0;
+};
+
+/**
+ * Reads file ranges with io_uring. Every read is split into chunks that are submitted together with a single system call
+ * into a pool of pre-registered buffers and copied into their destination by a completion thread that reaps the
+ * completion queue. Used by the database streamer on Linux, see 'ACL.DatabaseIoUring'.
+ */
+class FACLIoUring final : public FRunnable
+{
+public:
+	/** Returns the global io_uring instance. */
+	static FACLIoUring& Get();
+
+	/** Returns whether or not the io_uring backend is enabled ('ACL.DatabaseIoUring'). */
+	static bool IsEnabled();
+
+	/** Returns whether or not files should be opened with O_DIRECT ('ACL.DatabaseIoUring.DirectIO'). */
+	static bool UseDirectIO();
+
+	/** Opens and closes a file for reading, O_DIRECT bypasses the page cache. */
+	static FACLIoUringFile OpenFile(const FString& Filename, bool bDirectIO);
+	static void CloseFile(FACLIoUringFile& File);
+
+	/** Returns whether or not the ring could be created, it is created on first use. Thread safe. */
+	bool IsAvailable();
+
+	/**
+	 * Reads a range of a file into the destination. The callback is called on the completion thread once every chunk has been read.
+	 * Returns false if the read couldn't be submitted, in which case the callback isn't called. Thread safe.
+	 */
+	bool Read(const FACLIoUringFile& File, uint64 Offset, uint32 Size, uint8* Destination, TFunction<void(bool bSuccess)>&& OnComplete);
+
+	/** Cancels pending reads, stops the completion thread, and destroys the ring. */
+	void Shutdown();
+
+	/** Returns the statistics gathered since the last reset. */
+	FACLIoUringStats GetStats() const;
+	void ResetStats();
+
+private:
+	struct FReadRequest;
+	struct FSlot;
+
+	FACLIoUring();
+
+	void Initialize();
+	void Destroy();
+
+	/** Submits the chunks of pending requests into every free buffer slot with a single system call. Must hold the lock. */
+	void SubmitPendingReads();
+
+	// FRunnable implementation
+	virtual uint32 Run() override;
+
+	FCriticalSection Lock;
+
+	int32 RingHandle;
+	bool bIsInitialized;
+	bool bIsShuttingDown;
+	bool bUseRegisteredBuffers;
+
+	// Shared ring memory
+	void* SubmissionRing;
+	SIZE_T SubmissionRingSize;
+	void* CompletionRing;
+	SIZE_T CompletionRingSize;
+	void* SubmissionEntries;
+	SIZE_T SubmissionEntriesSize;
+
+	uint32* SubmissionHead;
+	uint32* SubmissionTail;
+	uint32 SubmissionRingMask;
+	uint32* SubmissionArray;
+	uint32* CompletionHead;
+	uint32* CompletionTail;
+	uint32 CompletionRingMask;
+	void* CompletionEntries;
+
+	uint8* SlotMemory;
+	TArray<FSlot> Slots;
+	TArray<int32> FreeSlots;
+
+	/** Requests that still have chunks to submit, in submission order. */
+	TArray<FReadRequest*> PendingRequests;
+	int32 NumInFlightRequests;
+
+	FRunnableThread* CompletionThread;
+
+	TAtomic<uint32> NumReads;
+	TAtomic<uint32> NumBatches;
+	TAtomic<uint64> NumBytesRead;
+	TAtomic<uint64> CompletionThreadCPUTimeNs;
+	TAtomic<uint64> CompletionThreadCPUTimeBaselineNs;
+};
+#endif
@@ -0,0 +1,97 @@
+// Copyright 2020 Nicholas Frechette. All Rights Reserved.
+
+#include "ACLPersistentPose.h"
+
+#include "ACLImpl.h"
+
+#include <acl/core/compressed_tracks.h>
+
+static thread_local FACLPersistentPoseState* GActivePersistentPoseState = nullptr;
+
+/** Sub-track types are packed with 2 bits per sub-track, 16 per entry, one range of entries per sub-track kind (rotations, translations, scales). */
+static constexpr uint32 ACLNumSubTrackTypesPerEntry = 16;
+static constexpr uint32 ACLAnimatedSubTrackType = 2;
+
+static void BuildStaticSubTracks(const acl::compressed_tracks& CompressedTracks, TArray<uint32>& OutStaticSubTracks)
+{
+	const uint32 NumTracks = CompressedTracks.get_num_tracks();
+	const uint32 NumSubTracks = NumTracks * 3;
+
+	OutStaticSubTracks.Reset();
+	OutStaticSubTracks.SetNumZeroed(FMath::DivideAndRoundUp<uint32>(NumSubTracks, 32));
+
+	const acl::acl_impl::tracks_header& TracksHeader = acl::acl_impl::get_tracks_header(CompressedTracks);
+	const acl::acl_impl::transform_tracks_header& TransformHeader = acl::acl_impl::get_transform_tracks_header(CompressedTracks);
+
+	const uint32* SubTrackTypes = reinterpret_cast<const uint32*>(TransformHeader.get_sub_track_types());
+	const uint32 NumEntriesPerKind = FMath::DivideAndRoundUp<uint32>(NumTracks, ACLNumSubTrackTypesPerEntry);
+
+	// Without scale, every scale sub-track is a default sub-track
+	const uint32 NumKinds = TracksHeader.get_has_scale() ? 3 : 2;
+
+	for (uint32 TrackIndex = 0; TrackIndex < NumTracks; ++TrackIndex)
+	{
+		const uint32 EntryIndex = TrackIndex / ACLNumSubTrackTypesPerEntry;
+		const uint32 Shift = (ACLNumSubTrackTypesPerEntry - 1 - (TrackIndex % ACLNumSubTrackTypesPerEntry)) * 2;
+
+		for (uint32 KindIndex = 0; KindIndex < 3; ++KindIndex)
+		{
+			const bool bIsAnimated = KindIndex < NumKinds && ((SubTrackTypes[(KindIndex * NumEntriesPerKind) + EntryIndex] >> Shift) & 0x3) == ACLAnimatedSubTrackType;
+			if (!bIsAnimated)
+			{
+				const uint32 SubTrackIndex = (TrackIndex * 3) + KindIndex;
+				OutStaticSubTracks[SubTrackIndex / 32] |= 1U << (SubTrackIndex % 32);
+			}
+		}
+	}
+}
+
+void FACLPersistentPoseState::Reset()
+{
+	CompressedTracks = nullptr;
+	CompressedTracksHash = 0;
+	OutputAtoms = nullptr;
+	NumOutputAtoms = 0;
+	TrackMappingHash = 0;
+}
+
+bool FACLPersistentPoseState::Prepare(const acl::compressed_tracks& CompressedTracks_, const TArrayView<FTransform>& OutAtoms, uint32 TrackMappingHash_)
+{
+	// The data hash guards against a sequence recompressed at the same address
+	const uint32 CompressedTracksHash_ = CompressedTracks_.get_hash();
+
+	if (CompressedTracks == &CompressedTracks_ && CompressedTracksHash == CompressedTracksHash_ && OutputAtoms == OutAtoms.GetData() && NumOutputAtoms == OutAtoms.Num() && TrackMappingHash == TrackMappingHash_)
+	{
+		return true;
+	}
+
+	// Something changed, write everything once
+	if (CompressedTracks != &CompressedTracks_ || CompressedTracksHash != CompressedTracksHash_)
+	{
+		BuildStaticSubTracks(CompressedTracks_, StaticSubTracks);
+	}
+
+	CompressedTracks = &CompressedTracks_;
+	CompressedTracksHash = CompressedTracksHash_;
+	OutputAtoms = OutAtoms.GetData();
+	NumOutputAtoms = OutAtoms.Num();
+	TrackMappingHash = TrackMappingHash_;
+	return false;
+}
+
+FACLPersistentPoseScope::FACLPersistentPoseScope(FACLPersistentPoseState& State, uint32 BoneMappingKey)
+	: PreviousState(GActivePersistentPoseState)
+{
+	State.BoneMappingKey = BoneMappingKey;
+	GActivePersistentPoseState = &State;
+}
+
+FACLPersistentPoseScope::~FACLPersistentPoseScope()
+{
+	GActivePersistentPoseState = PreviousState;
+}
+
+FACLPersistentPoseState* GetActivePersistentPoseState()
+{
+	return GActivePersistentPoseState;
+}
@@ -2,6 +2,9 @@
 
 #include "CoreMinimal.h"
 #include "IACLPluginModule.h"
+#include "ACLClipArena.h"
+#include "ACLIoUring.h"
+#include "ACLUsageRecorder.h"
 #include "Modules/ModuleManager.h"
 
 // Enable console commands only in development builds when logging is enabled
@@ -9,7 +12,11 @@
 
 #if WITH_ACL_CONSOLE_COMMANDS
 #include "AnimationCompressionLibraryDatabase.h"
+#include "AnimBoneCompressionCodec_ACLBase.h"
 #include "AnimBoneCompressionCodec_ACLDatabase.h"
+#include "ACLResidentDataRegion.h"
+#include "ACLSharedDataFile.h"
+#include "ACLStreamedClipManager.h"
 
 #include "AnimationCompression.h"
 #include "Animation/AnimBoneCompressionCodec.h"
@@ -17,7 +24,16 @@
 #include "Animation/AnimCurveCompressionCodec.h"
 #include "Animation/AnimCurveCompressionSettings.h"
 #include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
 #include "UObject/UObjectIterator.h"
+
+#if WITH_EDITOR
+#include "Animation/AnimCompressionTypes.h"
+#include "Async/ParallelFor.h"
+
+#include <acl/compression/compress.h>
+#include <acl/compression/transform_error_metrics.h>
+#endif
 #endif
 
 ACLAllocator ACLAllocatorImpl;
@@ -34,6 +50,8 @@ private:
 	void ListCodecs(const TArray<FString>& Args);
 	void ListAnimSequences(const TArray<FString>& Args);
 	void SetDatabaseVisualFidelity(const TArray<FString>& Args);
+	void RelocateClipData(const TArray<FString>& Args);
+	void CalibrateDecodeCost(const TArray<FString>& Args);
 
 	TArray<IConsoleObject*> ConsoleCommands;
 #endif
@@ -224,14 +242,14 @@ void FACLPlugin::ListCodecs(const TArray<FString>& Args)
 			}
 		}
 
-		const acl::compressed_database* CompressedDatabase = acl::make_compressed_database(Database->CookedCompressedBytes.GetData());
+		const acl::compressed_database* CompressedDatabase = acl::make_compressed_database(Database->CookedCompressedBytesView.GetData());
 
 		const uint32 DatabaseTotalSize = CompressedDatabase != nullptr ? CompressedDatabase->get_total_size() : 0;
 		const uint32 DatabaseSize = CompressedDatabase != nullptr ? CompressedDatabase->get_size() : 0;
 		const uint32 DatabaseBulkDataSizeMedium = CompressedDatabase != nullptr ? CompressedDatabase->get_bulk_data_size(acl::quality_tier::medium_importance) : 0;
 		const uint32 DatabaseBulkDataSizeLow = CompressedDatabase != nullptr ? CompressedDatabase->get_bulk_data_size(acl::quality_tier::lowest_importance) : 0;
 		const uint32 DatabaseBulkDataSize = DatabaseBulkDataSizeMedium + DatabaseBulkDataSizeLow;
-		const uint32 SequencesSize = Database->CookedCompressedBytes.Num() - DatabaseSize;	// CompressedBytes contains the DB metadata and the sequences but not the bulk data
+		const uint32 SequencesSize = Database->CookedCompressedBytesView.Num() - DatabaseSize;	// CompressedBytes contains the DB metadata and the sequences but not the bulk data
 
 		UE_LOG(LogAnimationCompression, Log, TEXT("%s ..."), *Database->GetPathName());
 		UE_LOG(LogAnimationCompression, Log, TEXT("    used by %d / %d (%.1f %%) anim sequences"), NumReferences, AnimSequences.Num(), Percentage(NumReferences, AnimSequences.Num()));
@@ -239,6 +257,38 @@ void FACLPlugin::ListCodecs(const TArray<FString>& Args)
 		UE_LOG(LogAnimationCompression, Log, TEXT("    database uses %.2f MB (%.2f MB streamable)"), BytesToMB(DatabaseTotalSize), BytesToMB(DatabaseBulkDataSize));
 	}
 
+	if (FACLResidentDataRegion::IsEnabled())
+	{
+		const FACLResidentDataRegion& Region = FACLResidentDataRegion::Get();
+		UE_LOG(LogAnimationCompression, Log, TEXT("===== Resident Data Region ====="));
+		UE_LOG(LogAnimationCompression, Log, TEXT("    uses %.2f MB / %.2f MB mapped in %d blocks (%.2f MB huge pages)"), BytesToMB(Region.GetUsedSize()), BytesToMB(Region.GetRegionSize()), Region.GetNumBlocks(), BytesToMB(Region.GetHugePageBackedSize()));
+	}
+
+	if (FACLSharedDataFile::IsEnabled())
+	{
+		// Data bound to the shared file lives in the page cache, shared by every process on the host instead of our resident set
+		const FACLSharedDataFile& SharedDataFile = FACLSharedDataFile::Get();
+		UE_LOG(LogAnimationCompression, Log, TEXT("===== Shared Data File ====="));
+		UE_LOG(LogAnimationCompression, Log, TEXT("    %d blobs bound to %.2f MB of shared data"), SharedDataFile.GetNumBoundBlobs(), BytesToMB(SharedDataFile.GetFileSize()));
+		UE_LOG(LogAnimationCompression, Log, TEXT("    saves %.2f MB of private memory in this process"), BytesToMB(SharedDataFile.GetNumBoundBytes()));
+	}
+
+	const FACLStreamedClipManager& StreamedClipManager = FACLStreamedClipManager::Get();
+	if (StreamedClipManager.GetNumClips() != 0)
+	{
+		UE_LOG(LogAnimationCompression, Log, TEXT("===== Streamed Clips ====="));
+		UE_LOG(LogAnimationCompression, Log, TEXT("    %d / %d anim sequences resident"), StreamedClipManager.GetNumResidentClips(), StreamedClipManager.GetNumClips());
+		UE_LOG(LogAnimationCompression, Log, TEXT("    uses %.2f MB / %.2f MB (%.1f %%)"), BytesToMB(StreamedClipManager.GetResidentSize()), BytesToMB(StreamedClipManager.GetBudgetSize()), Percentage(StreamedClipManager.GetResidentSize(), StreamedClipManager.GetBudgetSize()));
+		UE_LOG(LogAnimationCompression, Log, TEXT("    %d stream in requests, %d stream outs"), StreamedClipManager.GetNumStreamInRequests(), StreamedClipManager.GetNumStreamOuts());
+	}
+
+	const FACLClipArena& Arena = FACLClipArena::Get();
+	if (Arena.GetNumSequences() != 0)
+	{
+		UE_LOG(LogAnimationCompression, Log, TEXT("===== Clip Arena ====="));
+		UE_LOG(LogAnimationCompression, Log, TEXT("    %d anim sequences use %.2f MB"), Arena.GetNumSequences(), BytesToMB(Arena.GetArenaSize()));
+	}
+
 	LogAnimationCompression.SetVerbosity(OldVerbosity);
 }
 
@@ -327,10 +377,376 @@ void FACLPlugin::SetDatabaseVisualFidelity(const TArray<FString>& Args)
 
 	LogAnimationCompression.SetVerbosity(OldVerbosity);
 }
+
+/** Writes the decompressed pose into a buffer that we discard. */
+struct FACLCalibrationPoseWriter final : public acl::track_writer
+{
+	TArray<rtm::qvvf>& Pose;
+
+	explicit FACLCalibrationPoseWriter(TArray<rtm::qvvf>& Pose_) : Pose(Pose_) {}
+
+	void RTM_SIMD_CALL write_rotation(uint32_t TrackIndex, rtm::quatf_arg0 Rotation) { Pose[TrackIndex].rotation = Rotation; }
+	void RTM_SIMD_CALL write_translation(uint32_t TrackIndex, rtm::vector4f_arg0 Translation) { Pose[TrackIndex].translation = Translation; }
+	void RTM_SIMD_CALL write_scale(uint32_t TrackIndex, rtm::vector4f_arg0 Scale) { Pose[TrackIndex].scale = Scale; }
+};
+
+static constexpr int32 NumDecodeCostTerms = (int32)EACLDecodeCostTerm::Count;
+
+/** A measured pose decompression along with the decode cost terms that should explain it. */
+struct FACLDecodeCostSample
+{
+	float TermCounts[NumDecodeCostTerms];
+	double MeasuredNs;
+};
+
+template<class DecompressionSettingsType>
+static double MeasureDecodeNsPerPose(const acl::compressed_tracks& CompressedClipData, int32 NumIterations)
+{
+	acl::decompression_context<DecompressionSettingsType> ACLContext;
+	ACLContext.initialize(CompressedClipData);
+
+	TArray<rtm::qvvf> Pose;
+	Pose.SetNumUninitialized(CompressedClipData.get_num_tracks());
+	FACLCalibrationPoseWriter Writer(Pose);
+
+	const float Duration = CompressedClipData.get_duration();
+
+	const double StartTime = FPlatformTime::Seconds();
+	for (int32 Iteration = 0; Iteration < NumIterations; ++Iteration)
+	{
+		ACLContext.seek((Duration * Iteration) / NumIterations, acl::sample_rounding_policy::none);
+		ACLContext.decompress_tracks(Writer);
+	}
+	return ((FPlatformTime::Seconds() - StartTime) * 1.0e9) / NumIterations;
+}
+
+/** Measures a whole pose decompression with the decompression settings the codecs use at runtime for its formats. */
+static double MeasureDecodeNsPerPose(const acl::compressed_tracks& CompressedClipData, int32 NumIterations)
+{
+	const acl::acl_impl::tracks_header& TracksHeader = acl::acl_impl::get_tracks_header(CompressedClipData);
+
+	// Only the custom codec supports full precision vectors, it decompresses with the generic settings
+	const bool bHasVariableVectors = acl::is_vector_format_variable(TracksHeader.get_translation_format()) && acl::is_vector_format_variable(TracksHeader.get_scale_format());
+	if (bHasVariableVectors)
+	{
+		switch (TracksHeader.get_rotation_format())
+		{
+		case acl::rotation_format8::quatf_drop_w_variable:	return MeasureDecodeNsPerPose<UE4DefaultDecompressionSettings>(CompressedClipData, NumIterations);
+		case acl::rotation_format8::quatf_full:				return MeasureDecodeNsPerPose<UE4SafeDecompressionSettings>(CompressedClipData, NumIterations);
+		case acl::rotation_format8::quatf_drop_w_full:		return MeasureDecodeNsPerPose<UE4DropWFullDecompressionSettings>(CompressedClipData, NumIterations);
+		default:											break;
+		}
+	}
+
+	return MeasureDecodeNsPerPose<UE4CustomDecompressionSettings>(CompressedClipData, NumIterations);
+}
+
+static void AddDecodeCostSample(const acl::compressed_tracks& CompressedClipData, int32 NumIterations, TArray<FACLDecodeCostSample>& OutSamples)
+{
+	FACLDecodeCostSample Sample;
+	if (GetDecodeCostTermCounts(CompressedClipData, Sample.TermCounts))
+	{
+		Sample.MeasuredNs = MeasureDecodeNsPerPose(CompressedClipData, NumIterations);
+		OutSamples.Add(Sample);
+	}
+}
+
+#if WITH_EDITOR
+/**
+ * Compresses a sequence with every rotation and vector format and several segment sizes and measures each variant.
+ * Loaded sequences typically share their formats and segment sizes, the variants vary the terms they don't.
+ */
+static void AddDecodeCostVariantSamples(UAnimSequence& AnimSeq, const UAnimBoneCompressionCodec_ACLBase& Codec, int32 NumIterations, TArray<FACLDecodeCostSample>& OutSamples)
+{
+	static constexpr acl::rotation_format8 RotationFormats[] = { acl::rotation_format8::quatf_full, acl::rotation_format8::quatf_drop_w_full, acl::rotation_format8::quatf_drop_w_variable };
+	static constexpr acl::vector_format8 VectorFormats[] = { acl::vector_format8::vector3f_full, acl::vector_format8::vector3f_variable };
+	static constexpr uint32 SegmentSizes[][2] = { { 8, 15 }, { 16, 31 }, { 32, 63 }, { 64, 127 } };
+
+	static constexpr int32 NumRotationFormats = UE_ARRAY_COUNT(RotationFormats);
+	static constexpr int32 NumVectorFormats = UE_ARRAY_COUNT(VectorFormats);
+	static constexpr int32 NumSegmentSizes = UE_ARRAY_COUNT(SegmentSizes);
+	static constexpr int32 NumVariants = NumRotationFormats * NumVectorFormats * NumSegmentSizes;
+
+	const FCompressibleAnimData CompressibleAnimData(&AnimSeq, false);
+	const float ErrorThreshold = Codec.GetErrorThresholdForSequence(CompressibleAnimData);
+
+	acl::track_array_qvvf Tracks = BuildACLTransformTrackArray(ACLAllocatorImpl, CompressibleAnimData, Codec.GetDefaultVirtualVertexDistanceForPlatform(), Codec.GetSafeVirtualVertexDistanceForPlatform(), false);
+	for (acl::track_qvvf& Track : Tracks)
+		Track.get_description().precision = ErrorThreshold;
+
+	acl::track_array_qvvf BaseTracks;
+	if (CompressibleAnimData.bIsValidAdditive)
+	{
+		BaseTracks = BuildACLTransformTrackArray(ACLAllocatorImpl, CompressibleAnimData, Codec.GetDefaultVirtualVertexDistanceForPlatform(), Codec.GetSafeVirtualVertexDistanceForPlatform(), true);
+	}
+
+	// Compress every variant in parallel, they are measured one at a time afterwards
+	TArray<acl::compressed_tracks*> Variants;
+	Variants.SetNumZeroed(NumVariants);
+
+	ParallelFor(NumVariants, [&](int32 VariantIndex)
+		{
+			acl::compression_settings Settings = acl::get_default_compression_settings();
+			Settings.level = GetCompressionLevel(Codec.GetCompressionLevelForPlatform());
+			Settings.rotation_format = RotationFormats[VariantIndex % NumRotationFormats];
+			Settings.translation_format = VectorFormats[(VariantIndex / NumRotationFormats) % NumVectorFormats];
+			Settings.scale_format = Settings.translation_format;
+			Settings.segmenting.ideal_num_samples = SegmentSizes[VariantIndex / (NumRotationFormats * NumVectorFormats)][0];
+			Settings.segmenting.max_num_samples = SegmentSizes[VariantIndex / (NumRotationFormats * NumVectorFormats)][1];
+
+			acl::qvvf_transform_error_metric DefaultErrorMetric;
+			acl::additive_qvvf_transform_error_metric<acl::additive_clip_format8::additive1> AdditiveErrorMetric;
+			Settings.error_metric = BaseTracks.is_empty() ? static_cast<acl::itransform_error_metric*>(&DefaultErrorMetric) : static_cast<acl::itransform_error_metric*>(&AdditiveErrorMetric);
+
+			acl::output_stats Stats;
+			const acl::error_result CompressionResult = acl::compress_track_list(ACLAllocatorImpl, Tracks, Settings, BaseTracks, acl::additive_clip_format8::additive0, Variants[VariantIndex], Stats);
+			if (!CompressionResult.empty())
+			{
+				UE_LOG(LogAnimationCompression, Warning, TEXT("Failed to compress a decode cost variant of [%s]: %s"), *AnimSeq.GetPathName(), ANSI_TO_TCHAR(CompressionResult.c_str()));
+				Variants[VariantIndex] = nullptr;
+			}
+		});
+
+	for (acl::compressed_tracks* CompressedClipData : Variants)
+	{
+		if (CompressedClipData != nullptr)
+		{
+			AddDecodeCostSample(*CompressedClipData, NumIterations, OutSamples);
+			ACLAllocatorImpl.deallocate(CompressedClipData, CompressedClipData->get_size());
+		}
+	}
+}
+#endif
+
+/** Returns the estimate of a sample with the provided weights, in the unit of the weights. */
+static double EstimateDecodeCost(const FACLDecodeCostSample& Sample, const double Weights[NumDecodeCostTerms])
+{
+	double Estimate = 0.0;
+	for (int32 TermIndex = 0; TermIndex < NumDecodeCostTerms; ++TermIndex)
+	{
+		Estimate += Weights[TermIndex] * Sample.TermCounts[TermIndex];
+	}
+	return Estimate;
+}
+
+/** Returns the mean relative error of the estimates with the provided weights. */
+static double CalculateMeanDecodeCostError(const TArray<FACLDecodeCostSample>& Samples, const double WeightsNs[NumDecodeCostTerms])
+{
+	double TotalRelativeError = 0.0;
+	for (const FACLDecodeCostSample& Sample : Samples)
+	{
+		TotalRelativeError += FMath::Abs(EstimateDecodeCost(Sample, WeightsNs) - Sample.MeasuredNs) / FMath::Max(Sample.MeasuredNs, 1.0);
+	}
+	return TotalRelativeError / FMath::Max(Samples.Num(), 1);
+}
+
+/**
+ * Fits the weight of every decode cost term in nanoseconds with least squares on the relative estimate error.
+ * A small penalty pulls every weight towards its prior, terms the samples don't constrain (e.g. database sub-tracks when no database is loaded) retain it.
+ * Returns false if the system cannot be solved.
+ */
+static bool FitDecodeCostWeights(const TArray<FACLDecodeCostSample>& Samples, const double PriorWeightsNs[NumDecodeCostTerms], double OutWeightsNs[NumDecodeCostTerms])
+{
+	static constexpr double PriorPenalty = 0.01;
+
+	// Normal equations of the relative residuals: (estimate - measured) / measured
+	double Matrix[NumDecodeCostTerms][NumDecodeCostTerms + 1] = {};
+	for (const FACLDecodeCostSample& Sample : Samples)
+	{
+		const double InvMeasuredNs = 1.0 / FMath::Max(Sample.MeasuredNs, 1.0);
+
+		for (int32 RowIndex = 0; RowIndex < NumDecodeCostTerms; ++RowIndex)
+		{
+			const double RowValue = Sample.TermCounts[RowIndex] * InvMeasuredNs;
+			for (int32 ColumnIndex = 0; ColumnIndex < NumDecodeCostTerms; ++ColumnIndex)
+			{
+				Matrix[RowIndex][ColumnIndex] += RowValue * Sample.TermCounts[ColumnIndex] * InvMeasuredNs;
+			}
+
+			Matrix[RowIndex][NumDecodeCostTerms] += RowValue;	// The relative target is always 1.0
+		}
+	}
+
+	// The prior penalty is relative to the prior weight as well
+	for (int32 TermIndex = 0; TermIndex < NumDecodeCostTerms; ++TermIndex)
+	{
+		const double InvPriorNs = 1.0 / FMath::Max(PriorWeightsNs[TermIndex], 1.0e-6);
+		Matrix[TermIndex][TermIndex] += PriorPenalty * InvPriorNs * InvPriorNs;
+		Matrix[TermIndex][NumDecodeCostTerms] += PriorPenalty * InvPriorNs;
+	}
+
+	// Gaussian elimination with partial pivoting
+	for (int32 PivotIndex = 0; PivotIndex < NumDecodeCostTerms; ++PivotIndex)
+	{
+		int32 BestRowIndex = PivotIndex;
+		for (int32 RowIndex = PivotIndex + 1; RowIndex < NumDecodeCostTerms; ++RowIndex)
+		{
+			if (FMath::Abs(Matrix[RowIndex][PivotIndex]) > FMath::Abs(Matrix[BestRowIndex][PivotIndex]))
+			{
+				BestRowIndex = RowIndex;
+			}
+		}
+
+		if (FMath::Abs(Matrix[BestRowIndex][PivotIndex]) < 1.0e-30)
+		{
+			return false;
+		}
+
+		for (int32 ColumnIndex = 0; ColumnIndex <= NumDecodeCostTerms; ++ColumnIndex)
+		{
+			Swap(Matrix[PivotIndex][ColumnIndex], Matrix[BestRowIndex][ColumnIndex]);
+		}
+
+		for (int32 RowIndex = PivotIndex + 1; RowIndex < NumDecodeCostTerms; ++RowIndex)
+		{
+			const double Factor = Matrix[RowIndex][PivotIndex] / Matrix[PivotIndex][PivotIndex];
+			for (int32 ColumnIndex = PivotIndex; ColumnIndex <= NumDecodeCostTerms; ++ColumnIndex)
+			{
+				Matrix[RowIndex][ColumnIndex] -= Factor * Matrix[PivotIndex][ColumnIndex];
+			}
+		}
+	}
+
+	for (int32 RowIndex = NumDecodeCostTerms - 1; RowIndex >= 0; --RowIndex)
+	{
+		double Value = Matrix[RowIndex][NumDecodeCostTerms];
+		for (int32 ColumnIndex = RowIndex + 1; ColumnIndex < NumDecodeCostTerms; ++ColumnIndex)
+		{
+			Value -= Matrix[RowIndex][ColumnIndex] * OutWeightsNs[ColumnIndex];
+		}
+
+		OutWeightsNs[RowIndex] = Value / Matrix[RowIndex][RowIndex];
+	}
+
+	return true;
+}
+
+void FACLPlugin::CalibrateDecodeCost(const TArray<FString>& Args)
+{
+	// Make sure to log everything
+	const ELogVerbosity::Type OldVerbosity = LogAnimationCompression.GetVerbosity();
+	LogAnimationCompression.SetVerbosity(ELogVerbosity::All);
+
+	const int32 NumIterations = Args.Num() != 0 && Args[0].IsNumeric() ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 64;
+
+#if WITH_EDITOR
+	const bool bMeasureVariants = Args.Contains(TEXT("variants"));
+#endif
+
+	TArray<FACLDecodeCostSample> Samples;
+
+	// We measure every loaded sequence that doesn't live in a database
+	const TArray<UAnimSequence*> AnimSequences = GetObjectInstancesSorted<UAnimSequence>();
+	for (UAnimSequence* AnimSeq : AnimSequences)
+	{
+		const UAnimBoneCompressionCodec* Codec = AnimSeq->CompressedData.BoneCompressionCodec;
+		const ICompressedAnimData* AnimData = AnimSeq->CompressedData.CompressedDataStructure.Get();
+		if (Codec == nullptr || AnimData == nullptr || !Codec->IsA<UAnimBoneCompressionCodec_ACLBase>() || Codec->IsA<UAnimBoneCompressionCodec_ACLDatabase>())
+		{
+			continue;
+		}
+
+		const FACLCompressedAnimData& ACLAnimData = *static_cast<const FACLCompressedAnimData*>(AnimData);
+		const acl::compressed_tracks* CompressedClipData = ACLAnimData.GetCompressedTracks();
+		if (CompressedClipData == nullptr || acl::acl_impl::get_tracks_header(*CompressedClipData).get_has_database())
+		{
+			continue;
+		}
+
+		AddDecodeCostSample(*CompressedClipData, NumIterations, Samples);
+
+#if WITH_EDITOR
+		if (bMeasureVariants)
+		{
+			AddDecodeCostVariantSamples(*AnimSeq, *CastChecked<UAnimBoneCompressionCodec_ACLBase>(Codec), NumIterations, Samples);
+		}
+#endif
+	}
+
+	// The overall scale with our current weights
+	double CurrentWeights[NumDecodeCostTerms];
+	for (int32 TermIndex = 0; TermIndex < NumDecodeCostTerms; ++TermIndex)
+	{
+		CurrentWeights[TermIndex] = GetDecodeCostTermWeight((EACLDecodeCostTerm)TermIndex);
+	}
+
+	double TotalMeasuredNs = 0.0;
+	double TotalEstimatedUnits = 0.0;
+	for (const FACLDecodeCostSample& Sample : Samples)
+	{
+		TotalMeasuredNs += Sample.MeasuredNs;
+		TotalEstimatedUnits += EstimateDecodeCost(Sample, CurrentWeights);
+	}
+
+	if (TotalEstimatedUnits <= 0.0)
+	{
+		UE_LOG(LogAnimationCompression, Log, TEXT("No ACL anim sequences are loaded, cannot calibrate the decode cost"));
+		LogAnimationCompression.SetVerbosity(OldVerbosity);
+		return;
+	}
+
+	const double NsPerUnit = TotalMeasuredNs / TotalEstimatedUnits;
+
+	double CurrentWeightsNs[NumDecodeCostTerms];
+	for (int32 TermIndex = 0; TermIndex < NumDecodeCostTerms; ++TermIndex)
+	{
+		CurrentWeightsNs[TermIndex] = CurrentWeights[TermIndex] * NsPerUnit;
+	}
+
+	IConsoleVariable* NsPerUnitCVar = IConsoleManager::Get().FindConsoleVariable(TEXT("ACL.DecodeCostNsPerUnit"));
+	check(NsPerUnitCVar != nullptr);
+	NsPerUnitCVar->Set(float(NsPerUnit), ECVF_SetByConsole);
+
+	UE_LOG(LogAnimationCompression, Log, TEXT("ACL decode cost calibrated with %d measurements (warm cache, %d poses each): %.3f ns per unit, mean estimate error %.1f %%"),
+		Samples.Num(), NumIterations, NsPerUnit, CalculateMeanDecodeCostError(Samples, CurrentWeightsNs) * 100.0);
+	UE_LOG(LogAnimationCompression, Log, TEXT("Set 'ACL.DecodeCostNsPerUnit=%.3f' in the [SystemSettings] section of this platform's ini file to retain it"), NsPerUnit);
+
+	// Fit every weight, they are reported in units of the current scale so they can replace the current weights with the same 'ACL.DecodeCostNsPerUnit'
+	double FittedWeightsNs[NumDecodeCostTerms];
+	if (!FitDecodeCostWeights(Samples, CurrentWeightsNs, FittedWeightsNs))
+	{
+		UE_LOG(LogAnimationCompression, Warning, TEXT("Failed to fit the ACL decode cost weights, the measurements are degenerate"));
+		LogAnimationCompression.SetVerbosity(OldVerbosity);
+		return;
+	}
+
+	for (int32 TermIndex = 0; TermIndex < NumDecodeCostTerms; ++TermIndex)
+	{
+		FittedWeightsNs[TermIndex] = FMath::Max(FittedWeightsNs[TermIndex], 0.0);	// A negative cost isn't meaningful
+	}
+
+	UE_LOG(LogAnimationCompression, Log, TEXT("Fitted ACL decode cost weights, mean estimate error %.1f %%. Paste them in ACLDecodeCost (ACLImpl.cpp) and bump the auto codec DDC key:"),
+		CalculateMeanDecodeCostError(Samples, FittedWeightsNs) * 100.0);
+
+	for (int32 TermIndex = 0; TermIndex < NumDecodeCostTerms; ++TermIndex)
+	{
+		bool bIsConstrained = false;
+		for (const FACLDecodeCostSample& Sample : Samples)
+		{
+			bIsConstrained |= Sample.TermCounts[TermIndex] != 0.0f;
+		}
+
+		const EACLDecodeCostTerm Term = (EACLDecodeCostTerm)TermIndex;
+		UE_LOG(LogAnimationCompression, Log, TEXT("    static constexpr float %s = %.2ff;%s"),
+			GetDecodeCostTermName(Term), FittedWeightsNs[TermIndex] / NsPerUnit, bIsConstrained ? TEXT("") : TEXT("    // Not measured, retained"));
+	}
+
+	LogAnimationCompression.SetVerbosity(OldVerbosity);
+}
+
+void FACLPlugin::RelocateClipData(const TArray<FString>& Args)
+{
+	// Animations might be decompressing from the arena, relocate at the end of the frame once they are done
+	FACLClipArena::Get().RequestRelocate(true);
+}
 #endif
 
 void FACLPlugin::StartupModule()
 {
+	FACLClipArena::Get().Initialize();
+	FACLStreamedClipManager::Get().Initialize();
+	FACLUsageRecorder::Initialize();
+
 #if WITH_ACL_CONSOLE_COMMANDS
 	if (!IsRunningCommandlet())
 	{
@@ -354,12 +770,34 @@ void FACLPlugin::StartupModule()
 			FConsoleCommandWithArgsDelegate::CreateRaw(this, &FACLPlugin::SetDatabaseVisualFidelity),
 			ECVF_Default
 		));
+
+		ConsoleCommands.Add(IConsoleManager::Get().RegisterConsoleCommand(
+			TEXT("ACL.RelocateClipData"),
+			TEXT("Relocates the compressed data of loaded non-database ACL anim sequences into the contiguous clip arena and compacts it at the end of the frame."),
+			FConsoleCommandWithArgsDelegate::CreateRaw(this, &FACLPlugin::RelocateClipData),
+			ECVF_Default
+		));
+
+		ConsoleCommands.Add(IConsoleManager::Get().RegisterConsoleCommand(
+			TEXT("ACL.CalibrateDecodeCost"),
+			TEXT("Measures the decompression time of loaded ACL anim sequences, calibrates 'ACL.DecodeCostNsPerUnit' and fits the decode cost weights. Arguments: number of poses to decompress per sequence (default 64), 'variants' to also measure every sequence recompressed with every format and several segment sizes (editor only)"),
+			FConsoleCommandWithArgsDelegate::CreateRaw(this, &FACLPlugin::CalibrateDecodeCost),
+			ECVF_Default
+		));
 	}
 #endif
 }
 
 void FACLPlugin::ShutdownModule()
 {
+	FACLClipArena::Get().Shutdown();
+	FACLStreamedClipManager::Get().Shutdown();
+	FACLUsageRecorder::Shutdown();
+
+#if WITH_ACL_IO_URING
+	FACLIoUring::Get().Shutdown();
+#endif
+
 #if WITH_ACL_CONSOLE_COMMANDS
 	for (IConsoleObject* Cmd : ConsoleCommands)
 	{
@@ -0,0 +1,193 @@
+// Copyright 2020 Nicholas Frechette. All Rights Reserved.
+
+#include "ACLResidentDataRegion.h"
+
+#include "AnimationCompression.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/ScopeLock.h"
+
+#if PLATFORM_LINUX
+#include <sys/mman.h>
+#endif
+
+static TAutoConsoleVariable<int32> CVarACLUseHugePages(
+	TEXT("ACL.UseHugePages"),
+	0,
+	TEXT("When enabled, resident compressed animation data (databases and non-database sequences) is relocated at load time into a region backed by huge pages when the platform supports it.\n")
+	TEXT("Must be set before animation data loads (e.g. in the [SystemSettings] section of an ini file)."),
+	ECVF_ReadOnly);
+
+static TAutoConsoleVariable<int32> CVarACLHugePageRegionSizeMB(
+	TEXT("ACL.HugePageRegionSizeMB"),
+	64,
+	TEXT("The maximum size in MB of the region that holds resident compressed animation data. The region grows in blocks of huge pages as data loads and blocks are released once their data unloads.\n")
+	TEXT("Data that does not fit remains where it was loaded."),
+	ECVF_ReadOnly);
+
+/** Blocks are mapped in multiples of the huge page size. */
+static constexpr SIZE_T ACLHugePageSize = 2 * 1024 * 1024;
+
+FACLResidentDataRegion& FACLResidentDataRegion::Get()
+{
+	static FACLResidentDataRegion Region;
+	return Region;
+}
+
+bool FACLResidentDataRegion::IsEnabled()
+{
+	return CVarACLUseHugePages.GetValueOnAnyThread() != 0;
+}
+
+FACLResidentDataRegion::FACLResidentDataRegion()
+	: RegionSize(0)
+	, HugePageBackedSize(0)
+	, UsedSize(0)
+	, bHasLoggedBacking(false)
+{
+}
+
+bool FACLResidentDataRegion::MapBlock(SIZE_T MinSize, FBlock& OutBlock)
+{
+#if PLATFORM_LINUX
+	const SIZE_T Size = Align(MinSize, ACLHugePageSize);
+
+	// Try explicit huge pages first, this requires huge pages to be reserved with hugetlbfs.
+	// Without MAP_NORESERVE, the mapping fails immediately if not enough huge pages are available instead of
+	// faulting later.
+	void* HugeTLBPtr = mmap(nullptr, Size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	if (HugeTLBPtr != MAP_FAILED)
+	{
+		OutBlock = FBlock{ static_cast<uint8*>(HugeTLBPtr), Size, 0, 0, true };
+
+		if (!bHasLoggedBacking)
+		{
+			UE_LOG(LogAnimationCompression, Log, TEXT("ACL resident data region uses hugetlbfs pages"));
+			bHasLoggedBacking = true;
+		}
+		return true;
+	}
+
+	// Fallback to transparent huge pages. We reserve an extra huge page to align our block on a huge page boundary.
+	// Pages are only committed when we write to them.
+	void* Ptr = mmap(nullptr, Size + ACLHugePageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (Ptr == MAP_FAILED)
+	{
+		UE_LOG(LogAnimationCompression, Warning, TEXT("ACL failed to map %u KB for the resident data region, compressed data will not be relocated"), uint32(Size / 1024));
+		return false;
+	}
+
+	uint8* AlignedPtr = Align(static_cast<uint8*>(Ptr), ACLHugePageSize);
+
+	// Release the unused head and tail
+	const SIZE_T HeadSize = AlignedPtr - static_cast<uint8*>(Ptr);
+	const SIZE_T TailSize = ACLHugePageSize - HeadSize;
+	if (HeadSize != 0)
+	{
+		munmap(Ptr, HeadSize);
+	}
+
+	if (TailSize != 0)
+	{
+		munmap(AlignedPtr + Size, TailSize);
+	}
+
+	const bool bIsHugePageBacked = madvise(AlignedPtr, Size, MADV_HUGEPAGE) == 0;
+	OutBlock = FBlock{ AlignedPtr, Size, 0, 0, bIsHugePageBacked };
+
+	if (!bHasLoggedBacking)
+	{
+		UE_LOG(LogAnimationCompression, Log, TEXT("ACL resident data region uses %s"),
+			bIsHugePageBacked ? TEXT("transparent huge pages") : TEXT("regular pages, transparent huge pages are unavailable"));
+		bHasLoggedBacking = true;
+	}
+	return true;
+#else
+	if (!bHasLoggedBacking)
+	{
+		UE_LOG(LogAnimationCompression, Log, TEXT("ACL resident data region is not supported on this platform, compressed data will not be relocated"));
+		bHasLoggedBacking = true;
+	}
+	return false;
+#endif
+}
+
+void FACLResidentDataRegion::UnmapBlock(const FBlock& Block)
+{
+#if PLATFORM_LINUX
+	munmap(Block.Base, Block.Size);
+#endif
+}
+
+uint8* FACLResidentDataRegion::Allocate(SIZE_T Size, SIZE_T Alignment)
+{
+	check(Alignment <= ACLHugePageSize);
+
+	FScopeLock ScopeLock(&Lock);
+
+	// Allocate from the most recent block when it has room, older blocks only shrink as their data unloads
+	if (Blocks.Num() != 0)
+	{
+		FBlock& Block = Blocks.Last();
+		const SIZE_T Offset = Align(Block.Offset, Alignment);
+		if (Offset + Size <= Block.Size)
+		{
+			Block.Offset = Offset + Size;
+			Block.NumLiveBytes += Size;
+			UsedSize += Size;
+			return Block.Base + Offset;
+		}
+	}
+
+	const SIZE_T MaxRegionSize = SIZE_T(FMath::Max(CVarACLHugePageRegionSizeMB.GetValueOnAnyThread(), 1)) * 1024 * 1024;
+	if (RegionSize + Align(Size, ACLHugePageSize) > MaxRegionSize)
+	{
+		UE_LOG(LogAnimationCompression, Verbose, TEXT("ACL resident data region reached its maximum size, %u bytes will not be relocated"), uint32(Size));
+		return nullptr;
+	}
+
+	FBlock Block;
+	if (!MapBlock(Size, Block))
+	{
+		return nullptr;
+	}
+
+	Block.Offset = Size;
+	Block.NumLiveBytes = Size;
+
+	RegionSize += Block.Size;
+	HugePageBackedSize += Block.bIsHugePageBacked ? Block.Size : 0;
+	UsedSize += Size;
+	Blocks.Add(Block);
+
+	return Block.Base;
+}
+
+void FACLResidentDataRegion::Free(uint8* Ptr, SIZE_T Size)
+{
+	FScopeLock ScopeLock(&Lock);
+
+	for (int32 BlockIndex = Blocks.Num() - 1; BlockIndex >= 0; --BlockIndex)
+	{
+		FBlock& Block = Blocks[BlockIndex];
+		if (Ptr < Block.Base || Ptr >= Block.Base + Block.Size)
+		{
+			continue;
+		}
+
+		check(Block.NumLiveBytes >= Size);
+		Block.NumLiveBytes -= Size;
+		UsedSize -= Size;
+
+		if (Block.NumLiveBytes == 0)
+		{
+			// Everything the block held unloaded, release its memory
+			RegionSize -= Block.Size;
+			HugePageBackedSize -= Block.bIsHugePageBacked ? Block.Size : 0;
+			UnmapBlock(Block);
+			Blocks.RemoveAt(BlockIndex);
+		}
+		return;
+	}
+
+	checkf(false, TEXT("The pointer wasn't allocated from the ACL resident data region"));
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+// Copyright 2020 Nicholas Frechette. All Rights Reserved.
+
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+
+/**
+ * Virtual memory that holds resident compressed animation data. When the platform supports it, the memory is backed by
+ * huge pages to reduce the TLB pressure when many sequences are decompressed. The region grows in blocks of huge pages
+ * as data loads and a block is released once everything it holds has been freed.
+ */
+class FACLResidentDataRegion
+{
+public:
+	/** Returns the global region instance. */
+	static FACLResidentDataRegion& Get();
+
+	/** Returns whether or not resident compressed data should be relocated into the region. */
+	static bool IsEnabled();
+
+	/** Allocates from the region. Returns nullptr if the region is unavailable or has reached its maximum size. Thread safe. */
+	uint8* Allocate(SIZE_T Size, SIZE_T Alignment);
+
+	/** Frees an allocation made from the region, its block is released once all of its allocations are freed. Thread safe. */
+	void Free(uint8* Ptr, SIZE_T Size);
+
+	/** Returns the number of bytes mapped for the region. */
+	SIZE_T GetRegionSize() const { return RegionSize; }
+
+	/** Returns the number of bytes mapped for the region that are backed by huge pages. */
+	SIZE_T GetHugePageBackedSize() const { return HugePageBackedSize; }
+
+	/** Returns the number of bytes allocated from the region that haven't been freed. */
+	SIZE_T GetUsedSize() const { return UsedSize; }
+
+	/** Returns the number of blocks mapped for the region. */
+	int32 GetNumBlocks() const { return Blocks.Num(); }
+
+private:
+	/** A contiguous range of huge pages, allocated from linearly. */
+	struct FBlock
+	{
+		uint8* Base;
+		SIZE_T Size;
+
+		/** Where the next allocation starts. Freed memory is only reused once the whole block is released. */
+		SIZE_T Offset;
+
+		/** The number of bytes allocated from the block that haven't been freed. */
+		SIZE_T NumLiveBytes;
+
+		bool bIsHugePageBacked;
+	};
+
+	FACLResidentDataRegion();
+
+	/** Maps a new block of at least the provided size. Returns false if the platform doesn't support it or if we are out of memory. */
+	bool MapBlock(SIZE_T MinSize, FBlock& OutBlock);
+	void UnmapBlock(const FBlock& Block);
+
+	FCriticalSection Lock;
+
+	TArray<FBlock> Blocks;
+
+	SIZE_T RegionSize;
+	SIZE_T HugePageBackedSize;
+	SIZE_T UsedSize;
+
+	bool bHasLoggedBacking;
+};
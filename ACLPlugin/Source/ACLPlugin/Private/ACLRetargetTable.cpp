@@ -0,0 +1,175 @@
+// Copyright 2020 Nicholas Frechette. All Rights Reserved.
+
+#include "ACLRetargetTable.h"
+
+#include "Animation/Skeleton.h"
+#include "Engine/SkeletalMesh.h"
+#include "Misc/ScopeRWLock.h"
+#include "UObject/ObjectKey.h"
+
+static thread_local const FACLActiveRetarget* GActiveRetarget = nullptr;
+
+/** Tables are shared by every sequence authored on the same retarget source and played on the same target. */
+struct FACLRetargetTableKey
+{
+	FObjectKey Skeleton;
+	FObjectKey TargetMesh;
+	FName RetargetSource;
+	bool bIsBakedAdditive;
+
+	bool operator==(const FACLRetargetTableKey& Other) const
+	{
+		return Skeleton == Other.Skeleton && TargetMesh == Other.TargetMesh && RetargetSource == Other.RetargetSource && bIsBakedAdditive == Other.bIsBakedAdditive;
+	}
+
+	friend uint32 GetTypeHash(const FACLRetargetTableKey& Key)
+	{
+		uint32 Hash = HashCombine(GetTypeHash(Key.Skeleton), GetTypeHash(Key.TargetMesh));
+		Hash = HashCombine(Hash, GetTypeHash(Key.RetargetSource));
+		return HashCombine(Hash, GetTypeHash(Key.bIsBakedAdditive));
+	}
+};
+
+struct FACLRetargetTableCache
+{
+	FRWLock Lock;
+	TMap<FACLRetargetTableKey, TSharedRef<const FACLRetargetTable, ESPMode::ThreadSafe>> Tables;
+};
+
+static FACLRetargetTableCache& GetRetargetTableCache()
+{
+	static FACLRetargetTableCache Cache;
+	return Cache;
+}
+
+static TSharedRef<const FACLRetargetTable, ESPMode::ThreadSafe> BuildRetargetTable(const USkeleton& Skeleton, FName RetargetSource, const USkeletalMesh* TargetMesh, bool bIsBakedAdditive)
+{
+	TSharedRef<FACLRetargetTable, ESPMode::ThreadSafe> Table = MakeShared<FACLRetargetTable, ESPMode::ThreadSafe>();
+
+	const TArray<FTransform>& SkeletonRefPose = Skeleton.GetReferenceSkeleton().GetRefBonePose();
+	const TArray<FTransform>& SourceRefPose = Skeleton.GetRefLocalPoses(RetargetSource);
+	const int32 NumBones = SkeletonRefPose.Num();
+
+	Table->Bones.SetNum(NumBones);
+
+	for (int32 SkeletonBoneIndex = 0; SkeletonBoneIndex < NumBones; ++SkeletonBoneIndex)
+	{
+		// The engine retargets onto the reference pose of the mesh being played
+		FTransform TargetRefTransform = SkeletonRefPose[SkeletonBoneIndex];
+		if (TargetMesh != nullptr)
+		{
+			const int32 MeshBoneIndex = Skeleton.GetMeshBoneIndexFromSkeletonBoneIndex(TargetMesh, SkeletonBoneIndex);
+			if (MeshBoneIndex != INDEX_NONE)
+			{
+				TargetRefTransform = TargetMesh->RefSkeleton.GetRefBonePose()[MeshBoneIndex];
+			}
+		}
+
+		const FTransform& SourceRefTransform = SourceRefPose.IsValidIndex(SkeletonBoneIndex) ? SourceRefPose[SkeletonBoneIndex] : SkeletonRefPose[SkeletonBoneIndex];
+
+		FACLRetargetTranslation& Bone = Table->Bones[SkeletonBoneIndex];
+		switch (Skeleton.GetBoneTranslationRetargetingMode(SkeletonBoneIndex))
+		{
+		case EBoneTranslationRetargetingMode::Animation:
+		default:
+			break;
+		case EBoneTranslationRetargetingMode::Skeleton:
+			// The animated translation is replaced by the reference translation
+			Bone.Scale = 0.0f;
+			Bone.Offset = bIsBakedAdditive ? FVector::ZeroVector : TargetRefTransform.GetTranslation();
+			break;
+		case EBoneTranslationRetargetingMode::AnimationScaled:
+		{
+			const float SourceTranslationLength = SourceRefTransform.GetTranslation().Size();
+			if (SourceTranslationLength > KINDA_SMALL_NUMBER)
+			{
+				Bone.Scale = TargetRefTransform.GetTranslation().Size() / SourceTranslationLength;
+			}
+			break;
+		}
+		case EBoneTranslationRetargetingMode::AnimationRelative:
+			// With baked additive sequences, the relative delta cancels out
+			if (!bIsBakedAdditive)
+			{
+				// Only the translation delta can be applied inline, the rotation and scale deltas must be identity
+				if (!SourceRefTransform.GetRotation().Equals(TargetRefTransform.GetRotation()) || !SourceRefTransform.GetScale3D().Equals(TargetRefTransform.GetScale3D()))
+				{
+					Table->bIsSupported = false;
+				}
+
+				Bone.Offset = TargetRefTransform.GetTranslation() - SourceRefTransform.GetTranslation();
+			}
+			break;
+		case EBoneTranslationRetargetingMode::OrientAndScale:
+			// Also modifies the rotation unless both reference poses match
+			if (!SourceRefTransform.Equals(TargetRefTransform))
+			{
+				Table->bIsSupported = false;
+			}
+			break;
+		}
+	}
+
+	return Table;
+}
+
+TSharedRef<const FACLRetargetTable, ESPMode::ThreadSafe> FACLRetargetTable::FindOrBuild(const USkeleton& Skeleton, FName RetargetSource, const USkeletalMesh* TargetMesh, bool bIsBakedAdditive)
+{
+	FACLRetargetTableCache& Cache = GetRetargetTableCache();
+
+	FACLRetargetTableKey Key;
+	Key.Skeleton = FObjectKey(&Skeleton);
+	Key.TargetMesh = FObjectKey(TargetMesh);
+	Key.RetargetSource = RetargetSource;
+	Key.bIsBakedAdditive = bIsBakedAdditive;
+
+	{
+		FRWScopeLock ReadLock(Cache.Lock, SLT_ReadOnly);
+		const TSharedRef<const FACLRetargetTable, ESPMode::ThreadSafe>* CachedTable = Cache.Tables.Find(Key);
+		if (CachedTable != nullptr)
+		{
+			return *CachedTable;
+		}
+	}
+
+	// Built outside the lock, if another thread races us, the first table added wins
+	TSharedRef<const FACLRetargetTable, ESPMode::ThreadSafe> Table = BuildRetargetTable(Skeleton, RetargetSource, TargetMesh, bIsBakedAdditive);
+
+	FRWScopeLock WriteLock(Cache.Lock, SLT_Write);
+	const TSharedRef<const FACLRetargetTable, ESPMode::ThreadSafe>* CachedTable = Cache.Tables.Find(Key);
+	if (CachedTable != nullptr)
+	{
+		return *CachedTable;
+	}
+
+	Cache.Tables.Add(Key, Table);
+	return Table;
+}
+
+void FACLRetargetTable::ResetCache()
+{
+	FACLRetargetTableCache& Cache = GetRetargetTableCache();
+
+	FRWScopeLock WriteLock(Cache.Lock, SLT_Write);
+	Cache.Tables.Empty();
+}
+
+FACLRetargetScope::FACLRetargetScope(const FACLRetargetTable& Table, const TArray<FTrackToSkeletonMap>& TrackToSkeletonMap)
+	: PreviousRetarget(GActiveRetarget)
+{
+	Retarget.Table = &Table;
+	Retarget.TrackToSkeletonMap = TrackToSkeletonMap.GetData();
+	Retarget.NumTracks = TrackToSkeletonMap.Num();
+
+	GActiveRetarget = &Retarget;
+}
+
+FACLRetargetScope::~FACLRetargetScope()
+{
+	GActiveRetarget = PreviousRetarget;
+}
+
+const FACLActiveRetarget* GetActiveRetarget()
+{
+	return GActiveRetarget;
+}
@@ -0,0 +1,272 @@
+// Copyright 2020 Nicholas Frechette. All Rights Reserved.
+
+#include "ACLSharedDataFile.h"
+
+#include "AnimationCompression.h"
+#include "Async/MappedFileHandle.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformFilemanager.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+
+#if WITH_EDITOR
+#include "HAL/FileManager.h"
+#endif
+
+static TAutoConsoleVariable<FString> CVarACLSharedDataFile(
+	TEXT("ACL.SharedDataFile"),
+	TEXT(""),
+	TEXT("The path, relative to the project directory, of a shared data file built with the ACLSharedData commandlet. When set in a cooked build, compressed animation data found in the file binds to its memory mapped copy.\n")
+	TEXT("Must be set before animation data loads (e.g. in the [SystemSettings] section of an ini file)."),
+	ECVF_ReadOnly);
+
+namespace ACLSharedDataFormat
+{
+	static constexpr uint32 Tag = 0x534C4341;	// 'ACLS'
+	static constexpr uint32 Version = 1;
+
+	// The blob data starts on a page boundary, 64 KB covers the page size of every platform
+	static constexpr uint64 DataAlignment = 64 * 1024;
+
+	// ACL requires 16 byte alignment for its compressed data
+	static constexpr uint64 BlobAlignment = 16;
+
+	struct FHeader
+	{
+		uint32 Tag;
+		uint32 Version;
+		uint32 NumEntries;
+		uint32 Padding;
+		uint64 DataOffset;
+		uint64 DataSize;
+	};
+
+	/** Entries follow the header, sorted by hash and size. Offsets are relative to the start of the file. */
+	struct FEntry
+	{
+		uint32 Hash;
+		uint32 Size;
+		uint64 Offset;
+	};
+}
+
+FACLSharedDataFile& FACLSharedDataFile::Get()
+{
+	static FACLSharedDataFile SharedDataFile;
+	return SharedDataFile;
+}
+
+bool FACLSharedDataFile::IsEnabled()
+{
+	return !CVarACLSharedDataFile.GetValueOnAnyThread().IsEmpty();
+}
+
+FACLSharedDataFile::FACLSharedDataFile()
+	: MappedFile(nullptr)
+	, MappedRegion(nullptr)
+	, MappedData(nullptr)
+	, MappedSize(0)
+	, NumBoundBlobs(0)
+	, NumBoundBytes(0)
+	, bIsInitialized(false)
+{
+}
+
+void FACLSharedDataFile::Initialize()
+{
+	using namespace ACLSharedDataFormat;
+
+	bIsInitialized = true;
+
+	FString Filename = CVarACLSharedDataFile.GetValueOnAnyThread();
+	if (FPaths::IsRelative(Filename))
+	{
+		Filename = FPaths::Combine(FPaths::ProjectDir(), Filename);
+	}
+
+	// The file must be a loose file, files within a pak file cannot be memory mapped
+	MappedFile = FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*Filename);
+	if (MappedFile == nullptr)
+	{
+		UE_LOG(LogAnimationCompression, Warning, TEXT("ACL failed to memory map the shared data file '%s', compressed data will not be shared"), *Filename);
+		return;
+	}
+
+	MappedRegion = MappedFile->MapRegion(0, MappedFile->GetFileSize());
+	if (MappedRegion == nullptr)
+	{
+		UE_LOG(LogAnimationCompression, Warning, TEXT("ACL failed to memory map the shared data file '%s', compressed data will not be shared"), *Filename);
+
+		delete MappedFile;
+		MappedFile = nullptr;
+		return;
+	}
+
+	const uint8* Data = MappedRegion->GetMappedPtr();
+	const int64 Size = MappedRegion->GetMappedSize();
+
+	const FHeader* Header = reinterpret_cast<const FHeader*>(Data);
+	const bool bIsValid = Size >= int64(sizeof(FHeader))
+		&& Header->Tag == Tag
+		&& Header->Version == Version
+		&& int64(sizeof(FHeader) + (uint64(Header->NumEntries) * sizeof(FEntry))) <= Size
+		&& int64(Header->DataOffset + Header->DataSize) <= Size;
+
+	if (!bIsValid)
+	{
+		UE_LOG(LogAnimationCompression, Warning, TEXT("ACL shared data file '%s' is invalid or was built with an older version, compressed data will not be shared"), *Filename);
+
+		delete MappedRegion;
+		MappedRegion = nullptr;
+		delete MappedFile;
+		MappedFile = nullptr;
+		return;
+	}
+
+	MappedData = Data;
+	MappedSize = Size;
+
+	UE_LOG(LogAnimationCompression, Log, TEXT("ACL shared data file '%s' mapped with %u blobs (%.2f MB)"), *Filename, Header->NumEntries, double(Size) / (1024.0 * 1024.0));
+}
+
+uint8* FACLSharedDataFile::Find(uint32 Hash, TArrayView<const uint8> Bytes)
+{
+	using namespace ACLSharedDataFormat;
+
+	FScopeLock ScopeLock(&Lock);
+
+	if (!bIsInitialized)
+	{
+		Initialize();
+	}
+
+	if (MappedData == nullptr)
+	{
+		return nullptr;
+	}
+
+	const FHeader* Header = reinterpret_cast<const FHeader*>(MappedData);
+	const FEntry* Entries = reinterpret_cast<const FEntry*>(Header + 1);
+	const uint32 NumEntries = Header->NumEntries;
+
+	// Find the first entry with our hash
+	uint32 First = 0;
+	uint32 Count = NumEntries;
+	while (Count != 0)
+	{
+		const uint32 Step = Count / 2;
+		if (Entries[First + Step].Hash < Hash)
+		{
+			First += Step + 1;
+			Count -= Step + 1;
+		}
+		else
+		{
+			Count = Step;
+		}
+	}
+
+	for (uint32 EntryIndex = First; EntryIndex < NumEntries && Entries[EntryIndex].Hash == Hash; ++EntryIndex)
+	{
+		const FEntry& Entry = Entries[EntryIndex];
+		if (Entry.Size != uint32(Bytes.Num()) || int64(Entry.Offset + Entry.Size) > MappedSize)
+		{
+			continue;
+		}
+
+		// Reading the mapped pages doesn't break the sharing, only writing to them would
+		const uint8* SharedBytes = MappedData + Entry.Offset;
+		if (FMemory::Memcmp(SharedBytes, Bytes.GetData(), Entry.Size) == 0)
+		{
+			NumBoundBlobs++;
+			NumBoundBytes += Entry.Size;
+
+			// The mapping is read-only, compressed data is never written to
+			return const_cast<uint8*>(SharedBytes);
+		}
+	}
+
+	return nullptr;
+}
+
+#if WITH_EDITOR
+bool FACLSharedDataFile::WriteFile(const FString& Filename, const TArray<FACLSharedDataBlob>& Blobs)
+{
+	using namespace ACLSharedDataFormat;
+
+	// Sort by hash and size to allow binary searches at runtime and to find duplicates
+	TArray<const FACLSharedDataBlob*> SortedBlobs;
+	for (const FACLSharedDataBlob& Blob : Blobs)
+	{
+		SortedBlobs.Add(&Blob);
+	}
+
+	SortedBlobs.Sort([](const FACLSharedDataBlob& Lhs, const FACLSharedDataBlob& Rhs)
+		{
+			return Lhs.Hash != Rhs.Hash ? Lhs.Hash < Rhs.Hash : Lhs.Bytes.Num() < Rhs.Bytes.Num();
+		});
+
+	TArray<const FACLSharedDataBlob*> UniqueBlobs;
+	for (const FACLSharedDataBlob* Blob : SortedBlobs)
+	{
+		const bool bIsDuplicate = UniqueBlobs.Num() != 0
+			&& UniqueBlobs.Last()->Hash == Blob->Hash
+			&& UniqueBlobs.Last()->Bytes.Num() == Blob->Bytes.Num()
+			&& FMemory::Memcmp(UniqueBlobs.Last()->Bytes.GetData(), Blob->Bytes.GetData(), Blob->Bytes.Num()) == 0;
+
+		if (!bIsDuplicate)
+		{
+			UniqueBlobs.Add(Blob);
+		}
+	}
+
+	FHeader Header;
+	Header.Tag = Tag;
+	Header.Version = Version;
+	Header.NumEntries = UniqueBlobs.Num();
+	Header.Padding = 0;
+	Header.DataOffset = UniqueBlobs.Num() != 0 ? Align(sizeof(FHeader) + (uint64(UniqueBlobs.Num()) * sizeof(FEntry)), DataAlignment) : sizeof(FHeader);
+
+	TArray<FEntry> Entries;
+	uint64 Offset = Header.DataOffset;
+	for (const FACLSharedDataBlob* Blob : UniqueBlobs)
+	{
+		Offset = Align(Offset, BlobAlignment);
+
+		FEntry Entry;
+		Entry.Hash = Blob->Hash;
+		Entry.Size = Blob->Bytes.Num();
+		Entry.Offset = Offset;
+		Entries.Add(Entry);
+
+		Offset += Entry.Size;
+	}
+
+	Header.DataSize = Offset - Header.DataOffset;
+
+	TUniquePtr<FArchive> Writer(IFileManager::Get().CreateFileWriter(*Filename));
+	if (!Writer)
+	{
+		UE_LOG(LogAnimationCompression, Error, TEXT("Failed to create the shared data file: %s"), *Filename);
+		return false;
+	}
+
+	Writer->Serialize(&Header, sizeof(FHeader));
+	Writer->Serialize(Entries.GetData(), Entries.Num() * sizeof(FEntry));
+
+	TArray<uint8> Padding;
+	for (int32 EntryIndex = 0; EntryIndex < Entries.Num(); ++EntryIndex)
+	{
+		Padding.SetNumZeroed(int32(Entries[EntryIndex].Offset - Writer->Tell()));
+		Writer->Serialize(Padding.GetData(), Padding.Num());
+
+		const FACLSharedDataBlob* Blob = UniqueBlobs[EntryIndex];
+		Writer->Serialize(const_cast<uint8*>(Blob->Bytes.GetData()), Blob->Bytes.Num());
+	}
+
+	const bool bSuccess = Writer->Close();
+
+	UE_LOG(LogAnimationCompression, Log, TEXT("Wrote %d blobs (%d duplicates removed) to the shared data file: %s"), UniqueBlobs.Num(), Blobs.Num() - UniqueBlobs.Num(), *Filename);
+	return bSuccess;
+}
+#endif
@@ -0,0 +1,259 @@
+// Copyright 2020 Nicholas Frechette. All Rights Reserved.
+
+#include "ACLStreamedClipManager.h"
+
+#include "AnimBoneCompressionCodec_ACLBase.h"
+#include "ACLStreamedClipData.h"
+
+#include "AnimationCompression.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/ScopeLock.h"
+
+static TAutoConsoleVariable<int32> CVarACLStreamedClipBudgetMB(
+	TEXT("ACL.StreamedClipBudgetMB"),
+	32,
+	TEXT("The memory budget in MB of the resident compressed data of anim sequences cooked with 'Stream Compressed Data'.\n")
+	TEXT("When exceeded, the least recently used sequences stream out until it fits again. Sequences used within the last frames are retained."),
+	ECVF_Default);
+
+/** Clips used within this many frames are never streamed out, they are likely to play again. Clips being decompressed are protected by their reader count. */
+static constexpr uint64 ACLNumFramesBeforeStreamOut = 2;
+
+FACLStreamedClipData::FACLStreamedClipData(FACLCompressedAnimData& AnimData_)
+	: AnimData(AnimData_)
+	, Buffer(nullptr)
+	, PendingRequest(nullptr)
+	, State(uint32(EACLStreamedClipState::StreamedOut))
+	, LastUsedFrame(0)
+	, NumReaders(0)
+	, Size(0)
+{
+}
+
+FACLStreamedClipData::~FACLStreamedClipData()
+{
+	if (PendingRequest != nullptr)
+	{
+		// Our request references us, wait for it to complete before we go away
+		PendingRequest->WaitCompletion();
+		delete PendingRequest;
+		PendingRequest = nullptr;
+	}
+
+	FACLStreamedClipManager::Get().Unregister(*this);
+}
+
+void FACLStreamedClipData::Serialize(FArchive& Ar, UObject* Owner)
+{
+	check(Ar.IsLoading());
+
+	BulkData.Serialize(Ar, Owner, INDEX_NONE, false);
+	Size = BulkData.GetBulkDataSize();
+
+	FACLStreamedClipManager::Get().Register(*this);
+}
+
+bool FACLStreamedClipData::RequestStreamIn()
+{
+	return FACLStreamedClipManager::Get().StreamIn(*this);
+}
+
+FACLStreamedClipManager& FACLStreamedClipManager::Get()
+{
+	static FACLStreamedClipManager Manager;
+	return Manager;
+}
+
+FACLStreamedClipManager::FACLStreamedClipManager()
+	: NumResidentClips(0)
+	, ResidentSize(0)
+	, NumStreamInRequests(0)
+	, NumStreamOuts(0)
+{
+}
+
+void FACLStreamedClipManager::Initialize()
+{
+#if !WITH_EDITORONLY_DATA
+	TickerHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FACLStreamedClipManager::Tick));
+#endif
+}
+
+void FACLStreamedClipManager::Shutdown()
+{
+#if !WITH_EDITORONLY_DATA
+	FTicker::GetCoreTicker().RemoveTicker(TickerHandle);
+#endif
+}
+
+int64 FACLStreamedClipManager::GetBudgetSize() const
+{
+	return int64(FMath::Max(CVarACLStreamedClipBudgetMB.GetValueOnAnyThread(), 0)) * 1024 * 1024;
+}
+
+void FACLStreamedClipManager::Register(FACLStreamedClipData& Clip)
+{
+	FScopeLock ScopeLock(&Lock);
+	Clips.AddUnique(&Clip);
+}
+
+void FACLStreamedClipManager::Unregister(FACLStreamedClipData& Clip)
+{
+	FScopeLock ScopeLock(&Lock);
+
+	if (Clips.RemoveSingleSwap(&Clip, false) == 0)
+	{
+		return;	// Never registered (e.g. failed to load)
+	}
+
+	if (Clip.State.Load() == uint32(EACLStreamedClipState::Resident))
+	{
+		NumResidentClips--;
+		ResidentSize -= Clip.Size;
+	}
+
+	FMemory::Free(Clip.Buffer);
+	Clip.Buffer = nullptr;
+	Clip.State = uint32(EACLStreamedClipState::StreamedOut);
+}
+
+bool FACLStreamedClipManager::StreamIn(FACLStreamedClipData& Clip)
+{
+	FScopeLock ScopeLock(&Lock);
+
+	const uint32 State = Clip.State.Load();
+	if (State != uint32(EACLStreamedClipState::StreamedOut))
+	{
+		return State == uint32(EACLStreamedClipState::Resident);
+	}
+
+	if (Clip.Size == 0)
+	{
+		return false;	// Nothing to stream in
+	}
+
+	if (Clip.PendingRequest != nullptr)
+	{
+		// Our previous request completed, release it
+		Clip.PendingRequest->WaitCompletion();
+		delete Clip.PendingRequest;
+		Clip.PendingRequest = nullptr;
+	}
+
+	// ACL requires 16 byte alignment for its compressed data
+	Clip.Buffer = static_cast<uint8*>(FMemory::Malloc(Clip.Size, 16));
+	Clip.State = uint32(EACLStreamedClipState::StreamingIn);
+	NumStreamInRequests++;
+
+	FACLStreamedClipData* ClipPtr = &Clip;
+	FBulkDataIORequestCallBack AsyncFileCallBack = [this, ClipPtr](bool bWasCancelled, IBulkDataIORequest* Req)
+	{
+		OnStreamInComplete(*ClipPtr, bWasCancelled);
+	};
+
+	// The clip is about to play, it is requested at a normal priority
+	Clip.PendingRequest = Clip.BulkData.CreateStreamingRequest(0, Clip.Size, AIOP_Normal, &AsyncFileCallBack, Clip.Buffer);
+	if (Clip.PendingRequest == nullptr)
+	{
+		UE_LOG(LogAnimationCompression, Warning, TEXT("ACL failed to initiate an anim sequence stream in request!"));
+
+		FMemory::Free(Clip.Buffer);
+		Clip.Buffer = nullptr;
+		Clip.State = uint32(EACLStreamedClipState::StreamedOut);
+	}
+
+	return false;
+}
+
+void FACLStreamedClipManager::OnStreamInComplete(FACLStreamedClipData& Clip, bool bWasCancelled)
+{
+	FScopeLock ScopeLock(&Lock);
+
+	if (bWasCancelled)
+	{
+		// The next request will try again
+		FMemory::Free(Clip.Buffer);
+		Clip.Buffer = nullptr;
+		Clip.State = uint32(EACLStreamedClipState::StreamedOut);
+		return;
+	}
+
+	// Bind before we publish our state, decompression only reads our data once it observes it resident
+	Clip.AnimData.CompressedByteStream = TArrayView<uint8>(Clip.Buffer, int32(Clip.Size));
+	Clip.AnimData.CacheCompressedDataProperties();
+
+	// Estimate our decode cost now, it can't be read later without holding our data resident
+	if (Clip.AnimData.DecodeCostUnits < 0.0f)
+	{
+		Clip.AnimData.DecodeCostUnits = EstimateDecodeCostUnits(*Clip.AnimData.GetCompressedTracks());
+	}
+
+	Clip.State = uint32(EACLStreamedClipState::Resident);
+
+	NumResidentClips++;
+	ResidentSize += Clip.Size;
+}
+
+bool FACLStreamedClipManager::StreamOut(FACLStreamedClipData& Clip)
+{
+	check(Clip.State.Load() == uint32(EACLStreamedClipState::Resident));
+
+	// Publish our state before we check for readers, new readers will observe it and won't read our data (see FACLStreamedClipData::BeginRead)
+	Clip.State = uint32(EACLStreamedClipState::StreamedOut);
+	if (Clip.NumReaders.Load() != 0)
+	{
+		// Still decompressing, we'll try again next time
+		// Readers that observed us streamed out in the meantime issue a stream in request, it waits on our lock and finds us resident
+		Clip.State = uint32(EACLStreamedClipState::Resident);
+		return false;
+	}
+
+	Clip.AnimData.CompressedByteStream = TArrayView<uint8>();
+
+	FMemory::Free(Clip.Buffer);
+	Clip.Buffer = nullptr;
+
+	NumResidentClips--;
+	ResidentSize -= Clip.Size;
+	NumStreamOuts++;
+	return true;
+}
+
+bool FACLStreamedClipManager::Tick(float DeltaTime)
+{
+	check(IsInGameThread());
+
+	FScopeLock ScopeLock(&Lock);
+
+	const int64 BudgetSize = GetBudgetSize();
+	if (ResidentSize <= BudgetSize)
+	{
+		return true;	// Keep ticking
+	}
+
+	// Clips that were used recently are likely to play again, they are retained even if we exceed the budget
+	TArray<FACLStreamedClipData*> Candidates;
+	for (FACLStreamedClipData* Clip : Clips)
+	{
+		if (Clip->State.Load() == uint32(EACLStreamedClipState::Resident) && Clip->LastUsedFrame.Load() + ACLNumFramesBeforeStreamOut < GFrameCounter)
+		{
+			Candidates.Add(Clip);
+		}
+	}
+
+	// Least recently used first
+	Candidates.Sort([](const FACLStreamedClipData& Lhs, const FACLStreamedClipData& Rhs) { return Lhs.LastUsedFrame.Load() < Rhs.LastUsedFrame.Load(); });
+
+	for (FACLStreamedClipData* Clip : Candidates)
+	{
+		if (ResidentSize <= BudgetSize)
+		{
+			break;
+		}
+
+		// Clips being decompressed are skipped, they remain resident
+		StreamOut(*Clip);
+	}
+
+	return true;	// Keep ticking
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+// Copyright 2020 Nicholas Frechette. All Rights Reserved.
+
+#include "CoreMinimal.h"
+#include "Containers/Ticker.h"
+#include "HAL/CriticalSection.h"
+
+struct FACLStreamedClipData;
+
+/**
+ * Tracks every streamed anim sequence, issues their stream in requests, and streams out the least recently
+ * used ones once the resident streamed clips exceed their memory budget. Only used in cooked builds.
+ */
+class FACLStreamedClipManager
+{
+public:
+	/** Returns the global manager instance. */
+	static FACLStreamedClipManager& Get();
+
+	/** Registers the eviction ticker. */
+	void Initialize();
+
+	/** Unregisters the eviction ticker. */
+	void Shutdown();
+
+	/** Registers and unregisters a streamed clip. Thread safe. */
+	void Register(FACLStreamedClipData& Clip);
+	void Unregister(FACLStreamedClipData& Clip);
+
+	/** Issues a stream in request unless one is in flight. Returns whether or not the clip is resident. Thread safe. */
+	bool StreamIn(FACLStreamedClipData& Clip);
+
+	/** Returns the number of registered streamed clips and how many of them are resident. */
+	int32 GetNumClips() const { return Clips.Num(); }
+	int32 GetNumResidentClips() const { return NumResidentClips; }
+
+	/** Returns the number of bytes used by resident streamed clips. */
+	int64 GetResidentSize() const { return ResidentSize; }
+
+	/** Returns the memory budget in bytes of resident streamed clips. */
+	int64 GetBudgetSize() const;
+
+	/** Returns the number of stream in requests issued and the number of clips streamed out since startup. */
+	int32 GetNumStreamInRequests() const { return NumStreamInRequests; }
+	int32 GetNumStreamOuts() const { return NumStreamOuts; }
+
+private:
+	FACLStreamedClipManager();
+
+	void OnStreamInComplete(FACLStreamedClipData& Clip, bool bWasCancelled);
+	/** Streams out a resident clip unless it is being read. Returns whether or not it streamed out. Must hold the lock. */
+	bool StreamOut(FACLStreamedClipData& Clip);
+
+	/** Streams out the least recently used clips that aren't being read until we fit the budget. Runs on the game thread. */
+	bool Tick(float DeltaTime);
+
+	FCriticalSection Lock;
+
+	TArray<FACLStreamedClipData*> Clips;
+
+	int32 NumResidentClips;
+	int64 ResidentSize;
+
+	int32 NumStreamInRequests;
+	int32 NumStreamOuts;
+
+	FDelegateHandle TickerHandle;
+};
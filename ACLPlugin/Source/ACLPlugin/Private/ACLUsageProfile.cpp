@@ -0,0 +1,216 @@
+// Copyright 2020 Nicholas Frechette. All Rights Reserved.
+
+#include "ACLUsageProfile.h"
+
+#include "AnimationCompression.h"
+#include "Algo/BinarySearch.h"
+#include "Containers/BitArray.h"
+#include "Misc/FileHelper.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+/** Identifies our capture files, reads 'ACLU'. */
+static constexpr uint32 ACLUsageProfileMagic = 0x554C4341;
+
+/** Bump this when the capture format changes. */
+static constexpr uint32 ACLUsageProfileVersion = 3;
+
+FACLSequenceUsage::FACLSequenceUsage()
+	: SequenceKey(0)
+	, NumDecompressions(0)
+	, NumFrames(0)
+{
+	FMemory::Memzero(TimeHistogram);
+}
+
+FArchive& operator<<(FArchive& Ar, FACLSequenceUsage& Usage)
+{
+	Ar << Usage.SequenceName;
+	Ar << Usage.SequenceKey;
+	Ar << Usage.NumDecompressions;
+	Ar << Usage.NumFrames;
+
+	for (uint64& BucketCount : Usage.TimeHistogram)
+	{
+		Ar << BucketCount;
+	}
+
+	return Ar;
+}
+
+FArchive& operator<<(FArchive& Ar, FACLSequenceCoUsage& CoUsage)
+{
+	Ar << CoUsage.SequenceKeyA;
+	Ar << CoUsage.SequenceKeyB;
+	Ar << CoUsage.NumFrames;
+	return Ar;
+}
+
+FACLUsageProfile::FACLUsageProfile()
+	: NumFrames(0)
+{
+}
+
+const FACLSequenceUsage* FACLUsageProfile::FindSequence(uint32 SequenceKey) const
+{
+	const int32 SequenceIndex = Algo::BinarySearchBy(Sequences, SequenceKey, [](const FACLSequenceUsage& Usage) { return Usage.SequenceKey; });
+	return SequenceIndex != INDEX_NONE ? &Sequences[SequenceIndex] : nullptr;
+}
+
+TArray<int32> FACLUsageProfile::CalculateCoUsageOrder(const TArray<uint32>& SequenceKeys) const
+{
+	const int32 NumSequences = SequenceKeys.Num();
+
+	TMap<uint32, int32> KeyToSequenceIndex;
+	TArray<uint64> NumFramesPlayed;
+	NumFramesPlayed.AddZeroed(NumSequences);
+
+	for (int32 SequenceIndex = 0; SequenceIndex < NumSequences; ++SequenceIndex)
+	{
+		const uint32 SequenceUsageKey = SequenceKeys[SequenceIndex];
+		KeyToSequenceIndex.Add(SequenceUsageKey, SequenceIndex);
+
+		const FACLSequenceUsage* Usage = FindSequence(SequenceUsageKey);
+		NumFramesPlayed[SequenceIndex] = Usage != nullptr ? Usage->NumFrames : 0;
+	}
+
+	// Build our adjacency lists, only keep the sequences we order
+	TArray<TArray<TPair<int32, uint64>>> Partners;
+	Partners.AddDefaulted(NumSequences);
+
+	for (const FACLSequenceCoUsage& Pair : CoUsage)
+	{
+		const int32* SequenceIndexA = KeyToSequenceIndex.Find(Pair.SequenceKeyA);
+		const int32* SequenceIndexB = KeyToSequenceIndex.Find(Pair.SequenceKeyB);
+		if (SequenceIndexA != nullptr && SequenceIndexB != nullptr && *SequenceIndexA != *SequenceIndexB)
+		{
+			Partners[*SequenceIndexA].Add(TPair<int32, uint64>(*SequenceIndexB, Pair.NumFrames));
+			Partners[*SequenceIndexB].Add(TPair<int32, uint64>(*SequenceIndexA, Pair.NumFrames));
+		}
+	}
+
+	TArray<int32> Order;
+	Order.Reserve(NumSequences);
+
+	TBitArray<> IsPlaced(false, NumSequences);
+	TArray<uint64> Affinity;
+	Affinity.AddZeroed(NumSequences);
+
+	auto PlaceSequence = [&](int32 SequenceIndex)
+	{
+		Order.Add(SequenceIndex);
+		IsPlaced[SequenceIndex] = true;
+
+		for (const TPair<int32, uint64>& Partner : Partners[SequenceIndex])
+		{
+			Affinity[Partner.Key] += Partner.Value;
+		}
+	};
+
+	while (Order.Num() < NumSequences)
+	{
+		// Append the sequence most often played with the ones we already placed
+		int32 BestSequenceIndex = INDEX_NONE;
+		for (int32 SequenceIndex = 0; SequenceIndex < NumSequences; ++SequenceIndex)
+		{
+			if (!IsPlaced[SequenceIndex] && Affinity[SequenceIndex] != 0 && (BestSequenceIndex == INDEX_NONE || Affinity[SequenceIndex] > Affinity[BestSequenceIndex]))
+			{
+				BestSequenceIndex = SequenceIndex;
+			}
+		}
+
+		if (BestSequenceIndex == INDEX_NONE)
+		{
+			// No partners left, start a new group with the most played sequence remaining
+			for (int32 SequenceIndex = 0; SequenceIndex < NumSequences; ++SequenceIndex)
+			{
+				if (!IsPlaced[SequenceIndex] && NumFramesPlayed[SequenceIndex] != 0 && (BestSequenceIndex == INDEX_NONE || NumFramesPlayed[SequenceIndex] > NumFramesPlayed[BestSequenceIndex]))
+				{
+					BestSequenceIndex = SequenceIndex;
+				}
+			}
+
+			if (BestSequenceIndex == INDEX_NONE)
+			{
+				break;	// Everything left was never played
+			}
+
+			// Affinity only applies within a group
+			FMemory::Memzero(Affinity.GetData(), Affinity.Num() * sizeof(uint64));
+		}
+
+		PlaceSequence(BestSequenceIndex);
+	}
+
+	// Sequences that were never played retain their order
+	for (int32 SequenceIndex = 0; SequenceIndex < NumSequences; ++SequenceIndex)
+	{
+		if (!IsPlaced[SequenceIndex])
+		{
+			Order.Add(SequenceIndex);
+		}
+	}
+
+	return Order;
+}
+
+FArchive& operator<<(FArchive& Ar, FACLUsageProfile& Profile)
+{
+	Ar << Profile.NumFrames;
+	Ar << Profile.Sequences;
+	Ar << Profile.CoUsage;
+	return Ar;
+}
+
+bool FACLUsageProfile::SaveToFile(const FString& Filename) const
+{
+	TArray<uint8> Bytes;
+	FMemoryWriter Writer(Bytes);
+
+	uint32 Magic = ACLUsageProfileMagic;
+	uint32 Version = ACLUsageProfileVersion;
+	Writer << Magic;
+	Writer << Version;
+	Writer << const_cast<FACLUsageProfile&>(*this);
+
+	return FFileHelper::SaveArrayToFile(Bytes, *Filename);
+}
+
+bool FACLUsageProfile::LoadFromFile(const FString& Filename)
+{
+	TArray<uint8> Bytes;
+	if (!FFileHelper::LoadFileToArray(Bytes, *Filename))
+	{
+		UE_LOG(LogAnimationCompression, Warning, TEXT("Failed to read ACL usage profile: %s"), *Filename);
+		return false;
+	}
+
+	FMemoryReader Reader(Bytes);
+
+	uint32 Magic = 0;
+	uint32 Version = 0;
+	Reader << Magic;
+	Reader << Version;
+
+	if (Magic != ACLUsageProfileMagic || Version != ACLUsageProfileVersion)
+	{
+		UE_LOG(LogAnimationCompression, Warning, TEXT("Invalid or unsupported ACL usage profile: %s"), *Filename);
+		return false;
+	}
+
+	Reader << *this;
+
+	if (Reader.IsError())
+	{
+		UE_LOG(LogAnimationCompression, Warning, TEXT("Corrupted ACL usage profile: %s"), *Filename);
+		return false;
+	}
+
+	// Make sure we can binary search
+	Sequences.Sort([](const FACLSequenceUsage& Lhs, const FACLSequenceUsage& Rhs) { return Lhs.SequenceKey < Rhs.SequenceKey; });
+	CoUsage.Sort([](const FACLSequenceCoUsage& Lhs, const FACLSequenceCoUsage& Rhs)
+	{
+		return Lhs.SequenceKeyA != Rhs.SequenceKeyA ? Lhs.SequenceKeyA < Rhs.SequenceKeyA : Lhs.SequenceKeyB < Rhs.SequenceKeyB;
+	});
+	return true;
+}
@@ -0,0 +1,272 @@
+// Copyright 2020 Nicholas Frechette. All Rights Reserved.
+
+#include "ACLUsageRecorder.h"
+#include "ACLUsageProfile.h"
+
+#include "AnimationCompression.h"
+#include "Animation/AnimCompressionTypes.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/CoreDelegates.h"
+#include "Misc/DateTime.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+#include "UObject/UObjectThreadContext.h"
+
+int32 GACLRecordUsage = 0;
+static FAutoConsoleVariableRef CVarACLRecordUsage(
+	TEXT("ACL.RecordUsage"),
+	GACLRecordUsage,
+	TEXT("When enabled, records which ACL sequences are decompressed and at which normalized time. Use 'ACL.SaveUsageProfile' to write the capture to disk."),
+	ECVF_Default);
+
+static int32 GACLMaxCoUsageSequencesPerFrame = 64;
+static FAutoConsoleVariableRef CVarACLMaxCoUsageSequencesPerFrame(
+	TEXT("ACL.RecordUsage.MaxCoUsageSequencesPerFrame"),
+	GACLMaxCoUsageSequencesPerFrame,
+	TEXT("The maximum number of sequences per frame, most decompressed first, for which we record which sequences are decompressed together. The cost grows with the square of this value."),
+	ECVF_Default);
+
+/** The usage of a single sequence within a thread buffer or the merged results. */
+struct FACLSequenceUsageCounters
+{
+	FName SequenceName;
+	uint64 NumDecompressions = 0;
+	uint64 NumFrames = 0;
+	uint64 TimeHistogram[FACLSequenceUsage::NumTimeBuckets] = { 0 };
+};
+
+/** A per thread buffer. The lock is only contended while the buffer is merged at the end of the frame. */
+struct FACLUsageThreadBuffer
+{
+	FCriticalSection Lock;
+	TMap<uint32, FACLSequenceUsageCounters> Usage;
+};
+
+/** Holds the thread buffers and the merged results. */
+struct FACLUsageRecorderState
+{
+	FCriticalSection Lock;
+
+	/** Thread buffers are never freed since threads can outlive us. */
+	TArray<FACLUsageThreadBuffer*> ThreadBuffers;
+
+	TMap<uint32, FACLSequenceUsageCounters> MergedUsage;
+	uint64 NumFrames = 0;
+
+	/** The number of decompressions of each sequence during the current frame. */
+	TMap<uint32, uint64> FrameUsage;
+
+	/** The number of frames during which two sequences were decompressed, the sequence with the smallest usage key is first. */
+	TMap<TPair<uint32, uint32>, uint64> CoUsage;
+
+	FDelegateHandle EndFrameHandle;
+};
+
+static FACLUsageRecorderState& GetRecorderState()
+{
+	static FACLUsageRecorderState State;
+	return State;
+}
+
+static FACLUsageThreadBuffer& GetThreadBuffer()
+{
+	static thread_local FACLUsageThreadBuffer* ThreadBuffer = nullptr;
+	if (ThreadBuffer == nullptr)
+	{
+		ThreadBuffer = new FACLUsageThreadBuffer();
+
+		FACLUsageRecorderState& State = GetRecorderState();
+		FScopeLock ScopeLock(&State.Lock);
+		State.ThreadBuffers.Add(ThreadBuffer);
+	}
+
+	return *ThreadBuffer;
+}
+
+static void MergeThreadBuffers()
+{
+	FACLUsageRecorderState& State = GetRecorderState();
+	FScopeLock ScopeLock(&State.Lock);
+
+	for (FACLUsageThreadBuffer* ThreadBuffer : State.ThreadBuffers)
+	{
+		FScopeLock BufferLock(&ThreadBuffer->Lock);
+
+		for (const auto& It : ThreadBuffer->Usage)
+		{
+			FACLSequenceUsageCounters& Merged = State.MergedUsage.FindOrAdd(It.Key);
+			Merged.SequenceName = It.Value.SequenceName;
+			Merged.NumDecompressions += It.Value.NumDecompressions;
+			State.FrameUsage.FindOrAdd(It.Key) += It.Value.NumDecompressions;
+
+			for (int32 BucketIndex = 0; BucketIndex < FACLSequenceUsage::NumTimeBuckets; ++BucketIndex)
+			{
+				Merged.TimeHistogram[BucketIndex] += It.Value.TimeHistogram[BucketIndex];
+			}
+		}
+
+		// Keep the allocated slots around, the same sequences are likely to play next frame
+		ThreadBuffer->Usage.Reset();
+	}
+}
+
+static void OnEndFrame()
+{
+	if (GACLRecordUsage == 0)
+	{
+		return;
+	}
+
+	MergeThreadBuffers();
+
+	FACLUsageRecorderState& State = GetRecorderState();
+	FScopeLock ScopeLock(&State.Lock);
+
+	State.NumFrames++;
+
+	if (State.FrameUsage.Num() == 0)
+	{
+		return;	// Nothing played this frame
+	}
+
+	TArray<TPair<uint32, uint64>> FrameSequences;
+	FrameSequences.Reserve(State.FrameUsage.Num());
+	for (const auto& It : State.FrameUsage)
+	{
+		State.MergedUsage.FindChecked(It.Key).NumFrames++;
+		FrameSequences.Add(TPair<uint32, uint64>(It.Key, It.Value));
+	}
+
+	State.FrameUsage.Reset();
+
+	// Only track the co-usage of the most decompressed sequences to bound the cost
+	const int32 MaxNumSequences = FMath::Max(GACLMaxCoUsageSequencesPerFrame, 0);
+	if (FrameSequences.Num() > MaxNumSequences)
+	{
+		FrameSequences.Sort([](const TPair<uint32, uint64>& Lhs, const TPair<uint32, uint64>& Rhs) { return Lhs.Value > Rhs.Value; });
+		FrameSequences.SetNum(MaxNumSequences, false);
+	}
+
+	for (int32 IndexA = 0; IndexA < FrameSequences.Num(); ++IndexA)
+	{
+		for (int32 IndexB = IndexA + 1; IndexB < FrameSequences.Num(); ++IndexB)
+		{
+			const uint32 KeyA = FrameSequences[IndexA].Key;
+			const uint32 KeyB = FrameSequences[IndexB].Key;
+
+			State.CoUsage.FindOrAdd(KeyA <= KeyB ? TPair<uint32, uint32>(KeyA, KeyB) : TPair<uint32, uint32>(KeyB, KeyA))++;
+		}
+	}
+}
+
+void FACLUsageRecorder::Initialize()
+{
+	GetRecorderState().EndFrameHandle = FCoreDelegates::OnEndFrame.AddStatic(&OnEndFrame);
+}
+
+void FACLUsageRecorder::Shutdown()
+{
+	FCoreDelegates::OnEndFrame.Remove(GetRecorderState().EndFrameHandle);
+}
+
+void FACLUsageRecorder::RecordDecompression(const FAnimSequenceDecompressionContext& DecompContext, uint32 SequenceUsageKey)
+{
+	FACLUsageThreadBuffer& ThreadBuffer = GetThreadBuffer();
+	FScopeLock BufferLock(&ThreadBuffer.Lock);
+
+	FACLSequenceUsageCounters& Usage = ThreadBuffer.Usage.FindOrAdd(SequenceUsageKey);
+	Usage.SequenceName = DecompContext.AnimName;
+	Usage.NumDecompressions++;
+	Usage.TimeHistogram[FACLSequenceUsage::GetTimeBucket(DecompContext.RelativePos)]++;
+}
+
+void FACLUsageRecorder::GetProfile(FACLUsageProfile& OutProfile)
+{
+	// Decompressions that happened during the current frame will be merged at the end of the frame
+	FACLUsageRecorderState& State = GetRecorderState();
+	FScopeLock ScopeLock(&State.Lock);
+
+	OutProfile.NumFrames = State.NumFrames;
+	OutProfile.Sequences.Reset(State.MergedUsage.Num());
+
+	for (const auto& It : State.MergedUsage)
+	{
+		FACLSequenceUsage& Usage = OutProfile.Sequences.AddDefaulted_GetRef();
+		Usage.SequenceName = It.Value.SequenceName.ToString();
+		Usage.SequenceKey = It.Key;
+		Usage.NumDecompressions = It.Value.NumDecompressions;
+		Usage.NumFrames = It.Value.NumFrames;
+		FMemory::Memcpy(Usage.TimeHistogram, It.Value.TimeHistogram, sizeof(Usage.TimeHistogram));
+	}
+
+	OutProfile.CoUsage.Reset(State.CoUsage.Num());
+	for (const auto& It : State.CoUsage)
+	{
+		FACLSequenceCoUsage& CoUsage = OutProfile.CoUsage.AddDefaulted_GetRef();
+		CoUsage.SequenceKeyA = It.Key.Key;
+		CoUsage.SequenceKeyB = It.Key.Value;
+		CoUsage.NumFrames = It.Value;
+	}
+
+	OutProfile.Sequences.Sort([](const FACLSequenceUsage& Lhs, const FACLSequenceUsage& Rhs) { return Lhs.SequenceKey < Rhs.SequenceKey; });
+	OutProfile.CoUsage.Sort([](const FACLSequenceCoUsage& Lhs, const FACLSequenceCoUsage& Rhs)
+	{
+		return Lhs.SequenceKeyA != Rhs.SequenceKeyA ? Lhs.SequenceKeyA < Rhs.SequenceKeyA : Lhs.SequenceKeyB < Rhs.SequenceKeyB;
+	});
+}
+
+void FACLUsageRecorder::Reset()
+{
+	MergeThreadBuffers();
+
+	FACLUsageRecorderState& State = GetRecorderState();
+	FScopeLock ScopeLock(&State.Lock);
+
+	State.MergedUsage.Empty();
+	State.FrameUsage.Empty();
+	State.CoUsage.Empty();
+	State.NumFrames = 0;
+}
+
+void SerializeACLSequenceUsageKey(FArchive& Ar, uint32& SequenceUsageKey)
+{
+	Ar << SequenceUsageKey;
+
+	if (Ar.IsLoading())
+	{
+		// Our data is keyed on the anim sequence content and not its path, a renamed sequence can load data compressed under its previous path
+		FUObjectSerializeContext* SerializeContext = Ar.GetSerializeContext();
+		UObject* Owner = SerializeContext != nullptr ? SerializeContext->SerializedObject : nullptr;
+		if (Owner != nullptr)
+		{
+			SequenceUsageKey = GetACLSequenceUsageKey(Owner->GetFullName());
+		}
+	}
+}
+
+static void SaveUsageProfile(const TArray<FString>& Args)
+{
+	const FString Filename = Args.Num() != 0 ? Args[0] : FPaths::Combine(FPaths::ProfilingDir(), TEXT("ACL"), FString::Printf(TEXT("UsageProfile-%s.aclusage"), *FDateTime::Now().ToString()));
+
+	FACLUsageProfile Profile;
+	FACLUsageRecorder::GetProfile(Profile);
+
+	if (Profile.SaveToFile(Filename))
+	{
+		UE_LOG(LogAnimationCompression, Log, TEXT("ACL usage profile with %d sequences over %llu frames written to: %s"), Profile.Sequences.Num(), Profile.NumFrames, *Filename);
+	}
+	else
+	{
+		UE_LOG(LogAnimationCompression, Warning, TEXT("Failed to write ACL usage profile to: %s"), *Filename);
+	}
+}
+
+static FAutoConsoleCommand SaveUsageProfileCommand(
+	TEXT("ACL.SaveUsageProfile"),
+	TEXT("Writes the sequence usage recorded with 'ACL.RecordUsage' to disk. Argument: optional output filename"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&SaveUsageProfile));
+
+static FAutoConsoleCommand ResetUsageProfileCommand(
+	TEXT("ACL.ResetUsageProfile"),
+	TEXT("Discards the sequence usage recorded with 'ACL.RecordUsage'."),
+	FConsoleCommandDelegate::CreateStatic(&FACLUsageRecorder::Reset));
@@ -0,0 +1,49 @@
+#pragma once
+
+// Copyright 2020 Nicholas Frechette. All Rights Reserved.
+
+#include "CoreMinimal.h"
+
+class FAnimSequenceDecompressionContext;
+struct FACLUsageProfile;
+
+/** Whether or not sequence usage is being recorded. Driven by the 'ACL.RecordUsage' console variable. */
+extern int32 GACLRecordUsage;
+
+/**
+ * Records which sequences are decompressed and at which normalized time.
+ * Decompression threads write into their own thread local buffer and buffers are merged at the end of every frame.
+ */
+class FACLUsageRecorder
+{
+public:
+	/** Registers the end of frame callback. */
+	static void Initialize();
+
+	/** Unregisters the end of frame callback. */
+	static void Shutdown();
+
+	/** Records a decompression request of the sequence with the specified usage key. Called from any thread. */
+	static void RecordDecompression(const FAnimSequenceDecompressionContext& DecompContext, uint32 SequenceUsageKey);
+
+	/** Returns a snapshot of everything recorded so far. */
+	static void GetProfile(FACLUsageProfile& OutProfile);
+
+	/** Discards everything recorded so far. */
+	static void Reset();
+};
+
+/** Records a decompression request if usage recording is enabled. */
+FORCEINLINE void RecordACLUsage(const FAnimSequenceDecompressionContext& DecompContext, uint32 SequenceUsageKey)
+{
+	if (UNLIKELY(GACLRecordUsage != 0))
+	{
+		FACLUsageRecorder::RecordDecompression(DecompContext, SequenceUsageKey);
+	}
+}
+
+/**
+ * Serializes the usage key of a sequence (see GetACLSequenceUsageKey). When loading from a package, the key is recomputed
+ * from the anim sequence being loaded since our compressed data could have been cached under another path.
+ */
+void SerializeACLSequenceUsageKey(FArchive& Ar, uint32& SequenceUsageKey);
@@ -19,6 +19,7 @@ UAnimBoneCompressionCodec_ACL::UAnimBoneCompressionCodec_ACL(const FObjectInitia
 {
 #if WITH_EDITORONLY_DATA
 	SafetyFallbackThreshold = 1.0f;			// 1cm, should be very rarely exceeded
+	KeyframeStrippingProportion.Default = 0.0f;	// Strip nothing by default
 #endif	// WITH_EDITORONLY_DATA
 }
 
@@ -58,7 +59,12 @@ void UAnimBoneCompressionCodec_ACL::GetCompressionSettings(acl::compression_sett
 {
 	OutSettings = acl::get_default_compression_settings();
 
-	OutSettings.level = GetCompressionLevel(CompressionLevel);
+	OutSettings.level = GetCompressionLevel(GetCompressionLevelForPlatform());
+}
+
+float UAnimBoneCompressionCodec_ACL::GetKeyframeStrippingProportion() const
+{
+	return FMath::Clamp(GetPerPlatformValue(KeyframeStrippingProportion), 0.0f, 1.0f);
 }
 
 ACLSafetyFallbackResult UAnimBoneCompressionCodec_ACL::ExecuteSafetyFallback(acl::iallocator& Allocator, const acl::compression_settings& Settings, const acl::track_array_qvvf& RawClip, const acl::track_array_qvvf& BaseClip, const acl::compressed_tracks& CompressedClipData, const FCompressibleAnimData& CompressibleAnimData, FCompressibleAnimDataResult& OutResult)
@@ -93,8 +99,9 @@ void UAnimBoneCompressionCodec_ACL::PopulateDDCKey(FArchive& Ar)
 
 	uint32 ForceRebuildVersion = 1;
 	uint32 SettingsHash = Settings.get_hash();
+	float StrippingProportion = GetKeyframeStrippingProportion();
 
-	Ar	<< SafetyFallbackThreshold << ForceRebuildVersion << SettingsHash;
+	Ar	<< SafetyFallbackThreshold << ForceRebuildVersion << SettingsHash << StrippingProportion;
 
 	for (USkeletalMesh* SkelMesh : OptimizationTargets)
 	{
@@ -125,26 +132,63 @@ UAnimBoneCompressionCodec* UAnimBoneCompressionCodec_ACL::GetCodec(const FString
 	return CodecMatch;
 }
 
+/** Decompresses with the settings that match our compressed data, sequences compressed with a database use the database settings. */
+template<class DecompressFuncType>
+static void DecompressWithContext(const FACLCompressedAnimData& AnimData, const acl::compressed_tracks& CompressedClipData, DecompressFuncType&& DecompressFunc)
+{
+	if (AnimData.bHasDatabase)
+	{
+		// Our keyframes have been stripped, the sequence remains bound to the discarded database
+		acl::decompression_context<UE4DefaultDBDecompressionSettings> ACLContext;
+		ACLContext.initialize(CompressedClipData);
+
+		DecompressFunc(ACLContext);
+	}
+	else
+	{
+		acl::decompression_context<UE4DefaultDecompressionSettings> ACLContext;
+		ACLContext.initialize(CompressedClipData);
+
+		DecompressFunc(ACLContext);
+	}
+}
+
 void UAnimBoneCompressionCodec_ACL::DecompressPose(FAnimSequenceDecompressionContext& DecompContext, const BoneTrackArray& RotationPairs, const BoneTrackArray& TranslationPairs, const BoneTrackArray& ScalePairs, TArrayView<FTransform>& OutAtoms) const
 {
 	const FACLCompressedAnimData& AnimData = static_cast<const FACLCompressedAnimData&>(DecompContext.CompressedAnimData);
+	FACLCompressedDataReadScope ReadScope(AnimData);
+	if (!ReadScope.IsResident())
+	{
+		return;	// Our data is streaming in, the output pose retains the reference pose it was initialized with
+	}
+
+	RecordACLUsage(DecompContext, AnimData.SequenceUsageKey);
+
 	const acl::compressed_tracks* CompressedClipData = AnimData.GetCompressedTracks();
 	check(CompressedClipData != nullptr && CompressedClipData->is_valid(false).empty());
 
-	acl::decompression_context<UE4DefaultDecompressionSettings> ACLContext;
-	ACLContext.initialize(*CompressedClipData);
-
-	::DecompressPose(DecompContext, ACLContext, RotationPairs, TranslationPairs, ScalePairs, OutAtoms);
+	DecompressWithContext(AnimData, *CompressedClipData, [&](auto& ACLContext)
+		{
+			::DecompressPose(DecompContext, ACLContext, RotationPairs, TranslationPairs, ScalePairs, OutAtoms);
+		});
 }
 
 void UAnimBoneCompressionCodec_ACL::DecompressBone(FAnimSequenceDecompressionContext& DecompContext, int32 TrackIndex, FTransform& OutAtom) const
 {
 	const FACLCompressedAnimData& AnimData = static_cast<const FACLCompressedAnimData&>(DecompContext.CompressedAnimData);
+	FACLCompressedDataReadScope ReadScope(AnimData);
+	if (!ReadScope.IsResident())
+	{
+		return;	// Our data is streaming in, the output transform is left untouched
+	}
+
+	RecordACLUsage(DecompContext, AnimData.SequenceUsageKey);
+
 	const acl::compressed_tracks* CompressedClipData = AnimData.GetCompressedTracks();
 	check(CompressedClipData != nullptr && CompressedClipData->is_valid(false).empty());
 
-	acl::decompression_context<UE4DefaultDecompressionSettings> ACLContext;
-	ACLContext.initialize(*CompressedClipData);
-
-	::DecompressBone(DecompContext, ACLContext, TrackIndex, OutAtom);
+	DecompressWithContext(AnimData, *CompressedClipData, [&](auto& ACLContext)
+		{
+			::DecompressBone(DecompContext, ACLContext, TrackIndex, OutAtom);
+		});
 }
@@ -0,0 +1,275 @@
+// Copyright 2020 Nicholas Frechette. All Rights Reserved.
+
+#include "AnimBoneCompressionCodec_ACLAuto.h"
+
+#include "ACLDecompressionImpl.h"
+
+#if WITH_EDITORONLY_DATA
+#include "Async/ParallelFor.h"
+#include "Rendering/SkeletalMeshModel.h"
+
+#include <acl/compression/compression_settings.h>
+#include <acl/compression/transform_error_metrics.h>
+#endif
+
+UAnimBoneCompressionCodec_ACLAuto::UAnimBoneCompressionCodec_ACLAuto(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+#if WITH_EDITORONLY_DATA
+	// The default settings first, followed by smaller and larger segments, and faster to decompress full precision rotations
+	FACLAutoCandidate DefaultCandidate;
+	Candidates.Add(DefaultCandidate);
+
+	FACLAutoCandidate SmallSegmentsCandidate;
+	SmallSegmentsCandidate.IdealNumKeyFramesPerSegment = 8;
+	SmallSegmentsCandidate.MaxNumKeyFramesPerSegment = 15;
+	Candidates.Add(SmallSegmentsCandidate);
+
+	FACLAutoCandidate LargeSegmentsCandidate;
+	LargeSegmentsCandidate.IdealNumKeyFramesPerSegment = 32;
+	LargeSegmentsCandidate.MaxNumKeyFramesPerSegment = 63;
+	Candidates.Add(LargeSegmentsCandidate);
+
+	FACLAutoCandidate FullRotationsCandidate;
+	FullRotationsCandidate.RotationFormat = ACLRF_QuatDropW_96;
+	Candidates.Add(FullRotationsCandidate);
+
+	DecodeSpeedWeight = 0.25f;
+#endif	// WITH_EDITORONLY_DATA
+}
+
+#if WITH_EDITORONLY_DATA
+void UAnimBoneCompressionCodec_ACLAuto::GetCandidateCompressionSettings(const FACLAutoCandidate& Candidate, acl::compression_settings& OutSettings) const
+{
+	OutSettings = acl::get_default_compression_settings();
+	OutSettings.rotation_format = GetRotationFormat(Candidate.RotationFormat);
+	OutSettings.level = GetCompressionLevel(GetCompressionLevelForPlatform());
+
+	OutSettings.segmenting.ideal_num_samples = Candidate.IdealNumKeyFramesPerSegment;
+	OutSettings.segmenting.max_num_samples = FMath::Max(Candidate.MaxNumKeyFramesPerSegment, Candidate.IdealNumKeyFramesPerSegment);
+}
+
+void UAnimBoneCompressionCodec_ACLAuto::GetCompressionSettings(acl::compression_settings& OutSettings) const
+{
+	GetCandidateCompressionSettings(Candidates.Num() != 0 ? Candidates[0] : FACLAutoCandidate(), OutSettings);
+}
+
+void UAnimBoneCompressionCodec_ACLAuto::SelectCompressionSettings(const FCompressibleAnimData& CompressibleAnimData, const acl::track_array_qvvf& ACLTracks, const acl::track_array_qvvf& ACLBaseTracks, float SequenceErrorThreshold, acl::compression_settings& OutSettings) const
+{
+	GetCompressionSettings(OutSettings);
+
+	const int32 NumCandidates = Candidates.Num();
+	if (NumCandidates <= 1)
+	{
+		if (bAutoSegmenting)
+		{
+			SelectSegmentSize(ACLTracks, ACLBaseTracks, SequenceErrorThreshold, OutSettings);
+		}
+
+		return;	// Nothing else to choose from
+	}
+
+	TArray<uint32> CompressedSizes;
+	TArray<float> DecodeCostUnits;
+	CompressedSizes.SetNumZeroed(NumCandidates);
+	DecodeCostUnits.SetNumZeroed(NumCandidates);
+
+	// Every candidate is independent, compress them in parallel
+	ParallelFor(NumCandidates, [&](int32 CandidateIndex)
+		{
+			acl::compression_settings Settings;
+			GetCandidateCompressionSettings(Candidates[CandidateIndex], Settings);
+
+			acl::qvvf_transform_error_metric DefaultErrorMetric;
+			acl::additive_qvvf_transform_error_metric<acl::additive_clip_format8::additive1> AdditiveErrorMetric;
+			if (!ACLBaseTracks.is_empty())
+			{
+				Settings.error_metric = &AdditiveErrorMetric;
+			}
+			else
+			{
+				Settings.error_metric = &DefaultErrorMetric;
+			}
+
+			acl::compressed_tracks* CompressedTracks = nullptr;
+			const acl::error_result CompressionResult = CompressTracks(ACLTracks, ACLBaseTracks, Settings, SequenceErrorThreshold, CompressedTracks);
+			if (CompressionResult.any())
+			{
+				return;	// Leave it as invalid
+			}
+
+			// The decode cost estimate is deterministic unlike timing measurements, the same inputs always select the same candidate
+			CompressedSizes[CandidateIndex] = CompressedTracks->get_size();
+			DecodeCostUnits[CandidateIndex] = EstimateDecodeCostUnits(*CompressedTracks);
+
+			ACLAllocatorImpl.deallocate(CompressedTracks, CompressedTracks->get_size());
+		});
+
+	uint32 SmallestSize = MAX_uint32;
+	float LowestCost = MAX_flt;
+	for (int32 CandidateIndex = 0; CandidateIndex < NumCandidates; ++CandidateIndex)
+	{
+		if (CompressedSizes[CandidateIndex] != 0)
+		{
+			SmallestSize = FMath::Min(SmallestSize, CompressedSizes[CandidateIndex]);
+			LowestCost = FMath::Min(LowestCost, DecodeCostUnits[CandidateIndex]);
+		}
+	}
+
+	if (SmallestSize == MAX_uint32)
+	{
+		return;	// Every candidate failed, the default settings will report the error
+	}
+
+	// Both metrics are relative to the best candidate, a score of 1.0 is optimal
+	const float SpeedWeight = FMath::Clamp(DecodeSpeedWeight, 0.0f, 1.0f);
+
+	int32 BestCandidateIndex = INDEX_NONE;
+	float BestScore = MAX_flt;
+	for (int32 CandidateIndex = 0; CandidateIndex < NumCandidates; ++CandidateIndex)
+	{
+		if (CompressedSizes[CandidateIndex] == 0)
+		{
+			continue;
+		}
+
+		const float SizeScore = float(CompressedSizes[CandidateIndex]) / float(SmallestSize);
+		const float SpeedScore = LowestCost > 0.0f ? (DecodeCostUnits[CandidateIndex] / LowestCost) : 1.0f;
+		const float Score = ((1.0f - SpeedWeight) * SizeScore) + (SpeedWeight * SpeedScore);
+
+		if (Score < BestScore)
+		{
+			BestScore = Score;
+			BestCandidateIndex = CandidateIndex;
+		}
+	}
+
+	UE_LOG(LogAnimationCompression, Verbose, TEXT("ACL Auto selected candidate %d: %u bytes, %.1f decode cost units"), BestCandidateIndex, CompressedSizes[BestCandidateIndex], DecodeCostUnits[BestCandidateIndex]);
+
+	GetCandidateCompressionSettings(Candidates[BestCandidateIndex], OutSettings);
+
+	if (bAutoSegmenting)
+	{
+		SelectSegmentSize(ACLTracks, ACLBaseTracks, SequenceErrorThreshold, OutSettings);
+	}
+}
+
+void UAnimBoneCompressionCodec_ACLAuto::PopulateDDCKey(FArchive& Ar)
+{
+	Super::PopulateDDCKey(Ar);
+
+	// Bump this when the candidate scoring or the decode cost estimate changes
+	uint32 ForceRebuildVersion = 1;
+	float SpeedWeight = FMath::Clamp(DecodeSpeedWeight, 0.0f, 1.0f);
+
+	Ar << ForceRebuildVersion << SpeedWeight;
+
+	for (const FACLAutoCandidate& Candidate : Candidates)
+	{
+		acl::compression_settings Settings;
+		GetCandidateCompressionSettings(Candidate, Settings);
+
+		uint32 SettingsHash = Settings.get_hash();
+		Ar << SettingsHash;
+	}
+
+	for (USkeletalMesh* SkelMesh : OptimizationTargets)
+	{
+		FSkeletalMeshModel* MeshModel = SkelMesh != nullptr ? SkelMesh->GetImportedModel() : nullptr;
+		if (MeshModel != nullptr)
+		{
+			Ar << MeshModel->SkeletalMeshModelGUID;
+		}
+	}
+}
+#endif // WITH_EDITORONLY_DATA
+
+void UAnimBoneCompressionCodec_ACLAuto::DecompressPose(FAnimSequenceDecompressionContext& DecompContext, const BoneTrackArray& RotationPairs, const BoneTrackArray& TranslationPairs, const BoneTrackArray& ScalePairs, TArrayView<FTransform>& OutAtoms) const
+{
+	const FACLCompressedAnimData& AnimData = static_cast<const FACLCompressedAnimData&>(DecompContext.CompressedAnimData);
+	FACLCompressedDataReadScope ReadScope(AnimData);
+	if (!ReadScope.IsResident())
+	{
+		return;	// Our data is streaming in, the output pose retains the reference pose it was initialized with
+	}
+
+	RecordACLUsage(DecompContext, AnimData.SequenceUsageKey);
+
+	const acl::compressed_tracks* CompressedClipData = AnimData.GetCompressedTracks();
+	check(CompressedClipData != nullptr && CompressedClipData->is_valid(false).empty());
+
+	// Every sequence can use a different rotation format, dispatch to the matching decompression settings
+	const acl::acl_impl::tracks_header& TracksHeader = acl::acl_impl::get_tracks_header(*CompressedClipData);
+	switch (TracksHeader.get_rotation_format())
+	{
+	case acl::rotation_format8::quatf_full:
+	{
+		acl::decompression_context<UE4SafeDecompressionSettings> ACLContext;
+		ACLContext.initialize(*CompressedClipData);
+
+		::DecompressPose(DecompContext, ACLContext, RotationPairs, TranslationPairs, ScalePairs, OutAtoms);
+		break;
+	}
+	case acl::rotation_format8::quatf_drop_w_full:
+	{
+		acl::decompression_context<UE4DropWFullDecompressionSettings> ACLContext;
+		ACLContext.initialize(*CompressedClipData);
+
+		::DecompressPose(DecompContext, ACLContext, RotationPairs, TranslationPairs, ScalePairs, OutAtoms);
+		break;
+	}
+	default:
+	{
+		acl::decompression_context<UE4DefaultDecompressionSettings> ACLContext;
+		ACLContext.initialize(*CompressedClipData);
+
+		::DecompressPose(DecompContext, ACLContext, RotationPairs, TranslationPairs, ScalePairs, OutAtoms);
+		break;
+	}
+	}
+}
+
+void UAnimBoneCompressionCodec_ACLAuto::DecompressBone(FAnimSequenceDecompressionContext& DecompContext, int32 TrackIndex, FTransform& OutAtom) const
+{
+	const FACLCompressedAnimData& AnimData = static_cast<const FACLCompressedAnimData&>(DecompContext.CompressedAnimData);
+	FACLCompressedDataReadScope ReadScope(AnimData);
+	if (!ReadScope.IsResident())
+	{
+		return;	// Our data is streaming in, the output transform is left untouched
+	}
+
+	RecordACLUsage(DecompContext, AnimData.SequenceUsageKey);
+
+	const acl::compressed_tracks* CompressedClipData = AnimData.GetCompressedTracks();
+	check(CompressedClipData != nullptr && CompressedClipData->is_valid(false).empty());
+
+	// Every sequence can use a different rotation format, dispatch to the matching decompression settings
+	const acl::acl_impl::tracks_header& TracksHeader = acl::acl_impl::get_tracks_header(*CompressedClipData);
+	switch (TracksHeader.get_rotation_format())
+	{
+	case acl::rotation_format8::quatf_full:
+	{
+		acl::decompression_context<UE4SafeDecompressionSettings> ACLContext;
+		ACLContext.initialize(*CompressedClipData);
+
+		::DecompressBone(DecompContext, ACLContext, TrackIndex, OutAtom);
+		break;
+	}
+	case acl::rotation_format8::quatf_drop_w_full:
+	{
+		acl::decompression_context<UE4DropWFullDecompressionSettings> ACLContext;
+		ACLContext.initialize(*CompressedClipData);
+
+		::DecompressBone(DecompContext, ACLContext, TrackIndex, OutAtom);
+		break;
+	}
+	default:
+	{
+		acl::decompression_context<UE4DefaultDecompressionSettings> ACLContext;
+		ACLContext.initialize(*CompressedClipData);
+
+		::DecompressBone(DecompContext, ACLContext, TrackIndex, OutAtom);
+		break;
+	}
+	}
+}
@@ -1,12 +1,20 @@
 // Copyright 2018 Nicholas Frechette. All Rights Reserved.
 
 #include "AnimBoneCompressionCodec_ACLBase.h"
+#include "AnimBoneCompressionCodec_ACLDatabase.h"
+#include "ACLResidentDataRegion.h"
+#include "ACLSharedDataFile.h"
+#include "ACLUsageProfile.h"
+#include "ACLUsageRecorder.h"
+#include "Animation/AnimSequence.h"
 #include "Serialization/MemoryWriter.h"
 #include "Serialization/MemoryReader.h"
+#include "UObject/UObjectThreadContext.h"
 
 #if WITH_EDITORONLY_DATA
 #include "AnimBoneCompressionCodec_ACLSafe.h"
 #include "Animation/AnimationSettings.h"
+#include "Async/ParallelFor.h"
 #include "Rendering/SkeletalMeshModel.h"
 
 #include "ACLImpl.h"
@@ -21,6 +29,12 @@
 
 bool FACLCompressedAnimData::IsValid() const
 {
+	if (StreamedData != nullptr && CompressedByteStream.Num() == 0)
+	{
+		// Our data isn't resident, it will stream in when requested
+		return StreamedData->GetSize() != 0;
+	}
+
 	if (CompressedByteStream.Num() == 0)
 	{
 		return false;
@@ -30,23 +44,238 @@ bool FACLCompressedAnimData::IsValid() const
 	return CompressedClipData != nullptr && CompressedClipData->is_valid(false).empty();
 }
 
+FACLCompressedAnimData::~FACLCompressedAnimData()
+{
+	ReleaseResidentDataRegionBytes();
+}
+
+void FACLCompressedAnimData::ReleaseResidentDataRegionBytes()
+{
+	if (bIsInResidentDataRegion)
+	{
+		FACLResidentDataRegion::Get().Free(CompressedByteStream.GetData(), CompressedByteStream.Num());
+		CompressedByteStream = TArrayView<uint8>();
+		bIsInResidentDataRegion = false;
+	}
+}
+
+/** Returns the object being serialized, the anim sequence that owns us. Streamed bulk data requires it to find its package. */
+static UObject* GetSerializedOwner(FArchive& Ar)
+{
+	FUObjectSerializeContext* SerializeContext = Ar.GetSerializeContext();
+	return SerializeContext != nullptr ? SerializeContext->SerializedObject : nullptr;
+}
+
+void FACLCompressedAnimData::SerializeCompressedData(FArchive& Ar)
+{
+	ICompressedAnimData::SerializeCompressedData(Ar);
+
+	UObject* Owner = GetSerializedOwner(Ar);
+
+	SerializeACLSequenceUsageKey(Ar, SequenceUsageKey);
+
+	// Only cooked packages store our compressed data as streamed bulk data, the DDC and editor packages always hold it inline
+	bool bIsStreamed = false;
+#if WITH_EDITORONLY_DATA
+	bIsStreamed = Ar.IsSaving() && Ar.IsCooking() && bStreamWhenCooked && Owner != nullptr && CompressedByteStream.Num() != 0;
+#endif
+	Ar << bIsStreamed;
+
+	if (bIsStreamed)
+	{
+		SerializeStreamedData(Ar, Owner);
+		return;
+	}
+
+	// Our compressed data is serialized here instead of the engine byte stream, when loading we read it directly
+	// into its final location and avoid the intermediate engine buffer and its copy
+	int32 NumBytes = CompressedByteStream.Num();
+	Ar << NumBytes;
+
+	if (Ar.IsLoading())
+	{
+		ReleaseResidentDataRegionBytes();
+
+		uint8* Bytes = nullptr;
+
+#if !WITH_EDITORONLY_DATA
+		// In cooked builds, load our compressed data into the resident data region when enabled
+		// When a shared data file is used, we load into a temporary buffer instead since we'll likely bind to the file
+		const bool bUseSharedDataFile = FACLSharedDataFile::IsEnabled();
+		if (!bUseSharedDataFile && FACLResidentDataRegion::IsEnabled() && NumBytes != 0)
+		{
+			Bytes = FACLResidentDataRegion::Get().Allocate(NumBytes, 16);
+			bIsInResidentDataRegion = Bytes != nullptr;
+		}
+#endif
+
+		if (Bytes == nullptr)
+		{
+			// ACL requires 16 byte alignment for its compressed data
+			OwnedByteStream.Empty(NumBytes);
+			OwnedByteStream.AddUninitialized(NumBytes);
+			Bytes = OwnedByteStream.GetData();
+		}
+
+		Ar.Serialize(Bytes, NumBytes);
+
+		CompressedByteStream = TArrayView<uint8>(Bytes, NumBytes);
+		DecodeCostUnits = -1.0f;
+		CacheCompressedDataProperties();
+
+#if !WITH_EDITORONLY_DATA
+		// When the shared data file contains our data, bind to its mapped copy and release ours
+		const acl::compressed_tracks* CompressedClipData = bUseSharedDataFile && NumBytes != 0 ? GetCompressedTracks() : nullptr;
+		if (CompressedClipData != nullptr)
+		{
+			uint8* SharedBytes = FACLSharedDataFile::Get().Find(CompressedClipData->get_hash(), CompressedByteStream);
+			if (SharedBytes != nullptr)
+			{
+				CompressedByteStream = TArrayView<uint8>(SharedBytes, NumBytes);
+				OwnedByteStream.Empty();
+			}
+		}
+#endif
+	}
+	else
+	{
+		Ar.Serialize(CompressedByteStream.GetData(), NumBytes);
+	}
+}
+
+void FACLCompressedAnimData::SerializeStreamedData(FArchive& Ar, UObject* Owner)
+{
+	if (Ar.IsLoading())
+	{
+		// Our data streams in when first requested
+		ReleaseResidentDataRegionBytes();
+		StreamedData.Reset();
+		StreamedData = MakeUnique<FACLStreamedClipData>(*this);
+		StreamedData->Serialize(Ar, Owner);
+
+		CompressedByteStream = TArrayView<uint8>();
+		OwnedByteStream.Empty();
+		DecodeCostUnits = -1.0f;
+	}
+	else
+	{
+#if WITH_EDITORONLY_DATA
+		CookedStreamedBulkData.SetBulkDataFlags(BULKDATA_Force_NOT_InlinePayload);
+		CookedStreamedBulkData.Lock(LOCK_READ_WRITE);
+		{
+			const int32 NumBytes = CompressedByteStream.Num();
+			void* BulkDataToSave = CookedStreamedBulkData.Realloc(NumBytes);
+			FMemory::Memcpy(BulkDataToSave, CompressedByteStream.GetData(), NumBytes);
+		}
+		CookedStreamedBulkData.Unlock();
+
+		CookedStreamedBulkData.Serialize(Ar, Owner, INDEX_NONE, false);
+#endif
+	}
+}
+
+void FACLCompressedAnimData::Bind(const TArrayView<uint8> BulkData)
+{
+	// When our compressed data was serialized with us, the engine byte stream is empty and we remain bound to our data
+	if (BulkData.Num() != 0 || CompressedByteStream.Num() == 0)
+	{
+		ReleaseResidentDataRegionBytes();
+		CompressedByteStream = BulkData;
+		OwnedByteStream.Empty();
+	}
+
+	DecodeCostUnits = -1.0f;
+	CacheCompressedDataProperties();
+}
+
+void FACLCompressedAnimData::CacheCompressedDataProperties()
+{
+	const acl::compressed_tracks* CompressedClipData = CompressedByteStream.Num() != 0 ? GetCompressedTracks() : nullptr;
+	bHasDatabase = CompressedClipData != nullptr && acl::acl_impl::get_tracks_header(*CompressedClipData).get_has_database();
+}
+
+float FACLCompressedAnimData::GetDecodeCostUnits() const
+{
+	if (DecodeCostUnits < 0.0f)
+	{
+		// Streamed data is estimated when it streams in, it could stream out while we read it here
+		const acl::compressed_tracks* CompressedClipData = StreamedData == nullptr ? GetCompressedTracks() : nullptr;
+		if (CompressedClipData == nullptr)
+		{
+			return 0.0f;	// Not bound yet or not resident yet, we'll estimate once resident
+		}
+
+		DecodeCostUnits = EstimateDecodeCostUnits(*CompressedClipData);
+	}
+
+	return DecodeCostUnits;
+}
+
 UAnimBoneCompressionCodec_ACLBase::UAnimBoneCompressionCodec_ACLBase(const FObjectInitializer& ObjectInitializer)
 	: Super(ObjectInitializer)
 {
 #if WITH_EDITORONLY_DATA
-	CompressionLevel = ACLCL_Medium;
+	// Must match the default value we had before the compression level could be set per platform
+	CompressionLevel_DEPRECATED = ACLCL_Medium;
+
+	CompressionLevelPerPlatform.Default = ACLCL_Medium;
 
 	// We use a higher virtual vertex distance when bones have a socket attached or are keyed end effectors (IK, hand, camera, etc)
 	// We use 100cm instead of 3cm. UE 4 usually uses 50cm (END_EFFECTOR_DUMMY_BONE_LENGTH_SOCKET) but
 	// we use a higher value anyway due to the fact that ACL has no error compensation and it is more aggressive.
-	DefaultVirtualVertexDistance = 3.0f;	// 3cm, suitable for ordinary characters
-	SafeVirtualVertexDistance = 100.0f;		// 100cm
+	DefaultVirtualVertexDistance.Default = 3.0f;	// 3cm, suitable for ordinary characters
+	SafeVirtualVertexDistance.Default = 100.0f;		// 100cm
+
+	ErrorThreshold.Default = 0.01f;					// 0.01cm, conservative enough for cinematographic quality
+
+	MaxSampleRate = 0.0f;					// Disabled, we retain the source sample rate
+
+	bAutoSegmenting = false;
+	AutoSegmentingLocalityWeight = 0.5f;
 
-	ErrorThreshold = 0.01f;					// 0.01cm, conservative enough for cinematographic quality
+	bStreamCompressedData = false;
 #endif	// WITH_EDITORONLY_DATA
 }
 
 #if WITH_EDITORONLY_DATA
+void UAnimBoneCompressionCodec_ACLBase::PostLoad()
+{
+	Super::PostLoad();
+
+	// The deprecated value is only serialized when it differs from the old default and when it does, it becomes our default value
+	if (CompressionLevel_DEPRECATED != ACLCL_Medium)
+	{
+		CompressionLevelPerPlatform.Default = CompressionLevel_DEPRECATED;
+		CompressionLevel_DEPRECATED = ACLCL_Medium;
+	}
+}
+
+ACLCompressionLevel UAnimBoneCompressionCodec_ACLBase::GetCompressionLevelForPlatform() const
+{
+	return GetPerPlatformValue(CompressionLevelPerPlatform);
+}
+
+float UAnimBoneCompressionCodec_ACLBase::GetDefaultVirtualVertexDistanceForPlatform() const
+{
+	return FMath::Max(GetPerPlatformValue(DefaultVirtualVertexDistance), 0.0f);
+}
+
+float UAnimBoneCompressionCodec_ACLBase::GetSafeVirtualVertexDistanceForPlatform() const
+{
+	return FMath::Max(GetPerPlatformValue(SafeVirtualVertexDistance), 0.0f);
+}
+
+float UAnimBoneCompressionCodec_ACLBase::GetErrorThresholdForPlatform() const
+{
+	return FMath::Max(GetPerPlatformValue(ErrorThreshold), 0.0f);
+}
+
+float UAnimBoneCompressionCodec_ACLBase::GetErrorThresholdForSequence(const FCompressibleAnimData& CompressibleAnimData) const
+{
+	// Per sequence thresholds are stored on the sequence as a scale, it is part of its DDC key unlike anything we could store here
+	return GetErrorThresholdForPlatform() * FMath::Max(CompressibleAnimData.ErrorThresholdScale, 0.0f);
+}
+
 static void AppendMaxVertexDistances(USkeletalMesh* OptimizationTarget, TMap<FName, float>& BoneMaxVertexDistanceMap)
 {
 	USkeleton* Skeleton = OptimizationTarget != nullptr ? OptimizationTarget->Skeleton : nullptr;
@@ -168,13 +397,224 @@ static void PopulateShellDistanceFromOptimizationTargets(const FCompressibleAnim
 	}
 }
 
+static void StripLowestImportanceKeyframes(float Proportion, acl::compressed_tracks*& CompressedTracks)
+{
+	// We build a database that only contains our sequence and we move the requested proportion of keyframes
+	// into its lowest importance tier. The database and the keyframes it contains are then discarded.
+	// The resulting sequence remains bound to the database but it can be decompressed on its own, the missing
+	// keyframes are interpolated from the ones that remain.
+	acl::compression_database_settings Settings;	// Use defaults
+	Settings.low_importance_tier_proportion = Proportion;
+	Settings.medium_importance_tier_proportion = 0.0f;
+
+	const acl::compressed_tracks* InputTracks[1] = { CompressedTracks };
+	acl::compressed_tracks* StrippedTracks[1] = { nullptr };
+
+	acl::compressed_database* Database = nullptr;
+	const acl::error_result StripResult = acl::build_database(ACLAllocatorImpl, Settings, InputTracks, 1, StrippedTracks, Database);
+
+	if (StripResult.any())
+	{
+		// We failed to strip our keyframes but the sequence is still usable, don't fail anything
+		UE_LOG(LogAnimationCompression, Warning, TEXT("ACL failed to strip keyframes: %s"), ANSI_TO_TCHAR(StripResult.c_str()));
+		return;
+	}
+
+	checkSlow(StrippedTracks[0]->is_valid(true).empty());
+
+	UE_LOG(LogAnimationCompression, Verbose, TEXT("ACL Animation keyframe stripping (%.1f%%): %u bytes -> %u bytes"), Proportion * 100.0f, CompressedTracks->get_size(), StrippedTracks[0]->get_size());
+
+	ACLAllocatorImpl.deallocate(Database, Database->get_size());
+	ACLAllocatorImpl.deallocate(CompressedTracks, CompressedTracks->get_size());
+
+	CompressedTracks = StrippedTracks[0];
+}
+
+acl::error_result UAnimBoneCompressionCodec_ACLBase::CompressTracks(const acl::track_array_qvvf& ACLTracks, const acl::track_array_qvvf& ACLBaseTracks, const acl::compression_settings& Settings, float SequenceErrorThreshold, acl::compressed_tracks*& OutCompressedTracks) const
+{
+	const acl::additive_clip_format8 AdditiveFormat = acl::additive_clip_format8::additive0;
+
+	acl::output_stats Stats;
+	acl::compressed_tracks* CompressedTracks = nullptr;
+	acl::error_result CompressionResult;
+
+	const bool bResample = MaxSampleRate > 0.0f && ACLTracks.get_num_samples_per_track() > 1 && ACLTracks.get_sample_rate() > MaxSampleRate;
+	if (bResample)
+	{
+		acl::track_array_qvvf ACLResampledTracks = ResampleACLTransformTrackArray(ACLAllocatorImpl, ACLTracks, MaxSampleRate);
+
+		acl::track_array_qvvf ACLResampledBaseTracks;
+		if (!ACLBaseTracks.is_empty())
+			ACLResampledBaseTracks = ResampleACLTransformTrackArray(ACLAllocatorImpl, ACLBaseTracks, MaxSampleRate);
+
+		CompressionResult = acl::compress_track_list(ACLAllocatorImpl, ACLResampledTracks, Settings, ACLResampledBaseTracks, AdditiveFormat, CompressedTracks, Stats);
+
+		if (CompressionResult.empty())
+		{
+			// Our error must be measured against the source samples, not the resampled ones
+			acl::decompression_context<UE4DebugDBDecompressionSettings> Context;
+			Context.initialize(*CompressedTracks);
+
+			const acl::track_error TrackError = acl::calculate_compression_error(ACLAllocatorImpl, ACLTracks, Context, *Settings.error_metric, ACLBaseTracks);
+			if (TrackError.error > SequenceErrorThreshold)
+			{
+				UE_LOG(LogAnimationCompression, Verbose, TEXT("ACL resampled animation error too high: %.4f cm (bone %u @ %.3f), retaining the source sample rate"), TrackError.error, TrackError.index, TrackError.sample_time);
+
+				ACLAllocatorImpl.deallocate(CompressedTracks, CompressedTracks->get_size());
+				CompressedTracks = nullptr;
+			}
+			else
+			{
+				UE_LOG(LogAnimationCompression, Verbose, TEXT("ACL resampled animation from %.2f FPS to %.2f FPS"), ACLTracks.get_sample_rate(), ACLResampledTracks.get_sample_rate());
+			}
+		}
+	}
+
+	if (CompressedTracks == nullptr)
+	{
+		CompressionResult = acl::compress_track_list(ACLAllocatorImpl, ACLTracks, Settings, ACLBaseTracks, AdditiveFormat, CompressedTracks, Stats);
+	}
+
+	OutCompressedTracks = CompressionResult.empty() ? CompressedTracks : nullptr;
+	return CompressionResult;
+}
+
+void UAnimBoneCompressionCodec_ACLBase::SelectCompressionSettings(const FCompressibleAnimData& CompressibleAnimData, const acl::track_array_qvvf& ACLTracks, const acl::track_array_qvvf& ACLBaseTracks, float SequenceErrorThreshold, acl::compression_settings& OutSettings) const
+{
+	GetCompressionSettings(OutSettings);
+
+	if (bAutoSegmenting)
+	{
+		SelectSegmentSize(ACLTracks, ACLBaseTracks, SequenceErrorThreshold, OutSettings);
+	}
+}
+
+void UAnimBoneCompressionCodec_ACLBase::SelectSegmentSize(const acl::track_array_qvvf& ACLTracks, const acl::track_array_qvvf& ACLBaseTracks, float SequenceErrorThreshold, acl::compression_settings& InOutSettings) const
+{
+	// Ideal and maximum number of samples per segment
+	static constexpr uint32 SegmentSizes[][2] = { { 8, 15 }, { 16, 31 }, { 32, 63 }, { 64, 127 } };
+	static constexpr int32 NumSegmentSizes = UE_ARRAY_COUNT(SegmentSizes);
+
+	if (ACLTracks.get_num_samples_per_track() <= SegmentSizes[0][1])
+	{
+		return;	// Every segment size yields a single segment
+	}
+
+	TArray<uint32> CompressedSizes;
+	TArray<uint32> BytesTouchedPerSample;
+	CompressedSizes.SetNumZeroed(NumSegmentSizes);
+	BytesTouchedPerSample.SetNumZeroed(NumSegmentSizes);
+
+	ParallelFor(NumSegmentSizes, [&](int32 SizeIndex)
+		{
+			acl::compression_settings Settings = InOutSettings;
+			Settings.segmenting.ideal_num_samples = SegmentSizes[SizeIndex][0];
+			Settings.segmenting.max_num_samples = SegmentSizes[SizeIndex][1];
+
+			acl::qvvf_transform_error_metric DefaultErrorMetric;
+			acl::additive_qvvf_transform_error_metric<acl::additive_clip_format8::additive1> AdditiveErrorMetric;
+			if (!ACLBaseTracks.is_empty())
+			{
+				Settings.error_metric = &AdditiveErrorMetric;
+			}
+			else
+			{
+				Settings.error_metric = &DefaultErrorMetric;
+			}
+
+			acl::compressed_tracks* CompressedTracks = nullptr;
+			const acl::error_result CompressionResult = CompressTracks(ACLTracks, ACLBaseTracks, Settings, SequenceErrorThreshold, CompressedTracks);
+			if (CompressionResult.any())
+			{
+				return;	// Leave it as invalid
+			}
+
+			CompressedSizes[SizeIndex] = CompressedTracks->get_size();
+			BytesTouchedPerSample[SizeIndex] = EstimateBytesTouchedPerSample(*CompressedTracks);
+
+			ACLAllocatorImpl.deallocate(CompressedTracks, CompressedTracks->get_size());
+		});
+
+	uint32 SmallestSize = MAX_uint32;
+	uint32 FewestBytesTouched = MAX_uint32;
+	for (int32 SizeIndex = 0; SizeIndex < NumSegmentSizes; ++SizeIndex)
+	{
+		if (CompressedSizes[SizeIndex] != 0)
+		{
+			SmallestSize = FMath::Min(SmallestSize, CompressedSizes[SizeIndex]);
+			FewestBytesTouched = FMath::Min(FewestBytesTouched, BytesTouchedPerSample[SizeIndex]);
+		}
+	}
+
+	if (SmallestSize == MAX_uint32)
+	{
+		return;	// Every segment size failed, the original settings will report the error
+	}
+
+	// Both metrics are relative to the best segment size, a score of 1.0 is optimal
+	const float LocalityWeight = FMath::Clamp(AutoSegmentingLocalityWeight, 0.0f, 1.0f);
+
+	int32 BestSizeIndex = INDEX_NONE;
+	float BestScore = MAX_flt;
+	for (int32 SizeIndex = 0; SizeIndex < NumSegmentSizes; ++SizeIndex)
+	{
+		if (CompressedSizes[SizeIndex] == 0)
+		{
+			continue;
+		}
+
+		const float SizeScore = float(CompressedSizes[SizeIndex]) / float(SmallestSize);
+		const float LocalityScore = float(BytesTouchedPerSample[SizeIndex]) / float(FMath::Max<uint32>(FewestBytesTouched, 1));
+		const float Score = ((1.0f - LocalityWeight) * SizeScore) + (LocalityWeight * LocalityScore);
+
+		if (Score < BestScore)
+		{
+			BestScore = Score;
+			BestSizeIndex = SizeIndex;
+		}
+	}
+
+	UE_LOG(LogAnimationCompression, Verbose, TEXT("ACL auto segmenting selected %u:%u samples per segment: %u bytes, %u bytes touched per sample"), SegmentSizes[BestSizeIndex][0], SegmentSizes[BestSizeIndex][1], CompressedSizes[BestSizeIndex], BytesTouchedPerSample[BestSizeIndex]);
+
+	InOutSettings.segmenting.ideal_num_samples = SegmentSizes[BestSizeIndex][0];
+	InOutSettings.segmenting.max_num_samples = SegmentSizes[BestSizeIndex][1];
+}
+
+/**
+ * Scales the error measured by an ACL error metric. When the precision of every track is scaled by the same amount,
+ * compression makes the same decisions but the contributing error stored for every key frame is scaled.
+ */
+template<class ErrorMetricType>
+class TACLScaledErrorMetric final : public ErrorMetricType
+{
+public:
+	explicit TACLScaledErrorMetric(float InScale) : Scale(InScale) {}
+
+	virtual rtm::scalarf RTM_SIMD_CALL calculate_error(const acl::itransform_error_metric::calculate_error_args& Args) const override
+	{
+		return rtm::scalar_mul(ErrorMetricType::calculate_error(Args), rtm::scalar_set(Scale));
+	}
+
+	virtual rtm::scalarf RTM_SIMD_CALL calculate_error_no_scale(const acl::itransform_error_metric::calculate_error_args& Args) const override
+	{
+		return rtm::scalar_mul(ErrorMetricType::calculate_error_no_scale(Args), rtm::scalar_set(Scale));
+	}
+
+private:
+	float Scale;
+};
+
 bool UAnimBoneCompressionCodec_ACLBase::Compress(const FCompressibleAnimData& CompressibleAnimData, FCompressibleAnimDataResult& OutResult)
 {
-	acl::track_array_qvvf ACLTracks = BuildACLTransformTrackArray(ACLAllocatorImpl, CompressibleAnimData, DefaultVirtualVertexDistance, SafeVirtualVertexDistance, false);
+	const float PlatformDefaultVirtualVertexDistance = GetDefaultVirtualVertexDistanceForPlatform();
+	const float PlatformSafeVirtualVertexDistance = GetSafeVirtualVertexDistanceForPlatform();
+	const float SequenceErrorThreshold = GetErrorThresholdForSequence(CompressibleAnimData);
+
+	acl::track_array_qvvf ACLTracks = BuildACLTransformTrackArray(ACLAllocatorImpl, CompressibleAnimData, PlatformDefaultVirtualVertexDistance, PlatformSafeVirtualVertexDistance, false);
 
 	acl::track_array_qvvf ACLBaseTracks;
 	if (CompressibleAnimData.bIsValidAdditive)
-		ACLBaseTracks = BuildACLTransformTrackArray(ACLAllocatorImpl, CompressibleAnimData, DefaultVirtualVertexDistance, SafeVirtualVertexDistance, true);
+		ACLBaseTracks = BuildACLTransformTrackArray(ACLAllocatorImpl, CompressibleAnimData, PlatformDefaultVirtualVertexDistance, PlatformSafeVirtualVertexDistance, true);
 
 	UE_LOG(LogAnimationCompression, Verbose, TEXT("ACL Animation raw size: %u bytes"), ACLTracks.get_raw_size());
 
@@ -187,7 +627,7 @@ bool UAnimBoneCompressionCodec_ACLBase::Compress(const FCompressibleAnimData& Co
 
 	// Set our error threshold
 	for (acl::track_qvvf& Track : ACLTracks)
-		Track.get_description().precision = ErrorThreshold;
+		Track.get_description().precision = SequenceErrorThreshold;
 
 	// Override track settings if we need to
 	if (IsA<UAnimBoneCompressionCodec_ACLSafe>())
@@ -198,7 +638,7 @@ bool UAnimBoneCompressionCodec_ACLBase::Compress(const FCompressibleAnimData& Co
 	}
 
 	acl::compression_settings Settings;
-	GetCompressionSettings(Settings);
+	SelectCompressionSettings(CompressibleAnimData, ACLTracks, ACLBaseTracks, SequenceErrorThreshold, Settings);
 
 	acl::qvvf_transform_error_metric DefaultErrorMetric;
 	acl::additive_qvvf_transform_error_metric<acl::additive_clip_format8::additive1> AdditiveErrorMetric;
@@ -211,17 +651,49 @@ bool UAnimBoneCompressionCodec_ACLBase::Compress(const FCompressibleAnimData& Co
 		Settings.error_metric = &DefaultErrorMetric;
 	}
 
-	const acl::additive_clip_format8 AdditiveFormat = acl::additive_clip_format8::additive0;
 	const bool bUseStreamingDatabase = UseDatabase();
 
-	if (bUseStreamingDatabase)
+	// Keyframes stripped at compression time are lost, there is no point in doing so if we stream them later
+	const float KeyframeStrippingProportion = bUseStreamingDatabase ? 0.0f : GetKeyframeStrippingProportion();
+	const bool bStripKeyframes = KeyframeStrippingProportion > 0.0f;
+
+	if (bUseStreamingDatabase || bStripKeyframes)
 	{
+		// Required to be able to determine the importance of every keyframe
 		Settings.include_contributing_error = true;
 	}
 
-	acl::output_stats Stats;
+	// The database moves the key frames with the lowest contributing error first, across every sequence it contains.
+	// We scale both the error metric and the precision to bias the contributing error of this sequence without changing how it compresses.
+	const float ContributingErrorScale = bUseStreamingDatabase ? GetContributingErrorScale(CompressibleAnimData) : 1.0f;
+	const bool bScaleContributingError = ContributingErrorScale > 0.0f && ContributingErrorScale != 1.0f;
+
+	TACLScaledErrorMetric<acl::qvvf_transform_error_metric> ScaledDefaultErrorMetric(ContributingErrorScale);
+	TACLScaledErrorMetric<acl::additive_qvvf_transform_error_metric<acl::additive_clip_format8::additive1>> ScaledAdditiveErrorMetric(ContributingErrorScale);
+	acl::itransform_error_metric* ErrorMetric = Settings.error_metric;
+
+	float CompressionErrorThreshold = SequenceErrorThreshold;
+	if (bScaleContributingError)
+	{
+		CompressionErrorThreshold = SequenceErrorThreshold * ContributingErrorScale;
+		for (acl::track_qvvf& Track : ACLTracks)
+			Track.get_description().precision = CompressionErrorThreshold;
+
+		if (!ACLBaseTracks.is_empty())
+		{
+			Settings.error_metric = &ScaledAdditiveErrorMetric;
+		}
+		else
+		{
+			Settings.error_metric = &ScaledDefaultErrorMetric;
+		}
+	}
+
 	acl::compressed_tracks* CompressedTracks = nullptr;
-	const acl::error_result CompressionResult = acl::compress_track_list(ACLAllocatorImpl, ACLTracks, Settings, ACLBaseTracks, AdditiveFormat, CompressedTracks, Stats);
+	const acl::error_result CompressionResult = CompressTracks(ACLTracks, ACLBaseTracks, Settings, CompressionErrorThreshold, CompressedTracks);
+
+	// The error we validate and report is the true error
+	Settings.error_metric = ErrorMetric;
 
 	// Make sure if we managed to compress, that the error is acceptable and if it isn't, re-compress again with safer settings
 	// This should be VERY rare with the default threshold
@@ -245,6 +717,11 @@ bool UAnimBoneCompressionCodec_ACLBase::Compress(const FCompressibleAnimData& Co
 
 	checkSlow(CompressedTracks->is_valid(true).empty());
 
+	if (bStripKeyframes)
+	{
+		StripLowestImportanceKeyframes(KeyframeStrippingProportion, CompressedTracks);
+	}
+
 	const uint32 CompressedClipDataSize = CompressedTracks->get_size();
 
 	OutResult.CompressedByteStream.Empty(CompressedClipDataSize);
@@ -256,6 +733,12 @@ bool UAnimBoneCompressionCodec_ACLBase::Compress(const FCompressibleAnimData& Co
 	OutResult.AnimData = AllocateAnimData();
 	OutResult.AnimData->CompressedNumberOfFrames = CompressibleAnimData.NumFrames;
 
+	// Database anim data stores its own key when it registers with the database
+	if (!bUseStreamingDatabase)
+	{
+		static_cast<FACLCompressedAnimData&>(*OutResult.AnimData).SequenceUsageKey = GetACLSequenceUsageKey(CompressibleAnimData.FullName);
+	}
+
 #if !NO_LOGGING
 	{
 		acl::decompression_context<UE4DebugDBDecompressionSettings> Context;
@@ -274,8 +757,18 @@ bool UAnimBoneCompressionCodec_ACLBase::Compress(const FCompressibleAnimData& Co
 	{
 		RegisterWithDatabase(CompressibleAnimData, OutResult);
 	}
+	else
+	{
+		// Our compressed data is serialized with our anim data, we own it and the engine byte stream remains empty
+		FACLCompressedAnimData& AnimData = static_cast<FACLCompressedAnimData&>(*OutResult.AnimData);
+		AnimData.OwnedByteStream.Empty(CompressedClipDataSize);
+		AnimData.OwnedByteStream.Append(OutResult.CompressedByteStream.GetData(), CompressedClipDataSize);
+		AnimData.CompressedByteStream = TArrayView<uint8>(AnimData.OwnedByteStream.GetData(), CompressedClipDataSize);
+
+		OutResult.CompressedByteStream.Empty(0);
+	}
 
-	// Bind our compressed sequence data buffer
+	// Bind our compressed sequence data buffer, we remain bound to our own copy when the engine byte stream is empty
 	OutResult.AnimData->Bind(OutResult.CompressedByteStream);
 
 	return true;
@@ -285,10 +778,27 @@ void UAnimBoneCompressionCodec_ACLBase::PopulateDDCKey(FArchive& Ar)
 {
 	Super::PopulateDDCKey(Ar);
 
-	uint32 ForceRebuildVersion = 0;
+	// Bump this when the compressed data or its serialization changes
+	uint32 ForceRebuildVersion = 4;
+
+	// Per platform values are resolved for the platform we compress for
+	float PlatformDefaultVirtualVertexDistance = GetDefaultVirtualVertexDistanceForPlatform();
+	float PlatformSafeVirtualVertexDistance = GetSafeVirtualVertexDistanceForPlatform();
+	float PlatformErrorThreshold = GetErrorThresholdForPlatform();
+	TEnumAsByte<ACLCompressionLevel> PlatformCompressionLevel = GetCompressionLevelForPlatform();
+
+	Ar << ForceRebuildVersion << PlatformDefaultVirtualVertexDistance << PlatformSafeVirtualVertexDistance << PlatformErrorThreshold;
+	Ar << PlatformCompressionLevel;
+	Ar << MaxSampleRate;
+
+	if (bAutoSegmenting)
+	{
+		// Bump this when the segment sizes or their scoring changes
+		uint32 AutoSegmentingVersion = 1;
+		float LocalityWeight = FMath::Clamp(AutoSegmentingLocalityWeight, 0.0f, 1.0f);
 
-	Ar << ForceRebuildVersion << DefaultVirtualVertexDistance << SafeVirtualVertexDistance << ErrorThreshold;
-	Ar << CompressionLevel;
+		Ar << AutoSegmentingVersion << LocalityWeight;
+	}
 
 	// Add the end effector match name list since if it changes, we need to re-compress
 	const TArray<FString>& KeyEndEffectorsMatchNameArray = UAnimationSettings::Get()->KeyEndEffectorsMatchNameArray;
@@ -307,7 +817,13 @@ ACLSafetyFallbackResult UAnimBoneCompressionCodec_ACLBase::ExecuteSafetyFallback
 
 TUniquePtr<ICompressedAnimData> UAnimBoneCompressionCodec_ACLBase::AllocateAnimData() const
 {
-	return MakeUnique<FACLCompressedAnimData>();
+	TUniquePtr<FACLCompressedAnimData> AnimData = MakeUnique<FACLCompressedAnimData>();
+
+#if WITH_EDITORONLY_DATA
+	AnimData->bStreamWhenCooked = bStreamCompressedData;
+#endif
+
+	return AnimData;
 }
 
 void UAnimBoneCompressionCodec_ACLBase::ByteSwapIn(ICompressedAnimData& AnimData, TArrayView<uint8> CompressedData, FMemoryReader& MemoryStream) const
@@ -316,9 +832,8 @@ void UAnimBoneCompressionCodec_ACLBase::ByteSwapIn(ICompressedAnimData& AnimData
 #error "ACL does not currently support big-endian platforms"
 #endif
 
-	// TODO: ACL does not support byte swapping
-	FACLCompressedAnimData& ACLAnimData = static_cast<FACLCompressedAnimData&>(AnimData);
-	MemoryStream.Serialize(ACLAnimData.CompressedByteStream.GetData(), ACLAnimData.CompressedByteStream.Num());
+	// Our compressed data is serialized with our anim data, the engine byte stream is always empty
+	check(CompressedData.Num() == 0);
 }
 
 void UAnimBoneCompressionCodec_ACLBase::ByteSwapOut(ICompressedAnimData& AnimData, TArrayView<uint8> CompressedData, FMemoryWriter& MemoryStream) const
@@ -327,7 +842,39 @@ void UAnimBoneCompressionCodec_ACLBase::ByteSwapOut(ICompressedAnimData& AnimDat
 #error "ACL does not currently support big-endian platforms"
 #endif
 
-	// TODO: ACL does not support byte swapping
-	FACLCompressedAnimData& ACLAnimData = static_cast<FACLCompressedAnimData&>(AnimData);
-	MemoryStream.Serialize(ACLAnimData.CompressedByteStream.GetData(), ACLAnimData.CompressedByteStream.Num());
+	// Our compressed data is serialized with our anim data (see FACLCompressedAnimData::SerializeCompressedData), leave the engine byte stream empty
+}
+
+float UAnimBoneCompressionCodec_ACLBase::GetDecodeCostEstimate(const UAnimSequence& AnimSeq)
+{
+	const ICompressedAnimData* AnimData = AnimSeq.CompressedData.CompressedDataStructure.Get();
+	const UAnimBoneCompressionCodec* Codec = AnimSeq.CompressedData.BoneCompressionCodec;
+	if (AnimData == nullptr || Codec == nullptr)
+	{
+		return 0.0f;
+	}
+
+	float DecodeCostUnits = 0.0f;
+	if (Codec->IsA<UAnimBoneCompressionCodec_ACLDatabase>())
+	{
+		DecodeCostUnits = static_cast<const FACLDatabaseCompressedAnimData*>(AnimData)->GetDecodeCostUnits();
+	}
+	else if (Codec->IsA<UAnimBoneCompressionCodec_ACLBase>())
+	{
+		DecodeCostUnits = static_cast<const FACLCompressedAnimData*>(AnimData)->GetDecodeCostUnits();
+	}
+
+	return DecodeCostUnitsToNanoseconds(DecodeCostUnits);
+}
+
+bool UAnimBoneCompressionCodec_ACLBase::PreloadStreamedData(const UAnimSequence& AnimSeq)
+{
+	const ICompressedAnimData* AnimData = AnimSeq.CompressedData.CompressedDataStructure.Get();
+	const UAnimBoneCompressionCodec* Codec = AnimSeq.CompressedData.BoneCompressionCodec;
+	if (AnimData == nullptr || Codec == nullptr || !Codec->IsA<UAnimBoneCompressionCodec_ACLBase>() || Codec->IsA<UAnimBoneCompressionCodec_ACLDatabase>())
+	{
+		return true;	// Not an ACL sequence or its data lives in a database, nothing to stream
+	}
+
+	return static_cast<const FACLCompressedAnimData*>(AnimData)->RequestCompressedData();
 }
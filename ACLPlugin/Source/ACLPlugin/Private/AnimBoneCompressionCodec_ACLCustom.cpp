@@ -36,7 +36,7 @@ void UAnimBoneCompressionCodec_ACLCustom::GetCompressionSettings(acl::compressio
 	OutSettings.rotation_format = GetRotationFormat(RotationFormat);
 	OutSettings.translation_format = GetVectorFormat(TranslationFormat);
 	OutSettings.scale_format = GetVectorFormat(ScaleFormat);
-	OutSettings.level = GetCompressionLevel(CompressionLevel);
+	OutSettings.level = GetCompressionLevel(GetCompressionLevelForPlatform());
 
 	OutSettings.segmenting.ideal_num_samples = IdealNumKeyFramesPerSegment;
 	OutSettings.segmenting.max_num_samples = MaxNumKeyFramesPerSegment;
@@ -68,6 +68,14 @@ void UAnimBoneCompressionCodec_ACLCustom::PopulateDDCKey(FArchive& Ar)
 void UAnimBoneCompressionCodec_ACLCustom::DecompressPose(FAnimSequenceDecompressionContext& DecompContext, const BoneTrackArray& RotationPairs, const BoneTrackArray& TranslationPairs, const BoneTrackArray& ScalePairs, TArrayView<FTransform>& OutAtoms) const
 {
 	const FACLCompressedAnimData& AnimData = static_cast<const FACLCompressedAnimData&>(DecompContext.CompressedAnimData);
+	FACLCompressedDataReadScope ReadScope(AnimData);
+	if (!ReadScope.IsResident())
+	{
+		return;	// Our data is streaming in, the output pose retains the reference pose it was initialized with
+	}
+
+	RecordACLUsage(DecompContext, AnimData.SequenceUsageKey);
+
 	const acl::compressed_tracks* CompressedClipData = AnimData.GetCompressedTracks();
 	check(CompressedClipData != nullptr && CompressedClipData->is_valid(false).empty());
 
@@ -80,6 +88,14 @@ void UAnimBoneCompressionCodec_ACLCustom::DecompressPose(FAnimSequenceDecompress
 void UAnimBoneCompressionCodec_ACLCustom::DecompressBone(FAnimSequenceDecompressionContext& DecompContext, int32 TrackIndex, FTransform& OutAtom) const
 {
 	const FACLCompressedAnimData& AnimData = static_cast<const FACLCompressedAnimData&>(DecompContext.CompressedAnimData);
+	FACLCompressedDataReadScope ReadScope(AnimData);
+	if (!ReadScope.IsResident())
+	{
+		return;	// Our data is streaming in, the output transform is left untouched
+	}
+
+	RecordACLUsage(DecompContext, AnimData.SequenceUsageKey);
+
 	const acl::compressed_tracks* CompressedClipData = AnimData.GetCompressedTracks();
 	check(CompressedClipData != nullptr && CompressedClipData->is_valid(false).empty());
 
@@ -2,6 +2,7 @@
 
 #include "AnimBoneCompressionCodec_ACLDatabase.h"
 
+#include "ACLUsageProfile.h"
 #include "Algo/BinarySearch.h"
 
 #if WITH_EDITORONLY_DATA
@@ -23,6 +24,7 @@ void FACLDatabaseCompressedAnimData::SerializeCompressedData(FArchive& Ar)
 	ICompressedAnimData::SerializeCompressedData(Ar);
 
 	Ar << SequenceNameHash;
+	SerializeACLSequenceUsageKey(Ar, SequenceUsageKey);
 
 #if WITH_EDITORONLY_DATA
 	if (!Ar.IsFilterEditorOnly())
@@ -36,6 +38,8 @@ void FACLDatabaseCompressedAnimData::Bind(const TArrayView<uint8> BulkData)
 {
 	check(BulkData.Num() == 0);	// Should always be empty
 
+	DecodeCostUnits = -1.0f;
+
 #if !WITH_EDITORONLY_DATA
 	// In a cooked build, we lookup our anim sequence and database from the database asset
 	// We search by the sequence hash which lives in the top 32 bits of each entry
@@ -43,7 +47,7 @@ void FACLDatabaseCompressedAnimData::Bind(const TArrayView<uint8> BulkData)
 	if (SequenceIndex != INDEX_NONE)
 	{
 		const uint32 CompressedClipOffset = uint32(Codec->DatabaseAsset->CookedAnimSequenceMappings[SequenceIndex]);	// Truncate top 32 bits
-		uint8* CompressedBytes = Codec->DatabaseAsset->CookedCompressedBytes.GetData() + CompressedClipOffset;
+		uint8* CompressedBytes = Codec->DatabaseAsset->CookedCompressedBytesView.GetData() + CompressedClipOffset;
 
 		const acl::compressed_tracks* CompressedClipData = acl::make_compressed_tracks(CompressedBytes);
 		check(CompressedClipData != nullptr && CompressedClipData->is_valid(false).empty());
@@ -72,6 +76,17 @@ int64 FACLDatabaseCompressedAnimData::GetApproxCompressedSize() const
 #endif
 }
 
+float FACLDatabaseCompressedAnimData::GetDecodeCostUnits() const
+{
+	if (DecodeCostUnits < 0.0f)
+	{
+		const acl::compressed_tracks* CompressedClipData = GetCompressedTracks();
+		DecodeCostUnits = CompressedClipData != nullptr ? EstimateDecodeCostUnits(*CompressedClipData) : 0.0f;
+	}
+
+	return DecodeCostUnits;
+}
+
 bool FACLDatabaseCompressedAnimData::IsValid() const
 {
 	const acl::compressed_tracks* CompressedClipData = GetCompressedTracks();
@@ -128,6 +143,7 @@ void UAnimBoneCompressionCodec_ACLDatabase::RegisterWithDatabase(const FCompress
 
 	// Store the sequence name hash since we need it in cooked builds to find our data
 	AnimData.SequenceNameHash = GetTypeHash(CompressibleAnimData.AnimFName);
+	AnimData.SequenceUsageKey = GetACLSequenceUsageKey(CompressibleAnimData.FullName);
 
 	// Copy the sequence data
 	AnimData.CompressedClip = OutResult.CompressedByteStream;
@@ -141,7 +157,12 @@ void UAnimBoneCompressionCodec_ACLDatabase::GetCompressionSettings(acl::compress
 {
 	OutSettings = acl::get_default_compression_settings();
 
-	OutSettings.level = GetCompressionLevel(CompressionLevel);
+	OutSettings.level = GetCompressionLevel(GetCompressionLevelForPlatform());
+}
+
+float UAnimBoneCompressionCodec_ACLDatabase::GetContributingErrorScale(const FCompressibleAnimData& CompressibleAnimData) const
+{
+	return DatabaseAsset != nullptr ? DatabaseAsset->GetContributingErrorScale(GetACLSequenceUsageKey(CompressibleAnimData.FullName)) : 1.0f;
 }
 
 void UAnimBoneCompressionCodec_ACLDatabase::PopulateDDCKey(FArchive& Ar)
@@ -151,7 +172,7 @@ void UAnimBoneCompressionCodec_ACLDatabase::PopulateDDCKey(FArchive& Ar)
 	acl::compression_settings Settings;
 	GetCompressionSettings(Settings);
 
-	uint32 ForceRebuildVersion = 3;
+	uint32 ForceRebuildVersion = 4;
 	uint32 SettingsHash = Settings.get_hash();
 
 	Ar	<< ForceRebuildVersion << SettingsHash;
@@ -164,6 +185,13 @@ void UAnimBoneCompressionCodec_ACLDatabase::PopulateDDCKey(FArchive& Ar)
 			Ar << MeshModel->SkeletalMeshModelGUID;
 		}
 	}
+
+	// The contributing error of every sequence is scaled relative to the others, they all recompress when the profile changes
+	uint32 UsageProfileBiasHash = DatabaseAsset != nullptr ? DatabaseAsset->GetUsageProfileBiasHash() : 0;
+	if (UsageProfileBiasHash != 0)
+	{
+		Ar << UsageProfileBiasHash;
+	}
 }
 #endif // WITH_EDITORONLY_DATA
 
@@ -201,6 +229,7 @@ void UAnimBoneCompressionCodec_ACLDatabase::ByteSwapOut(ICompressedAnimData& Ani
 void UAnimBoneCompressionCodec_ACLDatabase::DecompressPose(FAnimSequenceDecompressionContext& DecompContext, const BoneTrackArray& RotationPairs, const BoneTrackArray& TranslationPairs, const BoneTrackArray& ScalePairs, TArrayView<FTransform>& OutAtoms) const
 {
 	const FACLDatabaseCompressedAnimData& AnimData = static_cast<const FACLDatabaseCompressedAnimData&>(DecompContext.CompressedAnimData);
+	RecordACLUsage(DecompContext, AnimData.SequenceUsageKey);
 
 	acl::decompression_context<UE4DefaultDBDecompressionSettings> ACLContext;
 
@@ -253,6 +282,7 @@ void UAnimBoneCompressionCodec_ACLDatabase::DecompressPose(FAnimSequenceDecompre
 void UAnimBoneCompressionCodec_ACLDatabase::DecompressBone(FAnimSequenceDecompressionContext& DecompContext, int32 TrackIndex, FTransform& OutAtom) const
 {
 	const FACLDatabaseCompressedAnimData& AnimData = static_cast<const FACLDatabaseCompressedAnimData&>(DecompContext.CompressedAnimData);
+	RecordACLUsage(DecompContext, AnimData.SequenceUsageKey);
 
 	acl::decompression_context<UE4DefaultDBDecompressionSettings> ACLContext;
 
@@ -31,8 +31,10 @@ void UAnimBoneCompressionCodec_ACLSafe::PopulateDDCKey(FArchive& Ar)
 
 	uint32 ForceRebuildVersion = 1;
 	uint32 SettingsHash = Settings.get_hash();
+	float PlatformDefaultVirtualVertexDistance = GetDefaultVirtualVertexDistanceForPlatform();
+	float PlatformSafeVirtualVertexDistance = GetSafeVirtualVertexDistanceForPlatform();
 
-	Ar << DefaultVirtualVertexDistance << SafeVirtualVertexDistance
+	Ar << PlatformDefaultVirtualVertexDistance << PlatformSafeVirtualVertexDistance
 		<< ForceRebuildVersion << SettingsHash;
 }
 #endif // WITH_EDITORONLY_DATA
@@ -40,6 +42,14 @@ void UAnimBoneCompressionCodec_ACLSafe::PopulateDDCKey(FArchive& Ar)
 void UAnimBoneCompressionCodec_ACLSafe::DecompressPose(FAnimSequenceDecompressionContext& DecompContext, const BoneTrackArray& RotationPairs, const BoneTrackArray& TranslationPairs, const BoneTrackArray& ScalePairs, TArrayView<FTransform>& OutAtoms) const
 {
 	const FACLCompressedAnimData& AnimData = static_cast<const FACLCompressedAnimData&>(DecompContext.CompressedAnimData);
+	FACLCompressedDataReadScope ReadScope(AnimData);
+	if (!ReadScope.IsResident())
+	{
+		return;	// Our data is streaming in, the output pose retains the reference pose it was initialized with
+	}
+
+	RecordACLUsage(DecompContext, AnimData.SequenceUsageKey);
+
 	const acl::compressed_tracks* CompressedClipData = AnimData.GetCompressedTracks();
 	check(CompressedClipData != nullptr && CompressedClipData->is_valid(false).empty());
 
@@ -52,6 +62,14 @@ void UAnimBoneCompressionCodec_ACLSafe::DecompressPose(FAnimSequenceDecompressio
 void UAnimBoneCompressionCodec_ACLSafe::DecompressBone(FAnimSequenceDecompressionContext& DecompContext, int32 TrackIndex, FTransform& OutAtom) const
 {
 	const FACLCompressedAnimData& AnimData = static_cast<const FACLCompressedAnimData&>(DecompContext.CompressedAnimData);
+	FACLCompressedDataReadScope ReadScope(AnimData);
+	if (!ReadScope.IsResident())
+	{
+		return;	// Our data is streaming in, the output transform is left untouched
+	}
+
+	RecordACLUsage(DecompContext, AnimData.SequenceUsageKey);
+
 	const acl::compressed_tracks* CompressedClipData = AnimData.GetCompressedTracks();
 	check(CompressedClipData != nullptr && CompressedClipData->is_valid(false).empty());
 
@@ -3,17 +3,23 @@
 #include "AnimationCompressionLibraryDatabase.h"
 #include "AnimBoneCompressionCodec_ACLDatabase.h"
 
+#include "ACLResidentDataRegion.h"
+#include "ACLSharedDataFile.h"
 #include "UE4DatabaseStreamer.h"
 
 #include "LatentActions.h"
 
 #if WITH_EDITORONLY_DATA
 #include "Animation/AnimBoneCompressionSettings.h"
+#include "HAL/FileManager.h"
 #include "PlatformInfo.h"
 #include "Interfaces/ITargetPlatform.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
 #include "UObject/UObjectIterator.h"
 
 #include "ACLImpl.h"
+#include "ACLUsageProfile.h"
 #include "UE4DatabasePreviewStreamer.h"
 
 #include <acl/compression/compress.h>
@@ -36,17 +42,23 @@ const TCHAR* VisualFidelityToString(ACLVisualFidelity Fidelity)
 
 UAnimationCompressionLibraryDatabase::UAnimationCompressionLibraryDatabase(const FObjectInitializer& ObjectInitializer)
 	: Super(ObjectInitializer)
+	, bIsCookedCompressedBytesViewInResidentDataRegion(false)
 	, CurrentVisualFidelity(ACLVisualFidelity::Lowest)
 	, NextFidelityChangeRequestID(0)
 	, MaxStreamRequestSizeKB(1024)		// By default we stream 1 MB (1 chunk) at a time
 #if WITH_EDITORONLY_DATA
-	, HighestImportanceProportion(0.5f)	// The rest remains in the anim sequences
-	, MediumImportanceProportion(0.0f)	// No medium quality tier by default
-	, LowestImportanceProportion(0.5f)	// By default we move 50% of the key frames to the database
+	, MediumImportanceProportion_DEPRECATED(0.0f)	// Must match the default value we had before the proportions could be set per platform
+	, LowestImportanceProportion_DEPRECATED(0.5f)
+	, HighestImportanceProportionPerPlatform(0.5f)	// The rest remains in the anim sequences
+	, MediumImportanceProportionPerPlatform(0.0f)	// No medium quality tier by default
+	, LowestImportanceProportionPerPlatform(0.5f)	// By default we move 50% of the key frames to the database
 	, StripLowestImportanceTier(false)	// By default we don't strip the lowest tier
+	, UsageProfileBias(0.5f)
 	// By default, in the editor we preview the full quality.
 	// Our database context won't be used until we need to build the database for preview if we change this value.
 	, PreviewVisualFidelity(ACLVisualFidelity::Highest)
+	, BiasUsageProfileHash(0)
+	, BiasUsageProfileMeanDecompressions(0.0)
 #endif
 {
 }
@@ -61,18 +73,16 @@ void UAnimationCompressionLibraryDatabase::PostEditChangeProperty(FPropertyChang
 		return;	// Safety check
 	}
 
-	const FName ChangedPropertyName = PropertyChangedEvent.Property->GetFName();
+	// Per platform values are edited through their inner properties
+	const FName ChangedPropertyName = PropertyChangedEvent.GetMemberPropertyName();
 
 	bool bBuildDatabaseForPreview = false;
 	bool bUpdateStreaming = false;
 
-	if (ChangedPropertyName == GET_MEMBER_NAME_CHECKED(UAnimationCompressionLibraryDatabase, LowestImportanceProportion))
+	if (ChangedPropertyName == GET_MEMBER_NAME_CHECKED(UAnimationCompressionLibraryDatabase, LowestImportanceProportionPerPlatform))
 	{
-		// Clamp our medium importance propertion
-		MediumImportanceProportion = FMath::Clamp(MediumImportanceProportion, 0.0f, FMath::Clamp(1.0f - LowestImportanceProportion, 0.0f, 1.0f));
-
-		// Update our high importance proportion to reflect what remains
-		HighestImportanceProportion = FMath::Clamp(1.0f - LowestImportanceProportion - MediumImportanceProportion, 0.0f, 1.0f);
+		// Clamp our medium importance propertion and update our high importance proportion to reflect what remains
+		ClampTierProportions(true);
 
 		// Only update our preview state if we are setting the final value to avoid slowing down the UI when using the slider
 		if (PropertyChangedEvent.ChangeType == EPropertyChangeType::ValueSet)
@@ -80,13 +90,10 @@ void UAnimationCompressionLibraryDatabase::PostEditChangeProperty(FPropertyChang
 			bBuildDatabaseForPreview = PreviewDatabaseStreamer != nullptr;	// If we already had a preview database, we need to rebuild it
 		}
 	}
-	else if (ChangedPropertyName == GET_MEMBER_NAME_CHECKED(UAnimationCompressionLibraryDatabase, MediumImportanceProportion))
+	else if (ChangedPropertyName == GET_MEMBER_NAME_CHECKED(UAnimationCompressionLibraryDatabase, MediumImportanceProportionPerPlatform))
 	{
-		// Clamp our medium importance propertion
-		LowestImportanceProportion = FMath::Clamp(LowestImportanceProportion, 0.0f, FMath::Clamp(1.0f - MediumImportanceProportion, 0.0f, 1.0f));
-
-		// Update our high importance proportion to reflect what remains
-		HighestImportanceProportion = FMath::Clamp(1.0f - LowestImportanceProportion - MediumImportanceProportion, 0.0f, 1.0f);
+		// Clamp our lowest importance propertion and update our high importance proportion to reflect what remains
+		ClampTierProportions(false);
 
 		// Only update our preview state if we are setting the final value to avoid slowing down the UI when using the slider
 		if (PropertyChangedEvent.ChangeType == EPropertyChangeType::ValueSet)
@@ -100,6 +107,20 @@ void UAnimationCompressionLibraryDatabase::PostEditChangeProperty(FPropertyChang
 		bBuildDatabaseForPreview = PreviewDatabaseStreamer == nullptr;	// We didn't have a preview database, create one now
 		bUpdateStreaming = true;
 	}
+	else if (ChangedPropertyName == GET_MEMBER_NAME_CHECKED(UAnimationCompressionLibraryDatabase, UsageProfile) || ChangedPropertyName == GET_MEMBER_NAME_CHECKED(UAnimationCompressionLibraryDatabase, UsageProfileBias))
+	{
+		// The contributing error of our anim sequences depends on the usage profile, they must compress again
+		if (PropertyChangedEvent.ChangeType == EPropertyChangeType::ValueSet)
+		{
+			for (UAnimSequence* AnimSeq : AnimSequences)
+			{
+				if (AnimSeq != nullptr)
+				{
+					AnimSeq->RequestAsyncAnimRecompression();
+				}
+			}
+		}
+	}
 
 	if (bBuildDatabaseForPreview || bUpdateStreaming)
 	{
@@ -113,17 +134,17 @@ void UAnimationCompressionLibraryDatabase::PreSave(const ITargetPlatform* Target
 
 	// Clear any stale cooked data we might have
 	CookedCompressedBytes.Empty(0);
+	CookedCompressedBytesView = TArrayView<uint8>();
 	CookedAnimSequenceMappings.Empty(0);
 	CookedBulkData.RemoveBulkData();
 
 	if (TargetPlatform != nullptr && TargetPlatform->RequiresCookedData())
 	{
-		const bool bStripLowestTier = StripLowestImportanceTier.GetValueForPlatformIdentifiers(
-			TargetPlatform->GetPlatformInfo().PlatformGroupName,
-			TargetPlatform->GetPlatformInfo().VanillaPlatformName);
+		const bool bStripLowestTier = ShouldStripLowestImportanceTier(TargetPlatform);
 
 		TArray<uint8> BulkData;
-		BuildDatabase(CookedCompressedBytes, CookedAnimSequenceMappings, BulkData, bStripLowestTier);
+		BuildDatabase(CookedCompressedBytes, CookedAnimSequenceMappings, BulkData, TargetPlatform, bStripLowestTier);
+		RelocateCookedCompressedBytes();
 
 		CookedBulkData.Lock(LOCK_READ_WRITE);
 		{
@@ -135,7 +156,60 @@ void UAnimationCompressionLibraryDatabase::PreSave(const ITargetPlatform* Target
 	}
 }
 
-void UAnimationCompressionLibraryDatabase::BuildDatabase(TArray<uint8>& OutCompressedBytes, TArray<uint64>& OutAnimSequenceMappings, TArray<uint8>& OutBulkData, bool bStripLowestTier) const
+/** Orders the sequences such that those frequently played together are next to each other, see FACLUsageProfile::CalculateCoUsageOrder. */
+static void OrderSequencesByUsage(TArray<UAnimSequence*>& Sequences, const FACLUsageProfile& Profile)
+{
+	// Profiles identify sequences by their path, see GetACLSequenceUsageKey
+	TArray<uint32> SequenceUsageKeys;
+	SequenceUsageKeys.Reserve(Sequences.Num());
+	for (const UAnimSequence* AnimSeq : Sequences)
+	{
+		SequenceUsageKeys.Add(GetACLSequenceUsageKey(AnimSeq->GetFullName()));
+	}
+
+	const TArray<int32> Order = Profile.CalculateCoUsageOrder(SequenceUsageKeys);
+
+	TArray<UAnimSequence*> OrderedSequences;
+	OrderedSequences.Reserve(Sequences.Num());
+	for (int32 SequenceIndex : Order)
+	{
+		OrderedSequences.Add(Sequences[SequenceIndex]);
+	}
+
+	Sequences = MoveTemp(OrderedSequences);
+}
+
+/** Returns the mean distance in bytes between sequences played together, weighted by how often they are played together. */
+static double CalculateCoUsageDistance(const TArray<UAnimSequence*>& Sequences, const FACLUsageProfile& Profile)
+{
+	TMap<uint32, uint32> KeyToOffset;
+
+	uint32 Offset = 0;
+	for (const UAnimSequence* AnimSeq : Sequences)
+	{
+		const FACLDatabaseCompressedAnimData& AnimData = static_cast<const FACLDatabaseCompressedAnimData&>(*AnimSeq->CompressedData.CompressedDataStructure);
+		KeyToOffset.Add(GetACLSequenceUsageKey(AnimSeq->GetFullName()), Offset);
+
+		Offset = acl::align_to(Offset + AnimData.GetCompressedTracks()->get_size(), 16);
+	}
+
+	double TotalDistance = 0.0;
+	double TotalWeight = 0.0;
+	for (const FACLSequenceCoUsage& CoUsage : Profile.CoUsage)
+	{
+		const uint32* OffsetA = KeyToOffset.Find(CoUsage.SequenceKeyA);
+		const uint32* OffsetB = KeyToOffset.Find(CoUsage.SequenceKeyB);
+		if (OffsetA != nullptr && OffsetB != nullptr)
+		{
+			TotalDistance += double(FMath::Abs(int64(*OffsetA) - int64(*OffsetB))) * double(CoUsage.NumFrames);
+			TotalWeight += double(CoUsage.NumFrames);
+		}
+	}
+
+	return TotalWeight != 0.0 ? (TotalDistance / TotalWeight) : 0.0;
+}
+
+void UAnimationCompressionLibraryDatabase::BuildDatabase(TArray<uint8>& OutCompressedBytes, TArray<uint64>& OutAnimSequenceMappings, TArray<uint8>& OutBulkData, const ITargetPlatform* TargetPlatform, bool bStripLowestTier) const
 {
 	// Clear any stale data we might have
 	OutCompressedBytes.Empty(0);
@@ -147,6 +221,7 @@ void UAnimationCompressionLibraryDatabase::BuildDatabase(TArray<uint8>& OutCompr
 	// be stale and we must double check.
 
 	// Gather the sequences we need to merge, these are already sorted by FName by construction
+	// If we have a usage profile, they will be re-ordered afterwards
 	TArray<UAnimSequence*> CookedSequences;
 	CookedSequences.Empty(AnimSequences.Num());
 
@@ -186,6 +261,29 @@ void UAnimationCompressionLibraryDatabase::BuildDatabase(TArray<uint8>& OutCompr
 		return;	// Nothing to cook
 	}
 
+	// Sequences and their bulk data are laid out in the order we provide them, co-locate those played together
+	if (!UsageProfile.FilePath.IsEmpty())
+	{
+		const FString ProfileFilename = FPaths::ConvertRelativePathToFull(FPaths::ProjectDir(), UsageProfile.FilePath);
+
+		FACLUsageProfile Profile;
+		if (Profile.LoadFromFile(ProfileFilename))
+		{
+			const double DistanceBefore = CalculateCoUsageDistance(CookedSequences, Profile);
+			OrderSequencesByUsage(CookedSequences, Profile);
+			const double DistanceAfter = CalculateCoUsageDistance(CookedSequences, Profile);
+
+			UE_LOG(LogAnimationCompression, Log, TEXT("ACL DB [%s] ordered with usage profile [%s], mean distance between sequences played together went from %.2f KB -> %.2f KB"),
+				*GetPathName(), *ProfileFilename, DistanceBefore / 1024.0, DistanceAfter / 1024.0);
+
+			if (UsageProfileBias > 0.0f)
+			{
+				// The bias is applied when our anim sequences compress, see GetContributingErrorScale
+				UE_LOG(LogAnimationCompression, Log, TEXT("ACL DB [%s] key frames are moved to the database with a usage profile bias of %.2f"), *GetPathName(), UsageProfileBias);
+			}
+		}
+	}
+
 	TArray<const acl::compressed_tracks*> ACLCompressedTracks;
 	for (const UAnimSequence* AnimSeq : CookedSequences)
 	{
@@ -196,8 +294,7 @@ void UAnimationCompressionLibraryDatabase::BuildDatabase(TArray<uint8>& OutCompr
 	const int32 NumSequences = ACLCompressedTracks.Num();
 
 	acl::compression_database_settings Settings;	// Use defaults
-	Settings.low_importance_tier_proportion = LowestImportanceProportion;
-	Settings.medium_importance_tier_proportion = MediumImportanceProportion;
+	GetTierProportions(TargetPlatform, Settings.low_importance_tier_proportion, Settings.medium_importance_tier_proportion);
 
 	TArray<acl::compressed_tracks*> ACLDBCompressedTracks;
 	ACLDBCompressedTracks.AddZeroed(NumSequences);
@@ -390,7 +487,7 @@ void UAnimationCompressionLibraryDatabase::UpdatePreviewState(bool bBuildDatabas
 		PreviewDatabaseStreamer.Reset();
 		DatabaseContext.reset();
 
-		BuildDatabase(PreviewCompressedBytes, PreviewAnimSequenceMappings, PreviewBulkData);
+		BuildDatabase(PreviewCompressedBytes, PreviewAnimSequenceMappings, PreviewBulkData, nullptr);
 
 		if (PreviewCompressedBytes.Num() != 0)
 		{
@@ -492,6 +589,171 @@ bool UAnimationCompressionLibraryDatabase::UpdateReferencingAnimSequenceList()
 
 	return bIsDirty;
 }
+
+void UAnimationCompressionLibraryDatabase::CalculateBuiltSize(uint32& OutCompressedSize, uint32& OutBulkDataSize, bool bStripLowestTier) const
+{
+	TArray<uint8> CompressedBytes;
+	TArray<uint64> AnimSequenceMappings;
+	TArray<uint8> BulkData;
+	BuildDatabase(CompressedBytes, AnimSequenceMappings, BulkData, nullptr, bStripLowestTier);
+
+	OutCompressedSize = CompressedBytes.Num();
+	OutBulkDataSize = BulkData.Num();
+}
+
+void UAnimationCompressionLibraryDatabase::BuildCookedCompressedBytes(const ITargetPlatform* TargetPlatform, TArray<uint8>& OutCompressedBytes) const
+{
+	check(TargetPlatform != nullptr);
+
+	TArray<uint64> AnimSequenceMappings;
+	TArray<uint8> BulkData;
+	BuildDatabase(OutCompressedBytes, AnimSequenceMappings, BulkData, TargetPlatform, ShouldStripLowestImportanceTier(TargetPlatform));
+}
+
+template<typename PerPlatformType>
+static auto GetValueForTargetPlatform(const PerPlatformType& Property, const ITargetPlatform* TargetPlatform) -> decltype(Property.Default)
+{
+	if (TargetPlatform == nullptr)
+	{
+		return GetPerPlatformValue(Property);
+	}
+
+	return Property.GetValueForPlatformIdentifiers(
+		TargetPlatform->GetPlatformInfo().PlatformGroupName,
+		TargetPlatform->GetPlatformInfo().VanillaPlatformName);
+}
+
+bool UAnimationCompressionLibraryDatabase::ShouldStripLowestImportanceTier(const ITargetPlatform* TargetPlatform) const
+{
+	return GetValueForTargetPlatform(StripLowestImportanceTier, TargetPlatform);
+}
+
+void UAnimationCompressionLibraryDatabase::GetTierProportions(const ITargetPlatform* TargetPlatform, float& OutLowestProportion, float& OutMediumProportion) const
+{
+	// A platform can override a single proportion, make sure both fit together
+	OutLowestProportion = FMath::Clamp(GetValueForTargetPlatform(LowestImportanceProportionPerPlatform, TargetPlatform), 0.0f, 1.0f);
+	OutMediumProportion = FMath::Clamp(GetValueForTargetPlatform(MediumImportanceProportionPerPlatform, TargetPlatform), 0.0f, 1.0f - OutLowestProportion);
+}
+
+void UAnimationCompressionLibraryDatabase::UpdateBiasUsageProfile()
+{
+	const FString ProfileFilename = (UsageProfile.FilePath.IsEmpty() || UsageProfileBias <= 0.0f) ? FString() : FPaths::ConvertRelativePathToFull(FPaths::ProjectDir(), UsageProfile.FilePath);
+	const FDateTime ProfileTimestamp = ProfileFilename.IsEmpty() ? FDateTime::MinValue() : IFileManager::Get().GetTimeStamp(*ProfileFilename);
+	if (ProfileFilename == BiasUsageProfileFilename && ProfileTimestamp == BiasUsageProfileTimestamp)
+	{
+		return;	// Up to date
+	}
+
+	BiasUsageProfileFilename = ProfileFilename;
+	BiasUsageProfileTimestamp = ProfileTimestamp;
+	BiasUsageProfile = FACLUsageProfile();
+	BiasUsageProfileHash = 0;
+	BiasUsageProfileMeanDecompressions = 0.0;
+
+	if (ProfileFilename.IsEmpty())
+	{
+		return;	// No bias
+	}
+
+	TArray<uint8> ProfileBytes;
+	if (!FFileHelper::LoadFileToArray(ProfileBytes, *ProfileFilename) || !BiasUsageProfile.LoadFromFile(ProfileFilename) || BiasUsageProfile.Sequences.Num() == 0)
+	{
+		UE_LOG(LogAnimationCompression, Warning, TEXT("ACL DB [%s] failed to load usage profile [%s], key frames will be moved to the database without bias"), *GetPathName(), *ProfileFilename);
+		BiasUsageProfile = FACLUsageProfile();
+		return;
+	}
+
+	uint64 TotalNumDecompressions = 0;
+	for (const FACLSequenceUsage& Usage : BiasUsageProfile.Sequences)
+	{
+		TotalNumDecompressions += Usage.NumDecompressions;
+	}
+
+	BiasUsageProfileHash = FCrc::MemCrc32(ProfileBytes.GetData(), ProfileBytes.Num());
+	BiasUsageProfileMeanDecompressions = double(TotalNumDecompressions) / double(BiasUsageProfile.Sequences.Num());
+}
+
+float UAnimationCompressionLibraryDatabase::GetContributingErrorScale(uint32 SequenceUsageKey)
+{
+	FScopeLock Lock(&BiasUsageProfileLock);
+
+	UpdateBiasUsageProfile();
+
+	if (BiasUsageProfileHash == 0 || BiasUsageProfileMeanDecompressions <= 0.0)
+	{
+		return 1.0f;
+	}
+
+	// Sequences played twice as often as the mean keep their key frames resident as if they were twice as important, up to 4x
+	// Sequences never played are the first to have their key frames moved to the database
+	const FACLSequenceUsage* Usage = BiasUsageProfile.FindSequence(SequenceUsageKey);
+	const double Hotness = Usage != nullptr ? (double(Usage->NumDecompressions) / BiasUsageProfileMeanDecompressions) : 0.0;
+
+	return FMath::Pow(FMath::Clamp(float(Hotness), 0.25f, 4.0f), FMath::Clamp(UsageProfileBias, 0.0f, 1.0f));
+}
+
+uint32 UAnimationCompressionLibraryDatabase::GetUsageProfileBiasHash()
+{
+	FScopeLock Lock(&BiasUsageProfileLock);
+
+	UpdateBiasUsageProfile();
+
+	return BiasUsageProfileHash != 0 ? HashCombine(BiasUsageProfileHash, GetTypeHash(UsageProfileBias)) : 0;
+}
+
+void UAnimationCompressionLibraryDatabase::ClampTierProportions(bool bLowestProportionChanged)
+{
+	// The proportion that changed retains its value
+	auto ClampProportions = [bLowestProportionChanged](float& LowestProportion, float& MediumProportion)
+	{
+		if (bLowestProportionChanged)
+		{
+			MediumProportion = FMath::Clamp(MediumProportion, 0.0f, FMath::Clamp(1.0f - LowestProportion, 0.0f, 1.0f));
+		}
+		else
+		{
+			LowestProportion = FMath::Clamp(LowestProportion, 0.0f, FMath::Clamp(1.0f - MediumProportion, 0.0f, 1.0f));
+		}
+	};
+
+	ClampProportions(LowestImportanceProportionPerPlatform.Default, MediumImportanceProportionPerPlatform.Default);
+	HighestImportanceProportionPerPlatform.Default = FMath::Clamp(1.0f - LowestImportanceProportionPerPlatform.Default - MediumImportanceProportionPerPlatform.Default, 0.0f, 1.0f);
+
+	TSet<FName> PlatformNames;
+	for (const auto& It : LowestImportanceProportionPerPlatform.PerPlatform)
+	{
+		PlatformNames.Add(It.Key);
+	}
+	for (const auto& It : MediumImportanceProportionPerPlatform.PerPlatform)
+	{
+		PlatformNames.Add(It.Key);
+	}
+
+	HighestImportanceProportionPerPlatform.PerPlatform.Empty();
+
+	for (const FName& PlatformName : PlatformNames)
+	{
+		const float* LowestOverride = LowestImportanceProportionPerPlatform.PerPlatform.Find(PlatformName);
+		const float* MediumOverride = MediumImportanceProportionPerPlatform.PerPlatform.Find(PlatformName);
+
+		float LowestProportion = LowestOverride != nullptr ? *LowestOverride : LowestImportanceProportionPerPlatform.Default;
+		float MediumProportion = MediumOverride != nullptr ? *MediumOverride : MediumImportanceProportionPerPlatform.Default;
+		ClampProportions(LowestProportion, MediumProportion);
+
+		// A value that had to be clamped becomes an override of this platform
+		if (LowestOverride != nullptr || LowestProportion != LowestImportanceProportionPerPlatform.Default)
+		{
+			LowestImportanceProportionPerPlatform.PerPlatform.Add(PlatformName, LowestProportion);
+		}
+
+		if (MediumOverride != nullptr || MediumProportion != MediumImportanceProportionPerPlatform.Default)
+		{
+			MediumImportanceProportionPerPlatform.PerPlatform.Add(PlatformName, MediumProportion);
+		}
+
+		HighestImportanceProportionPerPlatform.PerPlatform.Add(PlatformName, FMath::Clamp(1.0f - LowestProportion - MediumProportion, 0.0f, 1.0f));
+	}
+}
 #endif
 
 void UAnimationCompressionLibraryDatabase::BeginDestroy()
@@ -511,6 +773,8 @@ void UAnimationCompressionLibraryDatabase::BeginDestroy()
 		delete Streamer;
 	}
 
+	ReleaseResidentDataRegionBytes();
+
 #if WITH_EDITORONLY_DATA
 	if (PreviewDatabaseStreamer)
 	{
@@ -527,9 +791,22 @@ void UAnimationCompressionLibraryDatabase::PostLoad()
 {
 	Super::PostLoad();
 
-	if (CookedCompressedBytes.Num() != 0)
+#if WITH_EDITORONLY_DATA
+	// The deprecated values are only serialized when they differ from the old defaults and when they do, they become our default values
+	if (LowestImportanceProportion_DEPRECATED != 0.5f || MediumImportanceProportion_DEPRECATED != 0.0f)
+	{
+		LowestImportanceProportionPerPlatform.Default = LowestImportanceProportion_DEPRECATED;
+		MediumImportanceProportionPerPlatform.Default = MediumImportanceProportion_DEPRECATED;
+		LowestImportanceProportion_DEPRECATED = 0.5f;
+		MediumImportanceProportion_DEPRECATED = 0.0f;
+
+		ClampTierProportions(true);
+	}
+#endif
+
+	if (CookedCompressedBytesView.Num() != 0)
 	{
-		const acl::compressed_database* CompressedDatabase = acl::make_compressed_database(CookedCompressedBytes.GetData());
+		const acl::compressed_database* CompressedDatabase = acl::make_compressed_database(CookedCompressedBytesView.GetData());
 		check(CompressedDatabase != nullptr && CompressedDatabase->is_valid(false).empty());
 
 		DatabaseStreamer = MakeUnique<UE4DatabaseStreamer>(*CompressedDatabase, CookedBulkData);
@@ -551,6 +828,58 @@ void UAnimationCompressionLibraryDatabase::Serialize(FArchive& Ar)
 		CookedBulkData.SetBulkDataFlags(BULKDATA_Force_NOT_InlinePayload);
 		CookedBulkData.Serialize(Ar, this, INDEX_NONE, false);
 	}
+
+	if (Ar.IsLoading())
+	{
+		// Anim sequences bind to our compressed bytes before our PostLoad runs, relocate them now
+		RelocateCookedCompressedBytes();
+	}
+}
+
+void UAnimationCompressionLibraryDatabase::RelocateCookedCompressedBytes()
+{
+	ReleaseResidentDataRegionBytes();
+
+	CookedCompressedBytesView = TArrayView<uint8>(CookedCompressedBytes);
+
+#if !WITH_EDITORONLY_DATA
+	// When the shared data file contains our bytes, bind to its mapped copy and release ours
+	const acl::compressed_database* CompressedDatabase = FACLSharedDataFile::IsEnabled() && CookedCompressedBytes.Num() != 0 ? acl::make_compressed_database(CookedCompressedBytes.GetData()) : nullptr;
+	if (CompressedDatabase != nullptr)
+	{
+		uint8* SharedBytes = FACLSharedDataFile::Get().Find(CompressedDatabase->get_hash(), CookedCompressedBytes);
+		if (SharedBytes != nullptr)
+		{
+			CookedCompressedBytesView = TArrayView<uint8>(SharedBytes, CookedCompressedBytes.Num());
+			CookedCompressedBytes.Empty(0);
+			return;
+		}
+	}
+
+	if (FACLResidentDataRegion::IsEnabled() && CookedCompressedBytes.Num() != 0)
+	{
+		uint8* ResidentBytes = FACLResidentDataRegion::Get().Allocate(CookedCompressedBytes.Num(), 16);
+		if (ResidentBytes != nullptr)
+		{
+			FMemory::Memcpy(ResidentBytes, CookedCompressedBytes.GetData(), CookedCompressedBytes.Num());
+			CookedCompressedBytesView = TArrayView<uint8>(ResidentBytes, CookedCompressedBytes.Num());
+			bIsCookedCompressedBytesViewInResidentDataRegion = true;
+
+			// Our bytes now live in the resident data region, we no longer need our copy
+			CookedCompressedBytes.Empty(0);
+		}
+	}
+#endif
+}
+
+void UAnimationCompressionLibraryDatabase::ReleaseResidentDataRegionBytes()
+{
+	if (bIsCookedCompressedBytesViewInResidentDataRegion)
+	{
+		FACLResidentDataRegion::Get().Free(CookedCompressedBytesView.GetData(), CookedCompressedBytesView.Num());
+		CookedCompressedBytesView = TArrayView<uint8>();
+		bIsCookedCompressedBytesViewInResidentDataRegion = false;
+	}
 }
 
 void UAnimationCompressionLibraryDatabase::SetVisualFidelity(ACLVisualFidelity VisualFidelity)
@@ -4,15 +4,45 @@
 
 #include "AnimationCompression.h"
 #include "CoreMinimal.h"
+#include "HAL/PlatformTime.h"
 #include "HAL/UnrealMemory.h"
+#include "Templates/Atomic.h"
 
 #include "ACLImpl.h"
+#include "ACLIoUring.h"
+
+#if WITH_ACL_IO_URING
+#include "HAL/Event.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformProcess.h"
+#include "Misc/Paths.h"
+#endif
 
 #include <acl/decompression/database/database_streamer.h>
 
 // UE 4.25 doesn't expose its virtual memory management, see FPlatformMemory::FPlatformVirtualMemoryBlock
 #define WITH_VMEM_MANAGEMENT 0
 
+/** Streaming statistics gathered by the streamer, used to benchmark visual fidelity changes. */
+struct FACLDatabaseStreamingStats
+{
+	uint32 NumStreamInRequests = 0;
+	uint32 NumStreamOutRequests = 0;
+	uint64 NumBytesStreamedIn = 0;
+
+	/** How long the game thread waited for pending IO requests to complete, in seconds. */
+	double TotalWaitTime = 0.0;
+	double MaxWaitTime = 0.0;
+
+	/** How long stream in requests took from their submission to their completion, in seconds. */
+	uint32 NumCompletedStreamIns = 0;
+	double TotalStreamInLatency = 0.0;
+	double MaxStreamInLatency = 0.0;
+
+	/** Whether or not the last stream in request was read with io_uring. */
+	bool bUsedIoUring = false;
+};
+
 /** A simple async UE4 streamer. Memory is allocated on the first stream in request and deallocated on the last stream out request. */
 class UE4DatabaseStreamer final : public acl::database_streamer
 {
@@ -21,6 +51,14 @@ public:
 		: database_streamer(Requests, acl::k_num_database_tiers)
 		, StreamableBulkData(StreamableBulkData_)
 		, PendingIORequest(nullptr)
+		, NumCompletedStreamIns(0)
+		, TotalStreamInLatencyCycles(0)
+		, MaxStreamInLatencyCycles(0)
+#if WITH_ACL_IO_URING
+		, IoUringEvent(nullptr)
+		, bIsIoUringRequestPending(false)
+		, bIoUringFileFailed(false)
+#endif
 	{
 		BulkData[0] = BulkData[1] = nullptr;
 
@@ -54,6 +92,15 @@ public:
 		delete[] BulkData[0];
 		delete[] BulkData[1];
 #endif
+
+#if WITH_ACL_IO_URING
+		FACLIoUring::CloseFile(IoUringFile);
+
+		if (IoUringEvent != nullptr)
+		{
+			FPlatformProcess::ReturnSynchEventToPool(IoUringEvent);
+		}
+#endif
 	}
 
 	virtual bool is_initialized() const override { return true; }
@@ -78,10 +125,13 @@ public:
 		// If we already did a stream in request, wait for it to complete and clear it
 		WaitForStreamingToComplete();
 
-		FBulkDataIORequestCallBack AsyncFileCallBack = [this, RequestID](bool bWasCancelled, IBulkDataIORequest* Req)
+		const uint64 StartCycles = FPlatformTime::Cycles64();
+		FBulkDataIORequestCallBack AsyncFileCallBack = [this, RequestID, StartCycles](bool bWasCancelled, IBulkDataIORequest* Req)
 		{
 			UE_LOG(LogAnimationCompression, Log, TEXT("ACL completed the stream in request!"));
 
+			RecordStreamInLatency(StartCycles);
+
 			// Tell ACL whether the streaming request was a success or not, this is thread safe
 			if (bWasCancelled)
 				this->cancel(RequestID);
@@ -106,15 +156,32 @@ public:
 #endif
 		}
 
-		// Fire off our async streaming request
+		// Fire off our async streaming request, the requested range lands at the same offset within our tier buffer
 		const uint32 BulkDataOffset = Tier == acl::quality_tier::medium_importance ? 0 : BulkDataSize[0];
-		uint8* BulkDataPtr = BulkData[TierIndex];
+		uint8* BulkDataPtr = BulkData[TierIndex] + Offset;
+
+#if WITH_ACL_IO_URING
+		if (StreamInWithIoUring(BulkDataOffset + Offset, Size, BulkDataPtr, RequestID, StartCycles))
+		{
+			Stats.NumStreamInRequests++;
+			Stats.NumBytesStreamedIn += Size;
+			Stats.bUsedIoUring = true;
+			return;
+		}
+#endif
+
+		Stats.bUsedIoUring = false;
 		PendingIORequest = StreamableBulkData.CreateStreamingRequest(BulkDataOffset + Offset, Size, AIOP_Low, &AsyncFileCallBack, BulkDataPtr);
 		if (PendingIORequest == nullptr)
 		{
 			UE_LOG(LogAnimationCompression, Warning, TEXT("ACL failed to initiate database stream in request!"));
 			cancel(RequestID);
 		}
+		else
+		{
+			Stats.NumStreamInRequests++;
+			Stats.NumBytesStreamedIn += Size;
+		}
 	}
 
 	virtual void stream_out(uint32_t Offset, uint32_t Size, bool CanDeallocateBulkData, acl::quality_tier Tier, acl::streaming_request_id RequestID) override
@@ -149,21 +216,153 @@ public:
 #endif
 		}
 
+		Stats.NumStreamOutRequests++;
+
 		// Notify ACL that we streamed out the data, this is not thread safe and cannot run while animations are decompressing
 		complete(RequestID);
 	}
 
 	void WaitForStreamingToComplete()
 	{
+#if WITH_ACL_IO_URING
+		if (bIsIoUringRequestPending)
+		{
+			const double StartTime = FPlatformTime::Seconds();
+			IoUringEvent->Wait();
+			const double WaitTime = FPlatformTime::Seconds() - StartTime;
+
+			Stats.TotalWaitTime += WaitTime;
+			Stats.MaxWaitTime = FMath::Max(Stats.MaxWaitTime, WaitTime);
+
+			bIsIoUringRequestPending = false;
+		}
+#endif
+
 		if (PendingIORequest != nullptr)
 		{
+			const double StartTime = FPlatformTime::Seconds();
 			verify(PendingIORequest->WaitCompletion());
+			const double WaitTime = FPlatformTime::Seconds() - StartTime;
+
+			Stats.TotalWaitTime += WaitTime;
+			Stats.MaxWaitTime = FMath::Max(Stats.MaxWaitTime, WaitTime);
+
 			delete PendingIORequest;
 			PendingIORequest = nullptr;
 		}
 	}
 
+	/** Returns the statistics gathered since the last reset. Must be called on the game thread. */
+	FACLDatabaseStreamingStats GetStats() const
+	{
+		FACLDatabaseStreamingStats Result = Stats;
+		Result.NumCompletedStreamIns = NumCompletedStreamIns;
+		Result.TotalStreamInLatency = FPlatformTime::ToSeconds64(TotalStreamInLatencyCycles);
+		Result.MaxStreamInLatency = FPlatformTime::ToSeconds64(MaxStreamInLatencyCycles);
+		return Result;
+	}
+
+	void ResetStats()
+	{
+		Stats = FACLDatabaseStreamingStats();
+		NumCompletedStreamIns = 0;
+		TotalStreamInLatencyCycles = 0;
+		MaxStreamInLatencyCycles = 0;
+	}
+
 private:
+	/** Called on the IO thread when a stream in request completes. */
+	void RecordStreamInLatency(uint64 StartCycles)
+	{
+		const uint64 LatencyCycles = FPlatformTime::Cycles64() - StartCycles;
+
+		NumCompletedStreamIns++;
+		TotalStreamInLatencyCycles += LatencyCycles;
+
+		uint64 MaxLatencyCycles = MaxStreamInLatencyCycles;
+		while (LatencyCycles > MaxLatencyCycles && !MaxStreamInLatencyCycles.CompareExchange(MaxLatencyCycles, LatencyCycles))
+		{
+		}
+	}
+
+#if WITH_ACL_IO_URING
+	/** Reads the requested range with io_uring if it is enabled and our bulk data is a loose file. Returns false to fall back to the default IO path. */
+	bool StreamInWithIoUring(uint32 BulkDataOffset, uint32 Size, uint8* BulkDataPtr, acl::streaming_request_id RequestID, uint64 StartCycles)
+	{
+		if (!FACLIoUring::IsEnabled() || !FACLIoUring::Get().IsAvailable())
+		{
+			return false;
+		}
+
+		// Reopen the file if the setting changed
+		const bool bDirectIO = FACLIoUring::UseDirectIO();
+		if (IoUringFile.IsValid() && IoUringFile.bDirectIO != bDirectIO)
+		{
+			FACLIoUring::CloseFile(IoUringFile);
+			bIoUringFileFailed = false;
+		}
+
+		if (!IoUringFile.IsValid() && !bIoUringFileFailed)
+		{
+			OpenIoUringFile(bDirectIO);
+		}
+
+		if (!IoUringFile.IsValid())
+		{
+			return false;
+		}
+
+		if (IoUringEvent == nullptr)
+		{
+			IoUringEvent = FPlatformProcess::GetSynchEventFromPool(false);
+		}
+
+		const uint64 FileOffset = uint64(StreamableBulkData.GetBulkDataOffsetInFile()) + BulkDataOffset;
+		const bool bIsSubmitted = FACLIoUring::Get().Read(IoUringFile, FileOffset, Size, BulkDataPtr, [this, RequestID, StartCycles](bool bSuccess)
+			{
+				UE_LOG(LogAnimationCompression, Log, TEXT("ACL completed the stream in request!"));
+
+				RecordStreamInLatency(StartCycles);
+
+				// Tell ACL whether the streaming request was a success or not, this is thread safe
+				if (bSuccess)
+					this->complete(RequestID);
+				else
+					this->cancel(RequestID);
+
+				IoUringEvent->Trigger();
+			});
+
+		bIsIoUringRequestPending = bIsSubmitted;
+		return bIsSubmitted;
+	}
+
+	void OpenIoUringFile(bool bDirectIO)
+	{
+		// Compressed payloads must be decompressed by the engine
+		if (StreamableBulkData.IsStoredCompressedOnDisk())
+		{
+			bIoUringFileFailed = true;
+			return;
+		}
+
+		FString Filename = StreamableBulkData.GetFilename();
+		if (StreamableBulkData.IsInSeparateFile() && FPaths::GetExtension(Filename) != TEXT("ubulk"))
+		{
+			Filename = FPaths::ChangeExtension(Filename, TEXT(".ubulk"));
+		}
+
+		// Files within a pak file cannot be opened directly, the default IO path is used
+		Filename = IFileManager::Get().ConvertToAbsolutePathForExternalAppForRead(*Filename);
+		IoUringFile = FACLIoUring::OpenFile(Filename, bDirectIO);
+		if (!IoUringFile.IsValid())
+		{
+			UE_LOG(LogAnimationCompression, Log, TEXT("ACL cannot open '%s' for io_uring streaming, the default IO path will be used"), *Filename);
+			bIoUringFileFailed = true;
+		}
+	}
+#endif
+
 	UE4DatabaseStreamer(const UE4DatabaseStreamer&) = delete;
 	UE4DatabaseStreamer& operator=(const UE4DatabaseStreamer&) = delete;
 
@@ -173,6 +372,19 @@ private:
 
 	IBulkDataIORequest* PendingIORequest;
 
+	FACLDatabaseStreamingStats Stats;
+
+	TAtomic<uint32> NumCompletedStreamIns;
+	TAtomic<uint64> TotalStreamInLatencyCycles;
+	TAtomic<uint64> MaxStreamInLatencyCycles;
+
+#if WITH_ACL_IO_URING
+	FACLIoUringFile IoUringFile;
+	FEvent* IoUringEvent;
+	bool bIsIoUringRequestPending;
+	bool bIoUringFileFailed;
+#endif
+
 	acl::streaming_request Requests[acl::k_num_database_tiers];	// One request per tier is enough
 
 #if WITH_VMEM_MANAGEMENT
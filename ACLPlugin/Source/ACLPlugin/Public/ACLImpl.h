@@ -62,6 +62,12 @@ struct UE4SafeDecompressionSettings final : public UE4DefaultDecompressionSettin
 	static constexpr acl::rotation_format8 get_rotation_format(acl::rotation_format8 /*format*/) { return acl::rotation_format8::quatf_full; }
 };
 
+struct UE4DropWFullDecompressionSettings final : public UE4DefaultDecompressionSettings
+{
+	static constexpr bool is_rotation_format_supported(acl::rotation_format8 format) { return format == acl::rotation_format8::quatf_drop_w_full; }
+	static constexpr acl::rotation_format8 get_rotation_format(acl::rotation_format8 /*format*/) { return acl::rotation_format8::quatf_drop_w_full; }
+};
+
 using UE4DefaultDatabaseSettings = acl::default_database_settings;
 
 struct UE4DefaultDBDecompressionSettings final : public UE4DefaultDecompressionSettings
@@ -76,6 +82,42 @@ struct UE4DebugDBDecompressionSettings final : public acl::debug_transform_decom
 	using database_settings_type = UE4DebugDatabaseSettings;
 };
 
+/** The terms of the decode cost estimate. Each term counts something a pose decompression does and is weighed by its cost in decode cost units. */
+enum class EACLDecodeCostTerm : uint8
+{
+	PoseSetup,
+	SegmentSeek,
+	OutputTrack,
+	FullRotationSubTrack,
+	VariableRotationSubTrack,
+	FullVectorSubTrack,
+	VariableVectorSubTrack,
+	DatabaseSubTrack,
+
+	Count
+};
+
+/** Returns the name of a decode cost term as it appears in the ACLDecodeCost weights. */
+ACLPLUGIN_API const TCHAR* GetDecodeCostTermName(EACLDecodeCostTerm Term);
+
+/** Returns the weight of a decode cost term in decode cost units. */
+ACLPLUGIN_API float GetDecodeCostTermWeight(EACLDecodeCostTerm Term);
+
+/** Writes how many times every decode cost term occurs when decompressing a whole pose. Returns false and writes zeros if the tracks aren't transform tracks. */
+ACLPLUGIN_API bool GetDecodeCostTermCounts(const acl::compressed_tracks& CompressedTracks, float OutCounts[(int32)EACLDecodeCostTerm::Count]);
+
+/**
+ * Returns a deterministic estimate of the cost to decompress a whole pose, in decode cost units. Derived from the animated track counts and formats.
+ * The relative weight of each term can be fitted against measurements with 'ACL.CalibrateDecodeCost'.
+ */
+ACLPLUGIN_API float EstimateDecodeCostUnits(const acl::compressed_tracks& CompressedTracks);
+
+/** Returns a deterministic estimate of the number of compressed bytes a single sample touches. Derived from the compressed size and the number of segments. */
+ACLPLUGIN_API uint32 EstimateBytesTouchedPerSample(const acl::compressed_tracks& CompressedTracks);
+
+/** Converts decode cost units into nanoseconds with the scale calibrated for the running platform ('ACL.DecodeCostNsPerUnit'). */
+ACLPLUGIN_API float DecodeCostUnitsToNanoseconds(float DecodeCostUnits);
+
 /** UE4 equivalents for some ACL enums */
 /** An enum for ACL rotation formats. */
 UENUM()
@@ -107,12 +149,32 @@ enum ACLCompressionLevel
 
 /** Editor only utilities */
 #if WITH_EDITOR
+#include "PerPlatformProperties.h"
+
 #include <acl/compression/track_array.h>
 #include <acl/compression/compression_level.h>
 
+class ITargetPlatform;
+struct FPerPlatformACLCompressionLevel;
+
 ACLPLUGIN_API acl::rotation_format8 GetRotationFormat(ACLRotationFormat Format);
 ACLPLUGIN_API acl::vector_format8 GetVectorFormat(ACLVectorFormat Format);
 ACLPLUGIN_API acl::compression_level8 GetCompressionLevel(ACLCompressionLevel Level);
 
 ACLPLUGIN_API acl::track_array_qvvf BuildACLTransformTrackArray(ACLAllocator& AllocatorImpl, const FCompressibleAnimData& CompressibleAnimData, float DefaultVirtualVertexDistance, float SafeVirtualVertexDistance, bool bBuildAdditiveBase);
+
+/**
+ * Returns the platform we compress for: the active cook target or the running platform.
+ * Returns nullptr if we cook for multiple platforms at once, the engine compresses anim sequences once for all of them.
+ */
+ACLPLUGIN_API const ITargetPlatform* GetCompressionTargetPlatform();
+
+/** Returns the value of a per platform property for the platform we compress for. */
+ACLPLUGIN_API float GetPerPlatformValue(const FPerPlatformFloat& Property);
+ACLPLUGIN_API int32 GetPerPlatformValue(const FPerPlatformInt& Property);
+ACLPLUGIN_API bool GetPerPlatformValue(const FPerPlatformBool& Property);
+ACLPLUGIN_API ACLCompressionLevel GetPerPlatformValue(const FPerPlatformACLCompressionLevel& Property);
+
+/** Returns a copy of the provided tracks resampled at a sample rate equal to or lower than the one provided. The duration is preserved. */
+ACLPLUGIN_API acl::track_array_qvvf ResampleACLTransformTrackArray(ACLAllocator& AllocatorImpl, const acl::track_array_qvvf& Tracks, float MaxSampleRate);
 #endif // WITH_EDITOR
@@ -0,0 +1,66 @@
+#pragma once
+
+// Copyright 2020 Nicholas Frechette. All Rights Reserved.
+
+#include "CoreMinimal.h"
+
+namespace acl
+{
+	class compressed_tracks;
+}
+
+/**
+ * The output pose state of a single instance playing a single sequence.
+ * Constant and default tracks never change, they are written by the first decompression and later decompressions only write the animated tracks.
+ * The caller guarantees that the same output pose buffer is reused between decompressions and that nothing else writes into it (e.g. retargeting).
+ */
+struct ACLPLUGIN_API FACLPersistentPoseState
+{
+	/** Forces the next decompression to write every track. Call this when the output pose buffer content is no longer trusted. */
+	void Reset();
+
+	/**
+	 * Called by the decompression before a pose is written.
+	 * Returns true if the constant and default tracks can be skipped, otherwise every track must be written and the state is updated to match.
+	 */
+	bool Prepare(const acl::compressed_tracks& CompressedTracks, const TArrayView<FTransform>& OutAtoms, uint32 TrackMappingHash);
+
+	/** One bit per sub-track (rotation, translation, scale) of every track, set when the sub-track is constant or default. */
+	const uint32* GetStaticSubTracks() const { return StaticSubTracks.GetData(); }
+
+	/** The key the active scope provided for the tracks and atoms the caller decompresses. */
+	uint32 GetBoneMappingKey() const { return BoneMappingKey; }
+
+private:
+	/** Set by the active scope. */
+	uint32 BoneMappingKey = 0;
+
+	/** What the output pose was last written with. */
+	const acl::compressed_tracks* CompressedTracks = nullptr;
+	uint32 CompressedTracksHash = 0;
+	const FTransform* OutputAtoms = nullptr;
+	int32 NumOutputAtoms = 0;
+	uint32 TrackMappingHash = 0;
+
+	TArray<uint32> StaticSubTracks;
+
+	friend class FACLPersistentPoseScope;
+};
+
+/**
+ * While in scope, pose decompressions on the calling thread write into a persistent output pose with the provided state.
+ * The bone mapping key identifies which tracks are written to which atoms (e.g. a hash of the required bones computed when they change),
+ * the caller must provide a new key when the mapping changes.
+ */
+class ACLPLUGIN_API FACLPersistentPoseScope
+{
+public:
+	FACLPersistentPoseScope(FACLPersistentPoseState& State, uint32 BoneMappingKey);
+	~FACLPersistentPoseScope();
+
+private:
+	FACLPersistentPoseState* PreviousState;
+};
+
+/** Returns the persistent pose state active on the calling thread or nullptr if there is none. */
+ACLPLUGIN_API FACLPersistentPoseState* GetActivePersistentPoseState();
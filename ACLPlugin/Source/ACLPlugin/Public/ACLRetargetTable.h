@@ -0,0 +1,69 @@
+#pragma once
+
+// Copyright 2020 Nicholas Frechette. All Rights Reserved.
+
+#include "CoreMinimal.h"
+#include "Animation/AnimSequence.h"
+
+class USkeleton;
+class USkeletalMesh;
+
+/** The translation retargeting of a single skeleton bone, the output translation is: Translation * Scale + Offset. */
+struct FACLRetargetTranslation
+{
+	FVector Offset;
+	float Scale;
+
+	FACLRetargetTranslation() : Offset(FVector::ZeroVector), Scale(1.0f) {}
+};
+
+/**
+ * The translation retargeting of every skeleton bone for sequences authored on a retarget source and played on a target pose.
+ * It matches what the engine applies after decompression for the Animation, Skeleton, and AnimationScaled modes.
+ * Bones that also require their rotation or scale to be retargeted are not supported and the table reports it.
+ */
+struct ACLPLUGIN_API FACLRetargetTable
+{
+	/** The retargeting of every skeleton bone, indexed by skeleton bone index. */
+	TArray<FACLRetargetTranslation> Bones;
+
+	/** Whether or not every bone can be retargeted inline. When false, the engine retargeting must be used instead. */
+	bool bIsSupported;
+
+	FACLRetargetTable() : bIsSupported(true) {}
+
+	/**
+	 * Returns the table for the specified skeleton and retarget source played on the target mesh reference pose (or the skeleton reference pose if null).
+	 * Tables are built once and cached, call ResetCache() when the retargeting settings of a skeleton change.
+	 */
+	static TSharedRef<const FACLRetargetTable, ESPMode::ThreadSafe> FindOrBuild(const USkeleton& Skeleton, FName RetargetSource, const USkeletalMesh* TargetMesh, bool bIsBakedAdditive);
+
+	/** Discards every cached table. */
+	static void ResetCache();
+};
+
+/** The retargeting applied by pose decompressions on the calling thread. */
+struct FACLActiveRetarget
+{
+	const FACLRetargetTable* Table;
+	const FTrackToSkeletonMap* TrackToSkeletonMap;
+	int32 NumTracks;
+};
+
+/**
+ * While in scope, pose decompressions on the calling thread retarget translations inline as they are written.
+ * The caller is responsible for skipping the engine retargeting pass of the decompressed pose.
+ */
+class ACLPLUGIN_API FACLRetargetScope
+{
+public:
+	FACLRetargetScope(const FACLRetargetTable& Table, const TArray<FTrackToSkeletonMap>& TrackToSkeletonMap);
+	~FACLRetargetScope();
+
+private:
+	FACLActiveRetarget Retarget;
+	const FACLActiveRetarget* PreviousRetarget;
+};
+
+/** Returns the retargeting active on the calling thread or nullptr if there is none. */
+ACLPLUGIN_API const FACLActiveRetarget* GetActiveRetarget();
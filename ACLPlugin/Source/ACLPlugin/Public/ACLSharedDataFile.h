@@ -0,0 +1,64 @@
+#pragma once
+
+// Copyright 2020 Nicholas Frechette. All Rights Reserved.
+
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+
+class IMappedFileHandle;
+class IMappedFileRegion;
+
+/** A blob of compressed data stored in the shared data file, identified by the hash of its content. */
+struct FACLSharedDataBlob
+{
+	uint32 Hash;
+	TArrayView<const uint8> Bytes;
+};
+
+/**
+ * A read-only file that holds the compressed data of every non-database sequence and database.
+ * The file is memory mapped and never written, the page cache shares a single physical copy between every process
+ * on the host that uses it (e.g. dedicated servers). Loaded data whose content is found in the file binds to the mapped
+ * copy and releases its private copy. Data missing from the file (e.g. a stale file) is retained as usual.
+ */
+class ACLPLUGIN_API FACLSharedDataFile
+{
+public:
+	/** Returns the global shared data file instance. */
+	static FACLSharedDataFile& Get();
+
+	/** Returns whether or not a shared data file is configured ('ACL.SharedDataFile'). */
+	static bool IsEnabled();
+
+	/** Returns the mapped copy of the provided bytes or nullptr if the file doesn't contain them. Thread safe. */
+	uint8* Find(uint32 Hash, TArrayView<const uint8> Bytes);
+
+	/** Returns the number of blobs and bytes bound to the mapped file, these no longer use private memory in this process. */
+	int32 GetNumBoundBlobs() const { return NumBoundBlobs; }
+	uint64 GetNumBoundBytes() const { return NumBoundBytes; }
+
+	/** Returns the size of the mapped file. */
+	int64 GetFileSize() const { return MappedSize; }
+
+#if WITH_EDITOR
+	/** Writes a shared data file that contains the provided blobs. Blobs with the same content are only written once. */
+	static bool WriteFile(const FString& Filename, const TArray<FACLSharedDataBlob>& Blobs);
+#endif
+
+private:
+	FACLSharedDataFile();
+
+	void Initialize();
+
+	FCriticalSection Lock;
+
+	IMappedFileHandle* MappedFile;
+	IMappedFileRegion* MappedRegion;
+	const uint8* MappedData;
+	int64 MappedSize;
+
+	int32 NumBoundBlobs;
+	uint64 NumBoundBytes;
+
+	bool bIsInitialized;
+};
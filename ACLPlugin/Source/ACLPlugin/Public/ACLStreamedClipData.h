@@ -0,0 +1,92 @@
+#pragma once
+
+// Copyright 2020 Nicholas Frechette. All Rights Reserved.
+
+#include "CoreMinimal.h"
+#include "Serialization/BulkData.h"
+#include "Templates/Atomic.h"
+
+class IBulkDataIORequest;
+struct FACLCompressedAnimData;
+
+/** The residency of the compressed data of a streamed anim sequence. */
+enum class EACLStreamedClipState : uint32
+{
+	StreamedOut,	// Not resident, it must stream in before it can be decompressed
+	StreamingIn,	// A stream in request is in flight
+	Resident,		// Resident and bound to its anim data
+};
+
+/**
+ * Holds the compressed data of an anim sequence cooked as separately streamed bulk data.
+ * It streams in asynchronously when first requested and streams out once unused when the
+ * streamed clips exceed their memory budget ('ACL.StreamedClipBudgetMB').
+ */
+struct ACLPLUGIN_API FACLStreamedClipData
+{
+	explicit FACLStreamedClipData(FACLCompressedAnimData& AnimData_);
+	~FACLStreamedClipData();
+
+	/** Loads our bulk data header and registers with the streamed clip manager. */
+	void Serialize(FArchive& Ar, UObject* Owner);
+
+	/** Returns whether or not our compressed data is resident. If it isn't, a stream in request is issued unless one is in flight. Thread safe. */
+	bool Request()
+	{
+		LastUsedFrame = GFrameCounter;
+		return State.Load() == uint32(EACLStreamedClipState::Resident) || RequestStreamIn();
+	}
+
+	/**
+	 * Like Request() but when our compressed data is resident, it remains resident until EndRead() is called. Thread safe.
+	 * We register as a reader before we check our state and the manager publishes its stream out before it checks for readers,
+	 * one of the two always observes the other.
+	 */
+	bool BeginRead()
+	{
+		LastUsedFrame = GFrameCounter;
+		NumReaders++;
+
+		if (State.Load() == uint32(EACLStreamedClipState::Resident))
+		{
+			return true;
+		}
+
+		NumReaders--;
+		RequestStreamIn();
+		return false;
+	}
+
+	/** Must be called once done reading when BeginRead() returned true. Thread safe. */
+	void EndRead() { NumReaders--; }
+
+	/** Returns the size in bytes of our compressed data. */
+	int64 GetSize() const { return Size; }
+
+	/** The bulk data that holds our compressed data on disk. */
+	FByteBulkData BulkData;
+
+	/** The anim data we bind to once resident. */
+	FACLCompressedAnimData& AnimData;
+
+	/** Our compressed data, 16 byte aligned. Only valid while streaming in or resident. */
+	uint8* Buffer;
+
+	/** The last stream in request issued, deleted once the next one is issued or when we are destroyed. */
+	IBulkDataIORequest* PendingRequest;
+
+	/** Our EACLStreamedClipState. */
+	TAtomic<uint32> State;
+
+	/** The last frame (GFrameCounter) our data was requested. */
+	TAtomic<uint64> LastUsedFrame;
+
+	/** The number of threads currently reading our resident data, we cannot stream out until it is zero. */
+	TAtomic<int32> NumReaders;
+
+	/** The size in bytes of our compressed data. */
+	int64 Size;
+
+private:
+	bool RequestStreamIn();
+};
@@ -0,0 +1,89 @@
+#pragma once
+
+// Copyright 2020 Nicholas Frechette. All Rights Reserved.
+
+#include "CoreMinimal.h"
+
+/**
+ * Returns the key that identifies a sequence in usage profiles from its full name (e.g. 'AnimSequence /Game/Path/Name.Name').
+ * Unlike name hashes, it is unique per asset and stable across processes.
+ */
+inline uint32 GetACLSequenceUsageKey(const FString& SequenceFullName) { return FCrc::StrCrc32(*SequenceFullName); }
+
+/** Records how often a sequence was decompressed and where in the sequence. */
+struct FACLSequenceUsage
+{
+	/** The number of time buckets used to track the normalized sample time. */
+	static constexpr int32 NumTimeBuckets = 16;
+
+	/** The sequence name. */
+	FString SequenceName;
+
+	/** The sequence usage key, see GetACLSequenceUsageKey. */
+	uint32 SequenceKey;
+
+	/** The number of times the sequence was decompressed. */
+	uint64 NumDecompressions;
+
+	/** The number of frames during which the sequence was decompressed. */
+	uint64 NumFrames;
+
+	/** The number of times each normalized time range was decompressed. */
+	uint64 TimeHistogram[NumTimeBuckets];
+
+	FACLSequenceUsage();
+
+	/** Returns the bucket index that contains the specified normalized time. */
+	static int32 GetTimeBucket(float NormalizedTime) { return FMath::Clamp(FMath::FloorToInt(NormalizedTime * NumTimeBuckets), 0, NumTimeBuckets - 1); }
+
+	friend FArchive& operator<<(FArchive& Ar, FACLSequenceUsage& Usage);
+};
+
+/** Records how often two sequences were decompressed during the same frame. */
+struct FACLSequenceCoUsage
+{
+	/** The sequence usage keys, the smallest key is always first. */
+	uint32 SequenceKeyA;
+	uint32 SequenceKeyB;
+
+	/** The number of frames during which both sequences were decompressed. */
+	uint64 NumFrames;
+
+	FACLSequenceCoUsage() : SequenceKeyA(0), SequenceKeyB(0), NumFrames(0) {}
+
+	friend FArchive& operator<<(FArchive& Ar, FACLSequenceCoUsage& CoUsage);
+};
+
+/** A usage profile captured at runtime. It lists which sequences are decompressed, how often, and where. */
+struct ACLPLUGIN_API FACLUsageProfile
+{
+	/** The number of frames captured. */
+	uint64 NumFrames;
+
+	/** The per sequence usage, sorted by usage key. */
+	TArray<FACLSequenceUsage> Sequences;
+
+	/** Which sequences were decompressed together, sorted by usage keys. */
+	TArray<FACLSequenceCoUsage> CoUsage;
+
+	FACLUsageProfile();
+
+	/** Returns the usage of a sequence or nullptr if it was never decompressed. */
+	const FACLSequenceUsage* FindSequence(uint32 SequenceKey) const;
+
+	/**
+	 * Returns the order in which to lay out the sequences with the provided usage keys such that those frequently played together are next to each other.
+	 * Starting with the most played sequence, we greedily append the sequence most often played with the ones already placed.
+	 * When no placed sequence has a partner left, we start over with the most played sequence remaining.
+	 * Sequences absent from the profile retain their original order at the end.
+	 */
+	TArray<int32> CalculateCoUsageOrder(const TArray<uint32>& SequenceKeys) const;
+
+	/** Writes the profile to disk. Returns true on success. */
+	bool SaveToFile(const FString& Filename) const;
+
+	/** Reads a profile from disk. Returns true on success. */
+	bool LoadFromFile(const FString& Filename);
+
+	friend FArchive& operator<<(FArchive& Ar, FACLUsageProfile& Profile);
+};
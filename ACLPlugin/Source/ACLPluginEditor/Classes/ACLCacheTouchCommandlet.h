@@ -0,0 +1,31 @@
+#pragma once
+
+// Copyright 2020 Nicholas Frechette. All Rights Reserved.
+
+#include "Commandlets/Commandlet.h"
+#include "ACLCacheTouchCommandlet.generated.h"
+
+/*
+ * This commandlet is used to measure how many cache lines and pages of compressed data a pose decompression touches.
+ * Every clip is compressed with every combination of the requested settings and every compressed byte read
+ * while decompressing a pose is recorded by protecting the compressed data and single stepping the faulting reads.
+ * Only supported on Linux x64 in non-shipping builds.
+ *
+ * It supports the following arguments: -input=<path> -output=<path> -levels=<a,b,...> -segments=<ideal:max,...>
+ *     -NumPoses=<count> -CacheLineSize=<bytes>
+ *
+ *   input: This is the path to a directory that contains ACL SJSON animation clips.
+ *   output: This is an optional path where the CSV results will be written.
+ *   levels: The compression levels to measure, from 0 (lowest) to 4 (highest). Defaults to 1,2,3.
+ *   segments: The ideal and maximum number of samples per segment to measure. Defaults to 16:31.
+ *   NumPoses: How many poses, evenly spread over the clip duration, are decompressed per clip. Defaults to 64.
+ *   CacheLineSize: The cache line size in bytes. Defaults to 64.
+ */
+UCLASS()
+class UACLCacheTouchCommandlet : public UCommandlet
+{
+	GENERATED_UCLASS_BODY()
+
+public:
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,27 @@
+#pragma once
+
+// Copyright 2020 Nicholas Frechette. All Rights Reserved.
+
+#include "Commandlets/Commandlet.h"
+#include "ACLMemoryBudgetCommandlet.generated.h"
+
+/*
+ * This commandlet is used to fit the ACL anim sequences of the current project within a memory budget.
+ * The size and error of every sequence is measured over a range of error thresholds and per sequence thresholds
+ * are selected to minimize the worst error of any sequence while the total compressed size fits the budget.
+ * The selected thresholds are written to the compression error threshold scale of each sequence, relative to the error threshold of its codec.
+ *
+ * It supports the following arguments: -BudgetMB=<size> -thresholds=<a,b,...> -dryrun
+ *
+ *   BudgetMB: The memory budget in MB for the compressed bone data of every ACL anim sequence.
+ *   thresholds: The error thresholds (in cm) to consider. Defaults to 0.001,0.0025,0.005,0.01,0.025,0.05,0.1,0.25,0.5,1.0.
+ *   dryrun: When present, the results are logged but the sequences are not modified.
+ */
+UCLASS()
+class UACLMemoryBudgetCommandlet : public UCommandlet
+{
+	GENERATED_UCLASS_BODY()
+
+public:
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,36 @@
+#pragma once
+
+// Copyright 2020 Nicholas Frechette. All Rights Reserved.
+
+#include "Commandlets/Commandlet.h"
+#include "ACLPerfRegressionCommandlet.generated.h"
+
+/*
+ * This commandlet is used to detect compression and decompression performance regressions.
+ * A fixed corpus of clips is compressed with every ACL codec and the results are compared against a stored baseline.
+ *
+ * It supports the following arguments: -baseline=<path> -input=<path> -output=<path> -updatebaseline -SpeedBaseline=<path> -NoSpeed
+ *     -SizeTolerance=<percent> -ErrorTolerance=<percent> -SpeedTolerance=<percent> -NumPoses=<count>
+ *
+ *   baseline: This is the path to the SJSON baseline file to compare against (or to write when updating it). It only holds deterministic metrics.
+ *   input: This is an optional path to a directory that contains ACL SJSON animation clips to add to the synthetic corpus.
+ *   output: This is an optional path where the SJSON results of this run will be written.
+ *   updatebaseline: When present, the baseline and the speed baseline are overwritten with the results of this run instead of being compared against.
+ *   SpeedBaseline: This is the path to the SJSON baseline of the timings of this machine. Defaults to Saved/ACLPerfRegression/<machine>_speed_baseline.sjson.
+ *       When it doesn't exist, it is written and timings are compared from the next run onward.
+ *   NoSpeed: When present, timings are not compared.
+ *   SizeTolerance: How much larger the compressed data can grow before it is a regression. Defaults to 1%.
+ *   ErrorTolerance: How much larger the maximum error can grow before it is a regression. Defaults to 5%.
+ *   SpeedTolerance: How much slower decompression and the database build can get before it is a regression. Defaults to 25%.
+ *   NumPoses: How many poses to decompress per clip when measuring the decompression speed. Defaults to 1000.
+ *
+ * The commandlet returns a non-zero exit code when a regression is found.
+ */
+UCLASS()
+class UACLPerfRegressionCommandlet : public UCommandlet
+{
+	GENERATED_UCLASS_BODY()
+
+public:
+	virtual int32 Main(const FString& Params) override;
+};
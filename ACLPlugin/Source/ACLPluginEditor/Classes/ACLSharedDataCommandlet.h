@@ -0,0 +1,24 @@
+#pragma once
+
+// Copyright 2020 Nicholas Frechette. All Rights Reserved.
+
+#include "Commandlets/Commandlet.h"
+#include "ACLSharedDataCommandlet.generated.h"
+
+/*
+ * This commandlet is used to build the shared data file of the current project (see 'ACL.SharedDataFile').
+ * It contains the compressed data of every ACL anim sequence that doesn't use a database and of every ACL database.
+ * Run it with the same '-TargetPlatform' as the cook, data that doesn't match what was cooked is not shared at runtime.
+ *
+ * It supports the following arguments: -output=<path>
+ *
+ *   output: The path of the shared data file to write. It must be deployed as a loose file, files within a pak file cannot be memory mapped.
+ */
+UCLASS()
+class UACLSharedDataCommandlet : public UCommandlet
+{
+	GENERATED_UCLASS_BODY()
+
+public:
+	virtual int32 Main(const FString& Params) override;
+};
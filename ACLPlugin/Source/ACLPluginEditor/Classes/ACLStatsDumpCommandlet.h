@@ -13,6 +13,8 @@
  *   acl: This is the path to the input directory that contains the ACL SJSON animation clips.
  *   stats: This is the path to the output directory that will contain the extracted SJSON statistics.
  *   MasterTolerance: This is the master tolerance used by the UE4 Automatic compression algorithm. Defaults to 0.1cm.
+ *   sweep: Compresses every clip with a grid of ACL parameters and outputs the error/size Pareto frontier per clip and for the whole project.
+ *   database: Builds a database from every clip and outputs the size and error of every clip at every visual fidelity.
  */
 UCLASS()
 class UACLStatsDumpCommandlet : public UCommandlet
@@ -28,6 +30,8 @@ public:
 	bool PerformExhaustiveDump;
 	bool PerformCompression;
 	bool PerformClipExtraction;
+	bool PerformSweep;
+	bool PerformDatabase;
 	bool TryAutomaticCompression;
 	bool TryACLCompression;
 	bool TryKeyReductionRetarget;
@@ -40,4 +44,10 @@ public:
 	class UAnimBoneCompressionSettings* KeyReductionCompressionSettings;
 	class UAnimBoneCompressionCodec_ACL* ACLCodec;
 	class UAnimCompress_RemoveLinearKeys* KeyReductionCodec;
+
+	/** The parameter sweep state, only valid while sweeping. */
+	struct FACLParameterSweep* Sweep;
+
+	/** The database visual fidelity state, only valid while measuring a database. */
+	struct FACLDatabaseFidelity* DatabaseFidelity;
 };
@@ -0,0 +1,453 @@
+// Copyright 2020 Nicholas Frechette. All Rights Reserved.
+
+#include "ACLCacheTouchCommandlet.h"
+#include "ACLCommandletUtils.h"
+
+#include "Runtime/Core/Public/HAL/FileManagerGeneric.h"
+#include "Runtime/Core/Public/Misc/FileHelper.h"
+#include "Runtime/Engine/Public/AnimationCompression.h"
+
+#include "ACLImpl.h"
+
+#include <acl/compression/compress.h>
+#include <acl/compression/track_array.h>
+#include <acl/compression/transform_error_metrics.h>
+#include <acl/decompression/decompress.h>
+
+#include <rtm/quatf.h>
+#include <rtm/vector4f.h>
+
+// Tracking relies on page protection and the x64 trap flag to single step faulting reads
+#if PLATFORM_LINUX && PLATFORM_CPU_X86_FAMILY && PLATFORM_64BITS && !UE_BUILD_SHIPPING
+	#define ACL_WITH_TOUCH_TRACKING 1
+#else
+	#define ACL_WITH_TOUCH_TRACKING 0
+#endif
+
+#if ACL_WITH_TOUCH_TRACKING
+	#include <signal.h>
+	#include <sys/mman.h>
+	#include <ucontext.h>
+#endif
+
+//////////////////////////////////////////////////////////////////////////
+// Commandlet example inspired by: https://github.com/ue4plugins/CommandletPlugin
+// To run the commandlet, add to the commandline: "$(SolutionDir)$(ProjectName).uproject" -run=/Script/ACLPluginEditor.ACLCacheTouch "-input=<path/to/raw/acl/sjson/files/directory>" -nullrhi -unattended
+//
+// Usage:
+//		-input=<directory>: All *acl.sjson files in the directory are measured
+//		-output=<file>: If present the CSV results will be written at the given path
+//		-levels=<a,b,...>: The compression levels to measure, from 0 (lowest) to 4 (highest) (default 1,2,3)
+//		-segments=<ideal:max,...>: The segment sizes to measure (default 16:31)
+//		-NumPoses=<count>: How many poses are decompressed per clip (default 64)
+//		-CacheLineSize=<bytes>: The cache line size (default 64)
+//////////////////////////////////////////////////////////////////////////
+
+#if ACL_WITH_TOUCH_TRACKING
+/**
+ * Records the offset of every read within a copy of some data.
+ * The copy lives in its own pages which are protected while tracking. A read faults, we record its address,
+ * unprotect the pages, and single step the faulting instruction before protecting the pages again.
+ * The fault address is where the access starts, an access that straddles a cache line only counts its first line.
+ * A single tracker can be active at a time and the data must only be read by the thread that tracks it.
+ */
+class FACLTouchTracker
+{
+public:
+	FACLTouchTracker(const void* Data, uint32 Size_, int32 MaxNumOffsets)
+		: Size(Size_)
+		, NumOffsets(0)
+		, bOverflowed(false)
+	{
+		const uint32 PageSize = FPlatformMemory::GetConstants().PageSize;
+		BufferSize = Align(FMath::Max<uint32>(Size, 1), PageSize);
+
+		Buffer = static_cast<uint8*>(mmap(nullptr, BufferSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+		checkf(Buffer != MAP_FAILED, TEXT("Failed to map %u bytes"), BufferSize);
+		FMemory::Memcpy(Buffer, Data, Size);
+
+		Offsets.SetNumUninitialized(MaxNumOffsets);
+	}
+
+	~FACLTouchTracker()
+	{
+		check(ActiveTracker != this);
+		munmap(Buffer, BufferSize);
+	}
+
+	const uint8* GetData() const { return Buffer; }
+
+	/** Starts recording reads, previous recordings are discarded. */
+	void Begin()
+	{
+		check(ActiveTracker == nullptr);
+
+		NumOffsets = 0;
+		bOverflowed = false;
+		ActiveTracker = this;
+
+		struct sigaction Action;
+		FMemory::Memzero(Action);
+		Action.sa_flags = SA_SIGINFO;
+		sigemptyset(&Action.sa_mask);
+
+		Action.sa_sigaction = &FACLTouchTracker::OnSegmentationFault;
+		sigaction(SIGSEGV, &Action, &OldSegmentationFaultAction);
+
+		Action.sa_sigaction = &FACLTouchTracker::OnTrap;
+		sigaction(SIGTRAP, &Action, &OldTrapAction);
+
+		mprotect(Buffer, BufferSize, PROT_NONE);
+	}
+
+	/** Stops recording reads. */
+	void End()
+	{
+		check(ActiveTracker == this);
+
+		mprotect(Buffer, BufferSize, PROT_READ | PROT_WRITE);
+
+		sigaction(SIGSEGV, &OldSegmentationFaultAction, nullptr);
+		sigaction(SIGTRAP, &OldTrapAction, nullptr);
+
+		ActiveTracker = nullptr;
+	}
+
+	/** Returns the offsets of every read recorded, in the order they happened. */
+	TArrayView<const uint32> GetTouchedOffsets() const { return TArrayView<const uint32>(Offsets.GetData(), NumOffsets); }
+
+	/** Returns whether or not some reads could not be recorded. */
+	bool HasOverflowed() const { return bOverflowed; }
+
+private:
+	static constexpr greg_t TrapFlag = 0x100;
+
+	static void OnSegmentationFault(int Signal, siginfo_t* Info, void* Context)
+	{
+		FACLTouchTracker* Tracker = ActiveTracker;
+		const uint8* Address = static_cast<const uint8*>(Info->si_addr);
+
+		if (Tracker == nullptr || Address < Tracker->Buffer || Address >= Tracker->Buffer + Tracker->BufferSize)
+		{
+			// Not ours, restore the previous handler and let the faulting instruction execute again
+			sigaction(SIGSEGV, &OldSegmentationFaultAction, nullptr);
+			return;
+		}
+
+		if (Tracker->NumOffsets < Tracker->Offsets.Num())
+		{
+			Tracker->Offsets.GetData()[Tracker->NumOffsets++] = uint32(Address - Tracker->Buffer);
+		}
+		else
+		{
+			Tracker->bOverflowed = true;
+		}
+
+		mprotect(Tracker->Buffer, Tracker->BufferSize, PROT_READ);
+
+		ucontext_t* UContext = static_cast<ucontext_t*>(Context);
+		UContext->uc_mcontext.gregs[REG_EFL] |= TrapFlag;
+	}
+
+	static void OnTrap(int Signal, siginfo_t* Info, void* Context)
+	{
+		FACLTouchTracker* Tracker = ActiveTracker;
+		if (Tracker != nullptr)
+		{
+			mprotect(Tracker->Buffer, Tracker->BufferSize, PROT_NONE);
+		}
+
+		ucontext_t* UContext = static_cast<ucontext_t*>(Context);
+		UContext->uc_mcontext.gregs[REG_EFL] &= ~TrapFlag;
+	}
+
+	static FACLTouchTracker* ActiveTracker;
+	static struct sigaction OldSegmentationFaultAction;
+	static struct sigaction OldTrapAction;
+
+	uint8* Buffer;
+	uint32 Size;
+	uint32 BufferSize;
+
+	TArray<uint32> Offsets;
+	int32 NumOffsets;
+	bool bOverflowed;
+};
+
+FACLTouchTracker* FACLTouchTracker::ActiveTracker = nullptr;
+struct sigaction FACLTouchTracker::OldSegmentationFaultAction;
+struct sigaction FACLTouchTracker::OldTrapAction;
+
+struct FACLTouchPoseWriter final : public acl::track_writer
+{
+	TArray<rtm::qvvf>& Pose;
+
+	explicit FACLTouchPoseWriter(TArray<rtm::qvvf>& Pose_) : Pose(Pose_) {}
+
+	void RTM_SIMD_CALL write_rotation(uint32_t TrackIndex, rtm::quatf_arg0 Rotation) { Pose[TrackIndex].rotation = Rotation; }
+	void RTM_SIMD_CALL write_translation(uint32_t TrackIndex, rtm::vector4f_arg0 Translation) { Pose[TrackIndex].translation = Translation; }
+	void RTM_SIMD_CALL write_scale(uint32_t TrackIndex, rtm::vector4f_arg0 Scale) { Pose[TrackIndex].scale = Scale; }
+};
+
+/** The compression settings a clip is measured with. */
+struct FACLTouchSettings
+{
+	ACLCompressionLevel CompressionLevel;
+	uint32 IdealNumKeyFramesPerSegment;
+	uint32 MaxNumKeyFramesPerSegment;
+};
+
+/** What a clip touches per pose decompression. */
+struct FACLTouchResult
+{
+	uint32 CompressedSize = 0;
+
+	double AvgNumCacheLines = 0.0;
+	double AvgNumPages = 0.0;
+	uint32 MaxNumCacheLines = 0;
+	uint32 MaxNumPages = 0;
+
+	/** How many unique cache lines and pages were touched by all decompressions together. */
+	uint32 TotalNumCacheLines = 0;
+	uint32 TotalNumPages = 0;
+
+	bool bOverflowed = false;
+};
+
+static constexpr int32 MaxNumTouchesPerPose = 1024 * 1024;
+
+/** Mirrors what the codecs do for every pose decompression. */
+static void DecompressPose(const acl::compressed_tracks& CompressedTracks, float SampleTime, FACLTouchPoseWriter& Writer)
+{
+	acl::decompression_context<UE4DefaultDecompressionSettings> Context;
+	Context.initialize(CompressedTracks);
+	Context.seek(SampleTime, acl::sample_rounding_policy::none);
+	Context.decompress_tracks(Writer);
+}
+
+static FACLTouchResult MeasureTouches(const acl::compressed_tracks& CompressedTracks, int32 NumPoses, uint32 CacheLineSize)
+{
+	const uint32 PageSize = FPlatformMemory::GetConstants().PageSize;
+	const uint32 CompressedSize = CompressedTracks.get_size();
+
+	FACLTouchTracker Tracker(&CompressedTracks, CompressedSize, MaxNumTouchesPerPose);
+	const acl::compressed_tracks& TrackedTracks = *reinterpret_cast<const acl::compressed_tracks*>(Tracker.GetData());
+
+	TArray<rtm::qvvf> Pose;
+	Pose.SetNumUninitialized(CompressedTracks.get_num_tracks());
+	FACLTouchPoseWriter Writer(Pose);
+
+	const float Duration = CompressedTracks.get_duration();
+
+	FACLTouchResult Result;
+	Result.CompressedSize = CompressedSize;
+
+	TSet<uint32> TotalCacheLines;
+	TSet<uint32> TotalPages;
+	TSet<uint32> CacheLines;
+	TSet<uint32> Pages;
+
+	for (int32 PoseIndex = 0; PoseIndex < NumPoses; ++PoseIndex)
+	{
+		const float SampleTime = NumPoses > 1 ? ((Duration * PoseIndex) / (NumPoses - 1)) : 0.0f;
+
+		Tracker.Begin();
+		DecompressPose(TrackedTracks, SampleTime, Writer);
+		Tracker.End();
+
+		CacheLines.Reset();
+		Pages.Reset();
+		for (uint32 Offset : Tracker.GetTouchedOffsets())
+		{
+			CacheLines.Add(Offset / CacheLineSize);
+			Pages.Add(Offset / PageSize);
+		}
+
+		TotalCacheLines.Append(CacheLines);
+		TotalPages.Append(Pages);
+
+		Result.AvgNumCacheLines += CacheLines.Num();
+		Result.AvgNumPages += Pages.Num();
+		Result.MaxNumCacheLines = FMath::Max<uint32>(Result.MaxNumCacheLines, CacheLines.Num());
+		Result.MaxNumPages = FMath::Max<uint32>(Result.MaxNumPages, Pages.Num());
+		Result.bOverflowed |= Tracker.HasOverflowed();
+	}
+
+	Result.AvgNumCacheLines /= NumPoses;
+	Result.AvgNumPages /= NumPoses;
+	Result.TotalNumCacheLines = TotalCacheLines.Num();
+	Result.TotalNumPages = TotalPages.Num();
+
+	return Result;
+}
+
+static const TCHAR* TouchCSVHeader = TEXT("clip,compression_level,ideal_num_key_frames_per_segment,max_num_key_frames_per_segment,compressed_size,compressed_cache_lines,avg_cache_lines_per_pose,max_cache_lines_per_pose,total_cache_lines,avg_pages_per_pose,max_pages_per_pose,total_pages\n");
+
+static FString FormatTouchResultCSV(const FString& ClipName, const FACLTouchSettings& Settings, const FACLTouchResult& Result, uint32 CacheLineSize)
+{
+	return FString::Printf(TEXT("%s,%d,%u,%u,%u,%u,%f,%u,%u,%f,%u,%u\n"),
+		*ClipName, int32(Settings.CompressionLevel), Settings.IdealNumKeyFramesPerSegment, Settings.MaxNumKeyFramesPerSegment,
+		Result.CompressedSize, FMath::DivideAndRoundUp(Result.CompressedSize, CacheLineSize),
+		Result.AvgNumCacheLines, Result.MaxNumCacheLines, Result.TotalNumCacheLines,
+		Result.AvgNumPages, Result.MaxNumPages, Result.TotalNumPages);
+}
+#endif
+
+UACLCacheTouchCommandlet::UACLCacheTouchCommandlet(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = true;
+	LogToConsole = true;
+	ShowErrorCount = true;
+}
+
+int32 UACLCacheTouchCommandlet::Main(const FString& Params)
+{
+#if ACL_WITH_TOUCH_TRACKING
+	TArray<FString> Tokens;
+	TArray<FString> Switches;
+	TMap<FString, FString> ParamsMap;
+	UCommandlet::ParseCommandLine(*Params, Tokens, Switches, ParamsMap);
+
+	if (!ParamsMap.Contains(TEXT("input")))
+	{
+		UE_LOG(LogAnimationCompression, Error, TEXT("Missing commandlet argument: -input=<directory>"));
+		return 1;
+	}
+
+	const FString ACLRawDir = ParamsMap[TEXT("input")];
+	const int32 NumPoses = ParamsMap.Contains(TEXT("NumPoses")) ? FMath::Max(FCString::Atoi(*ParamsMap[TEXT("NumPoses")]), 1) : 64;
+	const uint32 CacheLineSize = ParamsMap.Contains(TEXT("CacheLineSize")) ? FMath::Max(FCString::Atoi(*ParamsMap[TEXT("CacheLineSize")]), 1) : 64;
+
+	TArray<FString> Levels;
+	(ParamsMap.Contains(TEXT("levels")) ? ParamsMap[TEXT("levels")] : FString(TEXT("1,2,3"))).ParseIntoArray(Levels, TEXT(","), true);
+
+	TArray<FString> Segments;
+	(ParamsMap.Contains(TEXT("segments")) ? ParamsMap[TEXT("segments")] : FString(TEXT("16:31"))).ParseIntoArray(Segments, TEXT(","), true);
+
+	TArray<FACLTouchSettings> AllSettings;
+	for (const FString& Level : Levels)
+	{
+		for (const FString& Segment : Segments)
+		{
+			FString Ideal;
+			FString Max;
+			if (!Segment.Split(TEXT(":"), &Ideal, &Max))
+			{
+				UE_LOG(LogAnimationCompression, Error, TEXT("Invalid segment size, expected <ideal:max>: %s"), *Segment);
+				return 1;
+			}
+
+			FACLTouchSettings Settings;
+			Settings.CompressionLevel = ACLCompressionLevel(FMath::Clamp(FCString::Atoi(*Level), int32(ACLCL_Lowest), int32(ACLCL_Highest)));
+			Settings.IdealNumKeyFramesPerSegment = FMath::Max(FCString::Atoi(*Ideal), 1);
+			Settings.MaxNumKeyFramesPerSegment = FMath::Max<uint32>(FCString::Atoi(*Max), Settings.IdealNumKeyFramesPerSegment);
+			AllSettings.Add(Settings);
+		}
+	}
+
+	FFileManagerGeneric FileManager;
+	TArray<FString> Files;
+	FileManager.FindFiles(Files, *ACLRawDir, TEXT(".acl.sjson"));
+	Files.Sort();
+
+	if (Files.Num() == 0)
+	{
+		UE_LOG(LogAnimationCompression, Error, TEXT("No ACL clips found in: %s"), *ACLRawDir);
+		return 1;
+	}
+
+	FString CSV = TouchCSVHeader;
+
+	// Per settings sums, to summarize every clip
+	TArray<double> SumAvgNumCacheLines;
+	TArray<double> SumAvgNumPages;
+	SumAvgNumCacheLines.SetNumZeroed(AllSettings.Num());
+	SumAvgNumPages.SetNumZeroed(AllSettings.Num());
+	int32 NumMeasuredClips = 0;
+
+	for (const FString& Filename : Files)
+	{
+		acl::track_array_qvvf Tracks;
+		const TCHAR* ErrorMsg = ReadACLClip(FileManager, FPaths::Combine(*ACLRawDir, *Filename), ACLAllocatorImpl, Tracks);
+		if (ErrorMsg != nullptr)
+		{
+			UE_LOG(LogAnimationCompression, Error, TEXT("%s: %s"), ErrorMsg, *Filename);
+			continue;
+		}
+
+		const FString ClipName = Filename.Replace(TEXT(".acl.sjson"), TEXT(""), ESearchCase::CaseSensitive);
+		UE_LOG(LogAnimationCompression, Display, TEXT("Measuring: %s"), *ClipName);
+
+		bool bAllCompressed = true;
+		for (int32 SettingsIndex = 0; SettingsIndex < AllSettings.Num(); ++SettingsIndex)
+		{
+			const FACLTouchSettings& TouchSettings = AllSettings[SettingsIndex];
+
+			acl::qvvf_transform_error_metric ErrorMetric;
+
+			acl::compression_settings Settings = acl::get_default_compression_settings();
+			Settings.level = GetCompressionLevel(TouchSettings.CompressionLevel);
+			Settings.segmenting.ideal_num_samples = TouchSettings.IdealNumKeyFramesPerSegment;
+			Settings.segmenting.max_num_samples = TouchSettings.MaxNumKeyFramesPerSegment;
+			Settings.error_metric = &ErrorMetric;
+
+			acl::output_stats Stats;
+			acl::compressed_tracks* CompressedTracks = nullptr;
+			const acl::error_result CompressionResult = acl::compress_track_list(ACLAllocatorImpl, Tracks, Settings, CompressedTracks, Stats);
+			if (CompressionResult.any())
+			{
+				UE_LOG(LogAnimationCompression, Warning, TEXT("Failed to compress [%s]: %s"), *ClipName, ANSI_TO_TCHAR(CompressionResult.c_str()));
+				bAllCompressed = false;
+				break;
+			}
+
+			const FACLTouchResult Result = MeasureTouches(*CompressedTracks, NumPoses, CacheLineSize);
+			ACLAllocatorImpl.deallocate(CompressedTracks, CompressedTracks->get_size());
+
+			if (Result.bOverflowed)
+			{
+				UE_LOG(LogAnimationCompression, Warning, TEXT("Too many reads to record for [%s], results are incomplete"), *ClipName);
+			}
+
+			UE_LOG(LogAnimationCompression, Display, TEXT("    Level=%d Segments=%u:%u -> %u bytes, %.1f cache lines (max %u) and %.1f pages (max %u) per pose, %u cache lines and %u pages in total"),
+				int32(TouchSettings.CompressionLevel), TouchSettings.IdealNumKeyFramesPerSegment, TouchSettings.MaxNumKeyFramesPerSegment, Result.CompressedSize,
+				Result.AvgNumCacheLines, Result.MaxNumCacheLines, Result.AvgNumPages, Result.MaxNumPages, Result.TotalNumCacheLines, Result.TotalNumPages);
+
+			CSV += FormatTouchResultCSV(ClipName, TouchSettings, Result, CacheLineSize);
+
+			SumAvgNumCacheLines[SettingsIndex] += Result.AvgNumCacheLines;
+			SumAvgNumPages[SettingsIndex] += Result.AvgNumPages;
+		}
+
+		if (bAllCompressed)
+		{
+			NumMeasuredClips++;
+		}
+	}
+
+	if (NumMeasuredClips != 0)
+	{
+		for (int32 SettingsIndex = 0; SettingsIndex < AllSettings.Num(); ++SettingsIndex)
+		{
+			const FACLTouchSettings& TouchSettings = AllSettings[SettingsIndex];
+			UE_LOG(LogAnimationCompression, Display, TEXT("Level=%d Segments=%u:%u -> %.1f cache lines and %.1f pages per pose on average over %d clips"),
+				int32(TouchSettings.CompressionLevel), TouchSettings.IdealNumKeyFramesPerSegment, TouchSettings.MaxNumKeyFramesPerSegment,
+				SumAvgNumCacheLines[SettingsIndex] / NumMeasuredClips, SumAvgNumPages[SettingsIndex] / NumMeasuredClips, NumMeasuredClips);
+		}
+	}
+
+	if (ParamsMap.Contains(TEXT("output")) && !FFileHelper::SaveStringToFile(CSV, *ParamsMap[TEXT("output")]))
+	{
+		UE_LOG(LogAnimationCompression, Error, TEXT("Failed to write the results: %s"), *ParamsMap[TEXT("output")]);
+		return 1;
+	}
+
+	return 0;
+#else
+	UE_LOG(LogAnimationCompression, Error, TEXT("Cache line touch tracking is only supported on Linux x64 in non-shipping builds"));
+	return 1;
+#endif
+}
@@ -0,0 +1,174 @@
+// Copyright 2020 Nicholas Frechette. All Rights Reserved.
+
+#include "ACLCommandletUtils.h"
+
+#include "Runtime/Core/Public/HAL/FileManagerGeneric.h"
+#include "Runtime/Engine/Classes/Animation/AnimSequence.h"
+#include "Runtime/Engine/Classes/Animation/Skeleton.h"
+#include "Runtime/Engine/Public/AnimationCompression.h"
+#include "FileHelpers.h"
+#include "ISourceControlModule.h"
+#include "SourceControlOperations.h"
+
+#include "ACLImpl.h"
+
+#include <acl/io/clip_reader.h>
+
+#include <rtm/quatf.h>
+#include <rtm/vector4f.h>
+
+const TCHAR* ReadACLClip(FFileManagerGeneric& FileManager, const FString& ACLClipPath, acl::iallocator& Allocator, acl::track_array_qvvf& OutTracks)
+{
+	FArchive* Reader = FileManager.CreateFileReader(*ACLClipPath);
+	const int64 Size = Reader->TotalSize();
+
+	// Allocate directly without a TArray to automatically manage the memory because some
+	// clips are larger than 2 GB
+	char* RawSJSONData = static_cast<char*>(GMalloc->Malloc(Size));
+
+	Reader->Serialize(RawSJSONData, Size);
+	Reader->Close();
+
+	acl::clip_reader ClipReader(Allocator, RawSJSONData, Size);
+
+	if (ClipReader.get_file_type() != acl::sjson_file_type::raw_clip)
+	{
+		GMalloc->Free(RawSJSONData);
+		return TEXT("SJSON file isn't a raw clip");
+	}
+
+	acl::sjson_raw_clip RawClip;
+	if (!ClipReader.read_raw_clip(RawClip))
+	{
+		GMalloc->Free(RawSJSONData);
+		return TEXT("Failed to read ACL raw clip from file");
+	}
+
+	OutTracks = MoveTemp(RawClip.track_list);
+
+	GMalloc->Free(RawSJSONData);
+	return nullptr;
+}
+
+void ConvertSkeleton(const acl::track_array_qvvf& Tracks, USkeleton* UE4Skeleton)
+{
+	// Not terribly clean, we cast away the 'const' to modify the skeleton
+	FReferenceSkeleton& RefSkeleton = const_cast<FReferenceSkeleton&>(UE4Skeleton->GetReferenceSkeleton());
+	FReferenceSkeletonModifier SkeletonModifier(RefSkeleton, UE4Skeleton);
+
+	const uint32 NumBones = Tracks.get_num_tracks();
+	for (uint32 BoneIndex = 0; BoneIndex < NumBones; ++BoneIndex)
+	{
+		const acl::track_qvvf& Track = Tracks[BoneIndex];
+		const acl::track_desc_transformf& Desc = Track.get_description();
+
+		const FString BoneName = ANSI_TO_TCHAR(Track.get_name().c_str());
+
+		FMeshBoneInfo UE4Bone;
+		UE4Bone.Name = FName(*BoneName);
+		UE4Bone.ParentIndex = Desc.parent_index == acl::k_invalid_track_index ? INDEX_NONE : Desc.parent_index;
+		UE4Bone.ExportName = BoneName;
+
+		SkeletonModifier.Add(UE4Bone, FTransform::Identity);
+	}
+
+	// When our modifier is destroyed here, it will rebuild the skeleton
+}
+
+void ConvertClip(const acl::track_array_qvvf& Tracks, UAnimSequence* UE4Clip, USkeleton* UE4Skeleton)
+{
+	const uint32 NumSamples = Tracks.get_num_samples_per_track();
+
+	UE4Clip->SequenceLength = FGenericPlatformMath::Max<float>(Tracks.get_duration(), MINIMUM_ANIMATION_LENGTH);
+	UE4Clip->SetRawNumberOfFrame(NumSamples);
+	UE4Clip->SetSkeleton(UE4Skeleton);
+
+	if (NumSamples != 0)
+	{
+		const uint32 NumBones = Tracks.get_num_tracks();
+		for (uint32 BoneIndex = 0; BoneIndex < NumBones; ++BoneIndex)
+		{
+			const acl::track_qvvf& Track = Tracks[BoneIndex];
+
+			FRawAnimSequenceTrack RawTrack;
+			RawTrack.PosKeys.Empty();
+			RawTrack.RotKeys.Empty();
+			RawTrack.ScaleKeys.Empty();
+
+			for (uint32 SampleIndex = 0; SampleIndex < NumSamples; ++SampleIndex)
+			{
+				const FQuat Rotation = QuatCast(rtm::quat_normalize(Track[SampleIndex].rotation));
+				RawTrack.RotKeys.Add(Rotation);
+			}
+
+			for (uint32 SampleIndex = 0; SampleIndex < NumSamples; ++SampleIndex)
+			{
+				const FVector Translation = VectorCast(Track[SampleIndex].translation);
+				RawTrack.PosKeys.Add(Translation);
+			}
+
+			for (uint32 SampleIndex = 0; SampleIndex < NumSamples; ++SampleIndex)
+			{
+				const FVector Scale = VectorCast(Track[SampleIndex].scale);
+				RawTrack.ScaleKeys.Add(Scale);
+			}
+
+			const FName BoneName(Track.get_name().c_str());
+			UE4Clip->AddNewRawTrack(BoneName, &RawTrack);
+		}
+	}
+
+	UE4Clip->MarkRawDataAsModified();
+	UE4Clip->PostProcessSequence();
+}
+
+bool SavePackagesWithSourceControl(const TArray<UPackage*>& Packages)
+{
+	bool bFailedToSave = false;
+
+	if (ISourceControlModule::Get().IsEnabled())
+	{
+		ISourceControlProvider& SourceControlProvider = ISourceControlModule::Get().GetProvider();
+
+		TArray<UPackage*> PackagesToSave;
+		for (UPackage* Package : Packages)
+		{
+			FSourceControlStatePtr SourceControlState = SourceControlProvider.GetState(Package, EStateCacheUsage::Use);
+			if (SourceControlState->IsCheckedOutOther())
+			{
+				UE_LOG(LogAnimationCompression, Warning, TEXT("Package %s is already checked out by someone, will not check out"), *SourceControlState->GetFilename());
+			}
+			else if (!SourceControlState->IsCurrent())
+			{
+				UE_LOG(LogAnimationCompression, Warning, TEXT("Package %s is not at head, will not check out"), *SourceControlState->GetFilename());
+			}
+			else if (SourceControlState->CanCheckout())
+			{
+				const ECommandResult::Type StatusResult = SourceControlProvider.Execute(ISourceControlOperation::Create<FCheckOut>(), Package);
+				if (StatusResult != ECommandResult::Succeeded)
+				{
+					UE_LOG(LogAnimationCompression, Log, TEXT("Package %s failed to check out"), *SourceControlState->GetFilename());
+					bFailedToSave = true;
+				}
+				else
+				{
+					PackagesToSave.Add(Package);
+				}
+			}
+			else if (!SourceControlState->IsSourceControlled() || SourceControlState->CanEdit())
+			{
+				PackagesToSave.Add(Package);
+			}
+		}
+
+		UEditorLoadingAndSavingUtils::SavePackages(PackagesToSave, true);
+		ISourceControlModule::Get().QueueStatusUpdate(PackagesToSave);
+	}
+	else
+	{
+		// No source control, just try to save what we have
+		UEditorLoadingAndSavingUtils::SavePackages(Packages, true);
+	}
+
+	return !bFailedToSave;
+}
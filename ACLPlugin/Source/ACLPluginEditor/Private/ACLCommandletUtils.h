@@ -0,0 +1,43 @@
+#pragma once
+
+// Copyright 2020 Nicholas Frechette. All Rights Reserved.
+
+#include "CoreMinimal.h"
+
+#include <sjson/writer.h>
+
+#include <acl/compression/track_array.h>
+
+class FFileManagerGeneric;
+class UAnimSequence;
+class UPackage;
+class USkeleton;
+
+/** Writes SJSON output into a UE4 archive. */
+class UE4SJSONStreamWriter final : public sjson::StreamWriter
+{
+public:
+	UE4SJSONStreamWriter(FArchive* File_)
+		: File(File_)
+	{}
+
+	virtual void write(const void* Buffer, size_t BufferSize) override
+	{
+		File->Serialize(const_cast<void*>(Buffer), BufferSize);
+	}
+
+private:
+	FArchive* File;
+};
+
+/** Reads a raw ACL SJSON clip from disk. Returns an error message on failure and nullptr on success. */
+const TCHAR* ReadACLClip(FFileManagerGeneric& FileManager, const FString& ACLClipPath, acl::iallocator& Allocator, acl::track_array_qvvf& OutTracks);
+
+/** Populates a UE4 skeleton from the hierarchy of the ACL tracks. */
+void ConvertSkeleton(const acl::track_array_qvvf& Tracks, USkeleton* UE4Skeleton);
+
+/** Populates the raw data of a UE4 anim sequence from the ACL tracks. */
+void ConvertClip(const acl::track_array_qvvf& Tracks, UAnimSequence* UE4Clip, USkeleton* UE4Skeleton);
+
+/** Saves the provided packages, checking them out first when source control is enabled. Returns whether or not every package could be checked out. */
+bool SavePackagesWithSourceControl(const TArray<UPackage*>& Packages);
@@ -1,15 +1,13 @@
 // Copyright 2021 Nicholas Frechette. All Rights Reserved.
 
 #include "ACLDatabaseBuildCommandlet.h"
+#include "ACLCommandletUtils.h"
 
 #include "AnimationCompressionLibraryDatabase.h"
 
 #include "AnimationCompression.h"
 #include "AnimationUtils.h"
 #include "AssetRegistryModule.h"
-#include "FileHelpers.h"
-#include "ISourceControlModule.h"
-#include "SourceControlOperations.h"
 
 
 //////////////////////////////////////////////////////////////////////////
@@ -117,52 +115,5 @@ int32 UACLDatabaseBuildCommandlet::Main(const FString& Params)
 		}
 	}
 
-	bool bFailedToSave = false;
-	{
-		if (ISourceControlModule::Get().IsEnabled())
-		{
-			ISourceControlProvider& SourceControlProvider = ISourceControlModule::Get().GetProvider();
-
-			TArray<UPackage*> PackagesToSave;
-			for (UPackage* Package : DirtyDatabasePackages)
-			{
-				FSourceControlStatePtr SourceControlState = SourceControlProvider.GetState(Package, EStateCacheUsage::Use);
-				if (SourceControlState->IsCheckedOutOther())
-				{
-					UE_LOG(LogAnimationCompression, Warning, TEXT("Package %s is already checked out by someone, will not check out"), *SourceControlState->GetFilename());
-				}
-				else if (!SourceControlState->IsCurrent())
-				{
-					UE_LOG(LogAnimationCompression, Warning, TEXT("Package %s is not at head, will not check out"), *SourceControlState->GetFilename());
-				}
-				else if (SourceControlState->CanCheckout())
-				{
-					const ECommandResult::Type StatusResult = SourceControlProvider.Execute(ISourceControlOperation::Create<FCheckOut>(), Package);
-					if (StatusResult != ECommandResult::Succeeded)
-					{
-						UE_LOG(LogAnimationCompression, Log, TEXT("Package %s failed to check out"), *SourceControlState->GetFilename());
-						bFailedToSave = true;
-					}
-					else
-					{
-						PackagesToSave.Add(Package);
-					}
-				}
-				else if (!SourceControlState->IsSourceControlled() || SourceControlState->CanEdit())
-				{
-					PackagesToSave.Add(Package);
-				}
-			}
-
-			UEditorLoadingAndSavingUtils::SavePackages(PackagesToSave, true);
-			ISourceControlModule::Get().QueueStatusUpdate(PackagesToSave);
-		}
-		else
-		{
-			// No source control, just try to save what we have
-			UEditorLoadingAndSavingUtils::SavePackages(DirtyDatabasePackages, true);
-		}
-	}
-
-	return bFailedToSave ? 1 : 0;
+	return SavePackagesWithSourceControl(DirtyDatabasePackages) ? 0 : 1;
 }
@@ -0,0 +1,471 @@
+// Copyright 2020 Nicholas Frechette. All Rights Reserved.
+
+#include "ACLMemoryBudgetCommandlet.h"
+#include "ACLCommandletUtils.h"
+
+#include "AnimBoneCompressionCodec_ACLBase.h"
+#include "AnimBoneCompressionCodec_ACLSafe.h"
+#include "ACLImpl.h"
+
+#include "AnimationCompression.h"
+#include "AnimationUtils.h"
+#include "AssetRegistryModule.h"
+#include "Async/ParallelFor.h"
+
+#include <acl/compression/compress.h>
+#include <acl/compression/track_error.h>
+#include <acl/compression/transform_error_metrics.h>
+#include <acl/decompression/decompress.h>
+
+//////////////////////////////////////////////////////////////////////////
+// Commandlet example inspired by: https://github.com/ue4plugins/CommandletPlugin
+// To run the commandlet, add to the commandline: "$(SolutionDir)$(ProjectName).uproject" -run=/Script/ACLPluginEditor.ACLMemoryBudget -BudgetMB=<size>
+
+//////////////////////////////////////////////////////////////////////////
+
+/** The measured size and error of an anim sequence for every candidate error threshold. */
+struct FACLSequenceCandidates
+{
+	UAnimSequence* AnimSeq = nullptr;
+	UAnimBoneCompressionCodec_ACLBase* Codec = nullptr;
+
+	TArray<float> Thresholds;
+	TArray<uint32> Sizes;
+	TArray<float> Errors;
+	TArray<bool> IsValid;
+
+	/** The candidate matching the error threshold the sequence currently compresses with. */
+	int32 CurrentCandidate = INDEX_NONE;
+
+	/** The candidate selected to fit the budget. */
+	int32 SelectedCandidate = INDEX_NONE;
+};
+
+/**
+ * Measures the compressed size and error of an anim sequence with every candidate error threshold.
+ * The codec compression settings, virtual vertex distances, and resampling are honored. Optimization targets are not.
+ */
+static void MeasureSequenceCandidates(FACLSequenceCandidates& Sequence)
+{
+	const UAnimBoneCompressionCodec_ACLBase* Codec = Sequence.Codec;
+	const FCompressibleAnimData CompressibleAnimData(Sequence.AnimSeq, false);
+
+	const float DefaultVirtualVertexDistance = Codec->GetDefaultVirtualVertexDistanceForPlatform();
+	const float SafeVirtualVertexDistance = Codec->GetSafeVirtualVertexDistanceForPlatform();
+
+	const acl::track_array_qvvf RawTracks = BuildACLTransformTrackArray(ACLAllocatorImpl, CompressibleAnimData, DefaultVirtualVertexDistance, SafeVirtualVertexDistance, false);
+
+	acl::track_array_qvvf BaseTracks;
+	if (CompressibleAnimData.bIsValidAdditive)
+	{
+		BaseTracks = BuildACLTransformTrackArray(ACLAllocatorImpl, CompressibleAnimData, DefaultVirtualVertexDistance, SafeVirtualVertexDistance, true);
+	}
+
+	const bool bResample = Codec->MaxSampleRate > 0.0f && RawTracks.get_num_samples_per_track() > 1 && RawTracks.get_sample_rate() > Codec->MaxSampleRate;
+	const bool bIsSafeCodec = Codec->IsA<UAnimBoneCompressionCodec_ACLSafe>();
+
+	const int32 NumCandidates = Sequence.Thresholds.Num();
+	Sequence.Sizes.SetNumZeroed(NumCandidates);
+	Sequence.Errors.SetNumZeroed(NumCandidates);
+	Sequence.IsValid.SetNumZeroed(NumCandidates);
+
+	// Every candidate is independent, compress them in parallel
+	ParallelFor(NumCandidates, [&](int32 CandidateIndex)
+		{
+			const float Threshold = Sequence.Thresholds[CandidateIndex];
+
+			acl::track_array_qvvf Tracks(ACLAllocatorImpl, RawTracks.get_num_tracks());
+			for (uint32 TrackIndex = 0; TrackIndex < RawTracks.get_num_tracks(); ++TrackIndex)
+			{
+				acl::track_qvvf Track = RawTracks[TrackIndex].get_copy(ACLAllocatorImpl);
+				Track.get_description().precision = Threshold;
+
+				if (bIsSafeCodec)
+				{
+					// Disable constant rotation track detection
+					Track.get_description().constant_rotation_threshold_angle = 0.0f;
+				}
+
+				Tracks[TrackIndex] = MoveTemp(Track);
+			}
+
+			acl::compression_settings Settings;
+			Codec->GetCompressionSettings(Settings);
+
+			acl::qvvf_transform_error_metric DefaultErrorMetric;
+			acl::additive_qvvf_transform_error_metric<acl::additive_clip_format8::additive1> AdditiveErrorMetric;
+			if (!BaseTracks.is_empty())
+			{
+				Settings.error_metric = &AdditiveErrorMetric;
+			}
+			else
+			{
+				Settings.error_metric = &DefaultErrorMetric;
+			}
+
+			const acl::additive_clip_format8 AdditiveFormat = acl::additive_clip_format8::additive0;
+
+			acl::output_stats Stats;
+			acl::compressed_tracks* CompressedTracks = nullptr;
+			acl::error_result CompressionResult;
+			acl::track_error TrackError;
+
+			// Same as the codec, we resample unless it exceeds our error threshold
+			if (bResample)
+			{
+				acl::track_array_qvvf ResampledTracks = ResampleACLTransformTrackArray(ACLAllocatorImpl, Tracks, Codec->MaxSampleRate);
+
+				acl::track_array_qvvf ResampledBaseTracks;
+				if (!BaseTracks.is_empty())
+					ResampledBaseTracks = ResampleACLTransformTrackArray(ACLAllocatorImpl, BaseTracks, Codec->MaxSampleRate);
+
+				CompressionResult = acl::compress_track_list(ACLAllocatorImpl, ResampledTracks, Settings, ResampledBaseTracks, AdditiveFormat, CompressedTracks, Stats);
+				if (CompressionResult.empty())
+				{
+					acl::decompression_context<UE4DebugDBDecompressionSettings> Context;
+					Context.initialize(*CompressedTracks);
+
+					TrackError = acl::calculate_compression_error(ACLAllocatorImpl, Tracks, Context, *Settings.error_metric, BaseTracks);
+					if (TrackError.error > Threshold)
+					{
+						ACLAllocatorImpl.deallocate(CompressedTracks, CompressedTracks->get_size());
+						CompressedTracks = nullptr;
+					}
+				}
+			}
+
+			if (CompressedTracks == nullptr)
+			{
+				CompressionResult = acl::compress_track_list(ACLAllocatorImpl, Tracks, Settings, BaseTracks, AdditiveFormat, CompressedTracks, Stats);
+				if (CompressionResult.empty())
+				{
+					acl::decompression_context<UE4DebugDBDecompressionSettings> Context;
+					Context.initialize(*CompressedTracks);
+
+					TrackError = acl::calculate_compression_error(ACLAllocatorImpl, Tracks, Context, *Settings.error_metric, BaseTracks);
+				}
+			}
+
+			if (!CompressionResult.empty())
+			{
+				UE_LOG(LogAnimationCompression, Warning, TEXT("Failed to compress [%s] with an error threshold of %.4f cm: %s"), *Sequence.AnimSeq->GetPathName(), Threshold, ANSI_TO_TCHAR(CompressionResult.c_str()));
+				return;
+			}
+
+			Sequence.Sizes[CandidateIndex] = CompressedTracks->get_size();
+			Sequence.Errors[CandidateIndex] = TrackError.error;
+			Sequence.IsValid[CandidateIndex] = true;
+
+			ACLAllocatorImpl.deallocate(CompressedTracks, CompressedTracks->get_size());
+		});
+}
+
+/** Returns the smallest candidate whose error doesn't exceed the provided error, INDEX_NONE if there are none. */
+static int32 FindSmallestCandidate(const FACLSequenceCandidates& Sequence, float MaxError)
+{
+	int32 BestCandidate = INDEX_NONE;
+	for (int32 CandidateIndex = 0; CandidateIndex < Sequence.Thresholds.Num(); ++CandidateIndex)
+	{
+		if (!Sequence.IsValid[CandidateIndex] || Sequence.Errors[CandidateIndex] > MaxError)
+		{
+			continue;
+		}
+
+		if (BestCandidate == INDEX_NONE || Sequence.Sizes[CandidateIndex] < Sequence.Sizes[BestCandidate])
+		{
+			BestCandidate = CandidateIndex;
+		}
+	}
+
+	return BestCandidate;
+}
+
+/** Selects the smallest candidate of every sequence whose error doesn't exceed the provided error. Returns the total size or MAX_uint64 if a sequence cannot reach that error. */
+static uint64 SelectSmallestCandidates(TArray<FACLSequenceCandidates>& Sequences, float MaxError)
+{
+	uint64 TotalSize = 0;
+	for (FACLSequenceCandidates& Sequence : Sequences)
+	{
+		Sequence.SelectedCandidate = FindSmallestCandidate(Sequence, MaxError);
+		if (Sequence.SelectedCandidate == INDEX_NONE)
+		{
+			return MAX_uint64;
+		}
+
+		TotalSize += Sequence.Sizes[Sequence.SelectedCandidate];
+	}
+
+	return TotalSize;
+}
+
+/**
+ * Selects a candidate for every sequence such that the total size fits the budget while minimizing the worst error.
+ * The total size at a given worst error is monotonic, we binary search the lowest measured error that fits.
+ * Whatever budget remains is then spent to reduce the error of the least accurate sequences.
+ * Returns the total size of the selection.
+ */
+static uint64 SolveMemoryBudget(TArray<FACLSequenceCandidates>& Sequences, uint64 Budget)
+{
+	TArray<float> MeasuredErrors;
+	for (const FACLSequenceCandidates& Sequence : Sequences)
+	{
+		for (int32 CandidateIndex = 0; CandidateIndex < Sequence.Thresholds.Num(); ++CandidateIndex)
+		{
+			if (Sequence.IsValid[CandidateIndex])
+			{
+				MeasuredErrors.AddUnique(Sequence.Errors[CandidateIndex]);
+			}
+		}
+	}
+
+	MeasuredErrors.Sort();
+
+	int32 LowIndex = 0;
+	int32 HighIndex = MeasuredErrors.Num() - 1;
+	if (SelectSmallestCandidates(Sequences, MeasuredErrors[HighIndex]) > Budget)
+	{
+		UE_LOG(LogAnimationCompression, Warning, TEXT("The memory budget cannot be met with the provided error thresholds, using the smallest candidates"));
+		return SelectSmallestCandidates(Sequences, MeasuredErrors[HighIndex]);
+	}
+
+	while (LowIndex < HighIndex)
+	{
+		const int32 MidIndex = (LowIndex + HighIndex) / 2;
+		if (SelectSmallestCandidates(Sequences, MeasuredErrors[MidIndex]) <= Budget)
+		{
+			HighIndex = MidIndex;
+		}
+		else
+		{
+			LowIndex = MidIndex + 1;
+		}
+	}
+
+	uint64 TotalSize = SelectSmallestCandidates(Sequences, MeasuredErrors[HighIndex]);
+
+	// Spend what remains of our budget on the least accurate sequences first
+	TArray<FACLSequenceCandidates*> SortedSequences;
+	for (FACLSequenceCandidates& Sequence : Sequences)
+	{
+		SortedSequences.Add(&Sequence);
+	}
+
+	SortedSequences.Sort([](const FACLSequenceCandidates& Lhs, const FACLSequenceCandidates& Rhs) { return Lhs.Errors[Lhs.SelectedCandidate] > Rhs.Errors[Rhs.SelectedCandidate]; });
+
+	for (FACLSequenceCandidates* Sequence : SortedSequences)
+	{
+		const uint32 SelectedSize = Sequence->Sizes[Sequence->SelectedCandidate];
+		float BestError = Sequence->Errors[Sequence->SelectedCandidate];
+
+		for (int32 CandidateIndex = 0; CandidateIndex < Sequence->Thresholds.Num(); ++CandidateIndex)
+		{
+			if (!Sequence->IsValid[CandidateIndex] || Sequence->Errors[CandidateIndex] >= BestError)
+			{
+				continue;
+			}
+
+			const uint64 NewTotalSize = TotalSize - SelectedSize + Sequence->Sizes[CandidateIndex];
+			if (NewTotalSize <= Budget)
+			{
+				Sequence->SelectedCandidate = CandidateIndex;
+				BestError = Sequence->Errors[CandidateIndex];
+			}
+		}
+
+		TotalSize = TotalSize - SelectedSize + Sequence->Sizes[Sequence->SelectedCandidate];
+	}
+
+	return TotalSize;
+}
+
+UACLMemoryBudgetCommandlet::UACLMemoryBudgetCommandlet(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = true;
+	LogToConsole = true;
+	ShowErrorCount = true;
+}
+
+int32 UACLMemoryBudgetCommandlet::Main(const FString& Params)
+{
+	TArray<FString> Tokens;
+	TArray<FString> Switches;
+	TMap<FString, FString> ParamsMap;
+	UCommandlet::ParseCommandLine(*Params, Tokens, Switches, ParamsMap);
+
+	if (!ParamsMap.Contains(TEXT("BudgetMB")))
+	{
+		UE_LOG(LogAnimationCompression, Error, TEXT("Missing commandlet argument: -BudgetMB=<size>"));
+		return 1;
+	}
+
+	const uint64 Budget = uint64(FMath::Max(FCString::Atod(*ParamsMap[TEXT("BudgetMB")]), 0.0) * 1024.0 * 1024.0);
+	const bool bDryRun = Switches.Contains(TEXT("dryrun"));
+
+	TArray<float> Thresholds;
+	{
+		const FString* ThresholdsParam = ParamsMap.Find(TEXT("thresholds"));
+
+		TArray<FString> ThresholdValues;
+		(ThresholdsParam != nullptr ? *ThresholdsParam : FString(TEXT("0.001,0.0025,0.005,0.01,0.025,0.05,0.1,0.25,0.5,1.0"))).ParseIntoArray(ThresholdValues, TEXT(","), true);
+
+		for (const FString& Value : ThresholdValues)
+		{
+			Thresholds.AddUnique(FMath::Max(FCString::Atof(*Value), 0.0f));
+		}
+	}
+
+	if (Thresholds.Num() == 0)
+	{
+		UE_LOG(LogAnimationCompression, Error, TEXT("No error thresholds to consider"));
+		return 1;
+	}
+
+	const FAssetRegistryModule& AssetRegistryModule = FModuleManager::LoadModuleChecked<FAssetRegistryModule>(TEXT("AssetRegistry"));
+
+	TArray<FAssetData> AnimSequenceAssets;
+	{
+		UE_LOG(LogAnimationCompression, Log, TEXT("Retrieving all animation sequences from current project ..."));
+
+		FARFilter AnimSequenceFilter;
+		AnimSequenceFilter.ClassNames.Add(UAnimSequence::StaticClass()->GetFName());
+		AssetRegistryModule.Get().GetAssets(AnimSequenceFilter, AnimSequenceAssets);
+	}
+
+	TArray<FACLSequenceCandidates> Sequences;
+	{
+		UE_LOG(LogAnimationCompression, Log, TEXT("Loading %u animation sequences ..."), AnimSequenceAssets.Num());
+		for (const FAssetData& Asset : AnimSequenceAssets)
+		{
+			UAnimSequence* AnimSeq = Cast<UAnimSequence>(Asset.GetAsset());
+			if (AnimSeq == nullptr)
+			{
+				UE_LOG(LogAnimationCompression, Log, TEXT("Failed to load animation sequence: %s"), *Asset.PackagePath.ToString());
+				continue;
+			}
+
+			// Make sure all our required dependencies are loaded
+			FAnimationUtils::EnsureAnimSequenceLoaded(*AnimSeq);
+
+			UAnimBoneCompressionCodec_ACLBase* Codec = Cast<UAnimBoneCompressionCodec_ACLBase>(AnimSeq->CompressedData.BoneCompressionCodec);
+			if (Codec == nullptr)
+			{
+				continue;	// Not compressed with ACL
+			}
+
+			FACLSequenceCandidates Sequence;
+			Sequence.AnimSeq = AnimSeq;
+			Sequence.Codec = Codec;
+			Sequence.Thresholds = Thresholds;
+
+			// Always measure the threshold we currently use
+			FCompressibleAnimData CompressibleAnimData(AnimSeq, false);
+			const float CurrentThreshold = Codec->GetErrorThresholdForSequence(CompressibleAnimData);
+			Sequence.CurrentCandidate = Sequence.Thresholds.AddUnique(CurrentThreshold);
+
+			Sequences.Add(MoveTemp(Sequence));
+		}
+	}
+
+	if (Sequences.Num() == 0)
+	{
+		UE_LOG(LogAnimationCompression, Log, TEXT("Failed to find any ACL animation sequences, done"));
+		return 0;
+	}
+
+	uint64 CurrentTotalSize = 0;
+	float CurrentMaxError = 0.0f;
+	{
+		UE_LOG(LogAnimationCompression, Log, TEXT("Measuring %u animation sequences with %u error thresholds ..."), Sequences.Num(), Thresholds.Num());
+		for (FACLSequenceCandidates& Sequence : Sequences)
+		{
+			MeasureSequenceCandidates(Sequence);
+
+			if (!Sequence.IsValid[Sequence.CurrentCandidate])
+			{
+				UE_LOG(LogAnimationCompression, Warning, TEXT("Failed to measure [%s], it will retain its error threshold"), *Sequence.AnimSeq->GetPathName());
+			}
+
+			CurrentTotalSize += Sequence.Sizes[Sequence.CurrentCandidate];
+			CurrentMaxError = FMath::Max(CurrentMaxError, Sequence.Errors[Sequence.CurrentCandidate]);
+		}
+	}
+
+	// Sequences we cannot measure retain their current threshold and size
+	uint64 UnmeasuredSize = 0;
+	TArray<FACLSequenceCandidates> MeasuredSequences;
+	for (FACLSequenceCandidates& Sequence : Sequences)
+	{
+		if (Sequence.IsValid[Sequence.CurrentCandidate])
+		{
+			MeasuredSequences.Add(MoveTemp(Sequence));
+		}
+		else
+		{
+			UnmeasuredSize += Sequence.Sizes[Sequence.CurrentCandidate];
+		}
+	}
+
+	if (MeasuredSequences.Num() == 0)
+	{
+		UE_LOG(LogAnimationCompression, Error, TEXT("Failed to measure any ACL animation sequence"));
+		return 1;
+	}
+
+	const uint64 MeasuredBudget = Budget > UnmeasuredSize ? Budget - UnmeasuredSize : 0;
+	const uint64 NewTotalSize = SolveMemoryBudget(MeasuredSequences, MeasuredBudget) + UnmeasuredSize;
+
+	float NewMaxError = 0.0f;
+	for (const FACLSequenceCandidates& Sequence : MeasuredSequences)
+	{
+		NewMaxError = FMath::Max(NewMaxError, Sequence.Errors[Sequence.SelectedCandidate]);
+	}
+
+	UE_LOG(LogAnimationCompression, Log, TEXT("Budget: %.2f MB"), double(Budget) / (1024.0 * 1024.0));
+	UE_LOG(LogAnimationCompression, Log, TEXT("Current: %.2f MB, worst error %.4f cm"), double(CurrentTotalSize) / (1024.0 * 1024.0), CurrentMaxError);
+	UE_LOG(LogAnimationCompression, Log, TEXT("Optimized: %.2f MB, worst error %.4f cm"), double(NewTotalSize) / (1024.0 * 1024.0), NewMaxError);
+
+	// Update the error threshold scale of every sequence, it is relative to the threshold of its codec for the current platform
+	TArray<UPackage*> DirtyPackages;
+	for (const FACLSequenceCandidates& Sequence : MeasuredSequences)
+	{
+		UAnimSequence* AnimSeq = Sequence.AnimSeq;
+		const float SelectedThreshold = Sequence.Thresholds[Sequence.SelectedCandidate];
+
+		UE_LOG(LogAnimationCompression, Verbose, TEXT("    %s: %.4f cm -> %u bytes, %.4f cm error"), *AnimSeq->GetPathName(), SelectedThreshold, Sequence.Sizes[Sequence.SelectedCandidate], Sequence.Errors[Sequence.SelectedCandidate]);
+
+		if (Sequence.SelectedCandidate == Sequence.CurrentCandidate)
+		{
+			continue;	// Unchanged
+		}
+
+		const float PlatformThreshold = Sequence.Codec->GetErrorThresholdForPlatform();
+		if (PlatformThreshold <= 0.0f)
+		{
+			UE_LOG(LogAnimationCompression, Warning, TEXT("The codec of [%s] has an error threshold of zero, it cannot be scaled and the sequence will retain its error threshold"), *AnimSeq->GetPathName());
+			continue;
+		}
+
+		if (bDryRun)
+		{
+			continue;
+		}
+
+		// The scale is part of the sequence DDC key, only this sequence recompresses
+		AnimSeq->Modify();
+		AnimSeq->CompressionErrorThresholdScale = SelectedThreshold / PlatformThreshold;
+		AnimSeq->RequestAsyncAnimRecompression();
+
+		DirtyPackages.AddUnique(AnimSeq->GetOutermost());
+	}
+
+	if (bDryRun || DirtyPackages.Num() == 0)
+	{
+		return 0;
+	}
+
+	UE_LOG(LogAnimationCompression, Log, TEXT("Saving %u modified packages ..."), DirtyPackages.Num());
+	return SavePackagesWithSourceControl(DirtyPackages) ? 0 : 1;
+}
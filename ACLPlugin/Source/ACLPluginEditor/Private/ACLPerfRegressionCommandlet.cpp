@@ -0,0 +1,762 @@
+// Copyright 2020 Nicholas Frechette. All Rights Reserved.
+
+#include "ACLPerfRegressionCommandlet.h"
+#include "ACLCommandletUtils.h"
+
+#include "Runtime/Core/Public/HAL/FileManagerGeneric.h"
+#include "Runtime/Core/Public/HAL/PlatformProcess.h"
+#include "Runtime/Core/Public/HAL/PlatformTime.h"
+#include "Runtime/Core/Public/Math/RandomStream.h"
+#include "Runtime/Core/Public/Misc/FileHelper.h"
+#include "Runtime/Core/Public/Misc/Paths.h"
+#include "Runtime/Engine/Classes/Animation/AnimBoneCompressionSettings.h"
+#include "Runtime/Engine/Classes/Animation/AnimSequence.h"
+#include "Runtime/Engine/Classes/Animation/Skeleton.h"
+#include "Runtime/Engine/Public/AnimationCompression.h"
+
+#include "AnimBoneCompressionCodec_ACL.h"
+#include "AnimBoneCompressionCodec_ACLCustom.h"
+#include "AnimBoneCompressionCodec_ACLDatabase.h"
+#include "AnimBoneCompressionCodec_ACLSafe.h"
+#include "AnimationCompressionLibraryDatabase.h"
+#include "ACLImpl.h"
+
+#include <sjson/parser.h>
+#include <sjson/writer.h>
+
+#include <acl/compression/track_array.h>
+#include <acl/compression/track_error.h>
+#include <acl/compression/transform_error_metrics.h>
+#include <acl/core/string.h>
+#include <acl/decompression/decompress.h>
+
+#include <rtm/quatf.h>
+#include <rtm/qvvf.h>
+#include <rtm/scalarf.h>
+#include <rtm/vector4f.h>
+
+//////////////////////////////////////////////////////////////////////////
+// Commandlet example inspired by: https://github.com/ue4plugins/CommandletPlugin
+// To run the commandlet, add to the commandline: "$(SolutionDir)$(ProjectName).uproject" -run=/Script/ACLPluginEditor.ACLPerfRegression "-baseline=<path/to/baseline.sjson>" -nullrhi -unattended
+//
+// Usage:
+//		-baseline=<file>: The SJSON baseline to compare against or to update
+//		-input=<directory>: If present all *acl.sjson files will be added to the synthetic clip corpus
+//		-output=<file>: If present the results of this run will be written at the given path
+//		-updatebaseline: Overwrites the baseline and the speed baseline with the results of this run
+//		-SpeedBaseline=<file>: The SJSON baseline of the timings of this machine (default Saved/ACLPerfRegression/<machine>_speed_baseline.sjson)
+//		-NoSpeed: Skips the timing comparison
+//		-SizeTolerance=<percent>: How much the compressed size can grow before it is a regression (default 1%)
+//		-ErrorTolerance=<percent>: How much the max error can grow before it is a regression (default 5%)
+//		-SpeedTolerance=<percent>: How much decompression and the database build can slow down before it is a regression (default 25%)
+//		-NumPoses=<count>: How many poses are decompressed per clip when measuring the decompression speed (default 1000)
+//////////////////////////////////////////////////////////////////////////
+
+/** The baseline file format version. Bump it when metrics are no longer comparable with older baselines. */
+static constexpr uint32 PerfBaselineVersion = 1;
+
+/** The number of times we time the decompression of a clip, we retain the fastest run to filter out scheduling noise. */
+static constexpr int32 NumDecompressionTimingPasses = 5;
+
+/** Below this absolute error (in centimeters), max error changes are considered noise. */
+static constexpr double MaxErrorAbsoluteSlack = 0.0001;
+
+enum class EACLPerfCodec : uint8
+{
+	Default,
+	Safe,
+	Custom,
+	Database,
+
+	Count
+};
+
+static const TCHAR* GetCodecName(EACLPerfCodec Codec)
+{
+	switch (Codec)
+	{
+	case EACLPerfCodec::Default:
+		return TEXT("default");
+	case EACLPerfCodec::Safe:
+		return TEXT("safe");
+	case EACLPerfCodec::Custom:
+		return TEXT("custom");
+	case EACLPerfCodec::Database:
+		return TEXT("database");
+	default:
+		return TEXT("unknown");
+	}
+}
+
+/** The metrics tracked for a clip and codec pair or for the database. Negative values are not measured. */
+struct FACLPerfMetrics
+{
+	FString Name;
+
+	double CompressedSize = -1.0;
+	double BulkDataSize = -1.0;
+	double MaxError = -1.0;
+	double DecompressionNsPerPose = -1.0;
+	double BuildTimeMs = -1.0;
+};
+
+/** The tolerances used when comparing against the baseline, in percent. */
+struct FACLPerfTolerances
+{
+	double Size = 1.0;
+	double Error = 5.0;
+	double Speed = 25.0;
+
+	/** Timings are only comparable on the machine that produced them, they are compared against a speed baseline local to the machine. */
+	bool bCompareSpeed = true;
+};
+
+/** Describes a synthetic clip from our corpus. They are generated from a fixed seed and are identical from run to run. */
+struct FACLSyntheticClipDesc
+{
+	const char* Name;
+	uint32 NumBones;
+	uint32 NumSamples;
+	float SampleRate;
+	bool bIsStatic;
+	bool bHasAnimatedScale;
+};
+
+static const FACLSyntheticClipDesc SyntheticClips[] =
+{
+	{ "synthetic_locomotion",	64,	61,		30.0f,	false,	false },
+	{ "synthetic_static",		64,	31,		30.0f,	true,	false },
+	{ "synthetic_scale",		32,	61,		30.0f,	false,	true },
+	{ "synthetic_long",			32,	1801,	30.0f,	false,	false },
+};
+
+static acl::track_array_qvvf MakeSyntheticClip(const FACLSyntheticClipDesc& ClipDesc)
+{
+	FRandomStream RandomStream(int32(ClipDesc.NumBones * 7919 + ClipDesc.NumSamples));
+
+	acl::track_array_qvvf Tracks(ACLAllocatorImpl, ClipDesc.NumBones);
+
+	for (uint32 BoneIndex = 0; BoneIndex < ClipDesc.NumBones; ++BoneIndex)
+	{
+		// Chains of 8 bones parented to the root
+		acl::track_desc_transformf Desc;
+		Desc.output_index = BoneIndex;
+		Desc.parent_index = BoneIndex == 0 ? acl::k_invalid_track_index : ((BoneIndex % 8) == 1 ? 0 : BoneIndex - 1);
+		Desc.precision = 0.01f;
+		Desc.shell_distance = 3.0f;
+
+		acl::track_qvvf Track = acl::track_qvvf::make_reserve(Desc, ACLAllocatorImpl, ClipDesc.NumSamples, ClipDesc.SampleRate);
+
+		const FString BoneName = FString::Printf(TEXT("bone_%u"), BoneIndex);
+		Track.set_name(acl::string(ACLAllocatorImpl, TCHAR_TO_ANSI(*BoneName)));
+
+		const FVector Axis = RandomStream.GetUnitVector();
+		const float BaseAngle = RandomStream.FRandRange(-PI, PI);
+		const float Amplitude = RandomStream.FRandRange(0.05f, 1.0f);
+		const float Frequency = RandomStream.FRandRange(0.25f, 2.0f);
+		const float Phase = RandomStream.FRandRange(0.0f, 2.0f * PI);
+		const float BoneLength = BoneIndex == 0 ? 0.0f : RandomStream.FRandRange(5.0f, 20.0f);
+
+		for (uint32 SampleIndex = 0; SampleIndex < ClipDesc.NumSamples; ++SampleIndex)
+		{
+			const float SampleTime = float(SampleIndex) / ClipDesc.SampleRate;
+			const float Wave = ClipDesc.bIsStatic ? 0.0f : rtm::scalar_sin(2.0f * PI * Frequency * SampleTime + Phase);
+
+			const rtm::quatf Rotation = rtm::quat_from_axis_angle(VectorCast(Axis), BaseAngle + Amplitude * Wave);
+
+			rtm::vector4f Translation = rtm::vector_set(0.0f, BoneLength, 0.0f);
+			if (BoneIndex == 0 && !ClipDesc.bIsStatic)
+			{
+				// The root moves forward while bobbing up and down
+				Translation = rtm::vector_set(150.0f * SampleTime, 0.0f, 90.0f + 2.0f * Wave);
+			}
+
+			rtm::vector4f Scale = rtm::vector_set(1.0f);
+			if (ClipDesc.bHasAnimatedScale)
+			{
+				Scale = rtm::vector_set(1.0f + 0.2f * Wave, 1.0f - 0.1f * Wave, 1.0f + 0.05f * Wave);
+			}
+
+			Track[SampleIndex] = rtm::qvv_set(Rotation, Translation, Scale);
+		}
+
+		Tracks[BoneIndex] = MoveTemp(Track);
+	}
+
+	return Tracks;
+}
+
+struct FACLPerfPoseWriter final : public acl::track_writer
+{
+	TArray<rtm::qvvf>& Pose;
+
+	explicit FACLPerfPoseWriter(TArray<rtm::qvvf>& Pose_) : Pose(Pose_) {}
+
+	void RTM_SIMD_CALL write_rotation(uint32_t TrackIndex, rtm::quatf_arg0 Rotation) { Pose[TrackIndex].rotation = Rotation; }
+	void RTM_SIMD_CALL write_translation(uint32_t TrackIndex, rtm::vector4f_arg0 Translation) { Pose[TrackIndex].translation = Translation; }
+	void RTM_SIMD_CALL write_scale(uint32_t TrackIndex, rtm::vector4f_arg0 Scale) { Pose[TrackIndex].scale = Scale; }
+};
+
+template<class DecompressionSettingsType>
+static double MeasureDecompressionNsPerPose(const acl::compressed_tracks& CompressedTracks, int32 NumPoses)
+{
+	acl::decompression_context<DecompressionSettingsType> Context;
+	Context.initialize(CompressedTracks);
+
+	TArray<rtm::qvvf> Pose;
+	Pose.SetNumUninitialized(CompressedTracks.get_num_tracks());
+	FACLPerfPoseWriter Writer(Pose);
+
+	const float Duration = CompressedTracks.get_duration();
+
+	double BestNsPerPose = TNumericLimits<double>::Max();
+	for (int32 PassIndex = 0; PassIndex < NumDecompressionTimingPasses; ++PassIndex)
+	{
+		const uint64 StartTimeCycles = FPlatformTime::Cycles64();
+
+		for (int32 PoseIndex = 0; PoseIndex < NumPoses; ++PoseIndex)
+		{
+			Context.seek((Duration * PoseIndex) / NumPoses, acl::sample_rounding_policy::none);
+			Context.decompress_tracks(Writer);
+		}
+
+		const uint64 ElapsedCycles = FPlatformTime::Cycles64() - StartTimeCycles;
+		BestNsPerPose = FMath::Min(BestNsPerPose, (FPlatformTime::ToSeconds64(ElapsedCycles) * 1.0e9) / NumPoses);
+	}
+
+	return BestNsPerPose;
+}
+
+static double MeasureDecompressionNsPerPose(EACLPerfCodec Codec, const acl::compressed_tracks& CompressedTracks, int32 NumPoses)
+{
+	// Use the same decompression settings as the codecs do at runtime
+	switch (Codec)
+	{
+	case EACLPerfCodec::Safe:
+		return MeasureDecompressionNsPerPose<UE4SafeDecompressionSettings>(CompressedTracks, NumPoses);
+	case EACLPerfCodec::Custom:
+		return MeasureDecompressionNsPerPose<UE4CustomDecompressionSettings>(CompressedTracks, NumPoses);
+	default:
+		return MeasureDecompressionNsPerPose<UE4DefaultDecompressionSettings>(CompressedTracks, NumPoses);
+	}
+}
+
+static double MeasureMaxError(const acl::track_array_qvvf& Tracks, const acl::compressed_tracks& CompressedTracks)
+{
+	const acl::qvvf_transform_error_metric ErrorMetric;
+
+	acl::decompression_context<acl::debug_transform_decompression_settings> Context;
+	Context.initialize(CompressedTracks);
+
+	const acl::track_error TrackError = acl::calculate_compression_error(ACLAllocatorImpl, Tracks, Context, ErrorMetric);
+	return TrackError.error;
+}
+
+static const acl::compressed_tracks* GetCompressedTracks(const UAnimSequence& UE4Clip)
+{
+	const ICompressedAnimData* AnimData = UE4Clip.CompressedData.CompressedDataStructure.Get();
+	if (AnimData == nullptr || !AnimData->IsValid())
+	{
+		return nullptr;
+	}
+
+	// With the database codec, the compressed sequence data doesn't live in the compressed byte stream
+	if (UE4Clip.CompressedData.BoneCompressionCodec->IsA<UAnimBoneCompressionCodec_ACLDatabase>())
+	{
+		return static_cast<const FACLDatabaseCompressedAnimData*>(AnimData)->GetCompressedTracks();
+	}
+
+	return static_cast<const FACLCompressedAnimData*>(AnimData)->GetCompressedTracks();
+}
+
+static bool CompressClip(UAnimSequence* UE4Clip, UAnimBoneCompressionSettings* Settings)
+{
+	// Force recompression and avoid the DDC
+	TGuardValue<int32> CompressGuard(UE4Clip->CompressCommandletVersion, INDEX_NONE);
+
+	UE4Clip->BoneCompressionSettings = Settings;
+	UE4Clip->RequestSyncAnimRecompression();
+
+	return UE4Clip->IsCompressedDataValid();
+}
+
+static bool WritePerfMetrics(const FString& Path, const TArray<FACLPerfMetrics>& AllMetrics, bool bWriteTimings)
+{
+	FArchive* File = IFileManager::Get().CreateFileWriter(*Path);
+	if (File == nullptr)
+	{
+		return false;
+	}
+
+	{
+		UE4SJSONStreamWriter StreamWriter(File);
+		sjson::Writer Writer(StreamWriter);
+
+		Writer["version"] = PerfBaselineVersion;
+		Writer["entries"] = [&](sjson::ArrayWriter& Writer)
+		{
+			for (const FACLPerfMetrics& Metrics : AllMetrics)
+			{
+				Writer.push([&](sjson::ObjectWriter& Writer)
+					{
+						Writer["name"] = TCHAR_TO_ANSI(*Metrics.Name);
+
+						if (Metrics.CompressedSize >= 0.0)
+						{
+							Writer["compressed_size"] = Metrics.CompressedSize;
+						}
+
+						if (Metrics.BulkDataSize >= 0.0)
+						{
+							Writer["bulk_data_size"] = Metrics.BulkDataSize;
+						}
+
+						if (Metrics.MaxError >= 0.0)
+						{
+							Writer["max_error"] = Metrics.MaxError;
+						}
+
+						if (bWriteTimings && Metrics.DecompressionNsPerPose >= 0.0)
+						{
+							Writer["decompression_ns_per_pose"] = Metrics.DecompressionNsPerPose;
+						}
+
+						if (bWriteTimings && Metrics.BuildTimeMs >= 0.0)
+						{
+							Writer["build_time_ms"] = Metrics.BuildTimeMs;
+						}
+					});
+			}
+		};
+	}
+
+	File->Close();
+	delete File;
+	return true;
+}
+
+static const TCHAR* ReadPerfMetrics(const FString& Path, TArray<FACLPerfMetrics>& OutAllMetrics)
+{
+	TArray<uint8> RawSJSONData;
+	if (!FFileHelper::LoadFileToArray(RawSJSONData, *Path))
+	{
+		return TEXT("Failed to read the baseline file");
+	}
+
+	sjson::Parser Parser(reinterpret_cast<const char*>(RawSJSONData.GetData()), RawSJSONData.Num());
+
+	double Version = 0.0;
+	if (!Parser.read("version", Version))
+	{
+		return TEXT("Baseline file is missing its version");
+	}
+
+	if (uint32(Version) != PerfBaselineVersion)
+	{
+		return TEXT("Baseline file version is no longer supported, it must be updated");
+	}
+
+	if (!Parser.array_begins("entries"))
+	{
+		return TEXT("Baseline file is missing its entries");
+	}
+
+	while (!Parser.try_array_ends())
+	{
+		if (!Parser.object_begins())
+		{
+			return TEXT("Baseline file entry is malformed");
+		}
+
+		sjson::StringView Name;
+		if (!Parser.read("name", Name))
+		{
+			return TEXT("Baseline file entry is missing its name");
+		}
+
+		FACLPerfMetrics Metrics;
+		Metrics.Name = FString(int32(Name.size()), Name.c_str());
+		Parser.try_read("compressed_size", Metrics.CompressedSize, -1.0);
+		Parser.try_read("bulk_data_size", Metrics.BulkDataSize, -1.0);
+		Parser.try_read("max_error", Metrics.MaxError, -1.0);
+		Parser.try_read("decompression_ns_per_pose", Metrics.DecompressionNsPerPose, -1.0);
+		Parser.try_read("build_time_ms", Metrics.BuildTimeMs, -1.0);
+
+		if (!Parser.object_ends())
+		{
+			return TEXT("Baseline file entry is malformed");
+		}
+
+		OutAllMetrics.Add(MoveTemp(Metrics));
+	}
+
+	if (!Parser.is_valid() || !Parser.remainder_is_comments_and_whitespace())
+	{
+		return TEXT("Baseline file is malformed");
+	}
+
+	return nullptr;
+}
+
+/** Compares a single metric against its baseline value. Returns true if it regressed. */
+static bool CompareMetric(const FString& EntryName, const TCHAR* MetricName, double Current, double Baseline, double TolerancePercent, double AbsoluteSlack)
+{
+	if (Current < 0.0 || Baseline < 0.0)
+	{
+		return false;	// Not measured
+	}
+
+	const double UpperBound = Baseline * (1.0 + TolerancePercent / 100.0) + AbsoluteSlack;
+	const double LowerBound = Baseline * (1.0 - TolerancePercent / 100.0) - AbsoluteSlack;
+	const double DeltaPercent = Baseline > 0.0 ? ((Current - Baseline) / Baseline) * 100.0 : 0.0;
+
+	if (Current > UpperBound)
+	{
+		UE_LOG(LogAnimationCompression, Error, TEXT("Regression: [%s] %s went from %.4f to %.4f (%+.2f%%, tolerance %.2f%%)"), *EntryName, MetricName, Baseline, Current, DeltaPercent, TolerancePercent);
+		return true;
+	}
+
+	if (Current < LowerBound)
+	{
+		UE_LOG(LogAnimationCompression, Display, TEXT("Improvement: [%s] %s went from %.4f to %.4f (%+.2f%%), consider updating the baseline"), *EntryName, MetricName, Baseline, Current, DeltaPercent);
+	}
+
+	return false;
+}
+
+/** Compares every metric against the baseline and the timings against the speed baseline when provided. Returns the number of regressions found. */
+static int32 CompareAgainstBaseline(const TArray<FACLPerfMetrics>& AllMetrics, const TArray<FACLPerfMetrics>& BaselineMetrics, const TArray<FACLPerfMetrics>* SpeedBaselineMetrics, const FACLPerfTolerances& Tolerances)
+{
+	int32 NumRegressions = 0;
+
+	for (const FACLPerfMetrics& Metrics : AllMetrics)
+	{
+		const FACLPerfMetrics* Baseline = BaselineMetrics.FindByPredicate([&Metrics](const FACLPerfMetrics& Entry) { return Entry.Name == Metrics.Name; });
+		if (Baseline == nullptr)
+		{
+			// A missing entry would otherwise go unchecked, the baseline must be updated
+			UE_LOG(LogAnimationCompression, Error, TEXT("[%s] isn't present in the baseline, it must be updated"), *Metrics.Name);
+			NumRegressions++;
+			continue;
+		}
+
+		NumRegressions += CompareMetric(Metrics.Name, TEXT("compressed size"), Metrics.CompressedSize, Baseline->CompressedSize, Tolerances.Size, 0.0) ? 1 : 0;
+		NumRegressions += CompareMetric(Metrics.Name, TEXT("bulk data size"), Metrics.BulkDataSize, Baseline->BulkDataSize, Tolerances.Size, 0.0) ? 1 : 0;
+		NumRegressions += CompareMetric(Metrics.Name, TEXT("max error"), Metrics.MaxError, Baseline->MaxError, Tolerances.Error, MaxErrorAbsoluteSlack) ? 1 : 0;
+
+		if (SpeedBaselineMetrics == nullptr)
+		{
+			continue;
+		}
+
+		const FACLPerfMetrics* SpeedBaseline = SpeedBaselineMetrics->FindByPredicate([&Metrics](const FACLPerfMetrics& Entry) { return Entry.Name == Metrics.Name; });
+		if (SpeedBaseline == nullptr)
+		{
+			UE_LOG(LogAnimationCompression, Error, TEXT("[%s] isn't present in the speed baseline, it must be updated"), *Metrics.Name);
+			NumRegressions++;
+			continue;
+		}
+
+		NumRegressions += CompareMetric(Metrics.Name, TEXT("decompression ns/pose"), Metrics.DecompressionNsPerPose, SpeedBaseline->DecompressionNsPerPose, Tolerances.Speed, 0.0) ? 1 : 0;
+		NumRegressions += CompareMetric(Metrics.Name, TEXT("build time ms"), Metrics.BuildTimeMs, SpeedBaseline->BuildTimeMs, Tolerances.Speed, 0.0) ? 1 : 0;
+	}
+
+	for (const FACLPerfMetrics& Baseline : BaselineMetrics)
+	{
+		if (!AllMetrics.ContainsByPredicate([&Baseline](const FACLPerfMetrics& Entry) { return Entry.Name == Baseline.Name; }))
+		{
+			UE_LOG(LogAnimationCompression, Warning, TEXT("[%s] is present in the baseline but wasn't measured"), *Baseline.Name);
+		}
+	}
+
+	return NumRegressions;
+}
+
+UACLPerfRegressionCommandlet::UACLPerfRegressionCommandlet(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = true;
+	LogToConsole = true;
+	ShowErrorCount = true;
+}
+
+int32 UACLPerfRegressionCommandlet::Main(const FString& Params)
+{
+	TArray<FString> Tokens;
+	TArray<FString> Switches;
+	TMap<FString, FString> ParamsMap;
+	UCommandlet::ParseCommandLine(*Params, Tokens, Switches, ParamsMap);
+
+	if (!ParamsMap.Contains(TEXT("baseline")))
+	{
+		UE_LOG(LogAnimationCompression, Error, TEXT("Missing commandlet argument: -baseline=<path/to/baseline.sjson>"));
+		return 1;
+	}
+
+	const FString BaselinePath = ParamsMap[TEXT("baseline")];
+	const bool bUpdateBaseline = Switches.Contains(TEXT("updatebaseline"));
+
+	FACLPerfTolerances Tolerances;
+	if (ParamsMap.Contains(TEXT("SizeTolerance")))
+	{
+		Tolerances.Size = FCString::Atod(*ParamsMap[TEXT("SizeTolerance")]);
+	}
+
+	if (ParamsMap.Contains(TEXT("ErrorTolerance")))
+	{
+		Tolerances.Error = FCString::Atod(*ParamsMap[TEXT("ErrorTolerance")]);
+	}
+
+	if (ParamsMap.Contains(TEXT("SpeedTolerance")))
+	{
+		Tolerances.Speed = FCString::Atod(*ParamsMap[TEXT("SpeedTolerance")]);
+	}
+
+	Tolerances.bCompareSpeed = !Switches.Contains(TEXT("NoSpeed"));
+
+	// Timings live in a baseline of their own that never leaves the machine that produced it
+	const FString SpeedBaselinePath = ParamsMap.Contains(TEXT("SpeedBaseline")) ? ParamsMap[TEXT("SpeedBaseline")]
+		: FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("ACLPerfRegression"), FString::Printf(TEXT("%s_speed_baseline.sjson"), FPlatformProcess::ComputerName()));
+
+	const int32 NumPoses = ParamsMap.Contains(TEXT("NumPoses")) ? FMath::Max(FCString::Atoi(*ParamsMap[TEXT("NumPoses")]), 1) : 1000;
+
+	TArray<FACLPerfMetrics> BaselineMetrics;
+	TArray<FACLPerfMetrics> SpeedBaselineMetrics;
+	bool bCreateSpeedBaseline = false;
+	if (!bUpdateBaseline)
+	{
+		const TCHAR* ErrorMsg = ReadPerfMetrics(BaselinePath, BaselineMetrics);
+		if (ErrorMsg != nullptr)
+		{
+			UE_LOG(LogAnimationCompression, Error, TEXT("%s: %s (run with -updatebaseline to create it)"), ErrorMsg, *BaselinePath);
+			return 1;
+		}
+
+		if (Tolerances.bCompareSpeed)
+		{
+			if (!FPaths::FileExists(SpeedBaselinePath))
+			{
+				// The first run on a machine records its timings, they are compared from the next run onward
+				UE_LOG(LogAnimationCompression, Warning, TEXT("No speed baseline for this machine, timings will be written to %s and compared from the next run"), *SpeedBaselinePath);
+				bCreateSpeedBaseline = true;
+			}
+			else
+			{
+				ErrorMsg = ReadPerfMetrics(SpeedBaselinePath, SpeedBaselineMetrics);
+				if (ErrorMsg != nullptr)
+				{
+					UE_LOG(LogAnimationCompression, Error, TEXT("%s: %s (run with -updatebaseline to update it)"), ErrorMsg, *SpeedBaselinePath);
+					return 1;
+				}
+			}
+		}
+	}
+
+	// Gather our corpus, synthetic clips first followed by the sample clips sorted by name
+	TArray<FString> ClipNames;
+	TArray<acl::track_array_qvvf> ClipTracks;
+
+	for (const FACLSyntheticClipDesc& ClipDesc : SyntheticClips)
+	{
+		ClipNames.Add(ANSI_TO_TCHAR(ClipDesc.Name));
+		ClipTracks.Add(MakeSyntheticClip(ClipDesc));
+	}
+
+	FFileManagerGeneric FileManager;
+	if (ParamsMap.Contains(TEXT("input")))
+	{
+		const FString ACLRawDir = ParamsMap[TEXT("input")];
+
+		TArray<FString> Files;
+		FileManager.FindFiles(Files, *ACLRawDir, TEXT(".acl.sjson"));
+		Files.Sort();
+
+		for (const FString& Filename : Files)
+		{
+			acl::track_array_qvvf Tracks;
+			const TCHAR* ErrorMsg = ReadACLClip(FileManager, FPaths::Combine(*ACLRawDir, *Filename), ACLAllocatorImpl, Tracks);
+			if (ErrorMsg != nullptr)
+			{
+				UE_LOG(LogAnimationCompression, Error, TEXT("%s: %s"), ErrorMsg, *Filename);
+				return 1;
+			}
+
+			ClipNames.Add(Filename.Replace(TEXT(".acl.sjson"), TEXT(""), ESearchCase::CaseSensitive));
+			ClipTracks.Add(MoveTemp(Tracks));
+		}
+	}
+
+#if ENGINE_MINOR_VERSION >= 26
+	UPackage* TempPackage = CreatePackage(TEXT("/Temp/ACLPerfRegression"));
+#else
+	UPackage* TempPackage = CreatePackage(nullptr, TEXT("/Temp/ACLPerfRegression"));
+#endif
+
+	UAnimationCompressionLibraryDatabase* DatabaseAsset = NewObject<UAnimationCompressionLibraryDatabase>(TempPackage, UAnimationCompressionLibraryDatabase::StaticClass());
+	DatabaseAsset->AddToRoot();
+
+	UAnimBoneCompressionSettings* CodecSettings[uint32(EACLPerfCodec::Count)];
+	for (uint32 CodecIndex = 0; CodecIndex < uint32(EACLPerfCodec::Count); ++CodecIndex)
+	{
+		UAnimBoneCompressionCodec* Codec = nullptr;
+		switch (EACLPerfCodec(CodecIndex))
+		{
+		case EACLPerfCodec::Default:
+			Codec = NewObject<UAnimBoneCompressionCodec_ACL>(this, UAnimBoneCompressionCodec_ACL::StaticClass());
+			break;
+		case EACLPerfCodec::Safe:
+			Codec = NewObject<UAnimBoneCompressionCodec_ACLSafe>(this, UAnimBoneCompressionCodec_ACLSafe::StaticClass());
+			break;
+		case EACLPerfCodec::Custom:
+			Codec = NewObject<UAnimBoneCompressionCodec_ACLCustom>(this, UAnimBoneCompressionCodec_ACLCustom::StaticClass());
+			break;
+		case EACLPerfCodec::Database:
+		{
+			UAnimBoneCompressionCodec_ACLDatabase* DatabaseCodec = NewObject<UAnimBoneCompressionCodec_ACLDatabase>(this, UAnimBoneCompressionCodec_ACLDatabase::StaticClass());
+			DatabaseCodec->DatabaseAsset = DatabaseAsset;
+			Codec = DatabaseCodec;
+			break;
+		}
+		default:
+			checkNoEntry();
+			break;
+		}
+
+		CodecSettings[CodecIndex] = NewObject<UAnimBoneCompressionSettings>(this, UAnimBoneCompressionSettings::StaticClass());
+		CodecSettings[CodecIndex]->Codecs.Add(Codec);
+		CodecSettings[CodecIndex]->AddToRoot();
+	}
+
+	TArray<FACLPerfMetrics> AllMetrics;
+	TArray<UAnimSequence*> DatabaseClips;
+	bool bAnyCompressionFailed = false;
+
+	for (int32 ClipIndex = 0; ClipIndex < ClipNames.Num(); ++ClipIndex)
+	{
+		const acl::track_array_qvvf& Tracks = ClipTracks[ClipIndex];
+
+		UE_LOG(LogAnimationCompression, Display, TEXT("Measuring: %s"), *ClipNames[ClipIndex]);
+
+		USkeleton* UE4Skeleton = NewObject<USkeleton>(TempPackage, USkeleton::StaticClass());
+		ConvertSkeleton(Tracks, UE4Skeleton);
+
+		UAnimSequence* UE4Clip = NewObject<UAnimSequence>(TempPackage, UAnimSequence::StaticClass());
+		ConvertClip(Tracks, UE4Clip, UE4Skeleton);
+
+		// Make sure any pending async compression that might have started during load or construction is done
+		UE4Clip->WaitOnExistingCompression();
+
+		// The database codec is last, the sequence remains compressed with it until we build the database
+		for (uint32 CodecIndex = 0; CodecIndex < uint32(EACLPerfCodec::Count); ++CodecIndex)
+		{
+			const EACLPerfCodec Codec = EACLPerfCodec(CodecIndex);
+
+			FACLPerfMetrics Metrics;
+			Metrics.Name = FString::Printf(TEXT("%s/%s"), *ClipNames[ClipIndex], GetCodecName(Codec));
+
+			const acl::compressed_tracks* CompressedTracks = CompressClip(UE4Clip, CodecSettings[CodecIndex]) ? GetCompressedTracks(*UE4Clip) : nullptr;
+			if (CompressedTracks == nullptr)
+			{
+				UE_LOG(LogAnimationCompression, Error, TEXT("Failed to compress [%s]"), *Metrics.Name);
+				bAnyCompressionFailed = true;
+				continue;
+			}
+
+			Metrics.CompressedSize = CompressedTracks->get_size();
+			Metrics.MaxError = MeasureMaxError(Tracks, *CompressedTracks);
+			Metrics.DecompressionNsPerPose = MeasureDecompressionNsPerPose(Codec, *CompressedTracks, NumPoses);
+
+			UE_LOG(LogAnimationCompression, Display, TEXT("    %s: %.0f bytes, %.4f cm, %.1f ns/pose"), GetCodecName(Codec), Metrics.CompressedSize, Metrics.MaxError, Metrics.DecompressionNsPerPose);
+			AllMetrics.Add(MoveTemp(Metrics));
+
+			if (Codec != EACLPerfCodec::Database)
+			{
+				// Reset our compressed data
+				UE4Clip->ClearCompressedBoneData();
+				UE4Clip->ClearCompressedCurveData();
+			}
+		}
+
+		DatabaseClips.Add(UE4Clip);
+	}
+
+	// Build the database with every sequence compressed with the database codec
+	DatabaseAsset->UpdateReferencingAnimSequenceList();
+
+	{
+		FACLPerfMetrics Metrics;
+		Metrics.Name = TEXT("database");
+
+		uint32 CompressedSize = 0;
+		uint32 BulkDataSize = 0;
+
+		const uint64 StartTimeCycles = FPlatformTime::Cycles64();
+		DatabaseAsset->CalculateBuiltSize(CompressedSize, BulkDataSize);
+		const uint64 ElapsedCycles = FPlatformTime::Cycles64() - StartTimeCycles;
+
+		Metrics.CompressedSize = CompressedSize;
+		Metrics.BulkDataSize = BulkDataSize;
+		Metrics.BuildTimeMs = FPlatformTime::ToMilliseconds64(ElapsedCycles);
+
+		UE_LOG(LogAnimationCompression, Display, TEXT("Database: %.0f bytes resident, %.0f bytes streamed, built in %.2f ms"), Metrics.CompressedSize, Metrics.BulkDataSize, Metrics.BuildTimeMs);
+		AllMetrics.Add(MoveTemp(Metrics));
+	}
+
+	for (UAnimSequence* UE4Clip : DatabaseClips)
+	{
+		UE4Clip->RecycleAnimSequence();
+	}
+
+	for (UAnimBoneCompressionSettings* Settings : CodecSettings)
+	{
+		Settings->RemoveFromRoot();
+	}
+
+	DatabaseAsset->RemoveFromRoot();
+
+	if (ParamsMap.Contains(TEXT("output")) && !WritePerfMetrics(ParamsMap[TEXT("output")], AllMetrics, true))
+	{
+		UE_LOG(LogAnimationCompression, Error, TEXT("Failed to write the results: %s"), *ParamsMap[TEXT("output")]);
+		return 1;
+	}
+
+	if (bAnyCompressionFailed)
+	{
+		return 1;
+	}
+
+	if (bUpdateBaseline || bCreateSpeedBaseline)
+	{
+		// The shared baseline only holds the deterministic metrics, timings are only written to the speed baseline of this machine
+		if (bUpdateBaseline && !WritePerfMetrics(BaselinePath, AllMetrics, false))
+		{
+			UE_LOG(LogAnimationCompression, Error, TEXT("Failed to write the baseline: %s"), *BaselinePath);
+			return 1;
+		}
+
+		if (Tolerances.bCompareSpeed && !WritePerfMetrics(SpeedBaselinePath, AllMetrics, true))
+		{
+			UE_LOG(LogAnimationCompression, Error, TEXT("Failed to write the speed baseline: %s"), *SpeedBaselinePath);
+			return 1;
+		}
+
+		if (bUpdateBaseline)
+		{
+			UE_LOG(LogAnimationCompression, Display, TEXT("Updated the baseline: %s"), *BaselinePath);
+			return 0;
+		}
+	}
+
+	const bool bCompareSpeed = Tolerances.bCompareSpeed && !bCreateSpeedBaseline;
+	const int32 NumRegressions = CompareAgainstBaseline(AllMetrics, BaselineMetrics, bCompareSpeed ? &SpeedBaselineMetrics : nullptr, Tolerances);
+	if (NumRegressions != 0)
+	{
+		UE_LOG(LogAnimationCompression, Error, TEXT("Found %d performance regressions against the baseline: %s"), NumRegressions, *BaselinePath);
+		return 1;
+	}
+
+	UE_LOG(LogAnimationCompression, Display, TEXT("No performance regressions found against the baseline: %s"), *BaselinePath);
+	return 0;
+}
@@ -0,0 +1,158 @@
+// Copyright 2020 Nicholas Frechette. All Rights Reserved.
+
+#include "ACLSharedDataCommandlet.h"
+
+#include "AnimationCompressionLibraryDatabase.h"
+#include "AnimBoneCompressionCodec_ACLBase.h"
+#include "AnimBoneCompressionCodec_ACLDatabase.h"
+#include "ACLImpl.h"
+#include "ACLSharedDataFile.h"
+
+#include "AnimationCompression.h"
+#include "AnimationUtils.h"
+#include "AssetRegistryModule.h"
+
+#include <acl/core/compressed_database.h>
+
+//////////////////////////////////////////////////////////////////////////
+// Commandlet example inspired by: https://github.com/ue4plugins/CommandletPlugin
+// To run the commandlet, add to the commandline: "$(SolutionDir)$(ProjectName).uproject" -run=/Script/ACLPluginEditor.ACLSharedData -output=<path> -TargetPlatform=<platform>
+
+//////////////////////////////////////////////////////////////////////////
+
+UACLSharedDataCommandlet::UACLSharedDataCommandlet(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = true;
+	LogToConsole = true;
+	ShowErrorCount = true;
+}
+
+int32 UACLSharedDataCommandlet::Main(const FString& Params)
+{
+	TArray<FString> Tokens;
+	TArray<FString> Switches;
+	TMap<FString, FString> ParamsMap;
+	UCommandlet::ParseCommandLine(*Params, Tokens, Switches, ParamsMap);
+
+	const FString* OutputPath = ParamsMap.Find(TEXT("output"));
+	if (OutputPath == nullptr || OutputPath->IsEmpty())
+	{
+		UE_LOG(LogAnimationCompression, Error, TEXT("Missing commandlet argument: -output=<path>"));
+		return 1;
+	}
+
+	const ITargetPlatform* TargetPlatform = GetCompressionTargetPlatform();
+	if (TargetPlatform == nullptr)
+	{
+		UE_LOG(LogAnimationCompression, Error, TEXT("A single target platform is required, use: -TargetPlatform=<platform>"));
+		return 1;
+	}
+
+	const FAssetRegistryModule& AssetRegistryModule = FModuleManager::LoadModuleChecked<FAssetRegistryModule>(TEXT("AssetRegistry"));
+
+	TArray<FAssetData> AnimSequenceAssets;
+	{
+		UE_LOG(LogAnimationCompression, Log, TEXT("Retrieving all animation sequences from current project ..."));
+
+		FARFilter AnimSequenceFilter;
+		AnimSequenceFilter.ClassNames.Add(UAnimSequence::StaticClass()->GetFName());
+		AssetRegistryModule.Get().GetAssets(AnimSequenceFilter, AnimSequenceAssets);
+	}
+
+	TArray<FAssetData> DatabaseAssets;
+	{
+		UE_LOG(LogAnimationCompression, Log, TEXT("Retrieving all ACL databases from current project ..."));
+
+		FARFilter DatabaseFilter;
+		DatabaseFilter.ClassNames.Add(UAnimationCompressionLibraryDatabase::StaticClass()->GetFName());
+		AssetRegistryModule.Get().GetAssets(DatabaseFilter, DatabaseAssets);
+	}
+
+	TArray<FACLSharedDataBlob> Blobs;
+
+	{
+		UE_LOG(LogAnimationCompression, Log, TEXT("Loading %u animation sequences ..."), AnimSequenceAssets.Num());
+		for (const FAssetData& Asset : AnimSequenceAssets)
+		{
+			UAnimSequence* AnimSeq = Cast<UAnimSequence>(Asset.GetAsset());
+			if (AnimSeq == nullptr)
+			{
+				UE_LOG(LogAnimationCompression, Log, TEXT("Failed to load animation sequence: %s"), *Asset.PackagePath.ToString());
+				continue;
+			}
+
+			// Make sure all our required dependencies are loaded
+			FAnimationUtils::EnsureAnimSequenceLoaded(*AnimSeq);
+
+			// Sequences that use a database bind to the database compressed data, they are shared with it
+			const UAnimBoneCompressionCodec* Codec = AnimSeq->CompressedData.BoneCompressionCodec;
+			if (Codec == nullptr || !Codec->IsA<UAnimBoneCompressionCodec_ACLBase>() || Codec->IsA<UAnimBoneCompressionCodec_ACLDatabase>())
+			{
+				continue;
+			}
+
+			const ICompressedAnimData* AnimData = AnimSeq->CompressedData.CompressedDataStructure.Get();
+			if (AnimData == nullptr)
+			{
+				continue;
+			}
+
+			const FACLCompressedAnimData& ACLAnimData = static_cast<const FACLCompressedAnimData&>(*AnimData);
+			const acl::compressed_tracks* CompressedClipData = ACLAnimData.GetCompressedTracks();
+			if (CompressedClipData == nullptr)
+			{
+				continue;
+			}
+
+			FACLSharedDataBlob Blob;
+			Blob.Hash = CompressedClipData->get_hash();
+			Blob.Bytes = ACLAnimData.CompressedByteStream;
+			Blobs.Add(Blob);
+		}
+	}
+
+	// Database blobs reference these buffers, they must remain alive until the file is written
+	TArray<TArray<uint8>> DatabaseCompressedBytes;
+	DatabaseCompressedBytes.SetNum(DatabaseAssets.Num());
+
+	{
+		UE_LOG(LogAnimationCompression, Log, TEXT("Building %u ACL databases ..."), DatabaseAssets.Num());
+		for (int32 DatabaseIndex = 0; DatabaseIndex < DatabaseAssets.Num(); ++DatabaseIndex)
+		{
+			const FAssetData& Asset = DatabaseAssets[DatabaseIndex];
+			UAnimationCompressionLibraryDatabase* Database = Cast<UAnimationCompressionLibraryDatabase>(Asset.GetAsset());
+			if (Database == nullptr)
+			{
+				UE_LOG(LogAnimationCompression, Log, TEXT("Failed to load ACL database: %s"), *Asset.PackagePath.ToString());
+				continue;
+			}
+
+			TArray<uint8>& CompressedBytes = DatabaseCompressedBytes[DatabaseIndex];
+			Database->BuildCookedCompressedBytes(TargetPlatform, CompressedBytes);
+
+			const acl::compressed_database* CompressedDatabase = CompressedBytes.Num() != 0 ? acl::make_compressed_database(CompressedBytes.GetData()) : nullptr;
+			if (CompressedDatabase == nullptr)
+			{
+				continue;
+			}
+
+			FACLSharedDataBlob Blob;
+			Blob.Hash = CompressedDatabase->get_hash();
+			Blob.Bytes = CompressedBytes;
+			Blobs.Add(Blob);
+		}
+	}
+
+	uint64 TotalSize = 0;
+	for (const FACLSharedDataBlob& Blob : Blobs)
+	{
+		TotalSize += Blob.Bytes.Num();
+	}
+
+	UE_LOG(LogAnimationCompression, Log, TEXT("Writing %d blobs (%.2f MB) for platform %s ..."), Blobs.Num(), double(TotalSize) / (1024.0 * 1024.0), *TargetPlatform->PlatformName());
+
+	return FACLSharedDataFile::WriteFile(*OutputPath, Blobs) ? 0 : 1;
+}
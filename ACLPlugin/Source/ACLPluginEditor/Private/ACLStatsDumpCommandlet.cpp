@@ -1,9 +1,12 @@
 // Copyright 2018 Nicholas Frechette. All Rights Reserved.
 
 #include "ACLStatsDumpCommandlet.h"
+#include "ACLCommandletUtils.h"
 
+#include "Runtime/Core/Public/Async/ParallelFor.h"
 #include "Runtime/Core/Public/HAL/FileManagerGeneric.h"
 #include "Runtime/Core/Public/HAL/PlatformTime.h"
+#include "Runtime/Core/Public/Misc/FileHelper.h"
 #include "Runtime/CoreUObject/Public/UObject/UObjectIterator.h"
 #include "Runtime/Engine/Classes/Animation/AnimBoneCompressionSettings.h"
 #include "Runtime/Engine/Classes/Animation/AnimCompress.h"
@@ -18,11 +21,13 @@
 #include <sjson/parser.h>
 #include <sjson/writer.h>
 
+#include <acl/compression/compress.h>
 #include <acl/compression/impl/track_list_context.h>	// For create_output_track_mapping(..)
 #include <acl/compression/track_array.h>
 #include <acl/compression/transform_error_metrics.h>
 #include <acl/compression/track_error.h>
 #include <acl/decompression/decompress.h>
+#include <acl/decompression/database/database.h>
 #include <acl/io/clip_reader.h>
 #include <acl/io/clip_writer.h>
 
@@ -44,129 +49,17 @@
 //		-noacl: Disables ACL compression
 //		-MasterTolerance=<tolerance>: The error threshold used by automatic compression
 //		-resume: If present, clip extraction or compression will continue where it left off
+//		-sweep: Commandlet will compress the input clips with every combination of the parameters below and output the Pareto frontier
+//		-SweepErrorThresholds=<a,b,...>: The error thresholds to sweep (default 0.001,0.01,0.05,0.1)
+//		-SweepVirtualVertexDistances=<a,b,...>: The default virtual vertex distances to sweep (default 1,3,10)
+//		-SweepSafeVirtualVertexDistances=<a,b,...>: The safe virtual vertex distances to sweep (default 100)
+//		-SweepLevels=<a,b,...>: The compression levels to sweep, from 0 (lowest) to 4 (highest) (default 1,2,3)
+//		-SweepSegments=<ideal:max,...>: The number of key frames per segment to sweep (default 16:31)
+//		-database: Commandlet will build a database from the input clips and output the size and error of every clip at every visual fidelity
+//		-DatabaseLowestProportions=<a,b,...>: The lowest importance tier proportions to build a database with (default 0.5)
+//		-DatabaseMediumProportion=<value>: The medium importance tier proportion (default 0.0)
 //////////////////////////////////////////////////////////////////////////
 
-class UE4SJSONStreamWriter final : public sjson::StreamWriter
-{
-public:
-	UE4SJSONStreamWriter(FArchive* File_)
-		: File(File_)
-	{}
-
-	virtual void write(const void* Buffer, size_t BufferSize) override
-	{
-		File->Serialize(const_cast<void*>(Buffer), BufferSize);
-	}
-
-private:
-	FArchive* File;
-};
-
-static const TCHAR* ReadACLClip(FFileManagerGeneric& FileManager, const FString& ACLClipPath, acl::iallocator& Allocator, acl::track_array_qvvf& OutTracks)
-{
-	FArchive* Reader = FileManager.CreateFileReader(*ACLClipPath);
-	const int64 Size = Reader->TotalSize();
-
-	// Allocate directly without a TArray to automatically manage the memory because some
-	// clips are larger than 2 GB
-	char* RawSJSONData = static_cast<char*>(GMalloc->Malloc(Size));
-
-	Reader->Serialize(RawSJSONData, Size);
-	Reader->Close();
-
-	acl::clip_reader ClipReader(Allocator, RawSJSONData, Size);
-
-	if (ClipReader.get_file_type() != acl::sjson_file_type::raw_clip)
-	{
-		GMalloc->Free(RawSJSONData);
-		return TEXT("SJSON file isn't a raw clip");
-	}
-
-	acl::sjson_raw_clip RawClip;
-	if (!ClipReader.read_raw_clip(RawClip))
-	{
-		GMalloc->Free(RawSJSONData);
-		return TEXT("Failed to read ACL raw clip from file");
-	}
-
-	OutTracks = MoveTemp(RawClip.track_list);
-
-	GMalloc->Free(RawSJSONData);
-	return nullptr;
-}
-
-static void ConvertSkeleton(const acl::track_array_qvvf& Tracks, USkeleton* UE4Skeleton)
-{
-	// Not terribly clean, we cast away the 'const' to modify the skeleton
-	FReferenceSkeleton& RefSkeleton = const_cast<FReferenceSkeleton&>(UE4Skeleton->GetReferenceSkeleton());
-	FReferenceSkeletonModifier SkeletonModifier(RefSkeleton, UE4Skeleton);
-
-	const uint32 NumBones = Tracks.get_num_tracks();
-	for (uint32 BoneIndex = 0; BoneIndex < NumBones; ++BoneIndex)
-	{
-		const acl::track_qvvf& Track = Tracks[BoneIndex];
-		const acl::track_desc_transformf& Desc = Track.get_description();
-
-		const FString BoneName = ANSI_TO_TCHAR(Track.get_name().c_str());
-
-		FMeshBoneInfo UE4Bone;
-		UE4Bone.Name = FName(*BoneName);
-		UE4Bone.ParentIndex = Desc.parent_index == acl::k_invalid_track_index ? INDEX_NONE : Desc.parent_index;
-		UE4Bone.ExportName = BoneName;
-
-		SkeletonModifier.Add(UE4Bone, FTransform::Identity);
-	}
-
-	// When our modifier is destroyed here, it will rebuild the skeleton
-}
-
-static void ConvertClip(const acl::track_array_qvvf& Tracks, UAnimSequence* UE4Clip, USkeleton* UE4Skeleton)
-{
-	const uint32 NumSamples = Tracks.get_num_samples_per_track();
-
-	UE4Clip->SequenceLength = FGenericPlatformMath::Max<float>(Tracks.get_duration(), MINIMUM_ANIMATION_LENGTH);
-	UE4Clip->SetRawNumberOfFrame(NumSamples);
-	UE4Clip->SetSkeleton(UE4Skeleton);
-
-	if (NumSamples != 0)
-	{
-		const uint32 NumBones = Tracks.get_num_tracks();
-		for (uint32 BoneIndex = 0; BoneIndex < NumBones; ++BoneIndex)
-		{
-			const acl::track_qvvf& Track = Tracks[BoneIndex];
-
-			FRawAnimSequenceTrack RawTrack;
-			RawTrack.PosKeys.Empty();
-			RawTrack.RotKeys.Empty();
-			RawTrack.ScaleKeys.Empty();
-
-			for (uint32 SampleIndex = 0; SampleIndex < NumSamples; ++SampleIndex)
-			{
-				const FQuat Rotation = QuatCast(rtm::quat_normalize(Track[SampleIndex].rotation));
-				RawTrack.RotKeys.Add(Rotation);
-			}
-
-			for (uint32 SampleIndex = 0; SampleIndex < NumSamples; ++SampleIndex)
-			{
-				const FVector Translation = VectorCast(Track[SampleIndex].translation);
-				RawTrack.PosKeys.Add(Translation);
-			}
-
-			for (uint32 SampleIndex = 0; SampleIndex < NumSamples; ++SampleIndex)
-			{
-				const FVector Scale = VectorCast(Track[SampleIndex].scale);
-				RawTrack.ScaleKeys.Add(Scale);
-			}
-
-			const FName BoneName(Track.get_name().c_str());
-			UE4Clip->AddNewRawTrack(BoneName, &RawTrack);
-		}
-	}
-
-	UE4Clip->MarkRawDataAsModified();
-	UE4Clip->PostProcessSequence();
-}
-
 static int32 GetAnimationTrackIndex(const int32 BoneIndex, const UAnimSequence* AnimSeq)
 {
 	if (BoneIndex == INDEX_NONE)
@@ -263,7 +156,7 @@ static void CalculateClipError(const acl::track_array_qvvf& Tracks, const UAnimS
 	UAnimBoneCompressionCodec_ACLBase* ACLCodec = Cast<UAnimBoneCompressionCodec_ACLBase>(UE4Clip->CompressedData.BoneCompressionCodec);
 	if (ACLCodec != nullptr)
 	{
-		const acl::compressed_tracks* CompressedClipData = acl::make_compressed_tracks(UE4Clip->CompressedData.CompressedByteStream.GetData());
+		const acl::compressed_tracks* CompressedClipData = static_cast<const FACLCompressedAnimData&>(*UE4Clip->CompressedData.CompressedDataStructure).GetCompressedTracks();
 
 		const acl::qvvf_transform_error_metric ErrorMetric;
 
@@ -429,7 +322,7 @@ static void DumpClipDetailedError(const acl::track_array_qvvf& Tracks, UAnimSequ
 
 		local_to_object_space_args_lossy.local_transforms = LossyRemappedLocalPoseTransforms.GetData();
 
-		const acl::compressed_tracks* CompressedClipData = acl::make_compressed_tracks(UE4Clip->CompressedData.CompressedByteStream.GetData());
+		const acl::compressed_tracks* CompressedClipData = static_cast<const FACLCompressedAnimData&>(*UE4Clip->CompressedData.CompressedDataStructure).GetCompressedTracks();
 
 		acl::decompression_context<acl::debug_transform_decompression_settings> Context;
 		Context.initialize(*CompressedClipData);
@@ -991,6 +884,755 @@ static void CompressWithUE4KeyReduction(FCompressionContext& Context, bool Perfo
 	}
 }
 
+//////////////////////////////////////////////////////////////////////////
+// Parameter sweep
+
+/** The number of poses we decompress when timing a sweep grid point, we retain the fastest of a few passes. */
+static constexpr int32 NumSweepDecompressionPoses = 100;
+static constexpr int32 NumSweepDecompressionPasses = 3;
+
+/** A set of compression parameters evaluated by the sweep. */
+struct FACLSweepParameters
+{
+	float ErrorThreshold;
+	float DefaultVirtualVertexDistance;
+	float SafeVirtualVertexDistance;
+	ACLCompressionLevel CompressionLevel;
+	uint16 IdealNumKeyFramesPerSegment;
+	uint16 MaxNumKeyFramesPerSegment;
+};
+
+/** The measurements of a set of compression parameters, for a single clip or for the whole project. */
+struct FACLSweepResult
+{
+	uint64 CompressedSize = 0;
+	float MaxError = 0.0f;
+	double CompressionTimeSec = 0.0;
+	double DecompressionNsPerPose = 0.0;
+	bool bIsValid = false;
+	bool bIsParetoOptimal = false;
+};
+
+/** The state of a parameter sweep, accumulated over every clip. */
+struct FACLParameterSweep
+{
+	/** Every combination of parameters we evaluate. */
+	TArray<FACLSweepParameters> Grid;
+
+	/** The project wide results for every grid point: sizes and times are summed, errors are the worst. */
+	TArray<FACLSweepResult> ProjectResults;
+
+	/** The per clip results, as CSV rows. */
+	FString ClipResultsCSV;
+
+	int32 NumClips = 0;
+};
+
+static const TCHAR* SweepCSVHeader = TEXT("clip,error_threshold,default_virtual_vertex_distance,safe_virtual_vertex_distance,compression_level,ideal_num_key_frames_per_segment,max_num_key_frames_per_segment,compressed_size,max_error,compression_time,decompression_ns_per_pose,is_pareto_optimal\n");
+
+static void ParseSweepValues(const TMap<FString, FString>& ParamsMap, const TCHAR* Name, const TCHAR* DefaultValues, TArray<FString>& OutValues)
+{
+	const FString* Values = ParamsMap.Find(Name);
+	(Values != nullptr ? *Values : FString(DefaultValues)).ParseIntoArray(OutValues, TEXT(","), true);
+}
+
+static void BuildSweepGrid(const TMap<FString, FString>& ParamsMap, FACLParameterSweep& Sweep)
+{
+	TArray<FString> ErrorThresholds;
+	TArray<FString> DefaultVirtualVertexDistances;
+	TArray<FString> SafeVirtualVertexDistances;
+	TArray<FString> CompressionLevels;
+	TArray<FString> SegmentSizes;
+	ParseSweepValues(ParamsMap, TEXT("SweepErrorThresholds"), TEXT("0.001,0.01,0.05,0.1"), ErrorThresholds);
+	ParseSweepValues(ParamsMap, TEXT("SweepVirtualVertexDistances"), TEXT("1,3,10"), DefaultVirtualVertexDistances);
+	ParseSweepValues(ParamsMap, TEXT("SweepSafeVirtualVertexDistances"), TEXT("100"), SafeVirtualVertexDistances);
+	ParseSweepValues(ParamsMap, TEXT("SweepLevels"), TEXT("1,2,3"), CompressionLevels);
+	ParseSweepValues(ParamsMap, TEXT("SweepSegments"), TEXT("16:31"), SegmentSizes);
+
+	for (const FString& ErrorThreshold : ErrorThresholds)
+	{
+		for (const FString& DefaultVirtualVertexDistance : DefaultVirtualVertexDistances)
+		{
+			for (const FString& SafeVirtualVertexDistance : SafeVirtualVertexDistances)
+			{
+				for (const FString& CompressionLevel : CompressionLevels)
+				{
+					for (const FString& SegmentSize : SegmentSizes)
+					{
+						// Segment sizes are specified as 'ideal:max'
+						FString IdealNumKeyFrames;
+						FString MaxNumKeyFrames;
+						if (!SegmentSize.Split(TEXT(":"), &IdealNumKeyFrames, &MaxNumKeyFrames))
+						{
+							IdealNumKeyFrames = SegmentSize;
+							MaxNumKeyFrames = FString::FromInt(FCString::Atoi(*SegmentSize) * 2 - 1);
+						}
+
+						FACLSweepParameters Parameters;
+						Parameters.ErrorThreshold = FMath::Max(FCString::Atof(*ErrorThreshold), 0.0f);
+						Parameters.DefaultVirtualVertexDistance = FMath::Max(FCString::Atof(*DefaultVirtualVertexDistance), 0.0f);
+						Parameters.SafeVirtualVertexDistance = FMath::Max(FCString::Atof(*SafeVirtualVertexDistance), 0.0f);
+						Parameters.CompressionLevel = ACLCompressionLevel(FMath::Clamp(FCString::Atoi(*CompressionLevel), int32(ACLCL_Lowest), int32(ACLCL_Highest)));
+						Parameters.IdealNumKeyFramesPerSegment = uint16(FMath::Clamp(FCString::Atoi(*IdealNumKeyFrames), 8, 0xFFFF));
+						Parameters.MaxNumKeyFramesPerSegment = uint16(FMath::Clamp(FCString::Atoi(*MaxNumKeyFrames), int32(Parameters.IdealNumKeyFramesPerSegment), 0xFFFF));
+						Sweep.Grid.Add(Parameters);
+					}
+				}
+			}
+		}
+	}
+
+	Sweep.ProjectResults.SetNum(Sweep.Grid.Num());
+	for (FACLSweepResult& Result : Sweep.ProjectResults)
+	{
+		Result.bIsValid = true;
+	}
+}
+
+/** Flags the results that are not dominated by another: no other result is both as small and as accurate while being strictly better at one of the two. */
+static void FindParetoFrontier(TArray<FACLSweepResult>& Results)
+{
+	for (FACLSweepResult& Candidate : Results)
+	{
+		Candidate.bIsParetoOptimal = Candidate.bIsValid;
+
+		for (const FACLSweepResult& Other : Results)
+		{
+			if (!Candidate.bIsParetoOptimal)
+			{
+				break;
+			}
+
+			if (!Other.bIsValid || &Other == &Candidate)
+			{
+				continue;
+			}
+
+			const bool bIsDominated = Other.CompressedSize <= Candidate.CompressedSize && Other.MaxError <= Candidate.MaxError
+				&& (Other.CompressedSize < Candidate.CompressedSize || Other.MaxError < Candidate.MaxError);
+			if (bIsDominated)
+			{
+				Candidate.bIsParetoOptimal = false;
+			}
+		}
+	}
+}
+
+static void WriteSweepResults(const FACLParameterSweep& Sweep, const TArray<FACLSweepResult>& Results, sjson::Writer& Writer)
+{
+	Writer["sweep"] = [&](sjson::ArrayWriter& Writer)
+	{
+		for (int32 PointIndex = 0; PointIndex < Results.Num(); ++PointIndex)
+		{
+			const FACLSweepParameters& Parameters = Sweep.Grid[PointIndex];
+			const FACLSweepResult& Result = Results[PointIndex];
+
+			Writer.push([&](sjson::ObjectWriter& Writer)
+				{
+					Writer["error_threshold"] = Parameters.ErrorThreshold;
+					Writer["default_virtual_vertex_distance"] = Parameters.DefaultVirtualVertexDistance;
+					Writer["safe_virtual_vertex_distance"] = Parameters.SafeVirtualVertexDistance;
+					Writer["compression_level"] = uint32(Parameters.CompressionLevel);
+					Writer["ideal_num_key_frames_per_segment"] = uint32(Parameters.IdealNumKeyFramesPerSegment);
+					Writer["max_num_key_frames_per_segment"] = uint32(Parameters.MaxNumKeyFramesPerSegment);
+
+					if (Result.bIsValid)
+					{
+						Writer["compressed_size"] = Result.CompressedSize;
+						Writer["max_error"] = Result.MaxError;
+						Writer["compression_time"] = Result.CompressionTimeSec;
+						Writer["decompression_ns_per_pose"] = Result.DecompressionNsPerPose;
+						Writer["is_pareto_optimal"] = Result.bIsParetoOptimal;
+					}
+					else
+					{
+						Writer["error"] = "failed to compress clip";
+					}
+				});
+		}
+	};
+}
+
+static void AppendSweepResultsCSV(const FACLParameterSweep& Sweep, const FString& Name, const TArray<FACLSweepResult>& Results, FString& OutCSV)
+{
+	for (int32 PointIndex = 0; PointIndex < Results.Num(); ++PointIndex)
+	{
+		const FACLSweepParameters& Parameters = Sweep.Grid[PointIndex];
+		const FACLSweepResult& Result = Results[PointIndex];
+		if (!Result.bIsValid)
+		{
+			continue;
+		}
+
+		OutCSV += FString::Printf(TEXT("%s,%f,%f,%f,%d,%u,%u,%llu,%f,%f,%f,%d\n"),
+			*Name, Parameters.ErrorThreshold, Parameters.DefaultVirtualVertexDistance, Parameters.SafeVirtualVertexDistance, int32(Parameters.CompressionLevel),
+			uint32(Parameters.IdealNumKeyFramesPerSegment), uint32(Parameters.MaxNumKeyFramesPerSegment),
+			Result.CompressedSize, Result.MaxError, Result.CompressionTimeSec, Result.DecompressionNsPerPose, Result.bIsParetoOptimal ? 1 : 0);
+	}
+}
+
+/**
+ * Compresses a clip with every set of parameters from the sweep grid.
+ * Bones flagged as safe (sockets and key end effectors) use the safe virtual vertex distance.
+ * The error is always measured against the original tracks so that every grid point is measured the same way.
+ */
+static void SweepClip(FACLParameterSweep& Sweep, const FString& ClipName, const acl::track_array_qvvf& Tracks, const TArray<bool>& SafeBones, const FString& OutputPath)
+{
+	const int32 NumPoints = Sweep.Grid.Num();
+	const uint32 NumTracks = Tracks.get_num_tracks();
+
+	TArray<FACLSweepResult> Results;
+	Results.SetNum(NumPoints);
+
+	TArray<acl::compressed_tracks*> CompressedClips;
+	CompressedClips.SetNumZeroed(NumPoints);
+
+	// Every grid point is independent, compress them in parallel
+	ParallelFor(NumPoints, [&](int32 PointIndex)
+		{
+			const FACLSweepParameters& Parameters = Sweep.Grid[PointIndex];
+
+			acl::track_array_qvvf SweepTracks(ACLAllocatorImpl, NumTracks);
+			for (uint32 TrackIndex = 0; TrackIndex < NumTracks; ++TrackIndex)
+			{
+				acl::track_qvvf Track = Tracks[TrackIndex].get_copy(ACLAllocatorImpl);
+
+				acl::track_desc_transformf& Desc = Track.get_description();
+				Desc.precision = Parameters.ErrorThreshold;
+				Desc.shell_distance = SafeBones.IsValidIndex(TrackIndex) && SafeBones[TrackIndex] ? Parameters.SafeVirtualVertexDistance : Parameters.DefaultVirtualVertexDistance;
+
+				SweepTracks[TrackIndex] = MoveTemp(Track);
+			}
+
+			acl::qvvf_transform_error_metric ErrorMetric;
+
+			acl::compression_settings Settings = acl::get_default_compression_settings();
+			Settings.level = GetCompressionLevel(Parameters.CompressionLevel);
+			Settings.segmenting.ideal_num_samples = Parameters.IdealNumKeyFramesPerSegment;
+			Settings.segmenting.max_num_samples = Parameters.MaxNumKeyFramesPerSegment;
+			Settings.error_metric = &ErrorMetric;
+
+			const uint64 StartTimeCycles = FPlatformTime::Cycles64();
+
+			acl::output_stats Stats;
+			acl::compressed_tracks* CompressedTracks = nullptr;
+			const acl::error_result CompressionResult = acl::compress_track_list(ACLAllocatorImpl, SweepTracks, Settings, CompressedTracks, Stats);
+
+			const uint64 ElapsedCycles = FPlatformTime::Cycles64() - StartTimeCycles;
+
+			if (CompressionResult.any())
+			{
+				UE_LOG(LogAnimationCompression, Warning, TEXT("Failed to compress [%s] during the sweep: %s"), *ClipName, ANSI_TO_TCHAR(CompressionResult.c_str()));
+				return;
+			}
+
+			acl::decompression_context<acl::debug_transform_decompression_settings> Context;
+			Context.initialize(*CompressedTracks);
+			const acl::track_error TrackError = acl::calculate_compression_error(ACLAllocatorImpl, Tracks, Context, ErrorMetric);
+
+			FACLSweepResult& Result = Results[PointIndex];
+			Result.CompressedSize = CompressedTracks->get_size();
+			Result.MaxError = TrackError.error;
+			Result.CompressionTimeSec = FPlatformTime::ToSeconds64(ElapsedCycles);
+			Result.bIsValid = true;
+
+			CompressedClips[PointIndex] = CompressedTracks;
+		});
+
+	// Decompression is timed serially, contention between threads would skew the results
+	TArray<rtm::qvvf> Pose;
+	Pose.AddUninitialized(NumTracks);
+	SimpleTransformWriter PoseWriter(Pose);
+
+	for (int32 PointIndex = 0; PointIndex < NumPoints; ++PointIndex)
+	{
+		acl::compressed_tracks* CompressedTracks = CompressedClips[PointIndex];
+		if (CompressedTracks == nullptr)
+		{
+			continue;
+		}
+
+		acl::decompression_context<UE4DefaultDecompressionSettings> Context;
+		Context.initialize(*CompressedTracks);
+
+		const float Duration = CompressedTracks->get_duration();
+
+		double BestNsPerPose = TNumericLimits<double>::Max();
+		for (int32 PassIndex = 0; PassIndex < NumSweepDecompressionPasses; ++PassIndex)
+		{
+			const uint64 StartTimeCycles = FPlatformTime::Cycles64();
+
+			for (int32 PoseIndex = 0; PoseIndex < NumSweepDecompressionPoses; ++PoseIndex)
+			{
+				Context.seek((Duration * PoseIndex) / NumSweepDecompressionPoses, acl::sample_rounding_policy::none);
+				Context.decompress_tracks(PoseWriter);
+			}
+
+			const uint64 ElapsedCycles = FPlatformTime::Cycles64() - StartTimeCycles;
+			BestNsPerPose = FMath::Min(BestNsPerPose, (FPlatformTime::ToSeconds64(ElapsedCycles) * 1.0e9) / NumSweepDecompressionPoses);
+		}
+
+		Results[PointIndex].DecompressionNsPerPose = BestNsPerPose;
+
+		ACLAllocatorImpl.deallocate(CompressedTracks, CompressedTracks->get_size());
+	}
+
+	FindParetoFrontier(Results);
+
+	// Accumulate our project wide results
+	for (int32 PointIndex = 0; PointIndex < NumPoints; ++PointIndex)
+	{
+		const FACLSweepResult& Result = Results[PointIndex];
+		FACLSweepResult& ProjectResult = Sweep.ProjectResults[PointIndex];
+
+		ProjectResult.bIsValid &= Result.bIsValid;
+		ProjectResult.CompressedSize += Result.CompressedSize;
+		ProjectResult.MaxError = FMath::Max(ProjectResult.MaxError, Result.MaxError);
+		ProjectResult.CompressionTimeSec += Result.CompressionTimeSec;
+		ProjectResult.DecompressionNsPerPose += Result.DecompressionNsPerPose;
+	}
+
+	AppendSweepResultsCSV(Sweep, ClipName, Results, Sweep.ClipResultsCSV);
+	Sweep.NumClips++;
+
+	FArchive* OutputWriter = IFileManager::Get().CreateFileWriter(*OutputPath);
+	if (OutputWriter != nullptr)
+	{
+		UE4SJSONStreamWriter StreamWriter(OutputWriter);
+		sjson::Writer Writer(StreamWriter);
+
+		Writer["clip"] = TCHAR_TO_ANSI(*ClipName);
+		Writer["num_tracks"] = NumTracks;
+		Writer["num_samples"] = Tracks.get_num_samples_per_track();
+		Writer["acl_raw_size"] = Tracks.get_raw_size();
+		WriteSweepResults(Sweep, Results, Writer);
+
+		OutputWriter->Close();
+		delete OutputWriter;
+	}
+}
+
+/** Writes the project wide results and the CSV of every clip result. */
+static void WriteSweepProjectResults(FACLParameterSweep& Sweep, const FString& OutputDir)
+{
+	FindParetoFrontier(Sweep.ProjectResults);
+
+	FArchive* OutputWriter = IFileManager::Get().CreateFileWriter(*FPaths::Combine(*OutputDir, TEXT("sweep_project.sjson")));
+	if (OutputWriter != nullptr)
+	{
+		UE4SJSONStreamWriter StreamWriter(OutputWriter);
+		sjson::Writer Writer(StreamWriter);
+
+		Writer["num_clips"] = Sweep.NumClips;
+		WriteSweepResults(Sweep, Sweep.ProjectResults, Writer);
+
+		OutputWriter->Close();
+		delete OutputWriter;
+	}
+
+	FString ProjectResultsCSV = SweepCSVHeader;
+	AppendSweepResultsCSV(Sweep, TEXT("<project>"), Sweep.ProjectResults, ProjectResultsCSV);
+	FFileHelper::SaveStringToFile(ProjectResultsCSV, *FPaths::Combine(*OutputDir, TEXT("sweep_project.csv")));
+	FFileHelper::SaveStringToFile(FString(SweepCSVHeader) + Sweep.ClipResultsCSV, *FPaths::Combine(*OutputDir, TEXT("sweep_clips.csv")));
+
+	int32 NumParetoOptimal = 0;
+	for (int32 PointIndex = 0; PointIndex < Sweep.ProjectResults.Num(); ++PointIndex)
+	{
+		const FACLSweepParameters& Parameters = Sweep.Grid[PointIndex];
+		const FACLSweepResult& Result = Sweep.ProjectResults[PointIndex];
+		if (Result.bIsParetoOptimal)
+		{
+			UE_LOG(LogAnimationCompression, Display, TEXT("Pareto optimal: ErrorThreshold=%.4f VirtualVertexDistance=%.1f SafeVirtualVertexDistance=%.1f Level=%d Segments=%u:%u -> %llu bytes, %.4f cm"),
+				Parameters.ErrorThreshold, Parameters.DefaultVirtualVertexDistance, Parameters.SafeVirtualVertexDistance, int32(Parameters.CompressionLevel),
+				uint32(Parameters.IdealNumKeyFramesPerSegment), uint32(Parameters.MaxNumKeyFramesPerSegment), Result.CompressedSize, Result.MaxError);
+			NumParetoOptimal++;
+		}
+	}
+
+	UE_LOG(LogAnimationCompression, Display, TEXT("Swept %d parameter combinations over %d clips, %d are Pareto optimal project wide"), Sweep.Grid.Num(), Sweep.NumClips, NumParetoOptimal);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Database visual fidelity
+
+/** The visual fidelity levels we measure, in the order the database tiers stream in. */
+static constexpr int32 NumDatabaseFidelities = 3;
+static const char* DatabaseFidelityKeys[NumDatabaseFidelities] = { "lowest", "medium", "highest" };
+
+static const TCHAR* DatabaseCSVHeader = TEXT("clip,lowest_importance_proportion,medium_importance_proportion,fidelity,size,max_error\n");
+
+/** A clip added to the database. */
+struct FACLDatabaseClip
+{
+	FString Name;
+	acl::track_array_qvvf Tracks;
+
+	/** Compressed with the codec settings and the contributing error required by the database. */
+	acl::compressed_tracks* CompressedTracks = nullptr;
+};
+
+/** The tier proportions of a database we build. */
+struct FACLDatabaseProportions
+{
+	float LowestImportanceProportion;
+	float MediumImportanceProportion;
+};
+
+/** The measurements of a clip in a database, at every visual fidelity. */
+struct FACLDatabaseClipResult
+{
+	uint32 ResidentSize = 0;
+	uint64 Size[NumDatabaseFidelities] = {};
+	float MaxError[NumDatabaseFidelities] = {};
+	bool bIsValid = false;
+};
+
+/** The measurements of a database built with a set of tier proportions. */
+struct FACLDatabaseMeasurement
+{
+	FACLDatabaseProportions Proportions;
+	TArray<FACLDatabaseClipResult> ClipResults;
+
+	uint64 ResidentSize = 0;
+	uint32 BulkDataSizeMedium = 0;
+	uint32 BulkDataSizeLow = 0;
+};
+
+/** The state of the database fidelity measurements, clips are gathered first and the databases are built once we have them all. */
+struct FACLDatabaseFidelity
+{
+	/** Every set of tier proportions we build a database with. */
+	TArray<FACLDatabaseProportions> Proportions;
+
+	TArray<FACLDatabaseClip> Clips;
+};
+
+static void BuildDatabaseProportions(const TMap<FString, FString>& ParamsMap, FACLDatabaseFidelity& DatabaseFidelity)
+{
+	// The defaults match those of the database asset
+	TArray<FString> LowestImportanceProportions;
+	ParseSweepValues(ParamsMap, TEXT("DatabaseLowestProportions"), TEXT("0.5"), LowestImportanceProportions);
+
+	const FString* MediumImportanceProportion = ParamsMap.Find(TEXT("DatabaseMediumProportion"));
+
+	for (const FString& LowestImportanceProportion : LowestImportanceProportions)
+	{
+		FACLDatabaseProportions Proportions;
+		Proportions.LowestImportanceProportion = FMath::Clamp(FCString::Atof(*LowestImportanceProportion), 0.0f, 1.0f);
+		Proportions.MediumImportanceProportion = MediumImportanceProportion != nullptr ? FMath::Clamp(FCString::Atof(**MediumImportanceProportion), 0.0f, 1.0f - Proportions.LowestImportanceProportion) : 0.0f;
+		DatabaseFidelity.Proportions.Add(Proportions);
+	}
+}
+
+static void AddDatabaseClip(FACLDatabaseFidelity& DatabaseFidelity, const FString& ClipName, acl::track_array_qvvf&& Tracks)
+{
+	FACLDatabaseClip& Clip = DatabaseFidelity.Clips.AddDefaulted_GetRef();
+	Clip.Name = ClipName;
+	Clip.Tracks = MoveTemp(Tracks);
+}
+
+/** Streams a tier in or out of a database with inline bulk data, requests complete right away. */
+static bool StreamDatabaseTier(acl::database_context<UE4DefaultDatabaseSettings>& Context, acl::quality_tier Tier, bool bStreamIn)
+{
+	// The first request dispatches and completes, the next one reports that we are done
+	for (int32 Attempt = 0; Attempt < 4; ++Attempt)
+	{
+		const acl::database_stream_request_result Result = bStreamIn ? Context.stream_in(Tier) : Context.stream_out(Tier);
+		if (Result == acl::database_stream_request_result::done)
+		{
+			return true;
+		}
+
+		if (Result != acl::database_stream_request_result::dispatched)
+		{
+			return false;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * Builds a database with the provided tier proportions and measures the error of every clip at every visual fidelity.
+ * A clip size at a visual fidelity is what remains in the clip plus its share of the tiers streamed in. A clip's share
+ * of a tier is estimated from the bytes it moved to the database.
+ */
+static bool MeasureDatabaseProportions(const FACLDatabaseFidelity& DatabaseFidelity, const FACLDatabaseProportions& Proportions, TArray<FACLDatabaseClipResult>& OutResults, uint32& OutBulkDataSizeMedium, uint32& OutBulkDataSizeLow)
+{
+	TArray<const acl::compressed_tracks*> InputCompressedTracks;
+	TArray<int32> ClipIndices;
+	for (int32 ClipIndex = 0; ClipIndex < DatabaseFidelity.Clips.Num(); ++ClipIndex)
+	{
+		if (DatabaseFidelity.Clips[ClipIndex].CompressedTracks != nullptr)
+		{
+			InputCompressedTracks.Add(DatabaseFidelity.Clips[ClipIndex].CompressedTracks);
+			ClipIndices.Add(ClipIndex);
+		}
+	}
+
+	OutResults.Reset();
+	OutResults.SetNum(DatabaseFidelity.Clips.Num());
+
+	const int32 NumSequences = InputCompressedTracks.Num();
+	if (NumSequences == 0)
+	{
+		return false;
+	}
+
+	acl::compression_database_settings Settings;	// Use defaults
+	Settings.low_importance_tier_proportion = Proportions.LowestImportanceProportion;
+	Settings.medium_importance_tier_proportion = Proportions.MediumImportanceProportion;
+
+	TArray<acl::compressed_tracks*> DBCompressedTracks;
+	DBCompressedTracks.AddZeroed(NumSequences);
+
+	acl::compressed_database* MergedDB = nullptr;
+	const acl::error_result MergeResult = acl::build_database(ACLAllocatorImpl, Settings, InputCompressedTracks.GetData(), NumSequences, DBCompressedTracks.GetData(), MergedDB);
+	if (MergeResult.any())
+	{
+		UE_LOG(LogAnimationCompression, Warning, TEXT("ACL failed to build the database: %s"), ANSI_TO_TCHAR(MergeResult.c_str()));
+		return false;
+	}
+
+	OutBulkDataSizeMedium = MergedDB->get_bulk_data_size(acl::quality_tier::medium_importance);
+	OutBulkDataSizeLow = MergedDB->get_bulk_data_size(acl::quality_tier::lowest_importance);
+
+	uint64 TotalMovedSize = 0;
+	for (int32 SequenceIndex = 0; SequenceIndex < NumSequences; ++SequenceIndex)
+	{
+		const uint32 OriginalSize = InputCompressedTracks[SequenceIndex]->get_size();
+		const uint32 ResidentSize = DBCompressedTracks[SequenceIndex]->get_size();
+		TotalMovedSize += OriginalSize > ResidentSize ? (OriginalSize - ResidentSize) : 0;
+	}
+
+	acl::database_context<UE4DefaultDatabaseSettings> DatabaseContext;
+	const bool ContextInitResult = DatabaseContext.initialize(ACLAllocatorImpl, *MergedDB);
+
+	// Start with nothing streamed in, the lowest visual fidelity
+	bool bIsStreamingValid = ContextInitResult
+		&& StreamDatabaseTier(DatabaseContext, acl::quality_tier::lowest_importance, false)
+		&& StreamDatabaseTier(DatabaseContext, acl::quality_tier::medium_importance, false);
+
+	for (int32 FidelityIndex = 0; FidelityIndex < NumDatabaseFidelities && bIsStreamingValid; ++FidelityIndex)
+	{
+		if (FidelityIndex == 1)
+		{
+			bIsStreamingValid = StreamDatabaseTier(DatabaseContext, acl::quality_tier::medium_importance, true);
+		}
+		else if (FidelityIndex == 2)
+		{
+			bIsStreamingValid = StreamDatabaseTier(DatabaseContext, acl::quality_tier::lowest_importance, true);
+		}
+
+		if (!bIsStreamingValid)
+		{
+			break;
+		}
+
+		// The tiers streamed in at this visual fidelity
+		const uint64 StreamedInSize = (FidelityIndex >= 1 ? OutBulkDataSizeMedium : 0) + (FidelityIndex >= 2 ? OutBulkDataSizeLow : 0);
+
+		// The database context isn't modified while we decompress, every clip is independent
+		ParallelFor(NumSequences, [&](int32 SequenceIndex)
+			{
+				const acl::qvvf_transform_error_metric ErrorMetric;
+
+				acl::decompression_context<UE4DefaultDBDecompressionSettings> Context;
+				Context.initialize(*DBCompressedTracks[SequenceIndex], DatabaseContext);
+
+				const acl::track_error TrackError = acl::calculate_compression_error(ACLAllocatorImpl, DatabaseFidelity.Clips[ClipIndices[SequenceIndex]].Tracks, Context, ErrorMetric);
+
+				const uint32 OriginalSize = InputCompressedTracks[SequenceIndex]->get_size();
+				const uint32 ResidentSize = DBCompressedTracks[SequenceIndex]->get_size();
+				const uint64 MovedSize = OriginalSize > ResidentSize ? (OriginalSize - ResidentSize) : 0;
+
+				FACLDatabaseClipResult& Result = OutResults[ClipIndices[SequenceIndex]];
+				Result.ResidentSize = ResidentSize;
+				Result.Size[FidelityIndex] = ResidentSize + (TotalMovedSize != 0 ? (StreamedInSize * MovedSize) / TotalMovedSize : 0);
+				Result.MaxError[FidelityIndex] = TrackError.error;
+			});
+	}
+
+	if (bIsStreamingValid)
+	{
+		for (int32 ClipIndex : ClipIndices)
+		{
+			OutResults[ClipIndex].bIsValid = true;
+		}
+	}
+	else
+	{
+		UE_LOG(LogAnimationCompression, Warning, TEXT("ACL failed to stream the database tiers"));
+	}
+
+	DatabaseContext.reset();
+
+	for (acl::compressed_tracks* CompressedTracks : DBCompressedTracks)
+	{
+		ACLAllocatorImpl.deallocate(CompressedTracks, CompressedTracks->get_size());
+	}
+
+	ACLAllocatorImpl.deallocate(MergedDB, MergedDB->get_size());
+
+	return bIsStreamingValid;
+}
+
+/**
+ * Compresses every clip for the database, then builds a database for every set of tier proportions and writes
+ * the size and error of every clip at every visual fidelity. The error is always measured against the original tracks.
+ */
+static void MeasureDatabaseFidelity(FACLDatabaseFidelity& DatabaseFidelity, const UAnimBoneCompressionCodec_ACL& Codec, const FString& OutputDir)
+{
+	acl::compression_settings CodecSettings;
+	Codec.GetCompressionSettings(CodecSettings);
+
+	const float ErrorThreshold = Codec.GetErrorThresholdForPlatform();
+
+	ParallelFor(DatabaseFidelity.Clips.Num(), [&](int32 ClipIndex)
+		{
+			FACLDatabaseClip& Clip = DatabaseFidelity.Clips[ClipIndex];
+
+			const uint32 NumTracks = Clip.Tracks.get_num_tracks();
+			for (uint32 TrackIndex = 0; TrackIndex < NumTracks; ++TrackIndex)
+			{
+				Clip.Tracks[TrackIndex].get_description().precision = ErrorThreshold;
+			}
+
+			acl::qvvf_transform_error_metric ErrorMetric;
+
+			// Required to be able to determine the importance of every keyframe
+			acl::compression_settings Settings = CodecSettings;
+			Settings.include_contributing_error = true;
+			Settings.error_metric = &ErrorMetric;
+
+			acl::output_stats Stats;
+			const acl::error_result CompressionResult = acl::compress_track_list(ACLAllocatorImpl, Clip.Tracks, Settings, Clip.CompressedTracks, Stats);
+			if (CompressionResult.any())
+			{
+				UE_LOG(LogAnimationCompression, Warning, TEXT("Failed to compress [%s] for the database: %s"), *Clip.Name, ANSI_TO_TCHAR(CompressionResult.c_str()));
+				Clip.CompressedTracks = nullptr;
+			}
+		});
+
+	TArray<FACLDatabaseMeasurement> Measurements;
+	for (const FACLDatabaseProportions& Proportions : DatabaseFidelity.Proportions)
+	{
+		FACLDatabaseMeasurement Measurement;
+		Measurement.Proportions = Proportions;
+		if (!MeasureDatabaseProportions(DatabaseFidelity, Proportions, Measurement.ClipResults, Measurement.BulkDataSizeMedium, Measurement.BulkDataSizeLow))
+		{
+			continue;
+		}
+
+		float WorstError[NumDatabaseFidelities] = {};
+		int32 NumValidClips = 0;
+		for (const FACLDatabaseClipResult& Result : Measurement.ClipResults)
+		{
+			if (Result.bIsValid)
+			{
+				Measurement.ResidentSize += Result.ResidentSize;
+				NumValidClips++;
+
+				for (int32 FidelityIndex = 0; FidelityIndex < NumDatabaseFidelities; ++FidelityIndex)
+				{
+					WorstError[FidelityIndex] = FMath::Max(WorstError[FidelityIndex], Result.MaxError[FidelityIndex]);
+				}
+			}
+		}
+
+		UE_LOG(LogAnimationCompression, Display, TEXT("Database LowestImportanceProportion=%.2f MediumImportanceProportion=%.2f: %llu bytes resident, %u bytes medium tier, %u bytes lowest tier"),
+			Proportions.LowestImportanceProportion, Proportions.MediumImportanceProportion, Measurement.ResidentSize, Measurement.BulkDataSizeMedium, Measurement.BulkDataSizeLow);
+		UE_LOG(LogAnimationCompression, Display, TEXT("    worst error over %d clips: lowest %.4f cm, medium %.4f cm, highest %.4f cm"),
+			NumValidClips, WorstError[0], WorstError[1], WorstError[2]);
+
+		Measurements.Add(MoveTemp(Measurement));
+	}
+
+	FArchive* OutputWriter = IFileManager::Get().CreateFileWriter(*FPaths::Combine(*OutputDir, TEXT("database_fidelity.sjson")));
+	if (OutputWriter != nullptr)
+	{
+		UE4SJSONStreamWriter StreamWriter(OutputWriter);
+		sjson::Writer Writer(StreamWriter);
+
+		Writer["num_clips"] = DatabaseFidelity.Clips.Num();
+		Writer["databases"] = [&](sjson::ArrayWriter& Writer)
+		{
+			for (const FACLDatabaseMeasurement& Measurement : Measurements)
+			{
+				Writer.push([&](sjson::ObjectWriter& Writer)
+					{
+						Writer["lowest_importance_proportion"] = Measurement.Proportions.LowestImportanceProportion;
+						Writer["medium_importance_proportion"] = Measurement.Proportions.MediumImportanceProportion;
+						Writer["resident_size"] = Measurement.ResidentSize;
+						Writer["medium_tier_size"] = Measurement.BulkDataSizeMedium;
+						Writer["lowest_tier_size"] = Measurement.BulkDataSizeLow;
+
+						Writer["clips"] = [&](sjson::ArrayWriter& Writer)
+						{
+							for (int32 ClipIndex = 0; ClipIndex < Measurement.ClipResults.Num(); ++ClipIndex)
+							{
+								const FACLDatabaseClipResult& Result = Measurement.ClipResults[ClipIndex];
+								if (!Result.bIsValid)
+								{
+									continue;
+								}
+
+								Writer.push([&](sjson::ObjectWriter& Writer)
+									{
+										Writer["clip"] = TCHAR_TO_ANSI(*DatabaseFidelity.Clips[ClipIndex].Name);
+										Writer["resident_size"] = Result.ResidentSize;
+
+										for (int32 FidelityIndex = 0; FidelityIndex < NumDatabaseFidelities; ++FidelityIndex)
+										{
+											Writer[DatabaseFidelityKeys[FidelityIndex]] = [&](sjson::ObjectWriter& Writer)
+											{
+												Writer["size"] = Result.Size[FidelityIndex];
+												Writer["max_error"] = Result.MaxError[FidelityIndex];
+											};
+										}
+									});
+							}
+						};
+					});
+			}
+		};
+
+		OutputWriter->Close();
+		delete OutputWriter;
+	}
+
+	FString ClipResultsCSV = DatabaseCSVHeader;
+	for (const FACLDatabaseMeasurement& Measurement : Measurements)
+	{
+		for (int32 ClipIndex = 0; ClipIndex < Measurement.ClipResults.Num(); ++ClipIndex)
+		{
+			const FACLDatabaseClipResult& Result = Measurement.ClipResults[ClipIndex];
+			if (!Result.bIsValid)
+			{
+				continue;
+			}
+
+			for (int32 FidelityIndex = 0; FidelityIndex < NumDatabaseFidelities; ++FidelityIndex)
+			{
+				ClipResultsCSV += FString::Printf(TEXT("%s,%f,%f,%s,%llu,%f\n"),
+					*DatabaseFidelity.Clips[ClipIndex].Name, Measurement.Proportions.LowestImportanceProportion, Measurement.Proportions.MediumImportanceProportion,
+					ANSI_TO_TCHAR(DatabaseFidelityKeys[FidelityIndex]), Result.Size[FidelityIndex], Result.MaxError[FidelityIndex]);
+			}
+		}
+	}
+
+	FFileHelper::SaveStringToFile(ClipResultsCSV, *FPaths::Combine(*OutputDir, TEXT("database_fidelity.csv")));
+
+	for (FACLDatabaseClip& Clip : DatabaseFidelity.Clips)
+	{
+		if (Clip.CompressedTracks != nullptr)
+		{
+			ACLAllocatorImpl.deallocate(Clip.CompressedTracks, Clip.CompressedTracks->get_size());
+			Clip.CompressedTracks = nullptr;
+		}
+	}
+}
+
 struct CompressAnimationsFunctor
 {
 	template<typename ObjectType>
@@ -1038,6 +1680,14 @@ struct CompressAnimationsFunctor
 			{
 				Filename = FString::Printf(TEXT("%X.acl.sjson"), GetTypeHash(Filename));
 			}
+			else if (StatsCommandlet->PerformSweep)
+			{
+				Filename = FString::Printf(TEXT("%X_sweep.sjson"), GetTypeHash(Filename));
+			}
+			else if (StatsCommandlet->PerformDatabase)
+			{
+				Filename = TEXT("database_fidelity.sjson");
+			}
 
 			FString UE4OutputPath = FPaths::Combine(*StatsCommandlet->OutputDir, *Filename).Replace(TEXT("/"), TEXT("\\"));
 
@@ -1060,12 +1710,39 @@ struct CompressAnimationsFunctor
 
 			FCompressibleAnimData CompressibleData(UE4Clip, false);
 
-			acl::track_array_qvvf ACLTracks = BuildACLTransformTrackArray(ACLAllocatorImpl, CompressibleData, StatsCommandlet->ACLCodec->DefaultVirtualVertexDistance, StatsCommandlet->ACLCodec->SafeVirtualVertexDistance, false);
+			acl::track_array_qvvf ACLTracks = BuildACLTransformTrackArray(ACLAllocatorImpl, CompressibleData, StatsCommandlet->ACLCodec->GetDefaultVirtualVertexDistanceForPlatform(), StatsCommandlet->ACLCodec->GetSafeVirtualVertexDistanceForPlatform(), false);
 
 			// TODO: Add support for additive clips
 			//acl::track_array_qvvf ACLBaseTracks;
 			//if (CompressibleData.bIsValidAdditive)
-				//ACLBaseTracks = BuildACLTransformTrackArray(Allocator, CompressibleData, StatsCommandlet->ACLCodec->DefaultVirtualVertexDistance, StatsCommandlet->ACLCodec->SafeVirtualVertexDistance, true);
+				//ACLBaseTracks = BuildACLTransformTrackArray(Allocator, CompressibleData, StatsCommandlet->ACLCodec->GetDefaultVirtualVertexDistanceForPlatform(), StatsCommandlet->ACLCodec->GetSafeVirtualVertexDistanceForPlatform(), true);
+
+			if (StatsCommandlet->PerformSweep)
+			{
+				UE_LOG(LogAnimationCompression, Verbose, TEXT("Sweeping: %s (%d / %d)"), *UE4Clip->GetPathName(), SequenceIndex, NumAnimSequences);
+
+				// Bones with sockets or that are key end effectors use the safe virtual vertex distance
+				TArray<bool> SafeBones;
+				for (const FBoneData& BoneData : CompressibleData.BoneData)
+				{
+					SafeBones.Add(BoneData.bHasSocket || BoneData.bKeyEndEffector);
+				}
+
+				SweepClip(*StatsCommandlet->Sweep, UE4Clip->GetPathName(), ACLTracks, SafeBones, UE4OutputPath);
+
+				UE4Clip->RecycleAnimSequence();
+				continue;
+			}
+
+			if (StatsCommandlet->PerformDatabase)
+			{
+				UE_LOG(LogAnimationCompression, Verbose, TEXT("Adding to the database: %s (%d / %d)"), *UE4Clip->GetPathName(), SequenceIndex, NumAnimSequences);
+
+				AddDatabaseClip(*StatsCommandlet->DatabaseFidelity, UE4Clip->GetPathName(), MoveTemp(ACLTracks));
+
+				UE4Clip->RecycleAnimSequence();
+				continue;
+			}
 
 			Context.ACLTracks = MoveTemp(ACLTracks);
 			Context.ACLRawSize = Context.ACLTracks.get_raw_size();
@@ -1159,6 +1836,8 @@ int32 UACLStatsDumpCommandlet::Main(const FString& Params)
 	PerformExhaustiveDump = Switches.Contains(TEXT("error"));
 	PerformCompression = Switches.Contains(TEXT("compress"));
 	PerformClipExtraction = Switches.Contains(TEXT("extract"));
+	PerformSweep = Switches.Contains(TEXT("sweep"));
+	PerformDatabase = Switches.Contains(TEXT("database"));
 	TryAutomaticCompression = Switches.Contains(TEXT("auto"));
 	TryACLCompression = Switches.Contains(TEXT("acl"));
 	TryKeyReductionRetarget = Switches.Contains(TEXT("keyreductionrt"));
@@ -1173,15 +1852,27 @@ int32 UACLStatsDumpCommandlet::Main(const FString& Params)
 		SkipAdditiveClips = true;
 	}
 
-	if (PerformCompression && PerformClipExtraction)
+	if (int32(PerformCompression) + int32(PerformClipExtraction) + int32(PerformSweep) + int32(PerformDatabase) > 1)
 	{
-		UE_LOG(LogAnimationCompression, Error, TEXT("Cannot compress and extract clips at the same time"));
+		UE_LOG(LogAnimationCompression, Error, TEXT("Cannot compress, extract, sweep, or build a database with clips at the same time"));
 		return 0;
 	}
 
-	if (!PerformCompression && !PerformClipExtraction)
+	if (!PerformCompression && !PerformClipExtraction && !PerformSweep && !PerformDatabase)
 	{
-		UE_LOG(LogAnimationCompression, Error, TEXT("Must compress or extract clips"));
+		UE_LOG(LogAnimationCompression, Error, TEXT("Must compress, extract, sweep, or build a database with clips"));
+		return 0;
+	}
+
+	if (PerformSweep && ResumeTask)
+	{
+		UE_LOG(LogAnimationCompression, Error, TEXT("Cannot resume a sweep, project wide results require every clip"));
+		return 0;
+	}
+
+	if (PerformDatabase && ResumeTask)
+	{
+		UE_LOG(LogAnimationCompression, Error, TEXT("Cannot resume a database measurement, the database requires every clip"));
 		return 0;
 	}
 
@@ -1205,7 +1896,7 @@ int32 UACLStatsDumpCommandlet::Main(const FString& Params)
 		}
 	}
 
-	if (TryACLCompression || !HasInput)
+	if (TryACLCompression || PerformDatabase || !HasInput)
 	{
 		ACLCompressionSettings = NewObject<UAnimBoneCompressionSettings>(this, UAnimBoneCompressionSettings::StaticClass());
 		ACLCodec = NewObject<UAnimBoneCompressionCodec_ACL>(this, UAnimBoneCompressionCodec_ACL::StaticClass());
@@ -1229,17 +1920,30 @@ int32 UACLStatsDumpCommandlet::Main(const FString& Params)
 	FFileManagerGeneric FileManager;
 	FileManager.MakeDirectory(*OutputDir, true);
 
+	FACLParameterSweep SweepState;
+	if (PerformSweep)
+	{
+		BuildSweepGrid(ParamsMap, SweepState);
+		Sweep = &SweepState;
+	}
+
+	FACLDatabaseFidelity DatabaseFidelityState;
+	if (PerformDatabase)
+	{
+		BuildDatabaseProportions(ParamsMap, DatabaseFidelityState);
+		DatabaseFidelity = &DatabaseFidelityState;
+	}
+
 	if (!HasInput)
 	{
 		// No source directory, use the current project instead
 		ACLRawDir = TEXT("");
 
 		DoActionToAllPackages<UAnimSequence, CompressAnimationsFunctor>(this, Params.ToUpper());
-		return 0;
 	}
 	else
 	{
-		check(PerformCompression);
+		check(PerformCompression || PerformSweep || PerformDatabase);
 
 		// Use source directory
 		ACLRawDir = ParamsMap[TEXT("input")];
@@ -1263,6 +1967,40 @@ int32 UACLStatsDumpCommandlet::Main(const FString& Params)
 				continue;
 			}
 
+			if (PerformSweep)
+			{
+				UE_LOG(LogAnimationCompression, Verbose, TEXT("Sweeping: %s"), *Filename);
+
+				acl::track_array_qvvf ACLTracks;
+				const TCHAR* ErrorMsg = ReadACLClip(FileManager, ACLClipPath, ACLAllocatorImpl, ACLTracks);
+				if (ErrorMsg != nullptr)
+				{
+					UE_LOG(LogAnimationCompression, Warning, TEXT("%s: %s"), ErrorMsg, *Filename);
+					continue;
+				}
+
+				// Raw clips do not retain which bones have sockets, every bone uses the default virtual vertex distance
+				const FString SweepPath = FPaths::Combine(*OutputDir, *Filename.Replace(TEXT(".acl.sjson"), TEXT("_sweep.sjson"), ESearchCase::CaseSensitive));
+				SweepClip(SweepState, Filename, ACLTracks, TArray<bool>(), SweepPath);
+				continue;
+			}
+
+			if (PerformDatabase)
+			{
+				UE_LOG(LogAnimationCompression, Verbose, TEXT("Adding to the database: %s"), *Filename);
+
+				acl::track_array_qvvf ACLTracks;
+				const TCHAR* ErrorMsg = ReadACLClip(FileManager, ACLClipPath, ACLAllocatorImpl, ACLTracks);
+				if (ErrorMsg != nullptr)
+				{
+					UE_LOG(LogAnimationCompression, Warning, TEXT("%s: %s"), ErrorMsg, *Filename);
+					continue;
+				}
+
+				AddDatabaseClip(DatabaseFidelityState, Filename, MoveTemp(ACLTracks));
+				continue;
+			}
+
 			UE_LOG(LogAnimationCompression, Verbose, TEXT("Compressing: %s"), *Filename);
 
 			FArchive* StatWriter = FileManager.CreateFileWriter(*UE4StatPath);
@@ -1344,5 +2082,17 @@ int32 UACLStatsDumpCommandlet::Main(const FString& Params)
 		}
 	}
 
+	if (PerformSweep)
+	{
+		WriteSweepProjectResults(SweepState, OutputDir);
+		Sweep = nullptr;
+	}
+
+	if (PerformDatabase)
+	{
+		MeasureDatabaseFidelity(DatabaseFidelityState, *ACLCodec, OutputDir);
+		DatabaseFidelity = nullptr;
+	}
+
 	return 0;
 }